@@ -67,6 +67,10 @@ Texture *assets_get_texture(Assets *assets, AssetID id) {
         AssetFont *font = assets_get_font(assets, id);
         result = &font->texture;
     } else if (asset->file_info.kind == ASSET_KIND_TEXTURE) {
+        // Evicted texture is packed in atlas again from mipmaps that are kept
+        if (asset->state == ASSET_STATE_LOADED && !renderer_use_texture(assets->renderer, asset->texture.texture)) {
+            asset->state = ASSET_STATE_UNLOADED;
+        }
         while (asset->state != ASSET_STATE_LOADED) {
             if (!asset->texture.mipmaps) {
                 void *pixels = alloc(assets->frame_arena, asset->file_info.data_size);
@@ -88,6 +92,9 @@ AssetFont *assets_get_font(Assets *assets, AssetID id) {
     
     Asset *asset = assets->asset_infos + id.value;
     assert(asset->file_info.kind == ASSET_KIND_FONT);    
+    if (asset->state == ASSET_STATE_LOADED && !renderer_use_texture(assets->renderer, asset->font.texture)) {
+        asset->state = ASSET_STATE_UNLOADED;
+    }
     while (asset->state != ASSET_STATE_LOADED) {
         if (!asset->font.glyphs || !asset->font.atlas_mipmaps) {
             void *data = alloc(assets->frame_arena, asset->file_info.data_size);
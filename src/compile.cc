@@ -50,14 +50,20 @@ extern "C" {
 
 #include "debug.cc"
 #include "mips.cc"
+#include "texture_atlas.cc"
 #include "renderer.cc"
 #include "render_group.cc"
 #include "assets.cc"
 #include "dev_ui.cc"
 #include "world.cc"
+#include "noise.cc"
+#include "world_generation.cc"
 #include "sim_region.cc"
 #include "world_state.cc"
 #include "orders.cc"
+#include "scheduler.cc"
+#include "utility_ai.cc"
+#include "entity_commands.cc"
 #include "particle_system.cc"
 #include "game.cc"
 #include "interface.cc"
@@ -31,6 +31,31 @@ static DebugValue *get_debug_value(DebugState *debug_state) {
     return value;
 }
 
+static u32 get_debug_thread_index(DebugState *debug_state, u32 thread_id) {
+    u32 result = 0;
+    while (result < debug_state->thread_count && debug_state->threads[result].thread_id != thread_id) {
+        ++result;
+    }
+    if (result == debug_state->thread_count) {
+        assert(debug_state->thread_count < DEBUG_MAX_THREAD_COUNT);
+        DebugThread *thread = debug_state->threads + debug_state->thread_count++;
+        thread->thread_id = thread_id;
+        thread->current_open_block = 0;
+    }
+    return result;
+}
+
+static void add_timeline_span(DebugFrameThread *frame_thread, u64 begin_clock, u64 end_clock) {
+    frame_thread->busy_clocks += end_clock - begin_clock;
+    if (frame_thread->span_count < DEBUG_MAX_TIMELINE_SPAN_COUNT) {
+        DebugTimelineSpan *span = frame_thread->spans + frame_thread->span_count++;
+        span->begin_clock = begin_clock;
+        span->end_clock = end_clock;
+    } else {
+        frame_thread->spans[DEBUG_MAX_TIMELINE_SPAN_COUNT - 1].end_clock = end_clock;
+    }
+}
+
 static void debug_collate_events(DebugState *debug_state, u32 invalid_event_array_index) {
     // Free values and value blocks
     DebugValueBlock *value_block_stack[DEBUG_VALUE_BLOCK_MAX_DEPTH] = {};
@@ -92,6 +117,7 @@ static void debug_collate_events(DebugState *debug_state, u32 invalid_event_arra
                     collation_frame->frame_index = debug_state->total_frame_count;
                 } break;
                 case DEBUG_EVENT_BEGIN_BLOCK: {
+                    DebugThread *thread = debug_state->threads + get_debug_thread_index(debug_state, event->thread_id);
                     DebugOpenBlock *debug_block = debug_state->first_free_block;
                     if (debug_block) {
                         debug_state->first_free_block = debug_block->next_free;
@@ -101,22 +127,26 @@ static void debug_collate_events(DebugState *debug_state, u32 invalid_event_arra
                     }
                     
                     debug_block->frame_index = debug_state->frame_index;
-                    debug_block->opening_event = event;
-                    debug_block->parent = debug_state->current_open_block;
+                    debug_block->begin_clock = event->clock;
+                    debug_block->debug_name = event->debug_name;
+                    debug_block->name = event->name;
+                    debug_block->parent = thread->current_open_block;
                     debug_block->next_free = 0;
                     
-                    debug_state->current_open_block = debug_block;
+                    thread->current_open_block = debug_block;
                 } break;
                 case DEBUG_EVENT_END_BLOCK: {
-                    assert(debug_state->current_open_block);
-                    DebugOpenBlock *matching_block = debug_state->current_open_block;
-                    DebugEvent *opening_event = matching_block->opening_event;
+                    u32 thread_index = get_debug_thread_index(debug_state, event->thread_id);
+                    DebugThread *thread = debug_state->threads + thread_index;
+                    assert(thread->current_open_block);
+                    DebugOpenBlock *matching_block = thread->current_open_block;
                     // Get debug record from frame hash
                     DebugRecord *record = 0;
+                    // Same block can be executed by different threads, their records are separate
 #if 1
-                    u32 hash_value = (u32)(uintptr_t)opening_event->debug_name;
+                    u32 hash_value = (u32)(uintptr_t)matching_block->debug_name + thread_index;
 #else 
-                    u32 hash_value = crc32_cstr(opening_event->debug_name);
+                    u32 hash_value = crc32_cstr(matching_block->debug_name) + thread_index;
 #endif 
                     u32 hash_mask = (DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME - 1);
                     u32 hash_slot = hash_value & hash_mask;
@@ -128,8 +158,9 @@ static void debug_collate_events(DebugState *debug_state, u32 invalid_event_arra
                             assert(collation_frame->records_count < DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME);
                             test->index = collation_frame->records_count++;
                             record = collation_frame->records + test->index;
-                            record->debug_name = opening_event->debug_name;
-                            record->name = opening_event->name;
+                            record->debug_name = matching_block->debug_name;
+                            record->name = matching_block->name;
+                            record->thread_index = thread_index;
                             break;
                         } else if (test->debug_name_hash == hash_value) {
                             record = collation_frame->records + test->index;
@@ -139,11 +170,14 @@ static void debug_collate_events(DebugState *debug_state, u32 invalid_event_arra
                     assert(record);
                     
                     ++record->times_called;
-                    record->total_clocks += (event->clock - opening_event->clock);
+                    record->total_clocks += (event->clock - matching_block->begin_clock);
+                    if (!matching_block->parent) {
+                        add_timeline_span(collation_frame->threads + thread_index, matching_block->begin_clock, event->clock);
+                    }
                     
                     matching_block->next_free = debug_state->first_free_block;
                     debug_state->first_free_block = matching_block;
-                    debug_state->current_open_block = matching_block->parent;
+                    thread->current_open_block = matching_block->parent;
                 } break;
 #define DEBUG_EVENT_VALUE_DEF(_type)                            \
 case DEBUG_EVENT_VALUE_##_type: {                               \
@@ -262,19 +296,39 @@ void DEBUG_update(DebugState *debug_state, InputManager *input, RendererCommands
         f32 frame_time = (f32)(frame->end_clock - frame->begin_clock);
         u64 record_count = frame->records_count;
         TempMemory records_sort_temp = begin_temp_memory(&debug_state->arena);
-        SortEntry *sort_a = alloc_arr(&debug_state->arena, record_count, SortEntry);
-        SortEntry *sort_b = alloc_arr(&debug_state->arena, record_count, SortEntry);
+        SortEntry32 *sort_a = alloc_arr(&debug_state->arena, record_count, SortEntry32);
+        SortEntry32 *sort_b = alloc_arr(&debug_state->arena, record_count, SortEntry32);
         for (size_t i = 0; i < record_count; ++i) {
-            sort_a[i].sort_key = frame->records[i].total_clocks;
-            sort_a[i].sort_index = i;
+            u64 total_clocks = frame->records[i].total_clocks;
+            sort_a[i].sort_key = total_clocks > UINT32_MAX ? UINT32_MAX : (u32)total_clocks;
+            sort_a[i].sort_index = (u32)i;
         }
-        radix_sort(sort_a, sort_b, record_count);
+        sort_a = radix_sort32(sort_a, sort_b, (u32)record_count);
         dev_ui_labelf(&dev_ui, "Frame %llu", frame->frame_index);    
         dev_ui_checkbox(&dev_ui, "Pause", &debug_state->is_paused);
+        // Timeline of each thread over frame, # marks time spent in top level blocks and . - waiting
+        for (u32 thread_index = 0; thread_index < debug_state->thread_count; ++thread_index) {
+            DebugFrameThread *frame_thread = frame->threads + thread_index;
+            char timeline[DEBUG_TIMELINE_WIDTH + 1];
+            memset(timeline, '.', DEBUG_TIMELINE_WIDTH);
+            timeline[DEBUG_TIMELINE_WIDTH] = 0;
+            for (u32 span_idx = 0; span_idx < frame_thread->span_count; ++span_idx) {
+                DebugTimelineSpan *span = frame_thread->spans + span_idx;
+                // Blocks of other threads can begin before frame marker
+                f32 begin = (f32)(i64)(span->begin_clock - frame->begin_clock) / frame_time * DEBUG_TIMELINE_WIDTH;
+                f32 end = (f32)(i64)(span->end_clock - frame->begin_clock) / frame_time * DEBUG_TIMELINE_WIDTH;
+                i32 first_column = Max_i32((i32)begin, 0);
+                i32 last_column = Min_i32((i32)end, DEBUG_TIMELINE_WIDTH - 1);
+                for (i32 column = first_column; column <= last_column; ++column) {
+                    timeline[column] = '#';
+                }
+            }
+            dev_ui_labelf(&dev_ui, "Thread %u %6.2f%% %s", thread_index, (f32)frame_thread->busy_clocks / frame_time * 100, timeline);
+        }
         dev_ui_begin_sizable(&dev_ui);
         for (size_t i = 0; i < Min_i32(frame->records_count, 20); ++i) {
             DebugRecord *record = frame->records + sort_a[record_count - i - 1].sort_index;
-            dev_ui_labelf(&dev_ui, "%2llu %32s %8llu %4u %8llu %.2f%%\n", i, record->name, record->total_clocks, 
+            dev_ui_labelf(&dev_ui, "%2llu %u %32s %8llu %4u %8llu %.2f%%\n", i, record->thread_index, record->name, record->total_clocks, 
                           record->times_called, record->total_clocks / (u64)record->times_called, ((f32)record->total_clocks / frame_time * 100));
         }
         dev_ui_end_sizable(&dev_ui);
@@ -296,8 +350,8 @@ void DEBUG_frame_end(DebugState *debug_state) {
         debug_table->current_event_array_index = 0;
     }
     
-    u64 event_array_index_event_index = _InterlockedExchange64((volatile i64 *)&debug_table->event_array_index_event_index,
-                                                               (i64)debug_table->current_event_array_index << 32);
+    u64 event_array_index_event_index = (u64)interlocked_exchange((volatile i64 *)&debug_table->event_array_index_event_index,
+                                                                  (i64)debug_table->current_event_array_index << 32);
     u32 event_array_index = event_array_index_event_index >> 32;
     u32 event_count       = event_array_index_event_index & UINT32_MAX;
     debug_table->event_counts[event_array_index] = event_count;
@@ -4,7 +4,6 @@
 
 #include "dev_ui.hh"
 
-#include <intrin.h>
 
 #if INTERNAL_BUILD
 
@@ -16,6 +15,11 @@
 #define DEBUG_MAX_EVENT_COUNT (1 << 22)
 #define DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME 128
 CT_ASSERT(IS_POW2(DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME));
+// Events can be recorded from several threads - game thread, that marks frames, and render thread
+#define DEBUG_MAX_THREAD_COUNT 4
+// Top level blocks of thread that are kept for timeline, following ones are merged with last one
+#define DEBUG_MAX_TIMELINE_SPAN_COUNT 64
+#define DEBUG_TIMELINE_WIDTH 64
 
 #define DEBUG_VALUE_TYPE_LIST() \
 DEBUG_VALUE_TYPE(u8)            \
@@ -49,6 +53,7 @@ DEBUG_VALUE_TYPE_LIST()
 
 struct DebugEvent {
     u8 type;          // DebugEventType
+    u32 thread_id;    // get_thread_id
     u64 clock;        // rdstc
     const char *debug_name; // see DEBUG_NAME
     const char *name;       // user-defined block name
@@ -75,14 +80,15 @@ extern DebugTable *debug_table;
 #define DEBUG_NAME_(a, b, c) DEBUG_NAME__(a, b, c)
 #define DEBUG_NAME() DEBUG_NAME_(__FILE__, __LINE__, __COUNTER__)
 
-// @TODO(hl): Can actualy replace interlocked_add with interlocked_increment
+// Event index is taken atomically, so events can be recorded from any thread
 #define RECORD_DEBUG_EVENT_INTERNAL(event_type, debug_name_init, name_init)                   \
-    u64 array_index_event_index = debug_table->event_array_index_event_index++;               \
+    u64 array_index_event_index = (u64)interlocked_add((volatile i64 *)&debug_table->event_array_index_event_index, 1); \
     u32 event_index = array_index_event_index & 0xFFFFFFFF;                                   \
     assert(event_index < ARRAY_SIZE(debug_table->events[0]));                                 \
     DebugEvent *event = debug_table->events[array_index_event_index >> 32] + event_index;     \
     event->clock = __rdtsc();                                                                 \
     event->type = (u8)event_type;                                                             \
+    event->thread_id = get_thread_id();                                                       \
     event->debug_name = debug_name_init;                                                      \
     event->name = name_init;                                                                  
     
@@ -103,6 +109,7 @@ extern DebugTable *debug_table;
 
 #define FRAME_MARKER() RECORD_DEBUG_EVENT(DEBUG_EVENT_FRAME_MARKER, DEBUG_NAME(), "#FRAME_MARKER")
 
+// Value blocks are collated in order of events regardless of thread, so values should be recorded only by game thread
 #define DEBUG_VALUE_PROC_DEF(_type)                                                \
 inline void DEBUG_VALUE_(const char *debug_name, const char *name, _type value) {  \
     RECORD_DEBUG_EVENT_INTERNAL(DEBUG_EVENT_VALUE_##_type, debug_name, name);      \
@@ -148,6 +155,7 @@ struct DebugTimedBlock {
 struct DebugRecord {
     const char *debug_name;
     const char *name;
+    u32 thread_index;
     u32 times_called;
     u64 total_clocks;
 };  
@@ -157,6 +165,18 @@ struct DebugRecordHash {
     u32 index;
 };
 
+struct DebugTimelineSpan {
+    u64 begin_clock;
+    u64 end_clock;
+};
+
+// Top level blocks of thread that ended in frame. Time outside of them is time thread waited
+struct DebugFrameThread {
+    u64 busy_clocks;
+    u32 span_count;
+    DebugTimelineSpan spans[DEBUG_MAX_TIMELINE_SPAN_COUNT];
+};
+
 struct DebugFrame {
     u64 frame_index;
     u64 begin_clock;
@@ -165,15 +185,25 @@ struct DebugFrame {
     u32 records_count;
     DebugRecord records         [DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME];
     DebugRecordHash records_hash[DEBUG_MAX_UNIQUE_REGIONS_PER_FRAME];
+    DebugFrameThread threads    [DEBUG_MAX_THREAD_COUNT];
 };
 
+// Opening event is copied, because block of other thread can end after its event array is written again
 struct DebugOpenBlock {
     u32 frame_index;
-    DebugEvent *opening_event;
+    u64 begin_clock;
+    const char *debug_name;
+    const char *name;
     DebugOpenBlock *parent;
     DebugOpenBlock *next_free;
 };
 
+// Blocks are nested only in events of same thread, so each thread has its own stack of open blocks
+struct DebugThread {
+    u32 thread_id;
+    DebugOpenBlock *current_open_block;
+};
+
 enum {
     DEBUG_VALUE_NONE,  
     DEBUG_VALUE_SWITCH,  
@@ -214,7 +244,8 @@ struct DebugState {
     DebugFrame frames[DEBUG_MAX_FRAME_COUNT];
     u64 debug_open_blocks_allocated;
     DebugOpenBlock *first_free_block;
-    DebugOpenBlock *current_open_block;
+    u32 thread_count;
+    DebugThread threads[DEBUG_MAX_THREAD_COUNT];
     u32 collation_array_index;
     bool is_paused;
     
@@ -7,6 +7,12 @@ enum {
     ENTITY_FLAG_IS_DELETED = 0x1,
     ENTITY_FLAG_IS_ANCHOR  = 0x2,
     ENTITY_FLAG_HAS_WORLD_PLACEMENT  = 0x4,
+    // Entity is waiting in scheduler and is not updated until it wakes up
+    ENTITY_FLAG_IS_SLEEPING = 0x8,
+    // Building that is placed but not built yet
+    ENTITY_FLAG_IS_UNDER_CONSTRUCTION = 0x10,
+    // Built building that pawns bring resources to
+    ENTITY_FLAG_IS_STOCKPILE = 0x20,
 };
 
 struct EntityID {
@@ -32,19 +38,30 @@ struct WorldObjectSpec {
     u32 resource_kind;
     u32 default_resource_interactions;
     u32 resource_gain;
+    // Time in seconds needed to restore single interaction, 0 if resource does not regrow
+    f32 regrowth_time;
+    // Time in seconds that single builder needs to build building
+    f32 build_time;
+    // Number of build orders added for construction site
+    u32 max_builders;
+    // Amount of resources that building can store, 0 if it is not a stockpile
+    u32 stockpile_capacity;
 };
 
 enum {
     INTERACTION_KIND_NONE,
     INTERACTION_KIND_MINE_RESOURCE,
+    // Pawn sleeps at construction site until building is finished
+    INTERACTION_KIND_BUILD,
 };
 
 // @TODO see if it is better inlined as entity fields
 struct Interaction {
     u32 kind; // Used to check if interaction exists
     EntityID entity;
-    f32 time;
-    f32 current_time;
+    // Scheduler ticks, pawn sleeps until interaction ends
+    u64 end_tick;
+    u64 duration_ticks;
     
     ParticleEmitterID particle_emitter;
 };
@@ -58,10 +75,26 @@ struct Entity {
     // resource
     u32 resource_interactions_left;
     // building
+    // From 0 to 1, increased by construction sites update for each builder
     f32 build_progress;      
+    u32 builder_count;
+    // item pile and stockpile
+    // Resource kind of items in pile, stockpile takes items of any kind
+    u32 item_kind;
+    u32 item_amount;
+    // Only stockpiles have capacity
+    u32 item_capacity;
     // pawn
     OrderID order;
     Interaction interaction;
+    // Hauling pawn has items in source pile and space in destination stockpile reserved for it
+    // Source is null after items are picked up
+    EntityID haul_source;
+    EntityID haul_destination;
+    u32 carry_kind;
+    u32 carry_amount;
+    // Steps left in which pawn walks with preferred velocity without looking for neighbours
+    u32 avoidance_free_steps;
 };
 
 #define ENTITY_HH 1
@@ -0,0 +1,127 @@
+#include "entity_commands.hh"
+#include "sim_region.hh"
+
+void init_entity_command_buffer(EntityCommandBuffer *buffer, MemoryArena *arena, u32 max_command_count, u32 max_prototype_count) {
+    buffer->command_count = 0;
+    buffer->max_command_count = max_command_count;
+    buffer->commands = alloc_arr(arena, max_command_count, EntityCommand, false);
+    buffer->prototype_count = 0;
+    buffer->max_prototype_count = max_prototype_count;
+    buffer->prototypes = 0;
+    if (max_prototype_count) {
+        buffer->prototypes = alloc_arr(arena, max_prototype_count, Entity, false);
+    }
+}
+
+static EntityCommand *add_entity_command(EntityCommandBuffer *buffer, u32 kind, u32 sort_key, EntityID id) {
+    assert(buffer->command_count < buffer->max_command_count);
+    EntityCommand *command = buffer->commands + buffer->command_count++;
+    command->kind = kind;
+    command->sort_key = sort_key;
+    command->id = id;
+    return command;
+}
+
+Entity *record_create_entity(EntityCommandBuffer *buffer, u32 sort_key, vec2 p) {
+    assert(buffer->prototype_count < buffer->max_prototype_count);
+    u32 prototype_idx = buffer->prototype_count++;
+    Entity *prototype = buffer->prototypes + prototype_idx;
+    *prototype = {};
+    prototype->p = p;
+    EntityCommand *command = add_entity_command(buffer, ENTITY_COMMAND_CREATE, sort_key, {});
+    command->prototype_idx = prototype_idx;
+    return prototype;
+}
+
+void record_move_entity(EntityCommandBuffer *buffer, u32 sort_key, EntityID id, vec2 p) {
+    EntityCommand *command = add_entity_command(buffer, ENTITY_COMMAND_MOVE, sort_key, id);
+    command->p = p;
+}
+
+void record_delete_entity(EntityCommandBuffer *buffer, u32 sort_key, EntityID id) {
+    add_entity_command(buffer, ENTITY_COMMAND_DELETE, sort_key, id);
+}
+
+void record_set_entity_field_(EntityCommandBuffer *buffer, u32 sort_key, EntityID id, u32 offset, u32 size, const void *data) {
+    assert(size <= ENTITY_COMMAND_MAX_FIELD_SIZE && offset + size <= sizeof(Entity));
+    EntityCommand *command = add_entity_command(buffer, ENTITY_COMMAND_SET_FIELD, sort_key, id);
+    command->field.offset = offset;
+    command->field.size = size;
+    memcpy(command->field.data, data, size);
+}
+
+// Command is found by sort_index of its sort entry
+struct EntityCommandRef {
+    EntityCommandBuffer *buffer;
+    EntityCommand *command;
+};
+
+static void apply_entity_command(SimRegion *sim, EntityCommandBuffer *buffer, EntityCommand *command) {
+    if (command->kind == ENTITY_COMMAND_CREATE) {
+        Entity *prototype = buffer->prototypes + command->prototype_idx;
+        prototype->id = get_new_id(sim->world);
+        // Entity is added like one loaded from world, so it gets into all sim indices its flags require
+        Entity *entity = create_new_entity(sim, prototype->p, prototype);
+        if (entity) {
+            add_sim_entity_influence(sim, entity);
+        }
+    } else {
+        Entity *entity = get_entity_by_id(sim, command->id);
+        if (entity && !(entity->flags & ENTITY_FLAG_IS_DELETED)) {
+            switch (command->kind) {
+                case ENTITY_COMMAND_MOVE: {
+                    change_entity_position(sim, entity, command->p);
+                } break;
+                case ENTITY_COMMAND_DELETE: {
+                    delete_sim_entity(sim, entity);
+                } break;
+                case ENTITY_COMMAND_SET_FIELD: {
+                    memcpy((u8 *)entity + command->field.offset, command->field.data, command->field.size);
+                } break;
+                INVALID_DEFAULT_CASE;
+            }
+        }
+    }
+}
+
+u32 apply_entity_commands(SimRegion *sim, EntityCommandBuffer *buffers, u32 buffer_count) {
+    TIMED_FUNCTION();
+    u32 command_count = 0;
+    for (u32 buffer_idx = 0; buffer_idx < buffer_count; ++buffer_idx) {
+        command_count += buffers[buffer_idx].command_count;
+    }
+
+    if (command_count) {
+        // This can't be temporary memory, because applied commands allocate entity blocks on the same arena
+        EntityCommandRef *refs = alloc_arr(sim->arena, command_count, EntityCommandRef, false);
+        SortEntry32 *sort_a = alloc_arr(sim->arena, command_count, SortEntry32, false);
+        SortEntry32 *sort_b = alloc_arr(sim->arena, command_count, SortEntry32, false);
+        u32 entry_idx = 0;
+        for (u32 buffer_idx = 0; buffer_idx < buffer_count; ++buffer_idx) {
+            EntityCommandBuffer *buffer = buffers + buffer_idx;
+            for (u32 command_idx = 0; command_idx < buffer->command_count; ++command_idx) {
+                EntityCommandRef *ref = refs + entry_idx;
+                ref->buffer = buffer;
+                ref->command = buffer->commands + command_idx;
+                sort_a[entry_idx].sort_key = ref->command->sort_key;
+                sort_a[entry_idx].sort_index = entry_idx;
+                ++entry_idx;
+            }
+        }
+
+        // Radix sort is stable, and buffers are put into sort array in recording order,
+        // so commands with same sort key stay in recording order
+        SortEntry32 *sorted = radix_sort32(sort_a, sort_b, command_count);
+        for (entry_idx = 0; entry_idx < command_count; ++entry_idx) {
+            EntityCommandRef *ref = refs + sorted[entry_idx].sort_index;
+            apply_entity_command(sim, ref->buffer, ref->command);
+        }
+    }
+
+    for (u32 buffer_idx = 0; buffer_idx < buffer_count; ++buffer_idx) {
+        buffers[buffer_idx].command_count = 0;
+        buffers[buffer_idx].prototype_count = 0;
+    }
+    DEBUG_VALUE(command_count, "Entity commands applied");
+    return command_count;
+}
@@ -0,0 +1,77 @@
+//
+// Entity command buffers make it possible to update entities of sim region from several threads
+// Creating, moving and deleting entities changes chunk lists, entity hash and influence maps of sim region,
+// so it can't be done while entities are iterated or from several threads at once. Instead each thread
+// records commands to its own buffer, and all buffers are applied at once at sync point
+//
+// Commands are applied in order of sort keys given when recording, and commands with same sort key are
+// applied in order they were recorded. Usually sort key is index of entity that records command, so as long as
+// each entity is updated by single thread, result does not depend on how entities were split between threads
+//
+// Pawns that are in sim pawn arrays get their positions from update_sim_pawns, so they should not be moved with commands
+//
+#if !defined(ENTITY_COMMANDS_HH)
+
+#include "lib.hh"
+#include "entity.hh"
+
+struct SimRegion;
+
+enum {
+    ENTITY_COMMAND_CREATE,
+    ENTITY_COMMAND_MOVE,
+    ENTITY_COMMAND_DELETE,
+    ENTITY_COMMAND_SET_FIELD,
+};
+
+#define ENTITY_COMMAND_MAX_FIELD_SIZE 16
+
+struct EntityCommand {
+    u32 kind;
+    u32 sort_key;
+    EntityID id;
+    union {
+        // Move
+        vec2 p;
+        // Create - new entity is copied from prototype stored in buffer, position is in prototype
+        u32 prototype_idx;
+        // Set field
+        struct {
+            u32 offset;
+            u32 size;
+            u8 data[ENTITY_COMMAND_MAX_FIELD_SIZE];
+        } field;
+    };
+};
+
+// Buffer memory is allocated before threads start, so recording does not touch arena
+struct EntityCommandBuffer {
+    u32 command_count;
+    u32 max_command_count;
+    EntityCommand *commands;
+
+    u32 prototype_count;
+    u32 max_prototype_count;
+    Entity *prototypes;
+};
+
+void init_entity_command_buffer(EntityCommandBuffer *buffer, MemoryArena *arena, u32 max_command_count, u32 max_prototype_count = 0);
+// Returns entity that should be filled, it gets id when command is applied
+Entity *record_create_entity(EntityCommandBuffer *buffer, u32 sort_key, vec2 p);
+void record_move_entity(EntityCommandBuffer *buffer, u32 sort_key, EntityID id, vec2 p);
+void record_delete_entity(EntityCommandBuffer *buffer, u32 sort_key, EntityID id);
+void record_set_entity_field_(EntityCommandBuffer *buffer, u32 sort_key, EntityID id, u32 offset, u32 size, const void *data);
+// Value must have the same type as field
+#define RECORD_SET_ENTITY_FIELD(_buffer, _sort_key, _id, _field, _value) do {                          \
+    auto _field_value = (_value);                                                                     \
+    CT_ASSERT(sizeof(_field_value) == sizeof(STRUCT_FIELD(Entity, _field)));                         \
+    record_set_entity_field_(_buffer, _sort_key, _id, (u32)STRUCT_OFFSET(Entity, _field),             \
+                             (u32)sizeof(_field_value), &_field_value);                              \
+} while (0)
+// Applies commands of all buffers in deterministic order and clears buffers
+// Commands for entities that are not in sim or were deleted by earlier commands are skipped
+// Returns number of commands applied
+u32 apply_entity_commands(SimRegion *sim, EntityCommandBuffer *buffers, u32 buffer_count);
+
+#define ENTITY_COMMANDS_HH 1
+#endif
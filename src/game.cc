@@ -119,8 +119,10 @@ void game_init(Game *game) {
     game->os = os_init(&game->renderer_settings.display_size);
     game->renderer = renderer_init(game->renderer_settings);
     game->assets = assets_init(game->renderer, &game->frame_arena);
+    renderer_start_thread(game->renderer, game->os);
     
-    world_state_init(&game->world_state, &game->arena, &game->frame_arena);
+    world_state_init(&game->world_state, &game->arena, &game->frame_arena, 
+                     os_get_work_queue(game->os), os_get_high_priority_work_queue(game->os));
     game->state = STATE_MAIN_MENU;
     build_interface_for_window_size(game);
 }
@@ -168,6 +170,13 @@ static void update_game_state(Game *game, RendererCommands *commands) {
         }
         
         update_and_render_interface(game->game_interface, &game->input, commands, game->assets);
+        // Building is placed by world state on next click
+        if (game->game_interface_button_building1->is_pressed) {
+            game->world_state.building_kind_to_place = WORLD_OBJECT_KIND_BUILDING1;
+        }
+        if (game->game_interface_button_building2->is_pressed) {
+            game->world_state.building_kind_to_place = WORLD_OBJECT_KIND_BUILDING2;
+        }
     }
     end_separated_rendering(commands);
 }
@@ -220,6 +229,10 @@ void game_update_and_render(Game *game) {
     if (is_key_pressed(&game->input, KEY_F10)) {
         game->renderer_settings.vsync = !game->renderer_settings.vsync;
     }
+    // Switches how vertex data gets to GPU, for comparing them
+    if (is_key_pressed(&game->input, KEY_F9)) {
+        game->renderer_settings.persistent_buffers = !game->renderer_settings.persistent_buffers;
+    }
     
     game->renderer_settings.display_size = platform->display_size;
     if (memcmp(get_current_settings(game->renderer), &game->renderer_settings, sizeof(RendererSettings)) != 0) {
@@ -238,9 +251,9 @@ void game_update_and_render(Game *game) {
         } break;
     }
     DEBUG_update(game->debug_state, &game->input, commands, game->assets);
+    // Frame is executed by render thread while next one is updated
     renderer_end_frame(game->renderer);
     
-    platform->vsync = game->renderer_settings.vsync;
     os_end_frame(game->os);
     DEBUG_frame_end(game->debug_state);
 }
@@ -9,10 +9,12 @@ struct EnumString {
 #define ENUM_STRING_(_string, _value) {_string, _value}
 #define ENUM_STRING(_value) ENUM_STRING_(#_value, _value)
 
-#define DEFINE_ENUM_(_enum_name, _enum_values) enum _enum_name { _enum_values };
-#define DEFINE_ENUM(_enum_name, _enum_values) DEFINE_ENUM_(_enum_name, _enum_values)
-#define DEFINE_ENUM_STRINGS_(_enum_name, _enum_values) const EnumString _enum_name##_strings[] = { _enum_values };
-#define DEFINE_ENUM_STRINGS(_enum_name, _enum_values) DEFINE_ENUM_STRINGS_(_enum_name, _enum_values)
+// Enum values are passed as variadic argument - they are lists with commas, and 
+// only MSVC preprocessor passes them as single argument
+#define DEFINE_ENUM_(_enum_name, ...) enum _enum_name { __VA_ARGS__ };
+#define DEFINE_ENUM(_enum_name, ...) DEFINE_ENUM_(_enum_name, __VA_ARGS__)
+#define DEFINE_ENUM_STRINGS_(_enum_name, ...) const EnumString _enum_name##_strings[] = { __VA_ARGS__ };
+#define DEFINE_ENUM_STRINGS(_enum_name, ...) DEFINE_ENUM_STRINGS_(_enum_name, __VA_ARGS__)
 
 // Lookup serialized enum value
 // This is better of using some hash table, but since this code is executed very rarely we
@@ -49,7 +51,7 @@ ENTITY_KIND(ENTITY_KIND_NONE,         0x0)              \
 ENTITY_KIND(ENTITY_KIND_PLAYER,       0x1)              \
 ENTITY_KIND(ENTITY_KIND_WORLD_OBJECT, 0x2)              \
 ENTITY_KIND(ENTITY_KIND_PAWN,         0x3)              \
-ENTITY_KIND(ENTITY_KIND_RESERVED4,    0x4)              \
+ENTITY_KIND(ENTITY_KIND_ITEM_PILE,    0x4)              \
 ENTITY_KIND(ENTITY_KIND_RESERVED5,    0x5)              \
 ENTITY_KIND(ENTITY_KIND_RESERVED6,    0x6)              \
 ENTITY_KIND(ENTITY_KIND_RESERVED7,    0x7)              \
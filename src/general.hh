@@ -11,8 +11,21 @@
 
 #define CT_ASSERT(_expr) static_assert(_expr, "Assertion " #_expr " failed")
 
+// Game itself is built with MSVC, but tools that don't need platform layer (like headless 
+// simulation benchmark) are also built with gcc or clang
+#if defined(_MSC_VER)
+#define COMPILER_MSVC 1
+#else 
+#define COMPILER_MSVC 0
+#endif 
+
 #include <stdint.h>
 #include <stdarg.h>
+#if COMPILER_MSVC
+#include <intrin.h>
+#else 
+#include <x86intrin.h>
+#endif 
 
 typedef int8_t  i8;
 typedef int16_t i16;
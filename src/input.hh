@@ -47,7 +47,7 @@ inline bool is_mouse_keycode(u32 keycode) {
 // A way of platform layer communcating with game.
 // In the begging of the frame platform layer supplies gaem with all information about user input 
 // it needs, during the frame game can modify some values in this struct to make commands to the 
-// platform layer, like go fullscreen or switch vsync
+// platform layer, like go fullscreen
 // The idea of this structure is not to provide api, but simply pass data between modules
 struct Platform {
     vec2 display_size;
@@ -66,7 +66,6 @@ struct Platform {
     u64 samples_per_second;
     // Settings that can be changed
     bool fullscreen;
-    bool vsync;
 };
 
 inline void update_key_state(Platform *input, u32 key, bool new_down) {
@@ -2,7 +2,6 @@
 
 #include "general.hh"
 
-#include <intrin.h>
 
 //
 // We use SSE4 here for different round functions
@@ -204,7 +203,7 @@ void *alloc_copy(MemoryArena *arena, const void *src, size_t size) {
     return result;
 }
 
-#define bootstrap_alloc_struct(_type, _field, ...) (_type *)bootstrap_alloc_size(SIZE_OF(_type), STRUCT_OFFSET(_type, _field), __VA_ARGS__)
+#define bootstrap_alloc_struct(_type, _field, ...) (_type *)bootstrap_alloc_size(SIZE_OF(_type), STRUCT_OFFSET(_type, _field), ##__VA_ARGS__)
 inline void *bootstrap_alloc_size(size_t size, size_t arena_offset, size_t minimal_block_size = MEGABYTES(4)) {
     MemoryArena bootstrap;
     arena_init(&bootstrap, os_alloc(minimal_block_size), minimal_block_size);
@@ -366,10 +365,10 @@ struct vec2G {
         return (*this = *this / v);
     }
     vec2G<T> &operator*=(T s) {
-        return (*this = *this * v);
+        return (*this = *this * s);
     }
     vec2G<T> &operator/=(T s) {
-        return (*this = *this / v);
+        return (*this = *this / s);
     }
     
     bool operator==(vec2G<T> other) {
@@ -520,10 +519,10 @@ struct vec4G {
         return (*this = *this / v);
     }
     vec4G<T> &operator*=(T s) {
-        return (*this = *this * v);
+        return (*this = *this * s);
     }
     vec4G<T> &operator/=(T s) {
-        return (*this = *this / v);
+        return (*this = *this / s);
     }
 };
 
@@ -1234,6 +1233,7 @@ inline u32 sort_key_to_u32(f32 sort_key) {
     return result;
 }
 
+// Always makes 4 passes of 8 bits and result is in sort_a. Kept as baseline for radix_sort32 in sim_benchmark
 void radix_sort(SortEntry *sort_a, SortEntry *sort_b, size_t count) {
     SortEntry *src = sort_a;
     SortEntry *dst = sort_b;
@@ -1264,16 +1264,171 @@ void radix_sort(SortEntry *sort_a, SortEntry *sort_b, size_t count) {
     }
 }
 
+// Parallel sort adds work to queue of os.hh, which can't be included here
+struct WorkQueue;
+bool add_work_queue_entry(WorkQueue *queue, void (*callback)(void *data), void *data);
+void complete_all_work(WorkQueue *queue);
+u32 get_work_queue_worker_count(WorkQueue *queue);
+
+// Compact sort entry, keys are compared as unsigned integers. Float keys are converted with sort_key_to_u32
+struct SortEntry32 {
+    u32 sort_key;
+    u32 sort_index;
+};
+
+// 3 passes of 11 bits cover 32 bit key, histogram of digit still fits in L1 cache
+#define RADIX_SORT_DIGIT_BITS 11
+#define RADIX_SORT_DIGIT_COUNT (1 << RADIX_SORT_DIGIT_BITS)
+#define RADIX_SORT_PASS_COUNT 3
+// Below this count histograms and scatters are not split between threads
+// @TODO Value is not measured - only single core machine was at hand, where parallel sort can't win at any count.
+// Set it to count from which sim_benchmark -radix N shows parallel time below serial one on multi-core machine
+#define RADIX_SORT_PARALLEL_MIN_COUNT (1 << 16)
+#define RADIX_SORT_MAX_JOB_COUNT 8
+
+inline u32 get_radix_digit(u32 key, u32 pass_idx) {
+    return (key >> (pass_idx * RADIX_SORT_DIGIT_BITS)) & (RADIX_SORT_DIGIT_COUNT - 1);
+}
+
+// Job either counts digits of its range of src, or moves its range to dst using offsets computed from counts
+struct RadixSortJob {
+    SortEntry32 *src;
+    SortEntry32 *dst;
+    u32 first;
+    u32 count;
+    u32 pass_idx;
+    bool is_scatter;
+    u32 offsets[RADIX_SORT_DIGIT_COUNT];
+};
+
+inline void radix_sort_work(void *data) {
+    RadixSortJob *job = (RadixSortJob *)data;
+    if (job->is_scatter) {
+        for (u32 entry_idx = job->first; entry_idx < job->first + job->count; ++entry_idx) {
+            SortEntry32 entry = job->src[entry_idx];
+            job->dst[job->offsets[get_radix_digit(entry.sort_key, job->pass_idx)]++] = entry;
+        }
+    } else {
+        memset(job->offsets, 0, sizeof(job->offsets));
+        for (u32 entry_idx = job->first; entry_idx < job->first + job->count; ++entry_idx) {
+            ++job->offsets[get_radix_digit(job->src[entry_idx].sort_key, job->pass_idx)];
+        }
+    }
+}
+
+// Calling thread takes first job, and jobs that did not fit in queue
+inline void run_radix_sort_jobs(WorkQueue *queue, RadixSortJob *jobs, u32 job_count) {
+    for (u32 job_idx = 1; job_idx < job_count; ++job_idx) {
+        if (!add_work_queue_entry(queue, radix_sort_work, jobs + job_idx)) {
+            radix_sort_work(jobs + job_idx);
+        }
+    }
+    radix_sort_work(jobs);
+    complete_all_work(queue);
+}
+
+// Each pass is counted and scattered by jobs that own contiguous ranges of src. Offsets of digit 
+// in dst are given to jobs in order of ranges, so sort stays stable
+inline SortEntry32 *radix_sort32_parallel(SortEntry32 *src, SortEntry32 *dst, u32 count, WorkQueue *queue) {
+    RadixSortJob jobs[RADIX_SORT_MAX_JOB_COUNT];
+    u32 job_count = RADIX_SORT_MAX_JOB_COUNT;
+    for (u32 pass_idx = 0; pass_idx < RADIX_SORT_PASS_COUNT; ++pass_idx) {
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            RadixSortJob *job = jobs + job_idx;
+            job->src = src;
+            job->dst = dst;
+            job->first = (u32)((u64)count * job_idx / job_count);
+            job->count = (u32)((u64)count * (job_idx + 1) / job_count) - job->first;
+            job->pass_idx = pass_idx;
+            job->is_scatter = false;
+        }
+        run_radix_sort_jobs(queue, jobs, job_count);
+        
+        u32 first_digit_count = 0;
+        u32 first_digit = get_radix_digit(src[0].sort_key, pass_idx);
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            first_digit_count += jobs[job_idx].offsets[first_digit];
+        }
+        // All keys have the same digit, so pass would not change order
+        if (first_digit_count == count) {
+            continue;
+        }
+        
+        u32 total = 0;
+        for (u32 digit = 0; digit < RADIX_SORT_DIGIT_COUNT; ++digit) {
+            for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+                u32 digit_count = jobs[job_idx].offsets[digit];
+                jobs[job_idx].offsets[digit] = total;
+                total += digit_count;
+            }
+        }
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            jobs[job_idx].is_scatter = true;
+        }
+        run_radix_sort_jobs(queue, jobs, job_count);
+        SortEntry32 *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    return src;
+}
+
+// Stable LSD radix sort with 11 bit digits. Digit counts of all passes are taken in single read,
+// and passes in which all keys have the same digit are skipped, so sorted entries end up either in src or dst -
+// returned pointer is the one that has them. Counts from RADIX_SORT_PARALLEL_MIN_COUNT are sorted on queue if it is given
+// and has more than one worker - with single worker jobs only take turns with calling thread, and 
+// splitting work costs more than it gives
+inline SortEntry32 *radix_sort32(SortEntry32 *src, SortEntry32 *dst, u32 count, WorkQueue *queue = 0) {
+    if (queue && count >= RADIX_SORT_PARALLEL_MIN_COUNT && get_work_queue_worker_count(queue) > 1) {
+        return radix_sort32_parallel(src, dst, count, queue);
+    }
+    
+    u32 offsets[RADIX_SORT_PASS_COUNT][RADIX_SORT_DIGIT_COUNT];
+    memset(offsets, 0, sizeof(offsets));
+    for (u32 entry_idx = 0; entry_idx < count; ++entry_idx) {
+        u32 key = src[entry_idx].sort_key;
+        for (u32 pass_idx = 0; pass_idx < RADIX_SORT_PASS_COUNT; ++pass_idx) {
+            ++offsets[pass_idx][get_radix_digit(key, pass_idx)];
+        }
+    }
+    
+    for (u32 pass_idx = 0; pass_idx < RADIX_SORT_PASS_COUNT && count; ++pass_idx) {
+        u32 *pass_offsets = offsets[pass_idx];
+        if (pass_offsets[get_radix_digit(src[0].sort_key, pass_idx)] == count) {
+            continue;
+        }
+        
+        u32 total = 0;
+        for (u32 digit = 0; digit < RADIX_SORT_DIGIT_COUNT; ++digit) {
+            u32 digit_count = pass_offsets[digit];
+            pass_offsets[digit] = total;
+            total += digit_count;
+        }
+        for (u32 entry_idx = 0; entry_idx < count; ++entry_idx) {
+            SortEntry32 entry = src[entry_idx];
+            dst[pass_offsets[get_radix_digit(entry.sort_key, pass_idx)]++] = entry;
+        }
+        SortEntry32 *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    return src;
+}
+
 // Abstracted texture
 struct Texture {
-    // Index in texture array
+    // Index of texture array layer
     u32 index;
-    // Size, needed to recompute uvs from image space to texture array space
+    // Size and position in layer, needed to recompute uvs from image space to texture array space
     u16 width;
     u16 height;
+    u16 x;
+    u16 y;
+    // Generation of layer texture was packed in, see texture_atlas.hh
+    u32 generation;
 };  
 
-static Texture INVALID_TEXTURE = { (u32)-1, 0, 0 };
+static Texture INVALID_TEXTURE = { (u32)-1, 0, 0, 0, 0, 0 };
 
 struct AssetID {
     u32 value;
@@ -1300,6 +1455,8 @@ inline u32 next_highest_pow_2(u32 v) {
     return v;
 }
 
+// Return new value for increment and decrement, and initial value for others
+#if COMPILER_MSVC
 i8 interlocked_increment(volatile i8 *value) {
     i8 result = (i8)_InterlockedExchangeAdd8((volatile char *)value, 1) + 1;
     return result;
@@ -1399,6 +1556,47 @@ i64 interlocked_compare_exchange(volatile i64 *dest, i64 exchange, i64 comparand
     i64 result = (i64)_InterlockedCompareExchange64((volatile long long *)dest, exchange, comparand);
     return result;
 }
+#else 
+// gcc and clang atomic builtins are generic over integer width
+#define INTERLOCKED_DEF(_type)                                                                        \
+inline _type interlocked_increment(volatile _type *value) {                                           \
+    return __atomic_add_fetch(value, (_type)1, __ATOMIC_SEQ_CST);                                     \
+}                                                                                                     \
+inline _type interlocked_decrement(volatile _type *value) {                                           \
+    return __atomic_sub_fetch(value, (_type)1, __ATOMIC_SEQ_CST);                                     \
+}                                                                                                     \
+inline _type interlocked_add(volatile _type *value, _type A) {                                        \
+    return __atomic_fetch_add(value, A, __ATOMIC_SEQ_CST);                                            \
+}                                                                                                     \
+inline _type interlocked_exchange(volatile _type *dest, _type exchange) {                             \
+    return __atomic_exchange_n(dest, exchange, __ATOMIC_SEQ_CST);                                     \
+}                                                                                                     \
+inline _type interlocked_compare_exchange(volatile _type *dest, _type exchange, _type comparand) {    \
+    __atomic_compare_exchange_n(dest, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+    return comparand;                                                                                 \
+}
+INTERLOCKED_DEF(i8)
+INTERLOCKED_DEF(i16)
+INTERLOCKED_DEF(i32)
+INTERLOCKED_DEF(i64)
+#undef INTERLOCKED_DEF
+#endif 
+
+// Cheap id of calling thread, used by profiler to tell events of different threads apart.
+// On windows it is id from thread information block, on linux - low bits of thread control block address
+#if COMPILER_MSVC
+inline u32 get_thread_id() {
+    u8 *thread_information_block = (u8 *)__readgsqword(0x30);
+    u32 result = *(u32 *)(thread_information_block + 0x48);
+    return result;
+}
+#else 
+inline u32 get_thread_id() {
+    u64 thread_control_block;
+    __asm__("mov %%fs:0, %0" : "=r"(thread_control_block));
+    return (u32)thread_control_block;
+}
+#endif 
 
 #include "simd_math.hh"
 
@@ -1414,5 +1612,52 @@ void get_billboard_positions(vec3 mid_bottom, vec3 right, vec3 up, f32 width, f3
     out[3] = bottom_right;
 }
 
+// Point p is inside frustum if dot(plane.xyz, p) + plane.w >= 0 for all planes
+// Planes are normalized, so this is signed distance to plane
+struct Frustum {
+    vec4 planes[6];
+};
+
+// Planes are extracted from rows of clip matrix, order is left, right, bottom, top, near, far
+inline Frustum frustum_from_mvp(Mat4x4 mvp) {
+    Frustum result;
+    vec4 w_row = Vec4(mvp.e[0][3], mvp.e[1][3], mvp.e[2][3], mvp.e[3][3]);
+    for (u32 axis = 0; axis < 3; ++axis) {
+        vec4 row = Vec4(mvp.e[0][axis], mvp.e[1][axis], mvp.e[2][axis], mvp.e[3][axis]);
+        result.planes[axis * 2 + 0] = w_row + row;
+        result.planes[axis * 2 + 1] = w_row - row;
+    }
+    for (u32 plane_idx = 0; plane_idx < ARRAY_SIZE(result.planes); ++plane_idx) {
+        vec4 *plane = result.planes + plane_idx;
+        *plane = *plane * (1.0f / length(plane->xyz));
+    }
+    return result;
+}
+
+// Box is outside if its corner that is furthest along plane normal is behind any plane
+inline bool is_box_in_frustum(Frustum *frustum, vec3 box_min, vec3 box_max) {
+    bool result = true;
+    for (u32 plane_idx = 0; plane_idx < ARRAY_SIZE(frustum->planes) && result; ++plane_idx) {
+        vec4 plane = frustum->planes[plane_idx];
+        vec3 furthest = Vec3(plane.x > 0 ? box_max.x : box_min.x,
+                             plane.y > 0 ? box_max.y : box_min.y,
+                             plane.z > 0 ? box_max.z : box_min.z);
+        result = dot(plane.xyz, furthest) + plane.w >= 0;
+    }
+    return result;
+}
+
+// Tests 4 spheres at once, returns mask which has bit set for each sphere that is at least partially inside
+inline u32 get_spheres_in_frustum_mask(Frustum *frustum, f32_4x x, f32_4x y, f32_4x z, f32_4x radius) {
+    f32_4x is_inside;
+    for (u32 plane_idx = 0; plane_idx < ARRAY_SIZE(frustum->planes); ++plane_idx) {
+        vec4 plane = frustum->planes[plane_idx];
+        f32_4x distance = x * F32_4x(plane.x) + y * F32_4x(plane.y) + z * F32_4x(plane.z) + F32_4x(plane.w);
+        f32_4x is_in_front = distance >= -radius;
+        is_inside = plane_idx ? (is_inside & is_in_front) : is_in_front;
+    }
+    return get_mask(is_inside);
+}
+
 #define LIB_HH 1
 #endif
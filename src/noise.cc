@@ -0,0 +1,250 @@
+#include "noise.hh"
+
+f32 value_noise(u32 seed, i32 cell_x, i32 cell_y, u32 scale_log2) {
+    i32 lattice_x = cell_x >> scale_log2;
+    i32 lattice_y = cell_y >> scale_log2;
+    f32 inv_scale = 1.0f / (f32)(1 << scale_log2);
+    f32 tx = (f32)(cell_x - (lattice_x << scale_log2)) * inv_scale;
+    f32 ty = (f32)(cell_y - (lattice_y << scale_log2)) * inv_scale;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    ty = ty * ty * (3.0f - 2.0f * ty);
+    f32 v00 = hash_to_unit(hash_cell(seed, lattice_x,     lattice_y));
+    f32 v10 = hash_to_unit(hash_cell(seed, lattice_x + 1, lattice_y));
+    f32 v01 = hash_to_unit(hash_cell(seed, lattice_x,     lattice_y + 1));
+    f32 v11 = hash_to_unit(hash_cell(seed, lattice_x + 1, lattice_y + 1));
+    f32 v0 = v00 + (v10 - v00) * tx;
+    f32 v1 = v01 + (v11 - v01) * tx;
+    f32 result = v0 + (v1 - v0) * ty;
+    return result;
+}
+
+f32_4x value_noise_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2) {
+    i32_4x lattice_x = cell_x >> scale_log2;
+    i32_4x lattice_y = cell_y >> scale_log2;
+    f32_4x inv_scale = F32_4x(1.0f / (f32)(1 << scale_log2));
+    f32_4x tx = F32_4x(cell_x - (lattice_x << scale_log2)) * inv_scale;
+    f32_4x ty = F32_4x(cell_y - (lattice_y << scale_log2)) * inv_scale;
+    tx = tx * tx * (F32_4x(3.0f) - F32_4x(2.0f) * tx);
+    ty = ty * ty * (F32_4x(3.0f) - F32_4x(2.0f) * ty);
+    i32_4x one = I32_4x(1);
+    f32_4x v00 = unit_f32(hash_cell_4x(seed, lattice_x,       lattice_y));
+    f32_4x v10 = unit_f32(hash_cell_4x(seed, lattice_x + one, lattice_y));
+    f32_4x v01 = unit_f32(hash_cell_4x(seed, lattice_x,       lattice_y + one));
+    f32_4x v11 = unit_f32(hash_cell_4x(seed, lattice_x + one, lattice_y + one));
+    f32_4x v0 = v00 + (v10 - v00) * tx;
+    f32_4x v1 = v01 + (v11 - v01) * tx;
+    f32_4x result = v0 + (v1 - v0) * ty;
+    return result;
+}
+
+f32 value_fbm(u32 seed, i32 cell_x, i32 cell_y, u32 scale_log2, u32 octave_count) {
+    assert(octave_count && octave_count <= scale_log2 + 1);
+    f32 result = 0;
+    f32 amplitude = 0.5f;
+    f32 total_amplitude = 0;
+    for (u32 octave = 0; octave < octave_count; ++octave) {
+        result += value_noise(seed + octave, cell_x, cell_y, scale_log2 - octave) * amplitude;
+        total_amplitude += amplitude;
+        amplitude *= 0.5f;
+    }
+    result /= total_amplitude;
+    return result;
+}
+
+f32_4x value_fbm_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2, u32 octave_count) {
+    assert(octave_count && octave_count <= scale_log2 + 1);
+    f32_4x result = F32_4x_zero();
+    f32 amplitude = 0.5f;
+    f32 total_amplitude = 0;
+    for (u32 octave = 0; octave < octave_count; ++octave) {
+        result += value_noise_4x(seed + octave, cell_x, cell_y, scale_log2 - octave) * F32_4x(amplitude);
+        total_amplitude += amplitude;
+        amplitude *= 0.5f;
+    }
+    result *= F32_4x(1.0f / total_amplitude);
+    return result;
+}
+
+// Skew factors for 2D simplex grid: (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+#define SIMPLEX_F2 0.36602540378f
+#define SIMPLEX_G2 0.21132486540f
+// Scales sum of corner contributions to [-1; 1]
+#define SIMPLEX_NORMALIZATION 70.0f
+
+// Gradient is picked from 4 diagonals by two hash bits, so dot product is just sum of
+// coordinates with flipped signs
+inline f32_4x simplex_corner(u32_4x seed, i32_4x i, i32_4x j, f32_4x x, f32_4x y) {
+    u32_4x hash = hash_u32_4x(seed ^ hash_u32_4x(U32_4x(i) ^ hash_u32_4x(U32_4x(j))));
+    f32_4x sign_bit = F32_4x(-0.0f);
+    f32_4x flip_x = is_not_zero(hash & U32_4x(1)) & sign_bit;
+    f32_4x flip_y = is_not_zero(hash & U32_4x(2)) & sign_bit;
+    f32_4x dot = (x ^ flip_x) + (y ^ flip_y);
+    f32_4x t = Max(F32_4x(0.5f) - x * x - y * y, F32_4x_zero());
+    t = t * t;
+    f32_4x result = t * t * dot;
+    return result;
+}
+
+static f32_4x simplex_noise_4x(u32_4x seed, f32_4x x, f32_4x y) {
+    // Find simplex cell origin in skewed space
+    f32_4x s = (x + y) * F32_4x(SIMPLEX_F2);
+    f32_4x i_f = Floor(x + s);
+    f32_4x j_f = Floor(y + s);
+    f32_4x t = (i_f + j_f) * F32_4x(SIMPLEX_G2);
+    f32_4x x0 = x - (i_f - t);
+    f32_4x y0 = y - (j_f - t);
+    // Pick upper or lower triangle of cell
+    f32_4x upper = x0 > y0;
+    f32_4x i1 = upper & F32_4x(1.0f);
+    f32_4x j1 = F32_4x(1.0f) - i1;
+    f32_4x x1 = x0 - i1 + F32_4x(SIMPLEX_G2);
+    f32_4x y1 = y0 - j1 + F32_4x(SIMPLEX_G2);
+    f32_4x x2 = x0 - F32_4x(1.0f - 2.0f * SIMPLEX_G2);
+    f32_4x y2 = y0 - F32_4x(1.0f - 2.0f * SIMPLEX_G2);
+
+    i32_4x i = Floor_i32(i_f);
+    i32_4x j = Floor_i32(j_f);
+    i32_4x one = I32_4x(1);
+    i32_4x i1_int = Floor_i32(i1);
+    i32_4x j1_int = Floor_i32(j1);
+    f32_4x n = simplex_corner(seed, i, j, x0, y0) +
+        simplex_corner(seed, i + i1_int, j + j1_int, x1, y1) +
+        simplex_corner(seed, i + one, j + one, x2, y2);
+    f32_4x result = Min(Max(n * F32_4x(SIMPLEX_NORMALIZATION), F32_4x(-1.0f)), F32_4x(1.0f));
+    return result;
+}
+
+f32_4x simplex_noise_4x(u32 seed, f32_4x x, f32_4x y) {
+    return simplex_noise_4x(U32_4x(seed), x, y);
+}
+
+// Floats can't represent cell coordinates far from origin precisely, so world is split
+// in regions of this size. Noise is computed relative to region origin, and each region
+// has its own seed. This creates seams on region borders, but they are 65536 chunks apart
+#define SIMPLEX_REGION_SIZE_LOG2 20
+
+f32_4x simplex_fbm_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2, u32 octave_count) {
+    assert(octave_count && scale_log2 < SIMPLEX_REGION_SIZE_LOG2);
+    i32_4x region_x = cell_x >> SIMPLEX_REGION_SIZE_LOG2;
+    i32_4x region_y = cell_y >> SIMPLEX_REGION_SIZE_LOG2;
+    u32_4x region_seed = hash_cell_4x(seed, region_x, region_y);
+    f32_4x inv_scale = F32_4x(1.0f / (f32)(1 << scale_log2));
+    f32_4x x = F32_4x(cell_x - (region_x << SIMPLEX_REGION_SIZE_LOG2)) * inv_scale;
+    f32_4x y = F32_4x(cell_y - (region_y << SIMPLEX_REGION_SIZE_LOG2)) * inv_scale;
+
+    f32_4x result = F32_4x_zero();
+    f32 amplitude = 0.5f;
+    f32 total_amplitude = 0;
+    for (u32 octave = 0; octave < octave_count; ++octave) {
+        result += simplex_noise_4x(region_seed + U32_4x(octave), x, y) * F32_4x(amplitude);
+        total_amplitude += amplitude;
+        amplitude *= 0.5f;
+        x *= F32_4x(2.0f);
+        y *= F32_4x(2.0f);
+    }
+    result *= F32_4x(1.0f / total_amplitude);
+    return result;
+}
+
+#if SIMD_8X
+// 8x versions repeat 4x ones operation by operation, so results are bit-exact with them
+
+f32_8x value_noise_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2) {
+    i32_8x lattice_x = cell_x >> scale_log2;
+    i32_8x lattice_y = cell_y >> scale_log2;
+    f32_8x inv_scale = F32_8x(1.0f / (f32)(1 << scale_log2));
+    f32_8x tx = F32_8x(cell_x - (lattice_x << scale_log2)) * inv_scale;
+    f32_8x ty = F32_8x(cell_y - (lattice_y << scale_log2)) * inv_scale;
+    tx = tx * tx * (F32_8x(3.0f) - F32_8x(2.0f) * tx);
+    ty = ty * ty * (F32_8x(3.0f) - F32_8x(2.0f) * ty);
+    i32_8x one = I32_8x(1);
+    f32_8x v00 = unit_f32(hash_cell_8x(seed, lattice_x,       lattice_y));
+    f32_8x v10 = unit_f32(hash_cell_8x(seed, lattice_x + one, lattice_y));
+    f32_8x v01 = unit_f32(hash_cell_8x(seed, lattice_x,       lattice_y + one));
+    f32_8x v11 = unit_f32(hash_cell_8x(seed, lattice_x + one, lattice_y + one));
+    f32_8x v0 = v00 + (v10 - v00) * tx;
+    f32_8x v1 = v01 + (v11 - v01) * tx;
+    f32_8x result = v0 + (v1 - v0) * ty;
+    return result;
+}
+
+f32_8x value_fbm_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2, u32 octave_count) {
+    assert(octave_count && octave_count <= scale_log2 + 1);
+    f32_8x result = F32_8x_zero();
+    f32 amplitude = 0.5f;
+    f32 total_amplitude = 0;
+    for (u32 octave = 0; octave < octave_count; ++octave) {
+        result += value_noise_8x(seed + octave, cell_x, cell_y, scale_log2 - octave) * F32_8x(amplitude);
+        total_amplitude += amplitude;
+        amplitude *= 0.5f;
+    }
+    result *= F32_8x(1.0f / total_amplitude);
+    return result;
+}
+
+inline f32_8x simplex_corner(u32_8x seed, i32_8x i, i32_8x j, f32_8x x, f32_8x y) {
+    u32_8x hash = hash_u32_8x(seed ^ hash_u32_8x(U32_8x(i) ^ hash_u32_8x(U32_8x(j))));
+    f32_8x sign_bit = F32_8x(-0.0f);
+    f32_8x flip_x = is_not_zero(hash & U32_8x(1)) & sign_bit;
+    f32_8x flip_y = is_not_zero(hash & U32_8x(2)) & sign_bit;
+    f32_8x dot = (x ^ flip_x) + (y ^ flip_y);
+    f32_8x t = Max(F32_8x(0.5f) - x * x - y * y, F32_8x_zero());
+    t = t * t;
+    f32_8x result = t * t * dot;
+    return result;
+}
+
+static f32_8x simplex_noise_8x(u32_8x seed, f32_8x x, f32_8x y) {
+    f32_8x s = (x + y) * F32_8x(SIMPLEX_F2);
+    f32_8x i_f = Floor(x + s);
+    f32_8x j_f = Floor(y + s);
+    f32_8x t = (i_f + j_f) * F32_8x(SIMPLEX_G2);
+    f32_8x x0 = x - (i_f - t);
+    f32_8x y0 = y - (j_f - t);
+    f32_8x upper = x0 > y0;
+    f32_8x i1 = upper & F32_8x(1.0f);
+    f32_8x j1 = F32_8x(1.0f) - i1;
+    f32_8x x1 = x0 - i1 + F32_8x(SIMPLEX_G2);
+    f32_8x y1 = y0 - j1 + F32_8x(SIMPLEX_G2);
+    f32_8x x2 = x0 - F32_8x(1.0f - 2.0f * SIMPLEX_G2);
+    f32_8x y2 = y0 - F32_8x(1.0f - 2.0f * SIMPLEX_G2);
+
+    i32_8x i = Floor_i32(i_f);
+    i32_8x j = Floor_i32(j_f);
+    i32_8x one = I32_8x(1);
+    i32_8x i1_int = Floor_i32(i1);
+    i32_8x j1_int = Floor_i32(j1);
+    f32_8x n = simplex_corner(seed, i, j, x0, y0) +
+        simplex_corner(seed, i + i1_int, j + j1_int, x1, y1) +
+        simplex_corner(seed, i + one, j + one, x2, y2);
+    f32_8x result = Min(Max(n * F32_8x(SIMPLEX_NORMALIZATION), F32_8x(-1.0f)), F32_8x(1.0f));
+    return result;
+}
+
+f32_8x simplex_noise_8x(u32 seed, f32_8x x, f32_8x y) {
+    return simplex_noise_8x(U32_8x(seed), x, y);
+}
+
+f32_8x simplex_fbm_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2, u32 octave_count) {
+    assert(octave_count && scale_log2 < SIMPLEX_REGION_SIZE_LOG2);
+    i32_8x region_x = cell_x >> SIMPLEX_REGION_SIZE_LOG2;
+    i32_8x region_y = cell_y >> SIMPLEX_REGION_SIZE_LOG2;
+    u32_8x region_seed = hash_cell_8x(seed, region_x, region_y);
+    f32_8x inv_scale = F32_8x(1.0f / (f32)(1 << scale_log2));
+    f32_8x x = F32_8x(cell_x - (region_x << SIMPLEX_REGION_SIZE_LOG2)) * inv_scale;
+    f32_8x y = F32_8x(cell_y - (region_y << SIMPLEX_REGION_SIZE_LOG2)) * inv_scale;
+
+    f32_8x result = F32_8x_zero();
+    f32 amplitude = 0.5f;
+    f32 total_amplitude = 0;
+    for (u32 octave = 0; octave < octave_count; ++octave) {
+        result += simplex_noise_8x(region_seed + U32_8x(octave), x, y) * F32_8x(amplitude);
+        total_amplitude += amplitude;
+        amplitude *= 0.5f;
+        x *= F32_8x(2.0f);
+        y *= F32_8x(2.0f);
+    }
+    result *= F32_8x(1.0f / total_amplitude);
+    return result;
+}
+#endif
@@ -0,0 +1,85 @@
+#if !defined(NOISE_HH)
+
+#include "lib.hh"
+
+//
+// Noise and hashing for procedural generation
+// Everything here is pure function of seed and coordinates, so results don't depend
+// on order of evaluation and can be computed on any thread
+//
+// 4x versions compute four independent samples at once, they are used by world generation
+// which evaluates several noise layers for every block of every chunk
+// 8x versions are the same for 8 samples, they only exist in builds with SIMD_8X and give
+// exactly the same values as 4x ones
+// Scalar versions are kept for single lookups and as reference for 4x ones
+//
+inline u32 hash_u32(u32 x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+    return x;
+}
+
+inline u32 hash_cell(u32 seed, i32 cell_x, i32 cell_y) {
+    return hash_u32(seed ^ hash_u32((u32)cell_x ^ hash_u32((u32)cell_y)));
+}
+
+// Maps hash to [0; 1)
+inline f32 hash_to_unit(u32 hash) {
+    return (f32)(hash >> 8) * (1.0f / (1 << 24));
+}
+
+inline u32_4x hash_u32_4x(u32_4x x) {
+    x ^= x >> 16;
+    x = x * U32_4x(0x7FEB352D);
+    x ^= x >> 15;
+    x = x * U32_4x(0x846CA68B);
+    x ^= x >> 16;
+    return x;
+}
+
+inline u32_4x hash_cell_4x(u32 seed, i32_4x cell_x, i32_4x cell_y) {
+    return hash_u32_4x(U32_4x(seed) ^ hash_u32_4x(U32_4x(cell_x) ^ hash_u32_4x(U32_4x(cell_y))));
+}
+
+#if SIMD_8X
+inline u32_8x hash_u32_8x(u32_8x x) {
+    x ^= x >> 16;
+    x = x * U32_8x(0x7FEB352D);
+    x ^= x >> 15;
+    x = x * U32_8x(0x846CA68B);
+    x ^= x >> 16;
+    return x;
+}
+
+inline u32_8x hash_cell_8x(u32 seed, i32_8x cell_x, i32_8x cell_y) {
+    return hash_u32_8x(U32_8x(seed) ^ hash_u32_8x(U32_8x(cell_x) ^ hash_u32_8x(U32_8x(cell_y))));
+}
+#endif
+
+// Value noise with lattice of (1 << scale_log2) cells, returns value in [0; 1)
+// Works on integer cell coordinates, so precision does not depend on how far from origin we are
+f32 value_noise(u32 seed, i32 cell_x, i32 cell_y, u32 scale_log2);
+f32_4x value_noise_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2);
+// Sum of value noise octaves, each next is twice smaller and has half the amplitude
+// Result is normalized to [0; 1)
+f32 value_fbm(u32 seed, i32 cell_x, i32 cell_y, u32 scale_log2, u32 octave_count);
+f32_4x value_fbm_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2, u32 octave_count);
+// 2D simplex noise, coordinates are in lattice units, returns value in [-1; 1]
+// Unlike value noise it has no visible grid artifacts, but costs more
+f32_4x simplex_noise_4x(u32 seed, f32_4x x, f32_4x y);
+// Simplex octaves, first octave has lattice of (1 << scale_log2) cells
+// Cell coordinates are converted to float relative to lattice, so precision does not
+// degrade far from origin
+f32_4x simplex_fbm_4x(u32 seed, i32_4x cell_x, i32_4x cell_y, u32 scale_log2, u32 octave_count);
+#if SIMD_8X
+f32_8x value_noise_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2);
+f32_8x value_fbm_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2, u32 octave_count);
+f32_8x simplex_noise_8x(u32 seed, f32_8x x, f32_8x y);
+f32_8x simplex_fbm_8x(u32 seed, i32_8x cell_x, i32_8x cell_y, u32 scale_log2, u32 octave_count);
+#endif
+
+#define NOISE_HH 1
+#endif
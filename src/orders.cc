@@ -1,50 +1,115 @@
 #include "orders.hh"
 
 u32 hash_order_description(Order order) {
-    return crc32(&order, sizeof(order));
+    u32 result = crc32(&order, sizeof(order));
+    // 0 is used as empty key in hash
+    if (!result) {
+        result = 1;
+    }
+    return result;
 }
 
-void init_order_system(OrderSystem *order_system, MemoryArena *arena) {
-    order_system->arena = arena;
-    CDLIST_INIT(&order_system->order_list);
+static void order_hash_init(OrderHash *hash, MemoryArena *arena, u32 capacity) {
+    assert(is_power_of_two(capacity));
+    hash->capacity = capacity;
+    hash->count = 0;
+    hash->entries = alloc_arr(arena, capacity, OrderHashEntry);
 }
 
-OrderHash *get_order_hash(OrderSystem *sys, OrderID id) {
-    if (IS_NULL(id)) {
-        return 0;
-    }
-    
-    OrderHash *result = 0;
-    u32 hash_value = id.value;
-    u32 hash_mask = ARRAY_SIZE(sys->order_hash) - 1;
-    for (size_t offset = 0; offset < ARRAY_SIZE(sys->order_hash); ++offset) {
-        u32 hash_idx = ((hash_value + offset) & hash_mask);
-        OrderHash *test = sys->order_hash + hash_idx;
-        if (IS_NULL(test->id) || IS_SAME(test->id, id)) {
+// Returns entry with given key, or empty entry where key should be inserted
+static OrderHashEntry *order_hash_probe(OrderHash *hash, u32 key) {
+    assert(key);
+    OrderHashEntry *result = 0;
+    u32 hash_mask = hash->capacity - 1;
+    // Table is never full, so there is always empty entry that ends probe chain
+    for (u32 hash_idx = key & hash_mask;; hash_idx = (hash_idx + 1) & hash_mask) {
+        OrderHashEntry *test = hash->entries + hash_idx;
+        if (!test->key || test->key == key) {
             result = test;
             break;
         }
     }
-    
     return result;
 }
 
-OrderSlot *get_order_slot_by_id(OrderSystem *sys, OrderID id) {
-    if (IS_NULL(id)) {
-        return 0;
+static void order_hash_grow(OrderHash *hash, MemoryArena *arena) {
+    OrderHash old = *hash;
+    order_hash_init(hash, arena, old.capacity * 2);
+    for (u32 entry_idx = 0; entry_idx < old.capacity; ++entry_idx) {
+        OrderHashEntry *entry = old.entries + entry_idx;
+        if (entry->key) {
+            OrderHashEntry *dst = order_hash_probe(hash, entry->key);
+            assert(!dst->key);
+            *dst = *entry;
+            ++hash->count;
+        }
     }
-    
+    assert(hash->count == old.count);
+}
+
+static OrderSlot *order_hash_get(OrderHash *hash, u32 key) {
     OrderSlot *result = 0;
-    OrderHash *hash = get_order_hash(sys, id);
-    if (hash) {
-        result = hash->ptr;
+    if (key) {
+        OrderHashEntry *entry = order_hash_probe(hash, key);
+        result = entry->ptr;
+    }
+    return result;
+}
+
+static void order_hash_add(OrderSystem *sys, OrderHash *hash, u32 key, OrderSlot *ptr) {
+    if ((hash->count + 1) * 100 > hash->capacity * ORDERS_HASH_MAX_LOAD_PERCENT) {
+        order_hash_grow(hash, sys->arena);
+        ++sys->hash_grow_count;
+    }
+
+    OrderHashEntry *entry = order_hash_probe(hash, key);
+    assert(!entry->key);
+    entry->key = key;
+    entry->ptr = ptr;
+    ++hash->count;
+}
+
+static void order_hash_remove(OrderHash *hash, u32 key) {
+    OrderHashEntry *entry = order_hash_probe(hash, key);
+    assert(entry->key == key);
+    u32 hash_mask = hash->capacity - 1;
+    u32 hole_idx = (u32)(entry - hash->entries);
+    // Backward shift deletion - move entries that are after the hole in probe chain
+    // into it if hole is between their home position and current position
+    for (u32 test_idx = (hole_idx + 1) & hash_mask;; test_idx = (test_idx + 1) & hash_mask) {
+        OrderHashEntry *test = hash->entries + test_idx;
+        if (!test->key) {
+            break;
+        }
+
+        u32 home_idx = test->key & hash_mask;
+        u32 distance_to_hole = (test_idx - hole_idx) & hash_mask;
+        u32 distance_to_home = (test_idx - home_idx) & hash_mask;
+        if (distance_to_home >= distance_to_hole) {
+            hash->entries[hole_idx] = *test;
+            hole_idx = test_idx;
+        }
     }
+    hash->entries[hole_idx] = {};
+    --hash->count;
+}
+
+void init_order_system(OrderSystem *order_system, MemoryArena *arena) {
+    order_system->arena = arena;
+    order_hash_init(&order_system->id_hash, arena, ORDERS_HASH_INITIAL_SIZE);
+    order_hash_init(&order_system->description_hash, arena, ORDERS_HASH_INITIAL_SIZE);
+    CDLIST_INIT(&order_system->pending_list);
+    CDLIST_INIT(&order_system->assigned_list);
+}
+
+OrderSlot *get_order_slot_by_id(OrderSystem *sys, OrderID id) {
+    OrderSlot *result = order_hash_get(&sys->id_hash, id.value);
     return result;
 }
 
 static OrderSlot *create_order_slot(OrderSystem *sys) {
     OrderID id = { ++sys->last_order_id_value };
-    
+
     OrderSlot *order = sys->first_free_slot;
     if (!order) {
         ++sys->orders_allocated;
@@ -56,13 +121,10 @@ static OrderSlot *create_order_slot(OrderSystem *sys) {
     // Add to list
     OrderListEntry *list_entry = &order->list_entry;
     list_entry->id = id;
-    CDLIST_ADD(&sys->order_list, list_entry);
-    
+    CSLIST_ADD_LAST(&sys->pending_list, list_entry);
     // Add to hash
-    OrderHash *hash = get_order_hash(sys, id);
-    assert(hash->ptr == 0);
-    hash->id = id;
-    hash->ptr = order;
+    order_hash_add(sys, &sys->id_hash, id.value, order);
+    ++sys->order_count;
     return order;
 }
 
@@ -77,37 +139,25 @@ Order *get_order_by_id(OrderSystem *sys, OrderID id) {
 
 OrderID get_pending_order_id(OrderSystem *sys) {
     OrderID result = {};
-    CDLIST_ITER(iter, &sys->order_list) {
-        OrderID id = iter->id;
-        OrderSlot *slot = get_order_slot_by_id(sys, id);
-        if (slot->state == ORDER_STATE_PENDING) {
-            result = id;
-            break;
-        }
+    // Pending list is kept in order of addition, so oldest orders are assigned first
+    if (sys->pending_list.next != &sys->pending_list) {
+        result = sys->pending_list.next->id;
+        assert(get_order_slot_by_id(sys, result)->state == ORDER_STATE_PENDING);
     }
     return result;
 }
 
 OrderID try_to_add_order(OrderSystem *sys, Order order) {
     OrderID result = {};
-    
-    bool same_description_exists = false;
+
     u32 description_hash = hash_order_description(order);
-    CDLIST_ITER(iter, &sys->order_list) {
-        OrderID id = iter->id;
-        OrderSlot *slot = get_order_slot_by_id(sys, id);
-        assert(slot);
-        if (slot->description_hash == description_hash) {
-            same_description_exists = true;
-            break;
-        }
-    }
-    
+    bool same_description_exists = order_hash_get(&sys->description_hash, description_hash) != 0;
     if (!same_description_exists) {
         OrderSlot *slot = create_order_slot(sys);
         slot->description_hash = description_hash;
         slot->order = order;
         slot->state = ORDER_STATE_PENDING;
+        order_hash_add(sys, &sys->description_hash, description_hash, slot);
         result = slot->id;
     }
     return result;
@@ -118,6 +168,8 @@ void set_order_assigned(OrderSystem *sys, OrderID id) {
     assert(slot);
     assert(slot->state == ORDER_STATE_PENDING);
     slot->state = ORDER_STATE_ASSIGNED;
+    CDLIST_REMOVE(&slot->list_entry);
+    CSLIST_ADD_LAST(&sys->assigned_list, &slot->list_entry);
 }
 
 void set_order_unassigned(OrderSystem *sys, OrderID id) {
@@ -125,13 +177,17 @@ void set_order_unassigned(OrderSystem *sys, OrderID id) {
     assert(slot);
     assert(slot->state == ORDER_STATE_ASSIGNED);
     slot->state = ORDER_STATE_PENDING;
+    CDLIST_REMOVE(&slot->list_entry);
+    CSLIST_ADD_LAST(&sys->pending_list, &slot->list_entry);
 }
 
 void disband_order(OrderSystem *sys, OrderID id) {
-    OrderHash *hash = get_order_hash(sys, id);
-    OrderSlot *slot = hash->ptr;
+    OrderSlot *slot = get_order_slot_by_id(sys, id);
+    assert(slot);
     CDLIST_REMOVE(&slot->list_entry);
-    hash->ptr = 0;
-    hash->id = {};
-    LLIST_ADD_OR_CREATE(&sys->first_free_slot, slot);
-}
\ No newline at end of file
+    order_hash_remove(&sys->id_hash, id.value);
+    order_hash_remove(&sys->description_hash, slot->description_hash);
+    slot->state = ORDER_STATE_NONE;
+    --sys->order_count;
+    LLIST_ADD(sys->first_free_slot, slot);
+}
@@ -21,12 +21,16 @@
 enum {
     ORDER_NONE = 0x0,
     ORDER_CHOP,
+    // Build construction site that is destination
+    ORDER_BUILD,
 };
 
 // Actual order description 
 struct Order {
     u32 kind;
     EntityID destination_id;
+    // Orders that differ only in slot can exist together, so several pawns can work on same destination
+    u32 slot;
 };
 
 struct OrderListEntry {
@@ -47,29 +51,50 @@ struct OrderSlot {
     u32 description_hash;
     Order order;
     // Needed for deletion, we can have it stack allocated since slot exist only while list entry exists
+    // Entry is stored in pending or assigned list, depending on state
     OrderListEntry list_entry;
     // Needed for free list
     OrderSlot *next;
 };
 
-struct OrderHash {
-    OrderID id;
+// Open-addressing hash table from u32 key to order slot
+// Key 0 marks empty entry. Deletion is done with backward shift, so there are
+// no tombstones and probe chains are always as short as if deleted keys were never inserted
+// Table grows when load factor gets over ORDERS_HASH_MAX_LOAD_PERCENT, new storage is taken from 
+// order system arena. Old storage is not reused - since capacity doubles each time, 
+// wasted memory is never greater than current table size
+struct OrderHashEntry {
+    u32 key;
     OrderSlot *ptr;
 };
 
-#define ORDERS_HASH_SIZE 512
-CT_ASSERT(IS_POW2(ORDERS_HASH_SIZE));
+struct OrderHash {
+    u32 capacity;
+    u32 count;
+    OrderHashEntry *entries;
+};
+
+#define ORDERS_HASH_INITIAL_SIZE 512
+#define ORDERS_HASH_MAX_LOAD_PERCENT 70
+CT_ASSERT(IS_POW2(ORDERS_HASH_INITIAL_SIZE));
 
 struct OrderSystem {
     // Needed to allocte orders and order list
     MemoryArena *arena;
     // Continiously incremented
     u32 last_order_id_value;
-    // Size of hash is not a probles since pointers are used here
-    OrderHash order_hash[ORDERS_HASH_SIZE];
-    OrderListEntry order_list;
+    // Order id -> order slot
+    OrderHash id_hash;
+    // Order description hash -> order slot, used to check for duplicates when adding new order
+    OrderHash description_hash;
+    // Orders waiting for assignment and orders that are already assigned are stored in separate lists,
+    // so getting pending order does not have to skip all assigned ones
+    OrderListEntry pending_list;
+    OrderListEntry assigned_list;
     
+    u32 order_count;
     u32 orders_allocated;
+    u32 hash_grow_count;
     OrderSlot *first_free_slot;
 };
 
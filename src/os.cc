@@ -29,15 +29,46 @@ typedef CO_INITIALIZE_EX(CoInitializeEx_);
 typedef XINPUT_GET_STATE(XInputGetState_);
 typedef XINPUT_SET_STATE(XInputSetState_);
 
+struct WorkQueueEntry {
+    WorkQueueCallback *callback;
+    void *data;
+};
+
+#define WORK_QUEUE_SIZE 256
+#define MAX_WORKER_THREADS 16
+// Circular buffer of entries - writer advances next_entry_to_write, 
+// workers compete for next_entry_to_read with compare exchange
+struct WorkQueue {
+    volatile i32 completion_goal;
+    volatile i32 completion_count;
+    volatile i32 next_entry_to_write;
+    volatile i32 next_entry_to_read;
+    // Shared by both queues, so sleeping worker wakes up for entry in any of them
+    HANDLE semaphore;
+    // Workers are shared by both queues too
+    u32 worker_count;
+    
+    WorkQueueEntry entries[WORK_QUEUE_SIZE];
+};
+
 struct OS {
     MemoryArena arena;
     
+    WorkQueue work_queue;
+    WorkQueue high_priority_work_queue;
+    u32 worker_thread_count;
+    
     bool old_fullscreen;
-    bool old_vsync;    
     
     Platform platform;
     HINSTANCE instance;
     HWND hwnd;
+    // Context is current on render thread after os_start_render_thread
+    HDC hwnd_dc;
+    HGLRC gl_rc;
+    bool swap_vsync;
+    RenderThreadProc *render_thread_proc;
+    void *render_thread_data;
     
     LARGE_INTEGER last_frame_time;
     LARGE_INTEGER game_start_time;
@@ -250,10 +281,149 @@ static void check_for_sse() {
     }
 }
 
+// Returns true if there was no work to do
+static bool do_next_work_queue_entry(WorkQueue *queue) {
+    bool should_sleep = false;
+    i32 original_next_entry_to_read = queue->next_entry_to_read;
+    i32 new_next_entry_to_read = (original_next_entry_to_read + 1) % WORK_QUEUE_SIZE;
+    if (original_next_entry_to_read != queue->next_entry_to_write) {
+        i32 index = interlocked_compare_exchange(&queue->next_entry_to_read, new_next_entry_to_read, original_next_entry_to_read);
+        if (index == original_next_entry_to_read) {
+            WorkQueueEntry entry = queue->entries[index];
+            entry.callback(entry.data);
+            interlocked_increment(&queue->completion_count);
+        }
+    } else {
+        should_sleep = true;
+    }
+    return should_sleep;
+}
+
+// Entries of normal queue are only taken when high priority queue is empty
+static DWORD WINAPI worker_thread_proc(LPVOID param) {
+    OS *os = (OS *)param;
+    for (;;) {
+        if (do_next_work_queue_entry(&os->high_priority_work_queue) && do_next_work_queue_entry(&os->work_queue)) {
+            WaitForSingleObjectEx(os->work_queue.semaphore, INFINITE, FALSE);
+        }
+    }
+}
+
+static void init_work_queue(OS *os) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    // Main thread does its own work, so leave one core for it
+    u32 worker_thread_count = system_info.dwNumberOfProcessors > 1 ? system_info.dwNumberOfProcessors - 1 : 1;
+    if (worker_thread_count > MAX_WORKER_THREADS) {
+        worker_thread_count = MAX_WORKER_THREADS;
+    }
+    os->worker_thread_count = worker_thread_count;
+    os->work_queue.worker_count = worker_thread_count;
+    os->high_priority_work_queue.worker_count = worker_thread_count;
+    
+    HANDLE semaphore = CreateSemaphoreExA(0, 0, worker_thread_count, 0, 0, SEMAPHORE_ALL_ACCESS);
+    assert(semaphore);
+    os->work_queue.semaphore = semaphore;
+    os->high_priority_work_queue.semaphore = semaphore;
+    for (u32 thread_idx = 0; thread_idx < worker_thread_count; ++thread_idx) {
+        HANDLE thread = CreateThread(0, 0, worker_thread_proc, os, 0, 0);
+        assert(thread);
+        CloseHandle(thread);
+    }
+}
+
+WorkQueue *os_get_work_queue(OS *os) {
+    return &os->work_queue;
+}
+
+WorkQueue *os_get_high_priority_work_queue(OS *os) {
+    return &os->high_priority_work_queue;
+}
+
+u32 get_work_queue_worker_count(WorkQueue *queue) {
+    return queue->worker_count;
+}
+
+bool add_work_queue_entry(WorkQueue *queue, WorkQueueCallback *callback, void *data) {
+    bool result = false;
+    i32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % WORK_QUEUE_SIZE;
+    if (new_next_entry_to_write != queue->next_entry_to_read) {
+        WorkQueueEntry *entry = queue->entries + queue->next_entry_to_write;
+        entry->callback = callback;
+        entry->data = data;
+        ++queue->completion_goal;
+        // Entry must be written before workers can see it
+        _WriteBarrier();
+        queue->next_entry_to_write = new_next_entry_to_write;
+        ReleaseSemaphore(queue->semaphore, 1, 0);
+        result = true;
+    }
+    return result;
+}
+
+void complete_all_work(WorkQueue *queue) {
+    while (queue->completion_goal != queue->completion_count) {
+        // Remaining entries are taken by workers - give them the core if there are more threads than cores
+        if (do_next_work_queue_entry(queue)) {
+            SwitchToThread();
+        }
+    }
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+}
+
+void init_semaphore(Semaphore *semaphore, u32 initial_count, u32 max_count) {
+    CT_ASSERT(sizeof(semaphore->storage) >= sizeof(HANDLE));
+    HANDLE handle = CreateSemaphoreExA(0, initial_count, max_count, 0, 0, SEMAPHORE_ALL_ACCESS);
+    assert(handle);
+    memcpy(semaphore->storage, &handle, sizeof(handle));
+}
+
+void wait_semaphore(Semaphore *semaphore) {
+    WaitForSingleObjectEx(*(HANDLE *)semaphore->storage, INFINITE, FALSE);
+}
+
+void signal_semaphore(Semaphore *semaphore) {
+    ReleaseSemaphore(*(HANDLE *)semaphore->storage, 1, 0);
+}
+
+static DWORD WINAPI render_thread_entry(LPVOID param) {
+    OS *os = (OS *)param;
+    os->wglMakeCurrent(os->hwnd_dc, os->gl_rc);
+    os->render_thread_proc(os->render_thread_data);
+    return 0;
+}
+
+void os_start_render_thread(OS *os, RenderThreadProc *proc, void *data) {
+    os->render_thread_proc = proc;
+    os->render_thread_data = data;
+    // Context can be current only on one thread
+    os->wglMakeCurrent(0, 0);
+    HANDLE thread = CreateThread(0, 0, render_thread_entry, os, 0, 0);
+    assert(thread);
+    CloseHandle(thread);
+}
+
+void os_swap_buffers(OS *os, bool vsync) {
+    if (os->swap_vsync != vsync) {
+        os->wglSwapIntervalEXT(vsync);
+        os->swap_vsync = vsync;
+    }
+    os->wglSwapLayerBuffers(os->hwnd_dc, WGL_SWAP_MAIN_PLANE);
+}
+
+OS *os_init_headless() {
+    OS *os = bootstrap_alloc_struct(OS, arena);
+    check_for_sse();
+    init_work_queue(os);
+    return os;
+}
+
 OS *os_init(vec2 *display_size) {
     OS *os = bootstrap_alloc_struct(OS, arena);
     
     check_for_sse();
+    init_work_queue(os);
     
     // Set working directory
     char executable_directory[MAX_PATH];
@@ -372,6 +542,8 @@ OS *os_init(vec2 *display_size) {
     };
     HGLRC gl_rc = os->wglCreateContextAttribsARB(hwnd_dc, 0, opengl_attributes);
     os->wglMakeCurrent(hwnd_dc, gl_rc);
+    os->hwnd_dc = hwnd_dc;
+    os->gl_rc = gl_rc;
     
 #define GLPROC(_name, _type)                                                   \
 *(void **)&_name = (void *)os->wglGetProcAddress(#_name);                  \
@@ -381,7 +553,7 @@ if (!_name) assert(!"Failed to load " #_name " OGL procedure.");
 #undef GLPROC
     
 #define DEFAULT_VSYNC true 
-    os->platform.vsync = DEFAULT_VSYNC;
+    os->swap_vsync = DEFAULT_VSYNC;
     os->wglSwapIntervalEXT(DEFAULT_VSYNC);
     // Sound
     os->sound_channels = 2;
@@ -636,7 +808,6 @@ Platform *os_begin_frame(OS *os) {
     input->sample_count_to_output = sound_sample_count_to_output;
     input->samples_per_second = os->sound_samples_per_sec;
     
-    os->old_vsync = input->vsync;
     os->old_fullscreen = input->fullscreen;
     
     return input;
@@ -646,11 +817,6 @@ void os_end_frame(OS *os) {
     TIMED_FUNCTION();
     fill_sound_buffer(os, os->platform.sound_samples, os->platform.sample_count_to_output);
     
-    if (os->old_vsync != os->platform.vsync) {
-        os->wglSwapIntervalEXT(os->platform.vsync);
-    }
-    os->wglSwapLayerBuffers(os->wglGetCurrentDC(), WGL_SWAP_MAIN_PLANE);
-    
     if (os->old_fullscreen != os->platform.fullscreen) {
         go_fullscreen(os, os->platform.fullscreen);
     }
@@ -670,6 +836,14 @@ RealWorldTime get_real_world_time() {
     return result;
 }
 
+f64 get_time() {
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+
 void mkdir(const char *name) {
     HRESULT result = CreateDirectoryA(name, 0);
     UNREFERENCED_VARIABLE(result);
@@ -23,12 +23,17 @@ struct OS;
 
 // @CLEANUP do we really have to do this ugly display_size passing?
 OS *os_init(vec2 *display_size);
+// Initializes only parts that don't need window, graphics or sound - used by 
+// headless tools. Functions that work with window must not be called then
+OS *os_init_headless();
 
 void init_renderer_backend(OS *os);
 Platform *os_begin_frame(OS *os);
 void os_end_frame(OS *os);
 
 RealWorldTime get_real_world_time();
+// High resolution wall clock time in seconds, from unspecified point
+f64 get_time();
 // Virtual memory management
 void *os_alloc(size_t size);
 void os_free(void *ptr);
@@ -44,6 +49,47 @@ void DEBUG_out_string(const char *format, ...);
 
 void mkdir(const char *name);
 void sleep(u32 ms);
+//
+// Multithreading
+// Work queue is filled by single thread, and entries are executed by worker threads created in os_init
+// Entries are started in order of addition but can finish in any order, so
+// callbacks should only write to data they were given
+// Profiler keeps timelines only of few threads - callbacks should not use TIMED_FUNCTION and others
+struct WorkQueue;
+#define WORK_QUEUE_CALLBACK(_name) void _name(void *data)
+typedef WORK_QUEUE_CALLBACK(WorkQueueCallback);
+
+WorkQueue *os_get_work_queue(OS *os);
+// Workers take entries of this queue before entries of normal queue, so jobs that frame waits for
+// don't wait behind long background jobs like world generation
+WorkQueue *os_get_high_priority_work_queue(OS *os);
+// Worker threads that take entries of queue, thread that calls complete_all_work is not counted
+u32 get_work_queue_worker_count(WorkQueue *queue);
+// Returns false if queue is full, caller can try again later
+bool add_work_queue_entry(WorkQueue *queue, WorkQueueCallback *callback, void *data);
+// Calling thread takes part in execution of remaining entries of this queue only
+void complete_all_work(WorkQueue *queue);
+
+// Semaphore that threads hand work to each other with, its count never goes above max_count
+// Storage is u64 so posix semaphore can be placed in it
+struct Semaphore {
+    u64 storage[4];
+};
+
+void init_semaphore(Semaphore *semaphore, u32 initial_count, u32 max_count);
+// Blocks until count is not zero and decrements it
+void wait_semaphore(Semaphore *semaphore);
+void signal_semaphore(Semaphore *semaphore);
+//
+// Render thread
+// Graphics context is created on main thread in os_init. os_start_render_thread moves it to new thread
+// that runs proc, and after that only this thread can make graphics calls and swap buffers
+#define RENDER_THREAD_PROC(_name) void _name(void *data)
+typedef RENDER_THREAD_PROC(RenderThreadProc);
+
+void os_start_render_thread(OS *os, RenderThreadProc *proc, void *data);
+// Shows frame drawn by render thread, swap interval is changed when vsync differs from last call
+void os_swap_buffers(OS *os, bool vsync);
 
 #define OS_H 1
 #endif
@@ -0,0 +1,278 @@
+#include "os.hh"
+
+//
+// Posix platform layer
+// Only headless part of os api is implemented here - memory, files, time and threads
+// It is used to build tools that run game simulation without window on Linux,
+// game itself uses os.cc
+//
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+struct WorkQueueEntry {
+    WorkQueueCallback *callback;
+    void *data;
+};
+
+#define WORK_QUEUE_SIZE 256
+#define MAX_WORKER_THREADS 16
+// Circular buffer of entries - writer advances next_entry_to_write,
+// workers compete for next_entry_to_read with compare exchange
+struct WorkQueue {
+    volatile i32 completion_goal;
+    volatile i32 completion_count;
+    volatile i32 next_entry_to_write;
+    volatile i32 next_entry_to_read;
+    // Shared by both queues, so sleeping worker wakes up for entry in any of them
+    sem_t *semaphore;
+    // Workers are shared by both queues too
+    u32 worker_count;
+
+    WorkQueueEntry entries[WORK_QUEUE_SIZE];
+};
+
+struct OS {
+    MemoryArena arena;
+
+    WorkQueue work_queue;
+    WorkQueue high_priority_work_queue;
+    sem_t work_semaphore;
+    u32 worker_thread_count;
+};
+
+// Returns true if there was no work to do
+static bool do_next_work_queue_entry(WorkQueue *queue) {
+    bool should_sleep = false;
+    i32 original_next_entry_to_read = queue->next_entry_to_read;
+    i32 new_next_entry_to_read = (original_next_entry_to_read + 1) % WORK_QUEUE_SIZE;
+    if (original_next_entry_to_read != queue->next_entry_to_write) {
+        i32 index = interlocked_compare_exchange(&queue->next_entry_to_read, new_next_entry_to_read, original_next_entry_to_read);
+        if (index == original_next_entry_to_read) {
+            WorkQueueEntry entry = queue->entries[index];
+            entry.callback(entry.data);
+            interlocked_increment(&queue->completion_count);
+        }
+    } else {
+        should_sleep = true;
+    }
+    return should_sleep;
+}
+
+// Entries of normal queue are only taken when high priority queue is empty
+static void *worker_thread_proc(void *param) {
+    OS *os = (OS *)param;
+    for (;;) {
+        if (do_next_work_queue_entry(&os->high_priority_work_queue) && do_next_work_queue_entry(&os->work_queue)) {
+            sem_wait(&os->work_semaphore);
+        }
+    }
+    return 0;
+}
+
+static void init_work_queue(OS *os) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    u32 processor_count = 1;
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        processor_count = CPU_COUNT(&cpu_set);
+    }
+    // Main thread does its own work, so leave one core for it
+    u32 worker_thread_count = processor_count > 1 ? processor_count - 1 : 1;
+    if (worker_thread_count > MAX_WORKER_THREADS) {
+        worker_thread_count = MAX_WORKER_THREADS;
+    }
+    os->worker_thread_count = worker_thread_count;
+    os->work_queue.worker_count = worker_thread_count;
+    os->high_priority_work_queue.worker_count = worker_thread_count;
+
+    int result = sem_init(&os->work_semaphore, 0, 0);
+    assert(result == 0);
+    os->work_queue.semaphore = &os->work_semaphore;
+    os->high_priority_work_queue.semaphore = &os->work_semaphore;
+    for (u32 thread_idx = 0; thread_idx < worker_thread_count; ++thread_idx) {
+        pthread_t thread;
+        result = pthread_create(&thread, 0, worker_thread_proc, os);
+        assert(result == 0);
+        pthread_detach(thread);
+    }
+}
+
+WorkQueue *os_get_work_queue(OS *os) {
+    return &os->work_queue;
+}
+
+WorkQueue *os_get_high_priority_work_queue(OS *os) {
+    return &os->high_priority_work_queue;
+}
+
+u32 get_work_queue_worker_count(WorkQueue *queue) {
+    return queue->worker_count;
+}
+
+bool add_work_queue_entry(WorkQueue *queue, WorkQueueCallback *callback, void *data) {
+    bool result = false;
+    i32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % WORK_QUEUE_SIZE;
+    if (new_next_entry_to_write != queue->next_entry_to_read) {
+        WorkQueueEntry *entry = queue->entries + queue->next_entry_to_write;
+        entry->callback = callback;
+        entry->data = data;
+        ++queue->completion_goal;
+        // Entry must be written before workers can see it
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        queue->next_entry_to_write = new_next_entry_to_write;
+        sem_post(queue->semaphore);
+        result = true;
+    }
+    return result;
+}
+
+void complete_all_work(WorkQueue *queue) {
+    while (queue->completion_goal != queue->completion_count) {
+        // Remaining entries are taken by workers - give them the core if there are more threads than cores
+        if (do_next_work_queue_entry(queue)) {
+            sched_yield();
+        }
+    }
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+}
+
+// Posix semaphores have no maximum count, max_count is only checked
+void init_semaphore(Semaphore *semaphore, u32 initial_count, u32 max_count) {
+    CT_ASSERT(sizeof(semaphore->storage) >= sizeof(sem_t));
+    assert(initial_count <= max_count);
+    int result = sem_init((sem_t *)semaphore->storage, 0, initial_count);
+    assert(result == 0);
+}
+
+void wait_semaphore(Semaphore *semaphore) {
+    while (sem_wait((sem_t *)semaphore->storage) != 0) {
+        // Interrupted by signal
+    }
+}
+
+void signal_semaphore(Semaphore *semaphore) {
+    sem_post((sem_t *)semaphore->storage);
+}
+
+OS *os_init_headless() {
+    OS *os = bootstrap_alloc_struct(OS, arena);
+    init_work_queue(os);
+    return os;
+}
+
+RealWorldTime get_real_world_time() {
+    struct timespec spec;
+    clock_gettime(CLOCK_REALTIME, &spec);
+    struct tm time;
+    localtime_r(&spec.tv_sec, &time);
+    RealWorldTime result;
+    result.year = time.tm_year + 1900;
+    result.month = time.tm_mon + 1;
+    result.day = time.tm_mday;
+    result.hour = time.tm_hour;
+    result.minute = time.tm_min;
+    result.second = time.tm_sec;
+    result.millisecond = (u32)(spec.tv_nsec / 1000000);
+    return result;
+}
+
+f64 get_time() {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (f64)spec.tv_sec + (f64)spec.tv_nsec * 1e-9;
+}
+
+void mkdir(const char *name) {
+    int result = mkdir(name, 0755);
+    UNREFERENCED_VARIABLE(result);
+    // @TODO errors
+}
+
+// Stdio is used instead of file descriptors, because unistd.h declares sleep
+// that conflicts with ours
+FileHandle open_file(const char *name, bool read) {
+    FileHandle result = {};
+    CT_ASSERT(sizeof(result.storage) >= sizeof(FILE *));
+    FILE *file = fopen(name, read ? "rb" : "wb");
+    result.no_errors = (file != 0);
+    memcpy(result.storage, &file, sizeof(file));
+    return result;
+}
+
+bool file_handle_valid(FileHandle handle) {
+    return handle.no_errors;
+}
+
+size_t get_file_size(FileHandle handle) {
+    FILE *file = *((FILE **)handle.storage);
+    fseek(file, 0, SEEK_END);
+    size_t result = (size_t)ftell(file);
+    return result;
+}
+
+void read_file(FileHandle handle, size_t offset, size_t size, void *dest) {
+    if (handle.no_errors) {
+        FILE *file = *((FILE **)handle.storage);
+        if (fseek(file, (long)offset, SEEK_SET) == 0 && fread(dest, 1, size, file) == size) {
+            // Success
+        } else {
+            INVALID_CODE_PATH;
+        }
+    }
+}
+
+void write_file(FileHandle handle, size_t offset, size_t size, const void *source) {
+    if (handle.no_errors) {
+        FILE *file = *((FILE **)handle.storage);
+        if (fseek(file, (long)offset, SEEK_SET) == 0 && fwrite(source, 1, size, file) == size) {
+            // Success
+        } else {
+            INVALID_CODE_PATH;
+        }
+    }
+}
+
+void close_file(FileHandle handle) {
+    int result = fclose(*((FILE **)handle.storage));
+    assert(result == 0);
+}
+
+void sleep(u32 ms) {
+    struct timespec spec;
+    spec.tv_sec = ms / 1000;
+    spec.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&spec, 0);
+}
+
+// Memory is reserved and committed at once like on windows, pages are zero and
+// physical memory is used only when they are touched
+// Size is stored before returned pointer, so memory can be unmapped
+#define OS_ALLOC_HEADER_SIZE 16
+void *os_alloc(size_t size) {
+    void *memory = mmap(0, size + OS_ALLOC_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(memory != MAP_FAILED);
+    *(size_t *)memory = size + OS_ALLOC_HEADER_SIZE;
+    return (u8 *)memory + OS_ALLOC_HEADER_SIZE;
+}
+
+void os_free(void *ptr) {
+    if (ptr) {
+        u8 *memory = (u8 *)ptr - OS_ALLOC_HEADER_SIZE;
+        munmap(memory, *(size_t *)memory);
+    }
+}
+
+size_t outf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    char buffer[4096];
+    size_t len = vsnprintf(buffer, sizeof(buffer), format, args);
+    fwrite(buffer, 1, len, stdout);
+    va_end(args);
+    return len;
+}
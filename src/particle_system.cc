@@ -40,9 +40,7 @@ void update_and_render_particles(ParticleSystem *sys, RenderGroup *render_group,
                 f32 e = particle->e.e[local_idx];
                 
                 if (e > 0.0) {
-                    vec3 billboard[4];
-                    get_billboard_positions(p, cam_x, cam_y, 0.05, 0.05, billboard);
-                    push_quad(render_group, billboard[0], billboard[1], billboard[2], billboard[3], RED);
+                    push_billboard(render_group, p, cam_x, cam_y, Vec2(0.05f, 0.05f), RED);
                     ++DEBUG_number_drawed;
                 }
             }
@@ -51,8 +51,14 @@ static RendererCommandQuads *get_current_quads(RendererCommands *commands) {
     RendererCommandQuads *result = 0;
     if (commands->last_header && commands->last_header->type == RENDERER_COMMAND_QUADS) {
         result = (RendererCommandQuads *)(commands->last_header + 1);
-        ++result->quad_count;
-    } else {
+        if (commands->vertex_count + 4 <= result->vertex_array_offset + RENDERER_VERTEX_PAGE_SIZE) {
+            ++result->quad_count;
+        } else {
+            result = 0;
+        }
+    }
+    
+    if (!result) {
         result = push_command(commands, RendererCommandQuads, RENDERER_COMMAND_QUADS);
         if (result) {
             result->index_array_offset = commands->index_count;
@@ -63,6 +69,31 @@ static RendererCommandQuads *get_current_quads(RendererCommands *commands) {
     return result;
 }
 
+static RendererCommandSprites *get_current_sprites(RendererCommands *commands, vec3 x_axis, vec3 y_axis) {
+    RendererCommandSprites *result = 0;
+    if (commands->last_header && commands->last_header->type == RENDERER_COMMAND_SPRITES) {
+        result = (RendererCommandSprites *)(commands->last_header + 1);
+        bool same_axes = result->x_axis.x == x_axis.x && result->x_axis.y == x_axis.y && result->x_axis.z == x_axis.z &&
+            result->y_axis.x == y_axis.x && result->y_axis.y == y_axis.y && result->y_axis.z == y_axis.z;
+        if (!same_axes) {
+            result = 0;
+        }
+    }
+    
+    if (result) {
+        ++result->sprite_count;
+    } else {
+        result = push_command(commands, RendererCommandSprites, RENDERER_COMMAND_SPRITES);
+        if (result) {
+            result->x_axis = x_axis;
+            result->y_axis = y_axis;
+            result->sprite_array_offset = commands->sprite_count;
+            result->sprite_count = 1;
+        }
+    }
+    return result;
+}
+
 void begin_separated_rendering(RendererCommands *commands) {
     push_command_no_storage(commands, RENDERER_COMMAND_BEGIN_SEPARATED);
 }
@@ -90,6 +121,54 @@ void end_depth_peel(RendererCommands *commands) {
     push_command_no_storage(commands, RENDERER_COMMAND_END_DEPTH_PEELING);
 }
 
+static u16 pack_uv(f32 uv) {
+    assert(uv >= 0.0f && uv <= 1.0f);
+    return (u16)Round_i32(uv * RENDERER_UV_MAX);
+}
+
+// Writes 4 vertices and 6 indices of quad, base index is index of first vertex relative to draw call
+static void write_quad(Vertex *vertex_buffer, RENDERER_INDEX_TYPE *index_buffer, RENDERER_INDEX_TYPE base_index,
+                       vec3 v00, vec3 v01, vec3 v10, vec3 v11,
+                       vec4 c00, vec4 c01, vec4 c10, vec4 c11,
+                       vec2 uv00, vec2 uv01, vec2 uv10, vec2 uv11,
+                       Texture texture) {
+    vec2 uv_scale = Vec2(texture.width, texture.height) * RENDERER_RECIPROCAL_TEXTURE_SIZE;
+    vec2 uv_offset = Vec2(texture.x, texture.y) * RENDERER_RECIPROCAL_TEXTURE_SIZE;
+    uv00 = uv_offset + uv00 * uv_scale;
+    uv01 = uv_offset + uv01 * uv_scale;
+    uv10 = uv_offset + uv10 * uv_scale;
+    uv11 = uv_offset + uv11 * uv_scale;
+    
+    u16 texture_index = (u16)texture.index;
+    vertex_buffer[0].p = v00;
+    vertex_buffer[0].uv[0] = pack_uv(uv00.x);
+    vertex_buffer[0].uv[1] = pack_uv(uv00.y);
+    vertex_buffer[0].c = rgba_pack_4x8_linear1(c00);
+    vertex_buffer[0].tex = texture_index;
+    vertex_buffer[1].p = v01;
+    vertex_buffer[1].uv[0] = pack_uv(uv01.x);
+    vertex_buffer[1].uv[1] = pack_uv(uv01.y);
+    vertex_buffer[1].c = rgba_pack_4x8_linear1(c01);
+    vertex_buffer[1].tex = texture_index;
+    vertex_buffer[2].p = v10;
+    vertex_buffer[2].uv[0] = pack_uv(uv10.x);
+    vertex_buffer[2].uv[1] = pack_uv(uv10.y);
+    vertex_buffer[2].c = rgba_pack_4x8_linear1(c10);
+    vertex_buffer[2].tex = texture_index;
+    vertex_buffer[3].p = v11;
+    vertex_buffer[3].uv[0] = pack_uv(uv11.x);
+    vertex_buffer[3].uv[1] = pack_uv(uv11.y);
+    vertex_buffer[3].c = rgba_pack_4x8_linear1(c11);
+    vertex_buffer[3].tex = texture_index;
+    
+    index_buffer[0] = base_index + 0;
+    index_buffer[1] = base_index + 2;
+    index_buffer[2] = base_index + 3;
+    index_buffer[3] = base_index + 0;
+    index_buffer[4] = base_index + 1;
+    index_buffer[5] = base_index + 3;
+}
+
 void push_quad(RendererCommands *commands, vec3 v00, vec3 v01, vec3 v10, vec3 v11,
                vec4 c00, vec4 c01, vec4 c10, vec4 c11,
                vec2 uv00, vec2 uv01, vec2 uv10, vec2 uv11,
@@ -97,51 +176,112 @@ void push_quad(RendererCommands *commands, vec3 v00, vec3 v01, vec3 v10, vec3 v1
     TIMED_FUNCTION();
     RendererCommandQuads *quads = get_current_quads(commands);
     if (quads) {
-        vec2 uv_scale = Vec2(texture.width, texture.height) * RENDERER_RECIPROCAL_TEXTURE_SIZE;
-        uv00 = uv00 * uv_scale;
-        uv01 = uv01 * uv_scale;
-        uv10 = uv10 * uv_scale;
-        uv11 = uv11 * uv_scale;
-        
-        u16 texture_index = (u16)texture.index;
-        // Vertex buffer
         assert(commands->vertex_count + 4 <= commands->max_vertex_count);
-        Vertex *vertex_buffer = commands->vertices + commands->vertex_count;
-        vertex_buffer[0].p = v00;
-        vertex_buffer[0].uv  = uv00;
-        vertex_buffer[0].c = c00;
-        vertex_buffer[0].tex = texture_index;
-        vertex_buffer[1].p = v01;
-        vertex_buffer[1].uv  = uv01;
-        vertex_buffer[1].c = c01;
-        vertex_buffer[1].tex = texture_index;
-        vertex_buffer[2].p = v10;
-        vertex_buffer[2].uv  = uv10;
-        vertex_buffer[2].c = c10;
-        vertex_buffer[2].tex = texture_index;
-        vertex_buffer[3].p = v11;
-        vertex_buffer[3].uv  = uv11;
-        vertex_buffer[3].c = c11;
-        vertex_buffer[3].tex = texture_index;
-        
-        // Index buffer
         assert(commands->index_count + 6 <= commands->max_index_count);
-        RENDERER_INDEX_TYPE *index_buffer = commands->indices + commands->index_count;
-        RENDERER_INDEX_TYPE  base_index   = (RENDERER_INDEX_TYPE)(commands->vertex_count - quads->vertex_array_offset);
-        index_buffer[0] = base_index + 0;
-        index_buffer[1] = base_index + 2;
-        index_buffer[2] = base_index + 3;
-        index_buffer[3] = base_index + 0;
-        index_buffer[4] = base_index + 1;
-        index_buffer[5] = base_index + 3;
-        
+        RENDERER_INDEX_TYPE base_index = (RENDERER_INDEX_TYPE)(commands->vertex_count - quads->vertex_array_offset);
+        write_quad(commands->vertices + commands->vertex_count, commands->indices + commands->index_count, base_index,
+                   v00, v01, v10, v11, c00, c01, c10, c11, uv00, uv01, uv10, uv11, texture);
         // Update buffer sizes after we are finished.
         commands->vertex_count += 4;
         commands->index_count  += 6;
     }
 }
 
-static Texture get_texture(RenderGroup *render_group, AssetID id) {
+static RendererRetainedGeometry *get_retained_geometry(RendererCommands *commands, u32 geometry) {
+    assert(geometry && geometry <= commands->retained_geometry_count);
+    RendererRetainedGeometry *result = commands->retained_geometry + geometry - 1;
+    assert(result->is_used);
+    return result;
+}
+
+u32 create_retained_geometry(RendererCommands *commands) {
+    u32 result = 0;
+    if (commands->first_free_retained_geometry) {
+        result = commands->first_free_retained_geometry;
+        commands->first_free_retained_geometry = commands->retained_geometry[result - 1].next_free;
+    } else if (commands->retained_geometry_count < commands->max_retained_geometry_count) {
+        result = ++commands->retained_geometry_count;
+    }
+    
+    if (result) {
+        RendererRetainedGeometry *geometry = commands->retained_geometry + result - 1;
+        *geometry = {};
+        geometry->is_used = true;
+    }
+    return result;
+}
+
+void free_retained_geometry(RendererCommands *commands, u32 geometry) {
+    RendererRetainedGeometry *retained = get_retained_geometry(commands, geometry);
+    retained->is_used = false;
+    retained->next_free = commands->first_free_retained_geometry;
+    commands->first_free_retained_geometry = geometry;
+}
+
+void clear_retained_geometry(RendererCommands *commands, u32 geometry) {
+    RendererRetainedGeometry *retained = get_retained_geometry(commands, geometry);
+    retained->vertex_count = 0;
+    retained->index_count = 0;
+    retained->is_dirty = true;
+}
+
+void add_retained_quad(RendererCommands *commands, u32 geometry, vec3 v00, vec3 v01, vec3 v10, vec3 v11, vec4 c,
+                       vec2 uv00, vec2 uv01, vec2 uv10, vec2 uv11, Texture texture) {
+    RendererRetainedGeometry *retained = get_retained_geometry(commands, geometry);
+    assert(retained->vertex_count + 4 <= RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT);
+    Vertex *vertices = commands->retained_vertices + (geometry - 1) * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT;
+    RENDERER_INDEX_TYPE *indices = commands->retained_indices + (geometry - 1) * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT;
+    write_quad(vertices + retained->vertex_count, indices + retained->index_count, (RENDERER_INDEX_TYPE)retained->vertex_count,
+               v00, v01, v10, v11, c, c, c, c, uv00, uv01, uv10, uv11, texture);
+    retained->vertex_count += 4;
+    retained->index_count += 6;
+    retained->is_dirty = true;
+}
+
+void push_retained_geometry(RendererCommands *commands, u32 geometry) {
+    get_retained_geometry(commands, geometry);
+    RendererCommandRetainedGeometry *retained = 0;
+    if (commands->last_header && commands->last_header->type == RENDERER_COMMAND_RETAINED_GEOMETRY) {
+        retained = (RendererCommandRetainedGeometry *)(commands->last_header + 1);
+    } else {
+        retained = push_command(commands, RendererCommandRetainedGeometry, RENDERER_COMMAND_RETAINED_GEOMETRY);
+        if (retained) {
+            retained->geometry_count = 0;
+        }
+    }
+    
+    // Command is the last one, so ids are appended to the end of command memory
+    if (retained && commands->command_memory_used + sizeof(u32) <= commands->command_memory_size) {
+        u32 *ids = (u32 *)(retained + 1);
+        assert((u8 *)(ids + retained->geometry_count) == commands->command_memory + commands->command_memory_used);
+        ids[retained->geometry_count++] = geometry;
+        commands->command_memory_used += sizeof(u32);
+    }
+}
+
+void push_sprite(RendererCommands *commands, vec3 p, vec3 x_axis, vec3 y_axis, vec2 size, vec4 c, 
+                 vec2 uv_min, vec2 uv_max, Texture texture) {
+    RendererCommandSprites *sprites = get_current_sprites(commands, x_axis, y_axis);
+    if (sprites) {
+        vec2 uv_scale = Vec2(texture.width, texture.height) * RENDERER_RECIPROCAL_TEXTURE_SIZE;
+        vec2 uv_offset = Vec2(texture.x, texture.y) * RENDERER_RECIPROCAL_TEXTURE_SIZE;
+        uv_min = uv_offset + uv_min * uv_scale;
+        uv_max = uv_offset + uv_max * uv_scale;
+        
+        assert(commands->sprite_count < commands->max_sprite_count);
+        RendererSprite *sprite = commands->sprites + commands->sprite_count++;
+        sprite->p = p;
+        sprite->size = size;
+        sprite->uv_min[0] = pack_uv(uv_min.x);
+        sprite->uv_min[1] = pack_uv(uv_min.y);
+        sprite->uv_max[0] = pack_uv(uv_max.x);
+        sprite->uv_max[1] = pack_uv(uv_max.y);
+        sprite->c = rgba_pack_4x8_linear1(c);
+        sprite->tex = (u16)texture.index;
+    }
+}
+
+Texture get_texture(RenderGroup *render_group, AssetID id) {
     Texture result;
     if (IS_SAME(id, INVALID_ASSET_ID)) {
         result = render_group->commands->white_texture;
@@ -168,13 +308,18 @@ void push_quad(RenderGroup *render_group, vec3 v[4], AssetID texture_id) {
     push_quad(render_group, v, WHITE, texture_id);
 }
 
+void push_billboard(RenderGroup *render_group, vec3 mid_bottom, vec3 right, vec3 up, vec2 size, 
+                    vec4 c, AssetID texture_id) {
+    Texture texture = get_texture(render_group, texture_id);
+    // Sprite starts from top left corner, where uv is 0
+    vec3 top_left = mid_bottom - right * size.x * 0.5f + up * size.y;
+    push_sprite(render_group->commands, top_left, right, -up, size, c, Vec2(0, 0), Vec2(1, 1), texture);
+}
+
 void push_rect(RenderGroup *render_group, Rect rect, vec4 color, Rect uv_rect, AssetID texture_id) {
-    vec3 v[4]; 
-    rect.store_points(v);
-    vec2 uvs[4];
-    uv_rect.store_points(uvs);
     Texture tex = get_texture(render_group, texture_id);
-    push_quad(render_group->commands, v[0], v[1], v[2], v[3], color, color, color, color, uvs[0], uvs[1], uvs[2], uvs[3], tex);
+    push_sprite(render_group->commands, Vec3(rect.top_left(), 0), Vec3(1, 0, 0), Vec3(0, 1, 0), rect.size(), color,
+                uv_rect.top_left(), uv_rect.bottom_right(), tex);
 }
 
 void DEBUG_push_line(RenderGroup *render_group, vec3 a, vec3 b, vec4 color, f32 thickness) {
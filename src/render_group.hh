@@ -22,6 +22,10 @@ enum {
     RENDERER_COMMAND_BLUR,
     RENDERER_COMMAND_BEGIN_DEPTH_PEELING,
     RENDERER_COMMAND_END_DEPTH_PEELING,
+    // Draw call for sprites with same axes
+    RENDERER_COMMAND_SPRITES,
+    // Draw call for retained geometries
+    RENDERER_COMMAND_RETAINED_GEOMETRY,
     RENDERER_COMMAND_SENTINEL,
 };
 
@@ -44,6 +48,18 @@ struct RendererCommandQuads {
     size_t index_array_offset;  
 };
 
+struct RendererCommandSprites {
+    vec3 x_axis;
+    vec3 y_axis;
+    size_t sprite_count;
+    size_t sprite_array_offset;
+};
+
+// Followed by geometry_count ids of geometries
+struct RendererCommandRetainedGeometry {
+    u32 geometry_count;
+};
+
 // Set rendering to be done on separate framebuffer - useful when need to postprocess
 void begin_separated_rendering(RendererCommands *commands);
 // Render separated framebuffef to default one
@@ -55,6 +71,21 @@ void push_quad(RendererCommands *commands, vec3 v00, vec3 v01, vec3 v10, vec3 v1
                vec4 c00, vec4 c01, vec4 c10, vec4 c11,
                vec2 uv00 = Vec2(0, 0), vec2 uv01 = Vec2(0, 1), vec2 uv10 = Vec2(1, 0), vec2 uv11 = Vec2(1, 1),
                Texture texture = INVALID_TEXTURE);
+// Draw call for quad that is sprite, see RendererSprite. Consecutive sprites with same axes are drawn in one call
+// UVs are in texture space like ones of push_quad
+void push_sprite(RendererCommands *commands, vec3 p, vec3 x_axis, vec3 y_axis, vec2 size, vec4 c, 
+                 vec2 uv_min = Vec2(0, 0), vec2 uv_max = Vec2(1, 1), Texture texture = INVALID_TEXTURE);
+// Returns 0 if all retained geometry slots are used
+u32 create_retained_geometry(RendererCommands *commands);
+void free_retained_geometry(RendererCommands *commands, u32 geometry);
+// Removes all quads from geometry, so it can be built again
+void clear_retained_geometry(RendererCommands *commands, u32 geometry);
+// Adds quad to retained geometry, arguments are the same as push_quad ones
+void add_retained_quad(RendererCommands *commands, u32 geometry, vec3 v00, vec3 v01, vec3 v10, vec3 v11, vec4 c,
+                       vec2 uv00 = Vec2(0, 0), vec2 uv01 = Vec2(0, 1), vec2 uv10 = Vec2(1, 0), vec2 uv11 = Vec2(1, 1),
+                       Texture texture = INVALID_TEXTURE);
+// Draw call for retained geometry, consecutive ones are drawn in one call
+void push_retained_geometry(RendererCommands *commands, u32 geometry);
 // Perfoms blurring and renders it on same framebuffer
 void do_blur(RendererCommands *commands);
 void begin_depth_peel(RendererCommands *commands);
@@ -78,11 +109,16 @@ inline RenderGroup create_render_group(RendererCommands *commands, struct Assets
     return result;
 }
 
+// Texture that quads with texture_id will use, white one for invalid id
+Texture get_texture(RenderGroup *render_group, AssetID texture_id);
 void push_quad(RenderGroup *render_group, vec3 v00, vec3 v01, vec3 v10, vec3 v11,
                vec4 c = WHITE, AssetID texture_id = INVALID_ASSET_ID);
 void push_quad(RenderGroup *render_group, vec3 v[4], vec4 c = WHITE, AssetID texture_id = INVALID_ASSET_ID);
 void push_quad(RenderGroup *render_group, vec3 v[4], AssetID texture_id = INVALID_ASSET_ID);
 
+// Quad facing camera, placed same way as get_billboard_positions does
+void push_billboard(RenderGroup *render_group, vec3 mid_bottom, vec3 right, vec3 up, vec2 size, 
+                    vec4 c = WHITE, AssetID texture_id = INVALID_ASSET_ID);
 void push_rect(RenderGroup *render_group, Rect rect, vec4 color, Rect uv_rect = Rect(0, 0, 1, 1), AssetID texture_id = INVALID_ASSET_ID);
 
 
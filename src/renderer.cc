@@ -2,6 +2,7 @@
 #include "game.hh"
 
 #include "mips.hh"
+#include "texture_atlas.hh"
 
 #define GLPROC(_name, _type) \
 _type _name;
@@ -69,13 +70,23 @@ struct OpenGLQuadShader {
     
     bool is_depth_peeling;
     GLuint depth_location;
+    
+    bool is_sprites;
+    GLuint x_axis_location;
+    GLuint y_axis_location;
 };
 
-OpenGLQuadShader compile_quad_shader(bool depth_peel) {
+OpenGLQuadShader compile_quad_shader(bool depth_peel, bool sprites = false) {
     const char *standard_shader_code = R"FOO(#ifdef VERTEX_SHADER       
+#if SPRITES
+// Per-instance attributes, corner is taken from vertex id of 4-vertex triangle strip
+layout(location = 0) in vec3 sprite_p;
+layout(location = 1) in vec2 sprite_size;
+layout(location = 2) in vec4 sprite_uv_rect;
+#else 
 layout(location = 0) in vec4 position;     
 layout(location = 1) in vec2 uv;       
-layout(location = 2) in vec3 n;        
+#endif 
 layout(location = 3) in vec4 color;        
 layout(location = 4) in int texture_index;     
        
@@ -86,15 +97,26 @@ flat out int frag_texture_index;
 
 uniform mat4 view_matrix = mat4(1);     
 uniform mat4 projection_matrix = mat4(1);
+#if SPRITES
+uniform vec3 x_axis;
+uniform vec3 y_axis;
+#endif 
 
 void main() {             
+#if SPRITES
+    // Strip goes through corners so diagonal is the same as in quads index buffer
+    vec2 corner = vec2(gl_VertexID >> 1, 1 - (gl_VertexID & 1));
+    vec4 world_space = vec4(sprite_p + x_axis * (corner.x * sprite_size.x) + y_axis * (corner.y * sprite_size.y), 1);
+    frag_uv = mix(sprite_uv_rect.xy, sprite_uv_rect.zw, corner);
+#else 
     vec4 world_space = position;       
+    frag_uv = uv;      
+#endif 
     vec4 cam_space = view_matrix * world_space;
     vec4 clip_space = projection_matrix * cam_space;        
     gl_Position = clip_space;      
        
     rect_color = color;        
-    frag_uv = uv;      
     frag_texture_index = texture_index;        
     
     float d = length(cam_space.xyz);
@@ -134,10 +156,11 @@ discard;
 #endif)FOO";
     
     char defines[256];
-    snprintf(defines, sizeof(defines), "#define DEPTH_PEEL %u\n", (u32)TO_BOOL(depth_peel));
+    snprintf(defines, sizeof(defines), "#define DEPTH_PEEL %u\n#define SPRITES %u\n", (u32)TO_BOOL(depth_peel), (u32)TO_BOOL(sprites));
     
     OpenGLQuadShader result = {};
     result.is_depth_peeling = depth_peel;
+    result.is_sprites = sprites;
     result.id = create_shader(standard_shader_code, defines);
     result.projection_location = get_uniform(result.id, "projection_matrix");
     result.view_location = get_uniform(result.id, "view_matrix");
@@ -145,6 +168,10 @@ discard;
     if (depth_peel) {
         result.depth_location = get_uniform(result.id, "depth");
     }
+    if (sprites) {
+        result.x_axis_location = get_uniform(result.id, "x_axis");
+        result.y_axis_location = get_uniform(result.id, "y_axis");
+    }
     return result;
 }
 
@@ -158,6 +185,12 @@ static void bind_shader(OpenGLQuadShader *shader, Mat4x4 *view, Mat4x4 *projecti
     }
 }
 
+static void bind_sprite_axes(OpenGLQuadShader *shader, vec3 x_axis, vec3 y_axis) {
+    assert(shader->is_sprites);
+    glUniform3f(shader->x_axis_location, x_axis.x, x_axis.y, x_axis.z);
+    glUniform3f(shader->y_axis_location, y_axis.x, y_axis.y, y_axis.z);
+}
+
 struct OpenGLBlitFramebufferShader {
     GLuint id;
     GLuint tex_location;
@@ -373,13 +406,68 @@ enum {
     RENDERER_FRAMEBUFFER_SENTINEL,
 };
 
+#define RENDERER_FRAMES_IN_FLIGHT 3
+// Game thread writes commands of one frame while render thread executes the other one
+#define RENDERER_FRAME_BUFFER_COUNT 2
+// Region of next frame in buffer is waited for after frame is executed, so it has to be fenced by earlier frame
+CT_ASSERT(RENDERER_FRAMES_IN_FLIGHT > RENDERER_FRAME_BUFFER_COUNT);
+#define RENDERER_MAX_TEXTURE_UPLOAD_COUNT 1024
+
+struct RendererTextureUpload {
+    Texture texture;
+    void *mipmaps;
+};
+
+// Commands of frame and everything render thread needs to execute them, so game thread can go on changing 
+// its state while frame is executed
+struct RendererFrame {
+    RendererCommands commands;
+    // Arrays commands are written to when buffers are not mapped, they are uploaded before frame is executed
+    Vertex *vertices;
+    RENDERER_INDEX_TYPE *indices;
+    RendererSprite *sprites;
+    // Commands are written to region of persistently mapped buffers
+    bool is_mapped;
+    u32 region;
+    // Textures are packed in atlas by game thread and uploaded by render thread. Texture array is grown
+    // to layer count of atlas before uploads
+    u32 texture_layer_count;
+    u32 texture_upload_count;
+    RendererTextureUpload *texture_uploads;
+    // Slots of retained geometry that changed are copied when frame is ended, together with index counts of all slots,
+    // because game can change slots while frame is executed
+    u32 retained_upload_count;
+    u32 *retained_upload_slots;
+    Vertex *retained_upload_vertices;
+    RENDERER_INDEX_TYPE *retained_upload_indices;
+    u32 *retained_index_counts;
+    // Frame only applies settings, nothing is drawn
+    bool is_settings_change;
+    RendererSettings settings;
+};
+
 struct Renderer {
+    // Used only by render thread after renderer_init
     MemoryArena arena;
+    // Changed only by render thread while game thread waits for it
     RendererSettings settings;
-    RendererCommands commands;
+    
+    // Game thread writes frame frame_index, render thread executes frames before it in order.
+    // Count of first semaphore is number of frames that are ended and not executed, 
+    // count of second - number of frames game thread can take
+    RendererFrame frames[RENDERER_FRAME_BUFFER_COUNT];
+    u64 frame_index;
+    u64 render_frame_index;
+    Semaphore frame_ready_semaphore;
+    Semaphore frame_free_semaphore;
+    OS *os;
+    // Game thread state
+    TextureAtlas atlas;
+    u32 white_texel;
     
     OpenGLQuadShader quad_shader;
     OpenGLQuadShader depth_peel_shader;
+    OpenGLQuadShader sprite_shader;
     OpenGLBlitFramebufferShader blit_framebuffer_shader;
     OpenGLVerticalBlurShader vertical_blur_shader;
     OpenGLHorizontalBlurShader horizontal_blur_shader;
@@ -389,8 +477,26 @@ struct Renderer {
     GLuint vertex_array;
     GLuint vertex_buffer;
     GLuint index_buffer;
-    size_t max_texture_count;
-    size_t texture_count;
+    GLuint sprite_array;
+    GLuint sprite_buffer;
+    u64 stream_video_memory;
+    // Persistently mapped buffers have region for each frame in flight, frame is written to its region
+    // while GPU reads previous ones. Fence of region is waited before frame that writes it is given to game thread
+    bool is_persistent;
+    GLsync region_fences[RENDERER_FRAMES_IN_FLIGHT];
+    Vertex *mapped_vertices;
+    RENDERER_INDEX_TYPE *mapped_indices;
+    RendererSprite *mapped_sprites;
+    u32 DEBUG_stall_count;
+    u32 DEBUG_draw_call_count;
+    u32 DEBUG_retained_draw_count;
+    // Retained geometry buffers are static and are not recreated with settings, dirty slots are uploaded before frame is executed
+    GLuint retained_array;
+    GLuint retained_vertex_buffer;
+    GLuint retained_index_buffer;
+    // Texture array has storage for texture_layer_count layers, and is recreated with more of them when atlas needs
+    u32 texture_layer_count;
+    u64 texture_video_memory;
     GLuint texture_array;
     
     GLuint framebuffer_ids[RENDERER_FRAMEBUFFER_SENTINEL];
@@ -401,6 +507,16 @@ struct Renderer {
     u64 video_memory_used;
 };
 
+// There is no base instance in OpenGL 3.3, so attributes are pointed to first sprite of draw call instead
+static void set_sprite_attribute_pointers(size_t sprite_array_offset) {
+    u8 *base = (u8 *)(sprite_array_offset * sizeof(RendererSprite));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RendererSprite), base + STRUCT_OFFSET(RendererSprite, p));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(RendererSprite), base + STRUCT_OFFSET(RendererSprite, size));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(RendererSprite), base + STRUCT_OFFSET(RendererSprite, uv_min));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(RendererSprite), base + STRUCT_OFFSET(RendererSprite, c));
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, sizeof(RendererSprite), base + STRUCT_OFFSET(RendererSprite, tex));
+}
+
 static void APIENTRY opengl_error_callback(GLenum source, GLenum type, GLenum id, GLenum severity, GLsizei length,
                                            const GLchar* message, const void *_) {
     if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) return;
@@ -512,8 +628,86 @@ static void init_framebuffer(Renderer *renderer, u32 idx,
     renderer->framebuffers[idx] = result;
 }
 
-void init_renderer_for_settings(Renderer *renderer, RendererSettings settings) {
-    renderer->texture_count = 0;
+// Vertex array and array buffer should be bound
+static void set_vertex_attribute_pointers() {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, p));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, uv));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, c));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, tex));
+    glEnableVertexAttribArray(4);
+}
+
+static void init_stream_buffers(Renderer *renderer, bool persistent) {
+    for (u32 region_idx = 0; region_idx < RENDERER_FRAMES_IN_FLIGHT; ++region_idx) {
+        if (renderer->region_fences[region_idx]) {
+            glDeleteSync(renderer->region_fences[region_idx]);
+            renderer->region_fences[region_idx] = 0;
+        }
+    }
+    // Buffers that are mapped get unmapped when deleted, and immutable storage can't be recreated anyway
+    glDeleteBuffers(1, &renderer->vertex_buffer);
+    glDeleteBuffers(1, &renderer->index_buffer);
+    glDeleteBuffers(1, &renderer->sprite_buffer);
+    renderer->video_memory_used -= renderer->stream_video_memory;
+    renderer->mapped_vertices = 0;
+    renderer->mapped_indices = 0;
+    renderer->mapped_sprites = 0;
+    
+    // All frames have the same sizes
+    RendererCommands *commands = &renderer->frames[0].commands;
+    size_t vertex_size = commands->max_vertex_count * sizeof(Vertex);
+    size_t index_size = commands->max_index_count * sizeof(RENDERER_INDEX_TYPE);
+    size_t sprite_size = commands->max_sprite_count * sizeof(RendererSprite);
+    u32 region_count = persistent ? RENDERER_FRAMES_IN_FLIGHT : 1;
+    GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    
+    glBindVertexArray(renderer->vertex_array);
+    glGenBuffers(1, &renderer->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+    glGenBuffers(1, &renderer->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+    if (persistent) {
+        glBufferStorage(GL_ARRAY_BUFFER, vertex_size * region_count, 0, map_flags);
+        renderer->mapped_vertices = (Vertex *)glMapBufferRange(GL_ARRAY_BUFFER, 0, vertex_size * region_count, map_flags);
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, index_size * region_count, 0, map_flags);
+        renderer->mapped_indices = (RENDERER_INDEX_TYPE *)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, index_size * region_count, map_flags);
+        assert(renderer->mapped_vertices && renderer->mapped_indices);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertex_size, 0, GL_STREAM_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size, 0, GL_STREAM_DRAW);
+    }
+    set_vertex_attribute_pointers();
+    glBindVertexArray(0);
+    
+    // Sprite attributes advance once per instance
+    glBindVertexArray(renderer->sprite_array);
+    glGenBuffers(1, &renderer->sprite_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->sprite_buffer);
+    if (persistent) {
+        glBufferStorage(GL_ARRAY_BUFFER, sprite_size * region_count, 0, map_flags);
+        renderer->mapped_sprites = (RendererSprite *)glMapBufferRange(GL_ARRAY_BUFFER, 0, sprite_size * region_count, map_flags);
+        assert(renderer->mapped_sprites);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, sprite_size, 0, GL_STREAM_DRAW);
+    }
+    set_sprite_attribute_pointers(0);
+    for (u32 attribute_idx = 0; attribute_idx < 5; ++attribute_idx) {
+        glEnableVertexAttribArray(attribute_idx);
+        glVertexAttribDivisor(attribute_idx, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    renderer->is_persistent = persistent;
+    renderer->stream_video_memory = (vertex_size + index_size + sprite_size) * region_count;
+    renderer->video_memory_used += renderer->stream_video_memory;
+}
+
+// Sets parameters of bound texture array
+static void set_texture_array_parameters(RendererSettings settings) {
     GLenum min_filter, mag_filter;
     if (settings.filtered) {
         mag_filter = GL_LINEAR;
@@ -530,25 +724,77 @@ void init_renderer_for_settings(Renderer *renderer, RendererSettings settings) {
             min_filter = GL_NEAREST;
         }
     }
-    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array); 
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, min_filter);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, mag_filter);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Only levels in which textures don't share texels are stored
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, TEXTURE_ATLAS_MIP_COUNT - 1);
+}
+
+// Creates texture array with given layer count and copies layers of old one to it
+static void resize_texture_array(Renderer *renderer, u32 layer_count) {
+    assert(layer_count >= renderer->texture_layer_count && layer_count <= TEXTURE_ATLAS_MAX_LAYER_COUNT);
+    GLuint texture_array;
+    glGenTextures(1, &texture_array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+    u64 video_memory = 0;
+    for (u32 level = 0; level < TEXTURE_ATLAS_MIP_COUNT; ++level) {
+        u32 level_dim = RENDERER_TEXTURE_DIM >> level;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, level_dim, level_dim, layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        video_memory += (u64)level_dim * level_dim * 4 * layer_count;
+    }
+    // Texture has to be complete to be copied to
+    set_texture_array_parameters(renderer->settings);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    if (renderer->texture_layer_count) {
+        for (u32 level = 0; level < TEXTURE_ATLAS_MIP_COUNT; ++level) {
+            u32 level_dim = RENDERER_TEXTURE_DIM >> level;
+            glCopyImageSubData(renderer->texture_array, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               texture_array, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, 
+                               level_dim, level_dim, renderer->texture_layer_count);
+        }
+        glDeleteTextures(1, &renderer->texture_array);
+    }
+    renderer->texture_array = texture_array;
+    renderer->texture_layer_count = layer_count;
+    renderer->video_memory_used += video_memory - renderer->texture_video_memory;
+    renderer->texture_video_memory = video_memory;
+}
+
+static RendererFrame *get_game_frame(Renderer *renderer) {
+    return renderer->frames + renderer->frame_index % RENDERER_FRAME_BUFFER_COUNT;
+}
+
+// Texture is packed in atlas now and is uploaded by render thread before commands of current frame are executed
+static Texture create_texture(Renderer *renderer, void *data, u32 width, u32 height, bool is_pinned) {
+    RendererFrame *frame = get_game_frame(renderer);
+    Texture tex = frame->commands.white_texture;
+    bool is_packed = texture_atlas_pack(&renderer->atlas, &tex, width, height, is_pinned);
+    // All layers are used by current frame
+    assert(is_packed);
+    if (is_packed) {
+        assert(frame->texture_upload_count < RENDERER_MAX_TEXTURE_UPLOAD_COUNT);
+        RendererTextureUpload *upload = frame->texture_uploads + frame->texture_upload_count++;
+        upload->texture = tex;
+        upload->mipmaps = data;
+    }
+    return tex;
+}
+
+// Textures are created again after settings change, white one is padded like others so it can be single texel
+static void reset_texture_atlas(Renderer *renderer) {
+    texture_atlas_reset(&renderer->atlas);
+    renderer->white_texel = 0xFFFFFFFF;
+    get_game_frame(renderer)->commands.white_texture = create_texture(renderer, &renderer->white_texel, 1, 1, true);
+}
+
+// Part of settings change that is done by render thread
+static void apply_settings(Renderer *renderer, RendererSettings settings) {
+    init_stream_buffers(renderer, settings.persistent_buffers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array); 
+    set_texture_array_parameters(settings);
     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
-    
-#if 1
-    size_t white_data_size = get_total_size_for_mips(RENDERER_TEXTURE_DIM, RENDERER_TEXTURE_DIM);
-    TempMemory white_temp = begin_temp_memory(&renderer->arena);
-    void *white_data = alloc(&renderer->arena, white_data_size);
-    memset(white_data, 0xFF, white_data_size);
-    renderer->commands.white_texture = renderer_create_texture_mipmaps(renderer, white_data, RENDERER_TEXTURE_DIM, RENDERER_TEXTURE_DIM);
-    end_temp_memory(white_temp);
-#else   
-    // ...
-    u32 white_data = 0xFFFFFFFF;
-    renderer->commands.white_texture = renderer_create_texture_mipmaps(renderer, &white_data, 1, 1);
-#endif   
     
     for (u32 i = 0; i < RENDERER_FRAMEBUFFER_SENTINEL; ++i) {
         renderer->video_memory_used -= renderer->framebuffers[i].video_memory;
@@ -566,110 +812,6 @@ void init_renderer_for_settings(Renderer *renderer, RendererSettings settings) {
     renderer->settings = settings;
 }
 
-Renderer *renderer_init(RendererSettings settings) {
-#define RENDERER_ARENA_SIZE MEGABYTES(256)
-    Renderer *renderer = bootstrap_alloc_struct(Renderer, arena, RENDERER_ARENA_SIZE);
-    
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
-    glDebugMessageCallback(opengl_error_callback, 0);
-    glDepthMask(GL_TRUE);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glDepthFunc(GL_LEQUAL);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glProvokingVertex(GL_FIRST_VERTEX_CONVENTION);
-    
-#define MAX_QUADS_COUNT MEGABYTES(16)
-#define MAX_VERTEX_COUNT (1 << 16)
-#define MAX_INDEX_COUNT (MAX_VERTEX_COUNT / 2 * 3)
-    renderer->commands.command_memory_size = MAX_QUADS_COUNT;
-    renderer->commands.command_memory = (u8 *) alloc(&renderer->arena, MAX_QUADS_COUNT);
-    renderer->commands.max_vertex_count = MAX_VERTEX_COUNT;
-    renderer->commands.vertices = alloc_arr(&renderer->arena, MAX_VERTEX_COUNT, Vertex);
-    renderer->commands.max_index_count = MAX_INDEX_COUNT;
-    renderer->commands.indices = alloc_arr(&renderer->arena, MAX_INDEX_COUNT, RENDERER_INDEX_TYPE);
-    
-    renderer->quad_shader = compile_quad_shader(false);
-    renderer->depth_peel_shader = compile_quad_shader(true);
-    renderer->blit_framebuffer_shader = compile_blit_framebuffer_shader();
-    renderer->horizontal_blur_shader = compile_horizontal_blur_shader();
-    renderer->vertical_blur_shader = compile_vertical_blur_shader();
-    renderer->depth_peel_composite_shader = compile_depth_peel_composite();
-    
-    // Generate vertex arrays
-    glGenVertexArrays(1, &renderer->render_framebuffer_vao);
-    glBindVertexArray(renderer->render_framebuffer_vao);
-    GLuint renderer_framebuffer_vbo;
-    f32 render_framebuffer_data[] = {
-        -1.0f, -1.0f, 
-        -1.0f, 1.0f, 
-        1.0f, -1.0f, 
-        1.0f, 1.0f, 
-    };
-    glGenBuffers(1, &renderer_framebuffer_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, renderer_framebuffer_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(render_framebuffer_data), render_framebuffer_data, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 8, (void *)0);
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-    
-    glGenVertexArrays(1, &renderer->vertex_array);
-    glBindVertexArray(renderer->vertex_array);
-    
-    glGenBuffers(1, &renderer->vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, renderer->commands.max_vertex_count * sizeof(Vertex), 0, GL_STREAM_DRAW);
-    renderer->video_memory_used += renderer->commands.max_vertex_count * sizeof(Vertex);
-    
-    glGenBuffers(1, &renderer->index_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, renderer->commands.max_index_count * sizeof(RENDERER_INDEX_TYPE), 0, GL_STREAM_DRAW);
-    renderer->video_memory_used += renderer->commands.max_index_count * sizeof(RENDERER_INDEX_TYPE);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, p));
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, uv));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, n));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, c));
-    glEnableVertexAttribArray(3);
-    glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (void *)STRUCT_OFFSET(Vertex, tex));
-    glEnableVertexAttribArray(4);
-    
-    glBindVertexArray(0);
-    
-#define MAX_TEXTURE_COUNT 256
-    renderer->max_texture_count = MAX_TEXTURE_COUNT;
-    glGenTextures(1, &renderer->texture_array);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
-    ITERATE(iter, iterate_mips(RENDERER_TEXTURE_DIM, RENDERER_TEXTURE_DIM)) {
-        glTexImage3D(GL_TEXTURE_2D_ARRAY, iter.level, GL_RGBA8, 
-                     iter.width, iter.height, MAX_TEXTURE_COUNT,
-                     0, GL_RGBA, GL_UNSIGNED_BYTE, 0);        
-        renderer->video_memory_used += iter.width * iter.height * 4 * renderer->max_texture_count;
-    }
-    
-    glGenFramebuffers(RENDERER_FRAMEBUFFER_SENTINEL, renderer->framebuffer_ids);
-    glGenTextures(RENDERER_FRAMEBUFFER_SENTINEL, renderer->framebuffer_textures);
-    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_SEPARATED);
-    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_PEEL1);
-    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_PEEL2);
-    
-    init_renderer_for_settings(renderer, settings);
-    return renderer;
-}
-
-RendererCommands *renderer_begin_frame(Renderer *renderer) {
-    RendererCommands *commands = &renderer->commands;
-    commands->command_memory_used = 0;
-    commands->vertex_count = 0;
-    commands->index_count = 0;
-    commands->last_header = 0;
-    commands->last_setup = 0;
-    return commands;
-}
-
 static void bind_framebuffer(Renderer *renderer, u32 id, bool clear = false) {
     b32 has_depth = false;
     if (id == RENDERER_FRAMEBUFFER_MAIN) {
@@ -711,13 +853,81 @@ static void blit_framebuffer(Renderer *renderer, u32 from, u32 to, bool clear =
     glEnable(GL_DEPTH_TEST);
 }
 
-void renderer_end_frame(Renderer *renderer) {
-    TIMED_FUNCTION();
-    // Upload data from vertex array to OpenGL buffers
-    glBindVertexArray(renderer->vertex_array);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, renderer->commands.vertex_count * sizeof(Vertex), renderer->commands.vertices);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, renderer->commands.index_count * sizeof(RENDERER_INDEX_TYPE), renderer->commands.indices);
+
+static void upload_textures(Renderer *renderer, RendererFrame *frame) {
+    if (frame->texture_layer_count > renderer->texture_layer_count) {
+        u32 layer_count = renderer->texture_layer_count;
+        while (layer_count < frame->texture_layer_count) {
+            layer_count *= 2;
+        }
+        if (layer_count > TEXTURE_ATLAS_MAX_LAYER_COUNT) {
+            layer_count = TEXTURE_ATLAS_MAX_LAYER_COUNT;
+        }
+        resize_texture_array(renderer, layer_count);
+    }
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
+    for (u32 upload_idx = 0; upload_idx < frame->texture_upload_count; ++upload_idx) {
+        RendererTextureUpload *upload = frame->texture_uploads + upload_idx;
+        Texture tex = upload->texture;
+        TempMemory upload_temp = begin_temp_memory(&renderer->arena);
+        for (u32 level = 0; level < TEXTURE_ATLAS_MIP_COUNT; ++level) {
+            TextureAtlasLevel level_upload = get_texture_atlas_level(&renderer->arena, tex, upload->mipmaps, level);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, level_upload.x, level_upload.y, tex.index, level_upload.width, level_upload.height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, level_upload.pixels);
+        }
+        end_temp_memory(upload_temp);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+static void upload_retained_geometry(Renderer *renderer, RendererFrame *frame) {
+    glBindVertexArray(renderer->retained_array);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->retained_vertex_buffer);
+    for (u32 upload_idx = 0; upload_idx < frame->retained_upload_count; ++upload_idx) {
+        u32 slot_idx = frame->retained_upload_slots[upload_idx];
+        glBufferSubData(GL_ARRAY_BUFFER, slot_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT * sizeof(Vertex), 
+                        RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT * sizeof(Vertex), 
+                        frame->retained_upload_vertices + upload_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, slot_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT * sizeof(RENDERER_INDEX_TYPE), 
+                        RENDERER_RETAINED_GEOMETRY_INDEX_COUNT * sizeof(RENDERER_INDEX_TYPE), 
+                        frame->retained_upload_indices + upload_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT);
+    }
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Executes frame on render thread
+static void render_frame(Renderer *renderer, RendererFrame *frame) {
+    TIMED_FUNCTION();
+    upload_textures(renderer, frame);
+    upload_retained_geometry(renderer, frame);
+    if (frame->is_settings_change) {
+        apply_settings(renderer, frame->settings);
+        return;
+    }
+    
+    RendererCommands *commands = &frame->commands;
+    // Offsets of frame region in buffers
+    size_t region_vertex_offset = 0;
+    size_t region_index_offset = 0;
+    size_t region_sprite_offset = 0;
+    if (frame->is_mapped) {
+        region_vertex_offset = frame->region * commands->max_vertex_count;
+        region_index_offset = frame->region * commands->max_index_count;
+        region_sprite_offset = frame->region * commands->max_sprite_count;
+    } else {
+        // Upload data from vertex array to OpenGL buffers
+        glBindVertexArray(renderer->vertex_array);
+        // Array buffer binding is not part of vertex array state
+        glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, commands->vertex_count * sizeof(Vertex), commands->vertices);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, commands->index_count * sizeof(RENDERER_INDEX_TYPE), commands->indices);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer->sprite_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, commands->sprite_count * sizeof(RendererSprite), commands->sprites);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
     
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -729,13 +939,14 @@ void renderer_end_frame(Renderer *renderer) {
     u32 current_framebuffer = RENDERER_FRAMEBUFFER_MAIN;
     bind_framebuffer(renderer, current_framebuffer, true);
     
-    u8 *cursor = renderer->commands.command_memory;
-    u8 *commands_bound = renderer->commands.command_memory + renderer->commands.command_memory_used;
+    u8 *cursor = commands->command_memory;
+    u8 *commands_bound = commands->command_memory + commands->command_memory_used;
     u8 *peel_header_restore = 0;
     u32 peel_count = 0;
     b32 is_peeling = false;
     
     u32 DEBUG_draw_call_count = 0;
+    u32 DEBUG_retained_draw_count = 0;
     while (cursor < commands_bound) {
         RendererCommandHeader *header = (RendererCommandHeader *)cursor;
         cursor += sizeof(*header);
@@ -756,11 +967,68 @@ void renderer_end_frame(Renderer *renderer) {
                 glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
                 glBindVertexArray(renderer->vertex_array);
                 
-                glDrawElementsBaseVertex(GL_TRIANGLES, 6 * quads->quad_count, GL_INDEX_TYPE, (void *)(sizeof(RENDERER_INDEX_TYPE) * quads->index_array_offset), quads->vertex_array_offset);
+                glDrawElementsBaseVertex(GL_TRIANGLES, 6 * quads->quad_count, GL_INDEX_TYPE, 
+                                         (void *)(sizeof(RENDERER_INDEX_TYPE) * (region_index_offset + quads->index_array_offset)), 
+                                         (GLint)(region_vertex_offset + quads->vertex_array_offset));
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+                glBindVertexArray(0);
+                glUseProgram(0);
+                
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_SPRITES: {
+                RendererCommandSprites *sprites = (RendererCommandSprites *)cursor;
+                cursor += sizeof(*sprites);
+                
+                assert(current_setup);
+                bind_shader(&renderer->sprite_shader, &current_setup->view, &current_setup->projection, 0);
+                bind_sprite_axes(&renderer->sprite_shader, sprites->x_axis, sprites->y_axis);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
+                glBindVertexArray(renderer->sprite_array);
+                glBindBuffer(GL_ARRAY_BUFFER, renderer->sprite_buffer);
+                set_sprite_attribute_pointers(region_sprite_offset + sprites->sprite_array_offset);
+                
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, sprites->sprite_count);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+                glBindVertexArray(0);
+                glUseProgram(0);
+                
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_RETAINED_GEOMETRY: {
+                RendererCommandRetainedGeometry *retained = (RendererCommandRetainedGeometry *)cursor;
+                cursor += sizeof(*retained);
+                u32 *ids = (u32 *)cursor;
+                cursor += retained->geometry_count * sizeof(u32);
+                
+                assert(current_setup);
+                // Each geometry is separate draw in single multi draw call, index offsets and base vertices point to slots
+                TempMemory draw_temp = begin_temp_memory(&renderer->arena);
+                GLsizei *counts = alloc_arr(&renderer->arena, retained->geometry_count, GLsizei);
+                void **index_offsets = alloc_arr(&renderer->arena, retained->geometry_count, void *);
+                GLint *base_vertices = alloc_arr(&renderer->arena, retained->geometry_count, GLint);
+                for (u32 id_idx = 0; id_idx < retained->geometry_count; ++id_idx) {
+                    u32 slot_idx = ids[id_idx] - 1;
+                    assert(slot_idx < commands->retained_geometry_count);
+                    counts[id_idx] = (GLsizei)frame->retained_index_counts[slot_idx];
+                    index_offsets[id_idx] = (void *)(slot_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT * sizeof(RENDERER_INDEX_TYPE));
+                    base_vertices[id_idx] = (GLint)(slot_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT);
+                }
+                
+                bind_shader(&renderer->quad_shader, &current_setup->view, &current_setup->projection, 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
+                glBindVertexArray(renderer->retained_array);
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_INDEX_TYPE, index_offsets, 
+                                              retained->geometry_count, base_vertices);
                 glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
                 glBindVertexArray(0);
                 glUseProgram(0);
+                end_temp_memory(draw_temp);
                 
+                DEBUG_retained_draw_count += retained->geometry_count;
                 ++DEBUG_draw_call_count;
             } break;
             case RENDERER_COMMAND_BLUR: {
@@ -851,34 +1119,278 @@ void renderer_end_frame(Renderer *renderer) {
     }
     
     assert(current_framebuffer == RENDERER_FRAMEBUFFER_MAIN);
+    if (frame->is_mapped) {
+        renderer->region_fences[frame->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    renderer->DEBUG_draw_call_count = DEBUG_draw_call_count;
+    renderer->DEBUG_retained_draw_count = DEBUG_retained_draw_count;
+}
+
+static void wait_for_region(Renderer *renderer, u32 region) {
+    GLsync fence = renderer->region_fences[region];
+    if (fence) {
+        // Region was used RENDERER_FRAMES_IN_FLIGHT frames ago, so GPU is usually done with it
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++renderer->DEBUG_stall_count;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        }
+        glDeleteSync(fence);
+        renderer->region_fences[region] = 0;
+    }
+}
+
+// Time render thread spends waiting for frames, vsync and GPU is not in timed blocks, so profiler shows it as idle
+static RENDER_THREAD_PROC(render_thread_proc) {
+    Renderer *renderer = (Renderer *)data;
+    for (;;) {
+        wait_semaphore(&renderer->frame_ready_semaphore);
+        RendererFrame *frame = renderer->frames + renderer->render_frame_index % RENDERER_FRAME_BUFFER_COUNT;
+        render_frame(renderer, frame);
+        if (!frame->is_settings_change) {
+            os_swap_buffers(renderer->os, renderer->settings.vsync);
+        }
+        ++renderer->render_frame_index;
+        // Frame that is written to this buffer next is given region that is not used by GPU anymore
+        if (renderer->is_persistent) {
+            wait_for_region(renderer, (renderer->render_frame_index - 1 + RENDERER_FRAME_BUFFER_COUNT) % RENDERER_FRAMES_IN_FLIGHT);
+        }
+        signal_semaphore(&renderer->frame_free_semaphore);
+    }
+}
+
+// Gives frame of game thread to render thread. Retained geometry that changed is copied to frame, 
+// because game thread can change it while frame is executed
+static void submit_frame(Renderer *renderer) {
+    RendererFrame *frame = get_game_frame(renderer);
+    RendererCommands *commands = &frame->commands;
+    frame->retained_upload_count = 0;
+    for (u32 slot_idx = 0; slot_idx < commands->retained_geometry_count; ++slot_idx) {
+        RendererRetainedGeometry *geometry = commands->retained_geometry + slot_idx;
+        frame->retained_index_counts[slot_idx] = geometry->index_count;
+        if (geometry->is_used && geometry->is_dirty) {
+            u32 upload_idx = frame->retained_upload_count++;
+            frame->retained_upload_slots[upload_idx] = slot_idx;
+            memcpy(frame->retained_upload_vertices + upload_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT,
+                   commands->retained_vertices + slot_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT,
+                   geometry->vertex_count * sizeof(Vertex));
+            memcpy(frame->retained_upload_indices + upload_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT,
+                   commands->retained_indices + slot_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT,
+                   geometry->index_count * sizeof(RENDERER_INDEX_TYPE));
+            geometry->is_dirty = false;
+        }
+    }
+    frame->texture_layer_count = renderer->atlas.layer_count;
+    
+    signal_semaphore(&renderer->frame_ready_semaphore);
+    ++renderer->frame_index;
+}
+
+// Takes buffer for next frame of game thread, waiting until render thread executes frame that used it
+static void acquire_frame(Renderer *renderer) {
+    BEGIN_BLOCK("Wait for render thread");
+    wait_semaphore(&renderer->frame_free_semaphore);
+    END_BLOCK();
+    RendererFrame *frame = get_game_frame(renderer);
+    RendererCommands *commands = &frame->commands;
+    // Retained geometry slots and white texture are shared by frames, so they are carried over from last one
+    if (renderer->frame_index) {
+        RendererCommands *last_commands = &renderer->frames[(renderer->frame_index - 1) % RENDERER_FRAME_BUFFER_COUNT].commands;
+        commands->retained_geometry_count = last_commands->retained_geometry_count;
+        commands->first_free_retained_geometry = last_commands->first_free_retained_geometry;
+        commands->white_texture = last_commands->white_texture;
+    }
+    
+    // Buffers are changed by render thread only when game thread waits for it, so they can be read here
+    frame->is_mapped = renderer->is_persistent;
+    frame->region = renderer->frame_index % RENDERER_FRAMES_IN_FLIGHT;
+    if (frame->is_mapped) {
+        commands->vertices = renderer->mapped_vertices + frame->region * commands->max_vertex_count;
+        commands->indices = renderer->mapped_indices + frame->region * commands->max_index_count;
+        commands->sprites = renderer->mapped_sprites + frame->region * commands->max_sprite_count;
+    } else {
+        commands->vertices = frame->vertices;
+        commands->indices = frame->indices;
+        commands->sprites = frame->sprites;
+    }
+    commands->command_memory_used = 0;
+    commands->vertex_count = 0;
+    commands->index_count = 0;
+    commands->sprite_count = 0;
+    commands->last_header = 0;
+    commands->last_setup = 0;
+    frame->texture_upload_count = 0;
+    frame->is_settings_change = false;
+}
+
+void init_renderer_for_settings(Renderer *renderer, RendererSettings settings) {
+    TIMED_FUNCTION();
+    RendererFrame *frame = get_game_frame(renderer);
+    frame->is_settings_change = true;
+    frame->settings = settings;
+    submit_frame(renderer);
+    // Stream buffers are recreated, so next frame can only be taken after render thread has applied settings
+    for (u32 frame_idx = 0; frame_idx < RENDERER_FRAME_BUFFER_COUNT; ++frame_idx) {
+        wait_semaphore(&renderer->frame_free_semaphore);
+    }
+    for (u32 frame_idx = 0; frame_idx < RENDERER_FRAME_BUFFER_COUNT; ++frame_idx) {
+        signal_semaphore(&renderer->frame_free_semaphore);
+    }
+    acquire_frame(renderer);
+    reset_texture_atlas(renderer);
+}
+
+Renderer *renderer_init(RendererSettings settings) {
+#define RENDERER_ARENA_SIZE MEGABYTES(256)
+    Renderer *renderer = bootstrap_alloc_struct(Renderer, arena, RENDERER_ARENA_SIZE);
+    
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+    glDebugMessageCallback(opengl_error_callback, 0);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_LEQUAL);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+    glProvokingVertex(GL_FIRST_VERTEX_CONVENTION);
+    
+#define MAX_QUADS_COUNT MEGABYTES(16)
+#define MAX_VERTEX_COUNT (RENDERER_VERTEX_PAGE_SIZE * 4)
+#define MAX_INDEX_COUNT (MAX_VERTEX_COUNT / 2 * 3)
+#define MAX_SPRITE_COUNT (1 << 16)
+#define MAX_RETAINED_GEOMETRY_COUNT 256
+    RendererRetainedGeometry *retained_geometry = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT, RendererRetainedGeometry);
+    Vertex *retained_vertices = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT, Vertex);
+    RENDERER_INDEX_TYPE *retained_indices = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT, RENDERER_INDEX_TYPE);
+    for (u32 frame_idx = 0; frame_idx < RENDERER_FRAME_BUFFER_COUNT; ++frame_idx) {
+        RendererFrame *frame = renderer->frames + frame_idx;
+        RendererCommands *commands = &frame->commands;
+        commands->command_memory_size = MAX_QUADS_COUNT;
+        commands->command_memory = (u8 *)alloc(&renderer->arena, MAX_QUADS_COUNT);
+        commands->max_vertex_count = MAX_VERTEX_COUNT;
+        frame->vertices = alloc_arr(&renderer->arena, MAX_VERTEX_COUNT, Vertex);
+        commands->max_index_count = MAX_INDEX_COUNT;
+        frame->indices = alloc_arr(&renderer->arena, MAX_INDEX_COUNT, RENDERER_INDEX_TYPE);
+        commands->max_sprite_count = MAX_SPRITE_COUNT;
+        frame->sprites = alloc_arr(&renderer->arena, MAX_SPRITE_COUNT, RendererSprite);
+        commands->max_retained_geometry_count = MAX_RETAINED_GEOMETRY_COUNT;
+        commands->retained_geometry = retained_geometry;
+        commands->retained_vertices = retained_vertices;
+        commands->retained_indices = retained_indices;
+        
+        frame->texture_uploads = alloc_arr(&renderer->arena, RENDERER_MAX_TEXTURE_UPLOAD_COUNT, RendererTextureUpload);
+        frame->retained_upload_slots = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT, u32);
+        frame->retained_upload_vertices = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT, Vertex);
+        frame->retained_upload_indices = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT, RENDERER_INDEX_TYPE);
+        frame->retained_index_counts = alloc_arr(&renderer->arena, MAX_RETAINED_GEOMETRY_COUNT, u32);
+    }
+    init_semaphore(&renderer->frame_ready_semaphore, 0, RENDERER_FRAME_BUFFER_COUNT);
+    init_semaphore(&renderer->frame_free_semaphore, RENDERER_FRAME_BUFFER_COUNT, RENDERER_FRAME_BUFFER_COUNT);
+    
+    renderer->quad_shader = compile_quad_shader(false);
+    renderer->depth_peel_shader = compile_quad_shader(true);
+    renderer->sprite_shader = compile_quad_shader(false, true);
+    renderer->blit_framebuffer_shader = compile_blit_framebuffer_shader();
+    renderer->horizontal_blur_shader = compile_horizontal_blur_shader();
+    renderer->vertical_blur_shader = compile_vertical_blur_shader();
+    renderer->depth_peel_composite_shader = compile_depth_peel_composite();
+    
+    // Generate vertex arrays
+    glGenVertexArrays(1, &renderer->render_framebuffer_vao);
+    glBindVertexArray(renderer->render_framebuffer_vao);
+    GLuint renderer_framebuffer_vbo;
+    f32 render_framebuffer_data[] = {
+        -1.0f, -1.0f, 
+        -1.0f, 1.0f, 
+        1.0f, -1.0f, 
+        1.0f, 1.0f, 
+    };
+    glGenBuffers(1, &renderer_framebuffer_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer_framebuffer_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(render_framebuffer_data), render_framebuffer_data, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 8, (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
     
+    // Buffers are created in init_renderer_for_settings, because they depend on settings
+    glGenVertexArrays(1, &renderer->vertex_array);
+    glGenVertexArrays(1, &renderer->sprite_array);
+    
+    size_t retained_vertex_size = MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT * sizeof(Vertex);
+    size_t retained_index_size = MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT * sizeof(RENDERER_INDEX_TYPE);
+    glGenVertexArrays(1, &renderer->retained_array);
+    glBindVertexArray(renderer->retained_array);
+    glGenBuffers(1, &renderer->retained_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->retained_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, retained_vertex_size, 0, GL_STATIC_DRAW);
+    glGenBuffers(1, &renderer->retained_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->retained_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, retained_index_size, 0, GL_STATIC_DRAW);
+    set_vertex_attribute_pointers();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    renderer->video_memory_used += retained_vertex_size + retained_index_size;
+    
+#define MIN_TEXTURE_LAYER_COUNT 4
+    resize_texture_array(renderer, MIN_TEXTURE_LAYER_COUNT);
+    
+    glGenFramebuffers(RENDERER_FRAMEBUFFER_SENTINEL, renderer->framebuffer_ids);
+    glGenTextures(RENDERER_FRAMEBUFFER_SENTINEL, renderer->framebuffer_textures);
+    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_SEPARATED);
+    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_PEEL1);
+    glGenTextures(1, renderer->framebuffer_depths + RENDERER_FRAMEBUFFER_PEEL2);
+    
+    // Render thread is not started yet, so settings are applied here
+    apply_settings(renderer, settings);
+    acquire_frame(renderer);
+    reset_texture_atlas(renderer);
+    return renderer;
+}
+
+void renderer_start_thread(Renderer *renderer, OS *os) {
+    renderer->os = os;
+    os_start_render_thread(os, render_thread_proc, renderer);
+}
+
+
+RendererCommands *renderer_begin_frame(Renderer *renderer) {
+    texture_atlas_begin_frame(&renderer->atlas);
+    return &get_game_frame(renderer)->commands;
+}
+
+void renderer_end_frame(Renderer *renderer) {
+    TIMED_FUNCTION();
+    RendererFrame *frame = get_game_frame(renderer);
+    RendererCommands *commands = &frame->commands;
+    submit_frame(renderer);
+    // Values of render thread are of some previous frame
     {DEBUG_VALUE_BLOCK("Renderer")
             DEBUG_VALUE(renderer->video_memory_used >> 20, "Video memory used");
-        DEBUG_VALUE(renderer->texture_count, "Texture count");
-        DEBUG_VALUE((f32)renderer->commands.index_count / renderer->commands.max_index_count * 100, "Index buffer");
-        DEBUG_VALUE((f32)renderer->commands.vertex_count / renderer->commands.max_vertex_count * 100, "Vertex buffer");
-        DEBUG_VALUE(DEBUG_draw_call_count, "Draw call count");
+        DEBUG_VALUE(renderer->texture_video_memory >> 20, "Texture memory used");
+        DEBUG_VALUE(renderer->atlas.layer_count, "Atlas layers");
+        DEBUG_VALUE(texture_atlas_get_occupancy(&renderer->atlas) * 100, "Atlas occupancy");
+        DEBUG_VALUE(renderer->atlas.eviction_count, "Atlas evictions");
+        DEBUG_VALUE((f32)commands->index_count / commands->max_index_count * 100, "Index buffer");
+        DEBUG_VALUE((f32)commands->vertex_count / commands->max_vertex_count * 100, "Vertex buffer");
+        DEBUG_VALUE((f32)commands->sprite_count / commands->max_sprite_count * 100, "Sprite buffer");
+        DEBUG_VALUE((u32)(commands->vertex_count * sizeof(Vertex)), "Vertex bytes");
+        DEBUG_VALUE((u32)(commands->sprite_count * sizeof(RendererSprite)), "Sprite bytes");
+        DEBUG_VALUE(frame->is_mapped, "Persistent buffers");
+        DEBUG_VALUE(renderer->DEBUG_stall_count, "Persistent buffer stalls");
+        DEBUG_VALUE(commands->retained_geometry_count, "Retained geometry count");
+        DEBUG_VALUE(renderer->DEBUG_retained_draw_count, "Retained geometry drawn");
+        DEBUG_VALUE(frame->retained_upload_count, "Retained geometry uploaded");
+        DEBUG_VALUE(frame->texture_upload_count, "Textures uploaded");
+        DEBUG_VALUE(renderer->DEBUG_draw_call_count, "Draw call count");
     }
+    acquire_frame(renderer);
 }
 
 Texture renderer_create_texture_mipmaps(Renderer *renderer, void *data, u32 width, u32 height) {
-    assert(width <= RENDERER_TEXTURE_DIM && height <= RENDERER_TEXTURE_DIM);
-    Texture tex;
-    assert(renderer->texture_count + 1 < renderer->max_texture_count);
-    tex.index = (u32)renderer->texture_count++;
-    tex.width  = (u16)width;
-    tex.height = (u16)height;
-    assert(tex.width == width && tex.height == height);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->texture_array);
-    ITERATE(iter, iterate_mips(width, height)) {
-        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, iter.level, 0, 0,
-                        tex.index, iter.width, iter.height, 1,
-                        GL_RGBA, GL_UNSIGNED_BYTE, (u32 *)data + iter.pixel_offset);    
-    }
-    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
-    return tex;
+    return create_texture(renderer, data, width, height, false);
 }
 
+bool renderer_use_texture(Renderer *renderer, Texture texture) {
+    return texture_atlas_use(&renderer->atlas, texture);
+}
 
 RendererSettings *get_current_settings(Renderer *renderer) {
     return &renderer->settings;
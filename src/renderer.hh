@@ -13,16 +13,52 @@
 #define RENDERER_INDEX_TYPE u16
 #define RENDERER_MAX_INDEX  MAX_VALUE(RENDERER_INDEX_TYPE)
 #define GL_INDEX_TYPE  (sizeof(RENDERER_INDEX_TYPE) == 4 ? GL_UNSIGNED_INT : sizeof(RENDERER_INDEX_TYPE) == 2 ? GL_UNSIGNED_SHORT : sizeof(RENDERER_INDEX_TYPE) == 1 ? GL_UNSIGNED_BYTE : 0)
+// Indices are relative to first vertex of draw call, so vertex array can be bigger than index type allows - 
+// draw call only can't use more vertices than this, and new one is started when it gets full
+#define RENDERER_VERTEX_PAGE_SIZE ((size_t)RENDERER_MAX_INDEX + 1)
 
+// UV in 0..1 range of texture array layer is stored as u16 in 0..RENDERER_UV_MAX range
+#define RENDERER_UV_MAX 65535
+
+// 24 bytes, shaders don't use normals and UV and color don't need float precision
 struct Vertex {
     vec3 p;
-    vec2 uv;
-    vec3 n;
-    vec4 c;  
+    u16 uv[2];
+    // RGBA8 like rgba_pack_4x8_linear1
+    u32 c;
+    u16 tex;
+};
+
+// Sprite is quad with corners p, p + x_axis * size.x, p + y_axis * size.y and p + x_axis * size.x + y_axis * size.y,
+// where axes are shared by all sprites of draw call. Corners are expanded by backend, so sprite takes 36 bytes
+// instead of 4 vertices and 6 indices of quad
+struct RendererSprite {
+    vec3 p;
+    vec2 size;
+    // UV of corners p and p + x_axis * size.x + y_axis * size.y, packed like Vertex uv
+    u16 uv_min[2];
+    u16 uv_max[2];
+    u32 c;
     u16 tex;
 };
 
+// Retained geometry is vertex data that stays in renderer across frames and is only referenced by draw calls,
+// so geometry that does not change is not written to frame vertex stream again. All geometries have slot of same size
+#define RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT 64
+#define RENDERER_RETAINED_GEOMETRY_INDEX_COUNT (RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT / 2 * 3)
+
+struct RendererRetainedGeometry {
+    u32 vertex_count;
+    u32 index_count;
+    // Set when geometry changes, backend clears it when geometry is uploaded
+    bool is_dirty;
+    bool is_used;
+    u32 next_free;
+};
+
 // Per-frame abstracted renderer interface.
+// Renderer keeps several of them, so commands of next frame can be written while previous one is executed.
+// Arrays of retained geometry are shared by all of them
 struct RendererCommands {
     size_t command_memory_size;
     size_t command_memory_used;
@@ -36,6 +72,19 @@ struct RendererCommands {
     size_t index_count;
     RENDERER_INDEX_TYPE *indices;
     
+    size_t max_sprite_count;
+    size_t sprite_count;
+    RendererSprite *sprites;
+    
+    // Retained geometry is kept between frames. Geometry id is slot index + 1, and vertices and indices of slot
+    // start at slot index times RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT and RENDERER_RETAINED_GEOMETRY_INDEX_COUNT
+    u32 max_retained_geometry_count;
+    u32 retained_geometry_count;
+    u32 first_free_retained_geometry;
+    RendererRetainedGeometry *retained_geometry;
+    Vertex *retained_vertices;
+    RENDERER_INDEX_TYPE *retained_indices;
+    
     struct RendererCommandHeader *last_header;
     struct RendererSetup *last_setup;
     
@@ -48,6 +97,8 @@ struct RendererSettings {
     bool mipmapping;
     bool vsync;
     u32 sample_count;
+    // Vertex data is written directly to persistently mapped buffers instead of being uploaded at the end of frame
+    bool persistent_buffers;
 };
 
 #define RENDERER_TEXTURE_DIM   512
@@ -55,15 +106,24 @@ struct RendererSettings {
 #define RENDERER_RECIPROCAL_TEXTURE_SIZE Vec2(1.0f / RENDERER_TEXTURE_DIM, 1.0f / RENDERER_TEXTURE_DIM)
 
 struct Renderer; 
+struct OS;
 
 Renderer *renderer_init(RendererSettings settings);
+// Moves graphics context to render thread, which executes frames ended by renderer_end_frame while game thread
+// writes next one. Before it frames are not executed. Software renderer has no render thread and executes
+// commands in renderer_end_frame
+void renderer_start_thread(Renderer *renderer, OS *os);
 RendererCommands *renderer_begin_frame(Renderer *renderer);
+// Hands commands to render thread and takes commands buffer for next frame. Waits if render thread
+// is still executing frame that used it
 void renderer_end_frame(Renderer *renderer);
-// Creates texture from mipmaps data.
-// @TODO see if we need to zero-initialize all mipmap levels to transparent so 
-// filtering works properly - maybe we can just avoid using textures of non-standart sizes?
+// Creates texture from mipmaps data. Textures are packed in atlas layers of texture array, see texture_atlas.hh
+// Data is uploaded by render thread, so it has to stay valid until current frame is executed
 Texture renderer_create_texture_mipmaps(Renderer *renderer, void *data, u32 width, u32 height);
-// Clean all previous settings and init new
+// Marks texture as used in current frame. Texture array layer that was not used for longest time is evicted when array is full,
+// so textures have to be checked before they are drawn. Returns false if texture was evicted and has to be created again
+bool renderer_use_texture(Renderer *renderer, Texture texture);
+// Clean all previous settings and init new. Called between frames, waits until render thread has executed all of them
 void init_renderer_for_settings(Renderer *renderer, RendererSettings settings);
 
 RendererSettings *get_current_settings(Renderer *renderer);
@@ -0,0 +1,983 @@
+#include "renderer_software.hh"
+#include "render_group.hh"
+#include "simd_math.hh"
+#include "texture_atlas.hh"
+
+enum {
+    SOFTWARE_FRAMEBUFFER_MAIN,
+    SOFTWARE_FRAMEBUFFER_SEPARATED,
+    SOFTWARE_FRAMEBUFFER_BLUR1,
+    SOFTWARE_FRAMEBUFFER_BLUR2,
+    SOFTWARE_FRAMEBUFFER_SENTINEL,
+};
+
+// Color is RGBA8. Row stride is multiple of 4 pixels, so rows can be processed 4 pixels at a time
+struct SoftwareFramebuffer {
+    u32 width;
+    u32 height;
+    u32 stride;
+    u32 *color;
+    // 0 for framebuffers without depth
+    f32 *depth;
+};
+
+enum {
+    SOFTWARE_ATTRIB_Z,
+    SOFTWARE_ATTRIB_INV_W,
+    // Rest are divided by w, so they can be interpolated linearly in screen space
+    SOFTWARE_ATTRIB_U,
+    SOFTWARE_ATTRIB_V,
+    SOFTWARE_ATTRIB_R,
+    SOFTWARE_ATTRIB_G,
+    SOFTWARE_ATTRIB_B,
+    SOFTWARE_ATTRIB_A,
+    SOFTWARE_ATTRIB_SENTINEL,
+};
+
+// Value of edge function or attribute at screen point is a * x + b * y + c
+// Edge functions are positive inside of triangle
+struct SoftwareTriangle {
+    f32 edge_a[3];
+    f32 edge_b[3];
+    f32 edge_c[3];
+    // Pixel that lies exactly on edge is drawn only if edge bit is set. Edge shared by two triangles
+    // is owned by only one of them, so pixels on diagonal of quad are not blended twice
+    u32 owned_edges;
+    u32 texture_index;
+    f32 attrib_a[SOFTWARE_ATTRIB_SENTINEL];
+    f32 attrib_b[SOFTWARE_ATTRIB_SENTINEL];
+    f32 attrib_c[SOFTWARE_ATTRIB_SENTINEL];
+    // Inclusive pixel bounds clamped to framebuffer
+    i32 min_x;
+    i32 min_y;
+    i32 max_x;
+    i32 max_y;
+};
+
+struct SoftwareClipVertex {
+    vec4 p;
+    vec2 uv;
+    vec4 c;
+};
+
+struct Renderer {
+    MemoryArena arena;
+    RendererSettings settings;
+    RendererCommands commands;
+    WorkQueue *work_queue;
+
+    // Layers of texture array are allocated when atlas first packs texture in them, only top mip level is stored
+    TextureAtlas atlas;
+    u32 *texture_layers[TEXTURE_ATLAS_MAX_LAYER_COUNT];
+
+    void *framebuffer_memory;
+    SoftwareFramebuffer framebuffers[SOFTWARE_FRAMEBUFFER_SENTINEL];
+
+    u32 triangle_count;
+    SoftwareTriangle *triangles;
+    // Framebuffer collected triangles are drawn to
+    u32 current_framebuffer;
+
+    // Statistics of last frame
+    u32 triangles_binned;
+    u32 tile_bin_entries;
+    u32 raster_pass_count;
+};
+
+// Shared by all jobs of raster pass, jobs take tiles one by one until all are done
+struct SoftwareRasterJob {
+    Renderer *renderer;
+    SoftwareFramebuffer *framebuffer;
+    u32 tile_count_x;
+    u32 tile_count;
+    // Triangles of tile are bin_triangles[bin_offsets[tile]] - bin_triangles[bin_offsets[tile + 1] - 1]
+    // in order they were added
+    u32 *bin_offsets;
+    u32 *bin_triangles;
+    volatile i32 next_tile;
+};
+
+inline vec4_4x unpack_color_4x(u32_4x color) {
+    f32_4x scale = F32_4x(1.0f / 255.0f);
+    u32_4x byte_mask = U32_4x(0xFF);
+    vec4_4x result;
+    result.r = F32_4x(I32_4x(color & byte_mask)) * scale;
+    result.g = F32_4x(I32_4x((color >> 8) & byte_mask)) * scale;
+    result.b = F32_4x(I32_4x((color >> 16) & byte_mask)) * scale;
+    result.a = F32_4x(I32_4x(color >> 24)) * scale;
+    return result;
+}
+
+inline u32_4x pack_color_4x(vec4_4x color) {
+    f32_4x zero = F32_4x_zero();
+    f32_4x one = F32_4x(1.0f);
+    f32_4x scale = F32_4x(255.0f);
+    f32_4x half = F32_4x(0.5f);
+    u32_4x r = U32_4x(Floor_i32(Min(Max(color.r, zero), one) * scale + half));
+    u32_4x g = U32_4x(Floor_i32(Min(Max(color.g, zero), one) * scale + half));
+    u32_4x b = U32_4x(Floor_i32(Min(Max(color.b, zero), one) * scale + half));
+    u32_4x a = U32_4x(Floor_i32(Min(Max(color.a, zero), one) * scale + half));
+    u32_4x result = r | (g << 8) | (b << 16) | (a << 24);
+    return result;
+}
+
+// Blend with GL_ONE, GL_ONE_MINUS_SRC_ALPHA - how framebuffers are blitted in OpenGL renderer
+inline vec4_4x blend_premultiplied(vec4_4x src, vec4_4x dst) {
+    f32_4x inv_alpha = F32_4x(1.0f) - src.a;
+    vec4_4x result;
+    result.r = src.r + dst.r * inv_alpha;
+    result.g = src.g + dst.g * inv_alpha;
+    result.b = src.b + dst.b * inv_alpha;
+    result.a = src.a + dst.a * inv_alpha;
+    return result;
+}
+
+static void clear_framebuffer(SoftwareFramebuffer *framebuffer) {
+    // Black with alpha 1, same as glClearColor in OpenGL renderer
+    u32 clear_color = 0xFF000000;
+    size_t pixel_count = (size_t)framebuffer->stride * framebuffer->height;
+    for (size_t pixel_idx = 0; pixel_idx < pixel_count; ++pixel_idx) {
+        framebuffer->color[pixel_idx] = clear_color;
+    }
+    if (framebuffer->depth) {
+        for (size_t pixel_idx = 0; pixel_idx < pixel_count; ++pixel_idx) {
+            framebuffer->depth[pixel_idx] = 1.0f;
+        }
+    }
+}
+
+//
+// Rasterization
+//
+
+static void rasterize_triangle(Renderer *renderer, SoftwareFramebuffer *framebuffer, SoftwareTriangle *triangle,
+                               i32 rect_min_x, i32 rect_min_y, i32 rect_max_x, i32 rect_max_y) {
+    // Tiles start at multiple of 4, so aligning start down does not leave tile
+    i32 min_x = (triangle->min_x > rect_min_x ? triangle->min_x : rect_min_x) & ~3;
+    i32 min_y = triangle->min_y > rect_min_y ? triangle->min_y : rect_min_y;
+    i32 max_x = triangle->max_x < rect_max_x ? triangle->max_x : rect_max_x;
+    i32 max_y = triangle->max_y < rect_max_y ? triangle->max_y : rect_max_y;
+
+    u32 *texture_pixels = renderer->texture_layers[triangle->texture_index];
+    f32_4x max_texel = F32_4x((f32)(RENDERER_TEXTURE_DIM - 1));
+    f32_4x texture_dim = F32_4x((f32)RENDERER_TEXTURE_DIM);
+    f32_4x zero = F32_4x_zero();
+    f32_4x one = F32_4x(1.0f);
+    f32_4x all_set = zero == zero;
+    // _mm_set_ps takes lanes from the highest one, so this is pixel centers of 4 consecutive pixels
+    f32_4x lane_offsets = F32_4x(3.5f, 2.5f, 1.5f, 0.5f);
+
+    f32_4x edge_a[3];
+    f32_4x edge_b[3];
+    f32_4x edge_c[3];
+    f32_4x edge_owned[3];
+    for (u32 edge_idx = 0; edge_idx < 3; ++edge_idx) {
+        edge_a[edge_idx] = F32_4x(triangle->edge_a[edge_idx]);
+        edge_b[edge_idx] = F32_4x(triangle->edge_b[edge_idx]);
+        edge_c[edge_idx] = F32_4x(triangle->edge_c[edge_idx]);
+        edge_owned[edge_idx] = (triangle->owned_edges & (1 << edge_idx)) ? all_set : zero;
+    }
+    f32_4x attrib_a[SOFTWARE_ATTRIB_SENTINEL];
+    for (u32 attrib_idx = 0; attrib_idx < SOFTWARE_ATTRIB_SENTINEL; ++attrib_idx) {
+        attrib_a[attrib_idx] = F32_4x(triangle->attrib_a[attrib_idx]);
+    }
+
+    for (i32 y = min_y; y <= max_y; ++y) {
+        f32_4x pixel_y = F32_4x((f32)y + 0.5f);
+        // Same expression is used for all triangles, so edge shared by two triangles gives exactly opposite values
+        f32_4x row_edge[3];
+        for (u32 edge_idx = 0; edge_idx < 3; ++edge_idx) {
+            row_edge[edge_idx] = edge_b[edge_idx] * pixel_y + edge_c[edge_idx];
+        }
+        f32_4x row_attrib[SOFTWARE_ATTRIB_SENTINEL];
+        for (u32 attrib_idx = 0; attrib_idx < SOFTWARE_ATTRIB_SENTINEL; ++attrib_idx) {
+            row_attrib[attrib_idx] = F32_4x(triangle->attrib_b[attrib_idx]) * pixel_y + F32_4x(triangle->attrib_c[attrib_idx]);
+        }
+        u32 *color_row = framebuffer->color + (size_t)y * framebuffer->stride;
+        f32 *depth_row = framebuffer->depth + (size_t)y * framebuffer->stride;
+
+        for (i32 x = min_x; x <= max_x; x += 4) {
+            f32_4x pixel_x = F32_4x((f32)x) + lane_offsets;
+            f32_4x mask = all_set;
+            for (u32 edge_idx = 0; edge_idx < 3; ++edge_idx) {
+                f32_4x edge = edge_a[edge_idx] * pixel_x + row_edge[edge_idx];
+                mask = mask & ((edge > zero) | ((edge == zero) & edge_owned[edge_idx]));
+            }
+            if (all_false(mask)) {
+                continue;
+            }
+
+            f32_4x z = attrib_a[SOFTWARE_ATTRIB_Z] * pixel_x + row_attrib[SOFTWARE_ATTRIB_Z];
+            f32_4x old_depth = F32_4x_load(depth_row + x);
+            mask = mask & (z <= old_depth);
+            if (all_false(mask)) {
+                continue;
+            }
+
+            f32_4x w = one / (attrib_a[SOFTWARE_ATTRIB_INV_W] * pixel_x + row_attrib[SOFTWARE_ATTRIB_INV_W]);
+            f32_4x u = (attrib_a[SOFTWARE_ATTRIB_U] * pixel_x + row_attrib[SOFTWARE_ATTRIB_U]) * w;
+            f32_4x v = (attrib_a[SOFTWARE_ATTRIB_V] * pixel_x + row_attrib[SOFTWARE_ATTRIB_V]) * w;
+            // Texture is surrounded by copies of its edge texels in atlas layer, so clamping to layer is same as clamping to texture
+            f32_4x texel_x = Floor(Min(Max(u * texture_dim, zero), max_texel));
+            f32_4x texel_y = Floor(Min(Max(v * texture_dim, zero), max_texel));
+            u32_4x offsets = U32_4x(Floor_i32(texel_y * texture_dim + texel_x));
+            u32_4x texels = U32_4x(texture_pixels[get_lane(offsets, 0)], texture_pixels[get_lane(offsets, 1)],
+                                   texture_pixels[get_lane(offsets, 2)], texture_pixels[get_lane(offsets, 3)]);
+            vec4_4x texel = unpack_color_4x(texels);
+            // Shader discards transparent texels, so they don't write depth
+            mask = mask & (texel.a > zero);
+            if (all_false(mask)) {
+                continue;
+            }
+
+            vec4_4x src;
+            src.r = texel.r * (attrib_a[SOFTWARE_ATTRIB_R] * pixel_x + row_attrib[SOFTWARE_ATTRIB_R]) * w;
+            src.g = texel.g * (attrib_a[SOFTWARE_ATTRIB_G] * pixel_x + row_attrib[SOFTWARE_ATTRIB_G]) * w;
+            src.b = texel.b * (attrib_a[SOFTWARE_ATTRIB_B] * pixel_x + row_attrib[SOFTWARE_ATTRIB_B]) * w;
+            src.a = texel.a * (attrib_a[SOFTWARE_ATTRIB_A] * pixel_x + row_attrib[SOFTWARE_ATTRIB_A]) * w;
+            u32_4x old_color = U32_4x_load(color_row + x);
+            vec4_4x dst = unpack_color_4x(old_color);
+            // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA for color and GL_ONE, GL_ONE_MINUS_SRC_ALPHA for alpha
+            f32_4x inv_alpha = one - src.a;
+            vec4_4x blended;
+            blended.r = src.r * src.a + dst.r * inv_alpha;
+            blended.g = src.g * src.a + dst.g * inv_alpha;
+            blended.b = src.b * src.a + dst.b * inv_alpha;
+            blended.a = src.a + dst.a * inv_alpha;
+
+            store(color_row + x, select(old_color, mask, pack_color_4x(blended)));
+            store(depth_row + x, select(old_depth, mask, z));
+        }
+    }
+}
+
+static void rasterize_tile(SoftwareRasterJob *job, u32 tile_idx) {
+    SoftwareFramebuffer *framebuffer = job->framebuffer;
+    i32 min_x = (i32)(tile_idx % job->tile_count_x) * SOFTWARE_RENDERER_TILE_SIZE;
+    i32 min_y = (i32)(tile_idx / job->tile_count_x) * SOFTWARE_RENDERER_TILE_SIZE;
+    i32 max_x = min_x + SOFTWARE_RENDERER_TILE_SIZE - 1;
+    i32 max_y = min_y + SOFTWARE_RENDERER_TILE_SIZE - 1;
+    max_x = max_x < (i32)framebuffer->width - 1 ? max_x : (i32)framebuffer->width - 1;
+    max_y = max_y < (i32)framebuffer->height - 1 ? max_y : (i32)framebuffer->height - 1;
+    for (u32 entry_idx = job->bin_offsets[tile_idx]; entry_idx < job->bin_offsets[tile_idx + 1]; ++entry_idx) {
+        SoftwareTriangle *triangle = job->renderer->triangles + job->bin_triangles[entry_idx];
+        rasterize_triangle(job->renderer, framebuffer, triangle, min_x, min_y, max_x, max_y);
+    }
+}
+
+WORK_QUEUE_CALLBACK(rasterize_tiles_work) {
+    SoftwareRasterJob *job = (SoftwareRasterJob *)data;
+    for (;;) {
+        u32 tile_idx = (u32)(interlocked_increment(&job->next_tile) - 1);
+        if (tile_idx >= job->tile_count) {
+            break;
+        }
+        rasterize_tile(job, tile_idx);
+    }
+}
+
+// Triangle bounds are tested first, so this only drops tiles that are near diagonal edges
+static bool triangle_overlaps_tile(SoftwareTriangle *triangle, i32 tile_x, i32 tile_y) {
+    bool result = true;
+    f32 min_x = (f32)(tile_x * SOFTWARE_RENDERER_TILE_SIZE);
+    f32 min_y = (f32)(tile_y * SOFTWARE_RENDERER_TILE_SIZE);
+    f32 max_x = min_x + SOFTWARE_RENDERER_TILE_SIZE;
+    f32 max_y = min_y + SOFTWARE_RENDERER_TILE_SIZE;
+    for (u32 edge_idx = 0; edge_idx < 3 && result; ++edge_idx) {
+        // Corner of tile where edge function is the largest
+        f32 a = triangle->edge_a[edge_idx];
+        f32 b = triangle->edge_b[edge_idx];
+        f32 x = a > 0.0f ? max_x : min_x;
+        f32 y = b > 0.0f ? max_y : min_y;
+        result = a * x + b * y + triangle->edge_c[edge_idx] >= 0.0f;
+    }
+    return result;
+}
+
+// Bins collected triangles into tiles and rasterizes them
+static void rasterize_collected_triangles(Renderer *renderer) {
+    if (!renderer->triangle_count) {
+        return;
+    }
+    TIMED_FUNCTION();
+    SoftwareFramebuffer *framebuffer = renderer->framebuffers + renderer->current_framebuffer;
+    assert(framebuffer->depth);
+    TempMemory bin_temp = begin_temp_memory(&renderer->arena);
+    SoftwareRasterJob *job = alloc_struct(&renderer->arena, SoftwareRasterJob);
+    job->renderer = renderer;
+    job->framebuffer = framebuffer;
+    job->tile_count_x = (framebuffer->width + SOFTWARE_RENDERER_TILE_SIZE - 1) / SOFTWARE_RENDERER_TILE_SIZE;
+    u32 tile_count_y = (framebuffer->height + SOFTWARE_RENDERER_TILE_SIZE - 1) / SOFTWARE_RENDERER_TILE_SIZE;
+    job->tile_count = job->tile_count_x * tile_count_y;
+
+    // Count triangles in each tile first, so bins can be stored in single array
+    u32 *bin_offsets = alloc_arr(&renderer->arena, (job->tile_count + 1), u32);
+    for (u32 triangle_idx = 0; triangle_idx < renderer->triangle_count; ++triangle_idx) {
+        SoftwareTriangle *triangle = renderer->triangles + triangle_idx;
+        for (i32 tile_y = triangle->min_y / SOFTWARE_RENDERER_TILE_SIZE; tile_y <= triangle->max_y / SOFTWARE_RENDERER_TILE_SIZE; ++tile_y) {
+            for (i32 tile_x = triangle->min_x / SOFTWARE_RENDERER_TILE_SIZE; tile_x <= triangle->max_x / SOFTWARE_RENDERER_TILE_SIZE; ++tile_x) {
+                if (triangle_overlaps_tile(triangle, tile_x, tile_y)) {
+                    ++bin_offsets[tile_y * job->tile_count_x + tile_x];
+                }
+            }
+        }
+    }
+    u32 entry_count = 0;
+    for (u32 tile_idx = 0; tile_idx <= job->tile_count; ++tile_idx) {
+        u32 tile_entry_count = bin_offsets[tile_idx];
+        bin_offsets[tile_idx] = entry_count;
+        entry_count += tile_entry_count;
+    }
+    u32 *bin_cursors = alloc_arr(&renderer->arena, job->tile_count, u32, false);
+    memcpy(bin_cursors, bin_offsets, sizeof(u32) * job->tile_count);
+    u32 *bin_triangles = alloc_arr(&renderer->arena, entry_count, u32, false);
+    for (u32 triangle_idx = 0; triangle_idx < renderer->triangle_count; ++triangle_idx) {
+        SoftwareTriangle *triangle = renderer->triangles + triangle_idx;
+        for (i32 tile_y = triangle->min_y / SOFTWARE_RENDERER_TILE_SIZE; tile_y <= triangle->max_y / SOFTWARE_RENDERER_TILE_SIZE; ++tile_y) {
+            for (i32 tile_x = triangle->min_x / SOFTWARE_RENDERER_TILE_SIZE; tile_x <= triangle->max_x / SOFTWARE_RENDERER_TILE_SIZE; ++tile_x) {
+                if (triangle_overlaps_tile(triangle, tile_x, tile_y)) {
+                    bin_triangles[bin_cursors[tile_y * job->tile_count_x + tile_x]++] = triangle_idx;
+                }
+            }
+        }
+    }
+    job->bin_offsets = bin_offsets;
+    job->bin_triangles = bin_triangles;
+
+    // Calling thread takes tiles too, so pass completes even if no job could be added
+    if (renderer->work_queue) {
+        u32 job_count = job->tile_count < SOFTWARE_RENDERER_MAX_JOB_COUNT ? job->tile_count : SOFTWARE_RENDERER_MAX_JOB_COUNT;
+        for (u32 job_idx = 1; job_idx < job_count; ++job_idx) {
+            if (!add_work_queue_entry(renderer->work_queue, rasterize_tiles_work, job)) {
+                break;
+            }
+        }
+    }
+    rasterize_tiles_work(job);
+    if (renderer->work_queue) {
+        complete_all_work(renderer->work_queue);
+    }
+
+    renderer->triangles_binned += renderer->triangle_count;
+    renderer->tile_bin_entries += entry_count;
+    ++renderer->raster_pass_count;
+    renderer->triangle_count = 0;
+    end_temp_memory(bin_temp);
+}
+
+//
+// Triangle setup
+//
+
+static void add_triangle(Renderer *renderer, SoftwareClipVertex *v0, SoftwareClipVertex *v1, SoftwareClipVertex *v2, u32 texture_index) {
+    SoftwareFramebuffer *framebuffer = renderer->framebuffers + renderer->current_framebuffer;
+    SoftwareClipVertex *clip_vertices[3] = { v0, v1, v2 };
+    f32 x[3], y[3];
+    f32 attribs[3][SOFTWARE_ATTRIB_SENTINEL];
+    for (u32 vertex_idx = 0; vertex_idx < 3; ++vertex_idx) {
+        SoftwareClipVertex *vertex = clip_vertices[vertex_idx];
+        f32 inv_w = 1.0f / vertex->p.w;
+        // Rows go from bottom to top, so this is the same as glViewport
+        x[vertex_idx] = (vertex->p.x * inv_w * 0.5f + 0.5f) * framebuffer->width;
+        y[vertex_idx] = (vertex->p.y * inv_w * 0.5f + 0.5f) * framebuffer->height;
+        f32 *attrib = attribs[vertex_idx];
+        attrib[SOFTWARE_ATTRIB_Z] = vertex->p.z * inv_w * 0.5f + 0.5f;
+        attrib[SOFTWARE_ATTRIB_INV_W] = inv_w;
+        attrib[SOFTWARE_ATTRIB_U] = vertex->uv.x * inv_w;
+        attrib[SOFTWARE_ATTRIB_V] = vertex->uv.y * inv_w;
+        attrib[SOFTWARE_ATTRIB_R] = vertex->c.r * inv_w;
+        attrib[SOFTWARE_ATTRIB_G] = vertex->c.g * inv_w;
+        attrib[SOFTWARE_ATTRIB_B] = vertex->c.b * inv_w;
+        attrib[SOFTWARE_ATTRIB_A] = vertex->c.a * inv_w;
+    }
+
+    f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0f) {
+        return;
+    }
+    // Faces are not culled, triangles are just turned counter clockwise
+    u32 order[3] = { 0, 1, 2 };
+    if (area < 0.0f) {
+        order[1] = 2;
+        order[2] = 1;
+        area = -area;
+    }
+    f32 min_px = Min(x[0], Min(x[1], x[2]));
+    f32 min_py = Min(y[0], Min(y[1], y[2]));
+    f32 max_px = Max(x[0], Max(x[1], x[2]));
+    f32 max_py = Max(y[0], Max(y[1], y[2]));
+    if (max_px < 0.0f || max_py < 0.0f || min_px >= framebuffer->width || min_py >= framebuffer->height) {
+        return;
+    }
+
+    if (renderer->triangle_count == SOFTWARE_RENDERER_MAX_TRIANGLE_COUNT) {
+        rasterize_collected_triangles(renderer);
+    }
+    SoftwareTriangle *triangle = renderer->triangles + renderer->triangle_count++;
+    triangle->texture_index = texture_index;
+    triangle->min_x = Floor_i32(Max(min_px, 0.0f));
+    triangle->min_y = Floor_i32(Max(min_py, 0.0f));
+    triangle->max_x = Floor_i32(Min(max_px, (f32)(framebuffer->width - 1)));
+    triangle->max_y = Floor_i32(Min(max_py, (f32)(framebuffer->height - 1)));
+
+    triangle->owned_edges = 0;
+    for (u32 edge_idx = 0; edge_idx < 3; ++edge_idx) {
+        u32 from = order[(edge_idx + 1) % 3];
+        u32 to = order[(edge_idx + 2) % 3];
+        f32 a = y[from] - y[to];
+        f32 b = x[to] - x[from];
+        // Constant is computed from the same end of edge for both triangles sharing it, so
+        // their edge functions are exactly opposite
+        u32 base = (x[from] < x[to] || (x[from] == x[to] && y[from] < y[to])) ? from : to;
+        triangle->edge_a[edge_idx] = a;
+        triangle->edge_b[edge_idx] = b;
+        triangle->edge_c[edge_idx] = -(a * x[base] + b * y[base]);
+        if (a > 0.0f || (a == 0.0f && b > 0.0f)) {
+            triangle->owned_edges |= 1 << edge_idx;
+        }
+    }
+
+    f32 inv_area = 1.0f / area;
+    f32 dx1 = x[order[1]] - x[order[0]];
+    f32 dy1 = y[order[1]] - y[order[0]];
+    f32 dx2 = x[order[2]] - x[order[0]];
+    f32 dy2 = y[order[2]] - y[order[0]];
+    for (u32 attrib_idx = 0; attrib_idx < SOFTWARE_ATTRIB_SENTINEL; ++attrib_idx) {
+        f32 f0 = attribs[order[0]][attrib_idx];
+        f32 df1 = attribs[order[1]][attrib_idx] - f0;
+        f32 df2 = attribs[order[2]][attrib_idx] - f0;
+        f32 a = (df1 * dy2 - df2 * dy1) * inv_area;
+        f32 b = (df2 * dx1 - df1 * dx2) * inv_area;
+        triangle->attrib_a[attrib_idx] = a;
+        triangle->attrib_b[attrib_idx] = b;
+        triangle->attrib_c[attrib_idx] = f0 - a * x[order[0]] - b * y[order[0]];
+    }
+}
+
+// Clips polygon to half space dot(plane, p) >= 0, returns new vertex count
+static u32 clip_polygon(SoftwareClipVertex *src, u32 src_count, SoftwareClipVertex *dst, vec4 plane) {
+    u32 dst_count = 0;
+    for (u32 vertex_idx = 0; vertex_idx < src_count; ++vertex_idx) {
+        SoftwareClipVertex *a = src + vertex_idx;
+        SoftwareClipVertex *b = src + (vertex_idx + 1) % src_count;
+        f32 da = dot(plane, a->p);
+        f32 db = dot(plane, b->p);
+        if (da >= 0.0f) {
+            dst[dst_count++] = *a;
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            f32 t = da / (da - db);
+            SoftwareClipVertex *vertex = dst + dst_count++;
+            vertex->p = a->p + (b->p - a->p) * t;
+            vertex->uv = a->uv + (b->uv - a->uv) * t;
+            vertex->c = a->c + (b->c - a->c) * t;
+        }
+    }
+    return dst_count;
+}
+
+static void clip_and_add_triangle(Renderer *renderer, SoftwareClipVertex *v0, SoftwareClipVertex *v1, SoftwareClipVertex *v2, u32 texture_index) {
+    // Triangles that are fully outside of one of side planes are dropped, the rest are cut by screen bounds
+    vec4 side_planes[] = { Vec4(1, 0, 0, 1), Vec4(-1, 0, 0, 1), Vec4(0, 1, 0, 1), Vec4(0, -1, 0, 1) };
+    for (u32 plane_idx = 0; plane_idx < ARRAY_SIZE(side_planes); ++plane_idx) {
+        vec4 plane = side_planes[plane_idx];
+        if (dot(plane, v0->p) < 0.0f && dot(plane, v1->p) < 0.0f && dot(plane, v2->p) < 0.0f) {
+            return;
+        }
+    }
+
+    // Near and far planes are clipped against, so w is positive and depth is in [0; 1]
+    vec4 near_plane = Vec4(0, 0, 1, 1);
+    vec4 far_plane = Vec4(0, 0, -1, 1);
+    bool is_inside = true;
+    SoftwareClipVertex *vertices[3] = { v0, v1, v2 };
+    for (u32 vertex_idx = 0; vertex_idx < 3; ++vertex_idx) {
+        vec4 p = vertices[vertex_idx]->p;
+        if (dot(near_plane, p) < 0.0f || dot(far_plane, p) < 0.0f) {
+            is_inside = false;
+        }
+    }
+    if (is_inside) {
+        add_triangle(renderer, v0, v1, v2, texture_index);
+    } else {
+        // Each plane adds at most one vertex
+        SoftwareClipVertex polygon[3];
+        SoftwareClipVertex near_clipped[4];
+        SoftwareClipVertex clipped[5];
+        polygon[0] = *v0;
+        polygon[1] = *v1;
+        polygon[2] = *v2;
+        u32 vertex_count = clip_polygon(polygon, 3, near_clipped, near_plane);
+        vertex_count = clip_polygon(near_clipped, vertex_count, clipped, far_plane);
+        for (u32 vertex_idx = 2; vertex_idx < vertex_count; ++vertex_idx) {
+            add_triangle(renderer, clipped, clipped + vertex_idx - 1, clipped + vertex_idx, texture_index);
+        }
+    }
+}
+
+// Indices are relative to first vertex, like base vertex in glDrawElementsBaseVertex
+static void add_indexed_triangles(Renderer *renderer, RendererSetup *setup, Vertex *vertices, u32 vertex_count,
+                                  RENDERER_INDEX_TYPE *indices, u32 index_count) {
+    TempMemory vertex_temp = begin_temp_memory(&renderer->arena);
+    SoftwareClipVertex *clip_vertices = alloc_arr(&renderer->arena, vertex_count, SoftwareClipVertex, false);
+    for (u32 vertex_idx = 0; vertex_idx < vertex_count; ++vertex_idx) {
+        Vertex *vertex = vertices + vertex_idx;
+        SoftwareClipVertex *clip_vertex = clip_vertices + vertex_idx;
+        clip_vertex->p = setup->mvp * Vec4(vertex->p, 1.0f);
+        clip_vertex->uv = Vec2(vertex->uv[0], vertex->uv[1]) * (1.0f / RENDERER_UV_MAX);
+        clip_vertex->c = rgba_unpack_linear1(vertex->c);
+    }
+
+    for (u32 triangle_idx = 0; triangle_idx < index_count / 3; ++triangle_idx) {
+        u32 i0 = indices[triangle_idx * 3 + 0];
+        u32 i1 = indices[triangle_idx * 3 + 1];
+        u32 i2 = indices[triangle_idx * 3 + 2];
+        assert(i0 < vertex_count && i1 < vertex_count && i2 < vertex_count);
+        // Texture index is flat attribute and is taken from first vertex
+        u32 texture_index = vertices[i0].tex;
+        assert(renderer->texture_layers[texture_index]);
+        clip_and_add_triangle(renderer, clip_vertices + i0, clip_vertices + i1, clip_vertices + i2, texture_index);
+    }
+    end_temp_memory(vertex_temp);
+}
+
+static void add_quads(Renderer *renderer, RendererSetup *setup, RendererCommandQuads *quads) {
+    TIMED_FUNCTION();
+    add_indexed_triangles(renderer, setup, renderer->commands.vertices + quads->vertex_array_offset, quads->quad_count * 4,
+                          renderer->commands.indices + quads->index_array_offset, quads->quad_count * 6);
+}
+
+// Geometry is read from retained arrays directly, so there is nothing to upload
+static void add_retained_geometry(Renderer *renderer, RendererSetup *setup, u32 *ids, u32 geometry_count) {
+    TIMED_FUNCTION();
+    RendererCommands *commands = &renderer->commands;
+    for (u32 id_idx = 0; id_idx < geometry_count; ++id_idx) {
+        u32 slot_idx = ids[id_idx] - 1;
+        assert(slot_idx < commands->retained_geometry_count);
+        RendererRetainedGeometry *geometry = commands->retained_geometry + slot_idx;
+        add_indexed_triangles(renderer, setup, commands->retained_vertices + slot_idx * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT, geometry->vertex_count,
+                              commands->retained_indices + slot_idx * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT, geometry->index_count);
+        geometry->is_dirty = false;
+    }
+}
+
+// Sprite corners are expanded to same triangles push_quad would make
+static void add_sprites(Renderer *renderer, RendererSetup *setup, RendererCommandSprites *sprites) {
+    TIMED_FUNCTION();
+    for (u32 sprite_idx = 0; sprite_idx < sprites->sprite_count; ++sprite_idx) {
+        RendererSprite *sprite = renderer->commands.sprites + sprites->sprite_array_offset + sprite_idx;
+        assert(renderer->texture_layers[sprite->tex]);
+        vec3 x = sprites->x_axis * sprite->size.x;
+        vec3 y = sprites->y_axis * sprite->size.y;
+        vec2 uv_min = Vec2(sprite->uv_min[0], sprite->uv_min[1]) * (1.0f / RENDERER_UV_MAX);
+        vec2 uv_max = Vec2(sprite->uv_max[0], sprite->uv_max[1]) * (1.0f / RENDERER_UV_MAX);
+        vec4 c = rgba_unpack_linear1(sprite->c);
+
+        SoftwareClipVertex v[4];
+        v[0].p = setup->mvp * Vec4(sprite->p, 1.0f);
+        v[0].uv = uv_min;
+        v[1].p = setup->mvp * Vec4(sprite->p + y, 1.0f);
+        v[1].uv = Vec2(uv_min.x, uv_max.y);
+        v[2].p = setup->mvp * Vec4(sprite->p + x, 1.0f);
+        v[2].uv = Vec2(uv_max.x, uv_min.y);
+        v[3].p = setup->mvp * Vec4(sprite->p + x + y, 1.0f);
+        v[3].uv = uv_max;
+        for (u32 vertex_idx = 0; vertex_idx < 4; ++vertex_idx) {
+            v[vertex_idx].c = c;
+        }
+        clip_and_add_triangle(renderer, v + 0, v + 2, v + 3, sprite->tex);
+        clip_and_add_triangle(renderer, v + 0, v + 1, v + 3, sprite->tex);
+    }
+}
+
+//
+// Framebuffer operations
+//
+
+// Samples source with nearest filter at pixel centers of destination and blends with GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+static void blit_framebuffer(Renderer *renderer, u32 from, u32 to, bool clear = false) {
+    TIMED_FUNCTION();
+    SoftwareFramebuffer *src = renderer->framebuffers + from;
+    SoftwareFramebuffer *dst = renderer->framebuffers + to;
+    if (clear) {
+        clear_framebuffer(dst);
+    }
+
+    TempMemory blit_temp = begin_temp_memory(&renderer->arena);
+    u32 *src_columns = alloc_arr(&renderer->arena, dst->stride, u32, false);
+    for (u32 x = 0; x < dst->stride; ++x) {
+        u32 src_x = (u32)(((f32)x + 0.5f) / dst->width * src->width);
+        src_columns[x] = src_x < src->width ? src_x : src->width - 1;
+    }
+    for (u32 y = 0; y < dst->height; ++y) {
+        u32 src_y = (u32)(((f32)y + 0.5f) / dst->height * src->height);
+        src_y = src_y < src->height ? src_y : src->height - 1;
+        u32 *src_row = src->color + (size_t)src_y * src->stride;
+        u32 *dst_row = dst->color + (size_t)y * dst->stride;
+        for (u32 x = 0; x < dst->stride; x += 4) {
+            u32_4x src_color = U32_4x(src_row[src_columns[x]], src_row[src_columns[x + 1]],
+                                      src_row[src_columns[x + 2]], src_row[src_columns[x + 3]]);
+            vec4_4x blended = blend_premultiplied(unpack_color_4x(src_color), unpack_color_4x(U32_4x_load(dst_row + x)));
+            store(dst_row + x, pack_color_4x(blended));
+        }
+    }
+    end_temp_memory(blit_temp);
+}
+
+static const f32 blur_weights[] = {
+    0.0093f, 0.028002f, 0.065984f, 0.121703f, 0.175713f, 0.198596f, 0.175713f, 0.121703f, 0.065984f, 0.028002f, 0.0093f
+};
+
+// Same as blur in OpenGL renderer: separated framebuffer is blurred horizontally into quarter size framebuffer,
+// then vertically into another one, and result is blitted back
+static void blur_separated_framebuffer(Renderer *renderer) {
+    TIMED_FUNCTION();
+    SoftwareFramebuffer *src = renderer->framebuffers + SOFTWARE_FRAMEBUFFER_SEPARATED;
+    SoftwareFramebuffer *blur1 = renderer->framebuffers + SOFTWARE_FRAMEBUFFER_BLUR1;
+    SoftwareFramebuffer *blur2 = renderer->framebuffers + SOFTWARE_FRAMEBUFFER_BLUR2;
+    i32 tap_radius = ARRAY_SIZE(blur_weights) / 2;
+    for (u32 y = 0; y < blur1->height; ++y) {
+        u32 src_y = (u32)(((f32)y + 0.5f) / blur1->height * src->height);
+        src_y = src_y < src->height ? src_y : src->height - 1;
+        u32 *src_row = src->color + (size_t)src_y * src->stride;
+        for (u32 x = 0; x < blur1->width; ++x) {
+            vec4 sum = Vec4(0);
+            for (i32 tap = -tap_radius; tap <= tap_radius; ++tap) {
+                f32 u = ((f32)x + 0.5f + tap) / blur1->width;
+                i32 src_x = Floor_i32(u * src->width);
+                src_x = src_x < 0 ? 0 : src_x < (i32)src->width ? src_x : (i32)src->width - 1;
+                sum += rgba_unpack_linear1(src_row[src_x]) * blur_weights[tap + tap_radius];
+            }
+            blur1->color[(size_t)y * blur1->stride + x] = rgba_pack_4x8_linear1(sum);
+        }
+    }
+    for (u32 y = 0; y < blur2->height; ++y) {
+        for (u32 x = 0; x < blur2->width; ++x) {
+            vec4 sum = Vec4(0);
+            for (i32 tap = -tap_radius; tap <= tap_radius; ++tap) {
+                i32 src_y = (i32)y + tap;
+                src_y = src_y < 0 ? 0 : src_y < (i32)blur1->height ? src_y : (i32)blur1->height - 1;
+                sum += rgba_unpack_linear1(blur1->color[(size_t)src_y * blur1->stride + x]) * blur_weights[tap + tap_radius];
+            }
+            blur2->color[(size_t)y * blur2->stride + x] = rgba_pack_4x8_linear1(sum);
+        }
+    }
+    blit_framebuffer(renderer, SOFTWARE_FRAMEBUFFER_BLUR2, SOFTWARE_FRAMEBUFFER_SEPARATED, true);
+}
+
+//
+// Renderer interface
+//
+
+Renderer *renderer_init(RendererSettings settings) {
+#define SOFTWARE_RENDERER_ARENA_SIZE MEGABYTES(512)
+    Renderer *renderer = bootstrap_alloc_struct(Renderer, arena, SOFTWARE_RENDERER_ARENA_SIZE);
+
+    // Indices are relative to first vertex of command, so vertex count is not limited by index type
+#define SOFTWARE_RENDERER_COMMAND_MEMORY_SIZE MEGABYTES(16)
+#define SOFTWARE_RENDERER_MAX_VERTEX_COUNT (1 << 20)
+#define SOFTWARE_RENDERER_MAX_INDEX_COUNT (SOFTWARE_RENDERER_MAX_VERTEX_COUNT / 2 * 3)
+    renderer->commands.command_memory_size = SOFTWARE_RENDERER_COMMAND_MEMORY_SIZE;
+    renderer->commands.command_memory = (u8 *)alloc(&renderer->arena, SOFTWARE_RENDERER_COMMAND_MEMORY_SIZE);
+    renderer->commands.max_vertex_count = SOFTWARE_RENDERER_MAX_VERTEX_COUNT;
+    renderer->commands.vertices = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_VERTEX_COUNT, Vertex);
+    renderer->commands.max_index_count = SOFTWARE_RENDERER_MAX_INDEX_COUNT;
+    renderer->commands.indices = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_INDEX_COUNT, RENDERER_INDEX_TYPE);
+#define SOFTWARE_RENDERER_MAX_SPRITE_COUNT (1 << 18)
+    renderer->commands.max_sprite_count = SOFTWARE_RENDERER_MAX_SPRITE_COUNT;
+    renderer->commands.sprites = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_SPRITE_COUNT, RendererSprite);
+#define SOFTWARE_RENDERER_MAX_RETAINED_GEOMETRY_COUNT 256
+    renderer->commands.max_retained_geometry_count = SOFTWARE_RENDERER_MAX_RETAINED_GEOMETRY_COUNT;
+    renderer->commands.retained_geometry = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_RETAINED_GEOMETRY_COUNT, RendererRetainedGeometry);
+    renderer->commands.retained_vertices = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_VERTEX_COUNT, Vertex);
+    renderer->commands.retained_indices = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_RETAINED_GEOMETRY_COUNT * RENDERER_RETAINED_GEOMETRY_INDEX_COUNT, RENDERER_INDEX_TYPE);
+
+    renderer->triangles = alloc_arr(&renderer->arena, SOFTWARE_RENDERER_MAX_TRIANGLE_COUNT, SoftwareTriangle, false);
+
+    init_renderer_for_settings(renderer, settings);
+    return renderer;
+}
+
+static Texture create_texture(Renderer *renderer, void *data, u32 width, u32 height, bool is_pinned) {
+    Texture tex = renderer->commands.white_texture;
+    bool is_packed = texture_atlas_pack(&renderer->atlas, &tex, width, height, is_pinned);
+    // All layers are used by current frame
+    assert(is_packed);
+    if (is_packed) {
+        // Memory for layer is allocated once and is reused after eviction
+        u32 **layer = renderer->texture_layers + tex.index;
+        if (!*layer) {
+            *layer = alloc_arr(&renderer->arena, RENDERER_TEXTURE_DIM * RENDERER_TEXTURE_DIM, u32, false);
+        }
+        TempMemory upload_temp = begin_temp_memory(&renderer->arena);
+        TextureAtlasLevel upload = get_texture_atlas_level(&renderer->arena, tex, data, 0);
+        for (u32 y = 0; y < upload.height; ++y) {
+            memcpy(*layer + (upload.y + y) * RENDERER_TEXTURE_DIM + upload.x, upload.pixels + y * upload.width, sizeof(u32) * upload.width);
+        }
+        end_temp_memory(upload_temp);
+    }
+    return tex;
+}
+
+void renderer_set_work_queue(Renderer *renderer, WorkQueue *queue) {
+    renderer->work_queue = queue;
+}
+
+void init_renderer_for_settings(Renderer *renderer, RendererSettings settings) {
+    // Texture layers are kept like in texture array, textures are created again after settings change
+    texture_atlas_reset(&renderer->atlas);
+    u32 white_data = 0xFFFFFFFF;
+    renderer->commands.white_texture = create_texture(renderer, &white_data, 1, 1, true);
+
+    if (renderer->framebuffer_memory) {
+        os_free(renderer->framebuffer_memory);
+    }
+    u32 width = (u32)settings.display_size.x;
+    u32 height = (u32)settings.display_size.y;
+    u32 blur_width = width / 4 ? width / 4 : 1;
+    u32 blur_height = height / 4 ? height / 4 : 1;
+    u32 sizes[SOFTWARE_FRAMEBUFFER_SENTINEL][2] = {
+        { width, height }, { width, height }, { blur_width, blur_height }, { blur_width, blur_height }
+    };
+
+    size_t memory_size = 0;
+    for (u32 framebuffer_idx = 0; framebuffer_idx < SOFTWARE_FRAMEBUFFER_SENTINEL; ++framebuffer_idx) {
+        SoftwareFramebuffer *framebuffer = renderer->framebuffers + framebuffer_idx;
+        framebuffer->width = sizes[framebuffer_idx][0];
+        framebuffer->height = sizes[framebuffer_idx][1];
+        framebuffer->stride = (framebuffer->width + 3) & ~3;
+        bool has_depth = framebuffer_idx == SOFTWARE_FRAMEBUFFER_MAIN || framebuffer_idx == SOFTWARE_FRAMEBUFFER_SEPARATED;
+        memory_size += (size_t)framebuffer->stride * framebuffer->height * (has_depth ? 8 : 4);
+    }
+    renderer->framebuffer_memory = os_alloc(memory_size);
+    u8 *cursor = (u8 *)renderer->framebuffer_memory;
+    for (u32 framebuffer_idx = 0; framebuffer_idx < SOFTWARE_FRAMEBUFFER_SENTINEL; ++framebuffer_idx) {
+        SoftwareFramebuffer *framebuffer = renderer->framebuffers + framebuffer_idx;
+        size_t plane_size = (size_t)framebuffer->stride * framebuffer->height * 4;
+        framebuffer->color = (u32 *)cursor;
+        cursor += plane_size;
+        framebuffer->depth = 0;
+        if (framebuffer_idx == SOFTWARE_FRAMEBUFFER_MAIN || framebuffer_idx == SOFTWARE_FRAMEBUFFER_SEPARATED) {
+            framebuffer->depth = (f32 *)cursor;
+            cursor += plane_size;
+        }
+        clear_framebuffer(framebuffer);
+    }
+
+    renderer->settings = settings;
+}
+
+RendererCommands *renderer_begin_frame(Renderer *renderer) {
+    RendererCommands *commands = &renderer->commands;
+    commands->command_memory_used = 0;
+    commands->vertex_count = 0;
+    commands->index_count = 0;
+    commands->sprite_count = 0;
+    commands->last_header = 0;
+    commands->last_setup = 0;
+    texture_atlas_begin_frame(&renderer->atlas);
+    return commands;
+}
+
+void renderer_end_frame(Renderer *renderer) {
+    TIMED_FUNCTION();
+    renderer->triangles_binned = 0;
+    renderer->tile_bin_entries = 0;
+    renderer->raster_pass_count = 0;
+    renderer->triangle_count = 0;
+    renderer->current_framebuffer = SOFTWARE_FRAMEBUFFER_MAIN;
+    clear_framebuffer(renderer->framebuffers + SOFTWARE_FRAMEBUFFER_MAIN);
+
+    RendererSetup *current_setup = 0;
+    u8 *cursor = renderer->commands.command_memory;
+    u8 *commands_bound = renderer->commands.command_memory + renderer->commands.command_memory_used;
+    u32 DEBUG_draw_call_count = 0;
+    u32 DEBUG_retained_draw_count = 0;
+    while (cursor < commands_bound) {
+        RendererCommandHeader *header = (RendererCommandHeader *)cursor;
+        cursor += sizeof(*header);
+        switch (header->type) {
+            case RENDERER_COMMAND_QUADS: {
+                RendererCommandQuads *quads = (RendererCommandQuads *)cursor;
+                cursor += sizeof(*quads);
+
+                assert(current_setup);
+                add_quads(renderer, current_setup, quads);
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_SPRITES: {
+                RendererCommandSprites *sprites = (RendererCommandSprites *)cursor;
+                cursor += sizeof(*sprites);
+
+                assert(current_setup);
+                add_sprites(renderer, current_setup, sprites);
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_RETAINED_GEOMETRY: {
+                RendererCommandRetainedGeometry *retained = (RendererCommandRetainedGeometry *)cursor;
+                cursor += sizeof(*retained);
+                u32 *ids = (u32 *)cursor;
+                cursor += retained->geometry_count * sizeof(u32);
+
+                assert(current_setup);
+                add_retained_geometry(renderer, current_setup, ids, retained->geometry_count);
+                DEBUG_retained_draw_count += retained->geometry_count;
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_BLUR: {
+                assert(renderer->current_framebuffer == SOFTWARE_FRAMEBUFFER_SEPARATED);
+                rasterize_collected_triangles(renderer);
+                blur_separated_framebuffer(renderer);
+                DEBUG_draw_call_count += 3;
+            } break;
+            case RENDERER_COMMAND_BEGIN_SEPARATED: {
+                rasterize_collected_triangles(renderer);
+                renderer->current_framebuffer = SOFTWARE_FRAMEBUFFER_SEPARATED;
+                clear_framebuffer(renderer->framebuffers + SOFTWARE_FRAMEBUFFER_SEPARATED);
+            } break;
+            case RENDERER_COMMAND_END_SEPARATED: {
+                rasterize_collected_triangles(renderer);
+                renderer->current_framebuffer = SOFTWARE_FRAMEBUFFER_MAIN;
+                blit_framebuffer(renderer, SOFTWARE_FRAMEBUFFER_SEPARATED, SOFTWARE_FRAMEBUFFER_MAIN);
+                ++DEBUG_draw_call_count;
+            } break;
+            case RENDERER_COMMAND_SET_SETUP: {
+                RendererSetup *setup = (RendererSetup *)cursor;
+                cursor += sizeof(*setup);
+
+                current_setup = setup;
+            } break;
+            case RENDERER_COMMAND_BEGIN_DEPTH_PEELING:
+            case RENDERER_COMMAND_END_DEPTH_PEELING: {
+                // Depth peeling is disabled in OpenGL renderer too
+            } break;
+            INVALID_DEFAULT_CASE;
+        }
+    }
+    rasterize_collected_triangles(renderer);
+    assert(renderer->current_framebuffer == SOFTWARE_FRAMEBUFFER_MAIN);
+
+    {DEBUG_VALUE_BLOCK("Renderer")
+        DEBUG_VALUE(renderer->atlas.layer_count, "Atlas layers");
+        DEBUG_VALUE(texture_atlas_get_occupancy(&renderer->atlas) * 100, "Atlas occupancy");
+        DEBUG_VALUE(renderer->atlas.eviction_count, "Atlas evictions");
+        DEBUG_VALUE((f32)renderer->commands.index_count / renderer->commands.max_index_count * 100, "Index buffer");
+        DEBUG_VALUE((f32)renderer->commands.vertex_count / renderer->commands.max_vertex_count * 100, "Vertex buffer");
+        DEBUG_VALUE((f32)renderer->commands.sprite_count / renderer->commands.max_sprite_count * 100, "Sprite buffer");
+        DEBUG_VALUE((u32)(renderer->commands.vertex_count * sizeof(Vertex)), "Vertex bytes");
+        DEBUG_VALUE((u32)(renderer->commands.sprite_count * sizeof(RendererSprite)), "Sprite bytes");
+        DEBUG_VALUE(renderer->commands.retained_geometry_count, "Retained geometry count");
+        DEBUG_VALUE(DEBUG_retained_draw_count, "Retained geometry drawn");
+        DEBUG_VALUE(DEBUG_draw_call_count, "Draw call count");
+        DEBUG_VALUE(renderer->triangles_binned, "Triangles binned");
+        DEBUG_VALUE(renderer->tile_bin_entries, "Tile bin entries");
+        DEBUG_VALUE(renderer->raster_pass_count, "Raster passes");
+    }
+}
+
+Texture renderer_create_texture_mipmaps(Renderer *renderer, void *data, u32 width, u32 height) {
+    return create_texture(renderer, data, width, height, false);
+}
+
+bool renderer_use_texture(Renderer *renderer, Texture texture) {
+    return texture_atlas_use(&renderer->atlas, texture);
+}
+
+RendererSettings *get_current_settings(Renderer *renderer) {
+    return &renderer->settings;
+}
+
+//
+// PNG output
+// Image data is not compressed - zlib stream is made of stored deflate blocks
+//
+
+static u8 *write_png_u32(u8 *dst, u32 value) {
+    dst[0] = (u8)(value >> 24);
+    dst[1] = (u8)(value >> 16);
+    dst[2] = (u8)(value >> 8);
+    dst[3] = (u8)value;
+    return dst + 4;
+}
+
+// Chunk data must be already written after 8 bytes of length and type
+static u8 *finish_png_chunk(u8 *chunk, const char *type, u32 data_size) {
+    write_png_u32(chunk, data_size);
+    memcpy(chunk + 4, type, 4);
+    u8 *end = chunk + 8 + data_size;
+    return write_png_u32(end, crc32(chunk + 4, data_size + 4));
+}
+
+bool renderer_write_png(Renderer *renderer, const char *filename) {
+    TIMED_FUNCTION();
+    SoftwareFramebuffer *framebuffer = renderer->framebuffers + SOFTWARE_FRAMEBUFFER_MAIN;
+#define PNG_MAX_STORED_BLOCK_SIZE 65535
+    size_t row_size = 1 + (size_t)framebuffer->width * 4;
+    size_t raw_size = row_size * framebuffer->height;
+    size_t block_count = (raw_size + PNG_MAX_STORED_BLOCK_SIZE - 1) / PNG_MAX_STORED_BLOCK_SIZE;
+    // zlib header, blocks with 5 byte headers and adler32
+    size_t idat_size = 2 + raw_size + block_count * 5 + 4;
+    size_t png_size = 8 + (12 + 13) + (12 + idat_size) + 12;
+
+    TempMemory png_temp = begin_temp_memory(&renderer->arena);
+    u8 *raw = (u8 *)alloc(&renderer->arena, raw_size, false);
+    // PNG rows go from top to bottom
+    for (u32 y = 0; y < framebuffer->height; ++y) {
+        u8 *row = raw + row_size * y;
+        row[0] = 0;
+        memcpy(row + 1, framebuffer->color + (size_t)(framebuffer->height - 1 - y) * framebuffer->stride,
+               (size_t)framebuffer->width * 4);
+    }
+
+    u8 *png = (u8 *)alloc(&renderer->arena, png_size, false);
+    u8 *cursor = png;
+    const u8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    memcpy(cursor, signature, sizeof(signature));
+    cursor += sizeof(signature);
+
+    u8 *ihdr = cursor;
+    u8 *data = write_png_u32(ihdr + 8, framebuffer->width);
+    data = write_png_u32(data, framebuffer->height);
+    // 8 bit RGBA, default compression and filtering, no interlace
+    data[0] = 8;
+    data[1] = 6;
+    data[2] = 0;
+    data[3] = 0;
+    data[4] = 0;
+    cursor = finish_png_chunk(ihdr, "IHDR", 13);
+
+    u8 *idat = cursor;
+    data = idat + 8;
+    *data++ = 0x78;
+    *data++ = 0x01;
+    u32 adler_a = 1;
+    u32 adler_b = 0;
+    for (size_t offset = 0; offset < raw_size; offset += PNG_MAX_STORED_BLOCK_SIZE) {
+        u32 block_size = (u32)(raw_size - offset < PNG_MAX_STORED_BLOCK_SIZE ? raw_size - offset : PNG_MAX_STORED_BLOCK_SIZE);
+        *data++ = offset + block_size == raw_size ? 1 : 0;
+        *data++ = (u8)block_size;
+        *data++ = (u8)(block_size >> 8);
+        *data++ = (u8)~block_size;
+        *data++ = (u8)(~block_size >> 8);
+        memcpy(data, raw + offset, block_size);
+        data += block_size;
+        for (u32 byte_idx = 0; byte_idx < block_size; ++byte_idx) {
+            adler_a = (adler_a + raw[offset + byte_idx]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+    data = write_png_u32(data, (adler_b << 16) | adler_a);
+    assert((size_t)(data - (idat + 8)) == idat_size);
+    cursor = finish_png_chunk(idat, "IDAT", (u32)idat_size);
+    cursor = finish_png_chunk(cursor, "IEND", 0);
+    assert((size_t)(cursor - png) == png_size);
+
+    FileHandle file = open_file(filename, false);
+    bool result = file_handle_valid(file);
+    if (result) {
+        write_file(file, 0, png_size, png);
+        close_file(file);
+    }
+    end_temp_memory(png_temp);
+    return result;
+}
@@ -0,0 +1,31 @@
+//
+// Software renderer
+// CPU backend for renderer.hh interface - executes the same command stream as OpenGL renderer,
+// so frames can be rendered and measured on machines without GPU
+//
+// Triangles are transformed and clipped as quad commands are read, and are collected until framebuffer changes
+// or triangle storage is full. Then they are binned into screen tiles, and tiles are rasterized in parallel
+// on work queue - each tile is owned by single job, so triangles are drawn in command order without locks
+// Pixels are rasterized 4 at a time with edge functions and attributes stored as screen space planes
+//
+// Textures are sampled from top mip level with nearest filter, depth peeling is ignored like in OpenGL renderer
+// Framebuffers store rows from bottom to top like OpenGL does, and are flipped when written to file
+// Vertex data is read from command arrays directly, so persistent_buffers setting has no effect
+//
+#if !defined(RENDERER_SOFTWARE_HH)
+
+#include "renderer.hh"
+#include "os.hh"
+
+#define SOFTWARE_RENDERER_TILE_SIZE 64
+// Triangles collected before they are rasterized
+#define SOFTWARE_RENDERER_MAX_TRIANGLE_COUNT (1 << 16)
+#define SOFTWARE_RENDERER_MAX_JOB_COUNT 16
+
+// Without work queue tiles are rasterized on calling thread
+void renderer_set_work_queue(Renderer *renderer, WorkQueue *queue);
+// Writes main framebuffer of last frame as RGBA PNG, returns false if file could not be opened
+bool renderer_write_png(Renderer *renderer, const char *filename);
+
+#define RENDERER_SOFTWARE_HH 1
+#endif
@@ -0,0 +1,214 @@
+#include "scheduler.hh"
+
+void init_entity_scheduler(EntityScheduler *scheduler, MemoryArena *arena) {
+    scheduler->arena = arena;
+    // Wake tick 0 means that there is no timer
+    scheduler->current_tick = 1;
+    for (u32 level = 0; level < SCHEDULER_WHEEL_LEVEL_COUNT; ++level) {
+        for (u32 slot = 0; slot < SCHEDULER_WHEEL_SLOT_COUNT; ++slot) {
+            CDLIST_INIT(&scheduler->wheel[level][slot]);
+        }
+    }
+    CDLIST_INIT(&scheduler->overflow_list);
+    for (u32 event = 0; event < SCHEDULER_EVENT_SENTINEL; ++event) {
+        CDLIST_INIT(&scheduler->event_lists[event]);
+    }
+    CDLIST_INIT(&scheduler->woken_chunk_list);
+}
+
+u64 get_scheduler_ticks(f32 seconds) {
+    u64 result = (u64)(seconds * SCHEDULER_TICKS_PER_SECOND + 0.5f);
+    return result;
+}
+
+static ScheduledChunk **get_woken_chunk_internal(EntityScheduler *scheduler, i32 chunk_x, i32 chunk_y) {
+    u32 hash_value = 123 * (u32)chunk_x + 456 * (u32)chunk_y + 789;
+    CT_ASSERT(IS_POW2(ARRAY_SIZE(scheduler->woken_chunk_hash)));
+    u32 hash_slot = hash_value & (ARRAY_SIZE(scheduler->woken_chunk_hash) - 1);
+
+    ScheduledChunk **chunk = &scheduler->woken_chunk_hash[hash_slot];
+    while (*chunk && !(chunk_x == (*chunk)->chunk_x && chunk_y == (*chunk)->chunk_y)) {
+        chunk = &(*chunk)->next;
+    }
+    return chunk;
+}
+
+static ScheduledChunk *get_or_create_woken_chunk(EntityScheduler *scheduler, i32 chunk_x, i32 chunk_y) {
+    ScheduledChunk **chunk_ptr = get_woken_chunk_internal(scheduler, chunk_x, chunk_y);
+    ScheduledChunk *result = *chunk_ptr;
+    if (!result) {
+        result = scheduler->first_free_chunk;
+        if (!result) {
+            result = alloc_struct(scheduler->arena, ScheduledChunk);
+        } else {
+            LLIST_POP(scheduler->first_free_chunk);
+        }
+        result->chunk_x = chunk_x;
+        result->chunk_y = chunk_y;
+        CDLIST_INIT(&result->woken_list);
+        LLIST_ADD(*chunk_ptr, result);
+        result->list_entry.chunk = result;
+        CSLIST_ADD_LAST(&scheduler->woken_chunk_list, &result->list_entry);
+        ++scheduler->woken_chunk_count;
+    }
+    return result;
+}
+
+static void wake_scheduled_entity(EntityScheduler *scheduler, ScheduledEntity *node) {
+    if (node->wake_tick) {
+        CDLIST_REMOVE(&node->timer_entry);
+        --scheduler->timer_count;
+    }
+    for (u32 event = 0; event < SCHEDULER_EVENT_SENTINEL; ++event) {
+        if (node->wake_events & SCHEDULER_EVENT_BIT(event)) {
+            CDLIST_REMOVE(&node->event_entries[event]);
+        }
+    }
+    // Entities are woken in order of their timers and events, so sims see them in deterministic order
+    ScheduledChunk *chunk = get_or_create_woken_chunk(scheduler, node->chunk_x, node->chunk_y);
+    CSLIST_ADD_LAST(&chunk->woken_list, &node->timer_entry);
+    --scheduler->sleeping_count;
+    ++scheduler->woken_count;
+}
+
+// Puts timer at the level of highest tick digit that differs from current tick
+static void place_timer(EntityScheduler *scheduler, ScheduledEntity *node) {
+    u64 tick = node->wake_tick;
+    if (tick < scheduler->current_tick) {
+        wake_scheduled_entity(scheduler, node);
+    } else {
+        u64 differing_bits = tick ^ scheduler->current_tick;
+        u32 level = 0;
+        while (level < SCHEDULER_WHEEL_LEVEL_COUNT && (differing_bits >> (SCHEDULER_WHEEL_SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+
+        ScheduledEntityListEntry *list = &scheduler->overflow_list;
+        if (level < SCHEDULER_WHEEL_LEVEL_COUNT) {
+            u32 slot = (tick >> (SCHEDULER_WHEEL_SLOT_BITS * level)) & SCHEDULER_WHEEL_SLOT_MASK;
+            list = &scheduler->wheel[level][slot];
+        }
+        CSLIST_ADD_LAST(list, &node->timer_entry);
+    }
+}
+
+// Places all timers of list again relative to current tick
+// List is detached first, because timers may be put back in it
+static void replace_timers(EntityScheduler *scheduler, ScheduledEntityListEntry *list) {
+    ScheduledEntityListEntry *entry = list->next;
+    list->prev->next = 0;
+    CDLIST_INIT(list);
+    while (entry != list && entry) {
+        ScheduledEntityListEntry *next = entry->next;
+        // Entry is unlinked from detached chain, so removing it from list later does not touch other entries
+        CDLIST_INIT(entry);
+        place_timer(scheduler, entry->node);
+        entry = next;
+    }
+}
+
+static void process_scheduler_tick(EntityScheduler *scheduler) {
+    u64 tick = scheduler->current_tick;
+    // When lower digits of tick wrap, timers from slot of next higher digit are moved down
+    // This is done from highest level, so timers can cascade several levels in single tick
+    u64 wheel_span_mask = ((u64)1 << (SCHEDULER_WHEEL_SLOT_BITS * SCHEDULER_WHEEL_LEVEL_COUNT)) - 1;
+    if (!(tick & wheel_span_mask)) {
+        replace_timers(scheduler, &scheduler->overflow_list);
+    }
+    for (u32 level = SCHEDULER_WHEEL_LEVEL_COUNT - 1; level > 0; --level) {
+        u64 lower_digits_mask = ((u64)1 << (SCHEDULER_WHEEL_SLOT_BITS * level)) - 1;
+        if (!(tick & lower_digits_mask)) {
+            u32 slot = (tick >> (SCHEDULER_WHEEL_SLOT_BITS * level)) & SCHEDULER_WHEEL_SLOT_MASK;
+            replace_timers(scheduler, &scheduler->wheel[level][slot]);
+        }
+    }
+
+    ScheduledEntityListEntry *fired = &scheduler->wheel[0][tick & SCHEDULER_WHEEL_SLOT_MASK];
+    while (fired->next != fired) {
+        ScheduledEntity *node = fired->next->node;
+        assert(node->wake_tick == tick);
+        wake_scheduled_entity(scheduler, node);
+    }
+    ++scheduler->current_tick;
+}
+
+void advance_entity_scheduler(EntityScheduler *scheduler, f32 dt) {
+    TIMED_FUNCTION();
+    scheduler->tick_accumulator += dt * SCHEDULER_TICKS_PER_SECOND;
+    while (scheduler->tick_accumulator >= 1.0f) {
+        scheduler->tick_accumulator -= 1.0f;
+        process_scheduler_tick(scheduler);
+    }
+}
+
+void sleep_entity(EntityScheduler *scheduler, Entity *entity, i32 chunk_x, i32 chunk_y, 
+                  u64 wake_tick, u32 wake_events, EntityID target) {
+    assert(!(entity->flags & ENTITY_FLAG_IS_SLEEPING));
+    // Entity that waits for nothing would never wake up
+    assert(wake_tick || wake_events);
+    ScheduledEntity *node = scheduler->first_free;
+    if (!node) {
+        ++scheduler->nodes_allocated;
+        node = alloc_struct(scheduler->arena, ScheduledEntity);
+    } else {
+        LLIST_POP(scheduler->first_free);
+    }
+    node->id = entity->id;
+    node->wake_tick = wake_tick;
+    node->wake_events = wake_events;
+    node->target = target;
+    node->chunk_x = chunk_x;
+    node->chunk_y = chunk_y;
+    entity->flags |= ENTITY_FLAG_IS_SLEEPING;
+    ++scheduler->sleeping_count;
+
+    for (u32 event = 0; event < SCHEDULER_EVENT_SENTINEL; ++event) {
+        if (wake_events & SCHEDULER_EVENT_BIT(event)) {
+            ScheduledEntityListEntry *entry = &node->event_entries[event];
+            entry->node = node;
+            CSLIST_ADD_LAST(&scheduler->event_lists[event], entry);
+        }
+    }
+    node->timer_entry.node = node;
+    CDLIST_INIT(&node->timer_entry);
+    if (wake_tick) {
+        ++scheduler->timer_count;
+        place_timer(scheduler, node);
+    }
+}
+
+void signal_scheduler_event(EntityScheduler *scheduler, u32 event, EntityID target) {
+    assert(event < SCHEDULER_EVENT_SENTINEL);
+    ScheduledEntityListEntry *list = &scheduler->event_lists[event];
+    for (ScheduledEntityListEntry *entry = list->next, *next; entry != list; entry = next) {
+        next = entry->next;
+        ScheduledEntity *node = entry->node;
+        if (IS_NULL(target) || node->target.value == target.value) {
+            wake_scheduled_entity(scheduler, node);
+        }
+    }
+}
+
+ScheduledEntityListEntry *get_woken_list(EntityScheduler *scheduler, i32 chunk_x, i32 chunk_y) {
+    ScheduledEntityListEntry *result = 0;
+    ScheduledChunk *chunk = *get_woken_chunk_internal(scheduler, chunk_x, chunk_y);
+    if (chunk) {
+        result = &chunk->woken_list;
+    }
+    return result;
+}
+
+void release_woken_entity(EntityScheduler *scheduler, ScheduledEntity *node) {
+    CDLIST_REMOVE(&node->timer_entry);
+    --scheduler->woken_count;
+    LLIST_ADD(scheduler->first_free, node);
+    ScheduledChunk **chunk_ptr = get_woken_chunk_internal(scheduler, node->chunk_x, node->chunk_y);
+    ScheduledChunk *chunk = *chunk_ptr;
+    assert(chunk);
+    if (chunk->woken_list.next == &chunk->woken_list) {
+        *chunk_ptr = chunk->next;
+        CDLIST_REMOVE(&chunk->list_entry);
+        LLIST_ADD(scheduler->first_free_chunk, chunk);
+        --scheduler->woken_chunk_count;
+    }
+}
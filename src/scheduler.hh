@@ -0,0 +1,130 @@
+//
+// Entity scheduler decides which entities need to be updated
+// Most of entities spend most of the time waiting - for interaction to end, for new order or
+// for player to move away. Instead of checking this every frame, entity is put to sleep and
+// scheduler wakes it up when its timer fires or event it waits for happens
+//
+// Timers are stored in hierarchical timer wheel - each level has SCHEDULER_WHEEL_SLOT_COUNT slots
+// and each slot at level n spans SCHEDULER_WHEEL_SLOT_COUNT^n ticks. Timer is placed at the level of
+// the highest tick digit that differs from current tick, and is moved to lower level when current tick
+// reaches its slot. So adding, removing and firing timer is O(1), and each tick only touches timers
+// that fire in it
+//
+// Woken entities are collected in woken lists of chunks they sleep in, and are consumed by sim regions
+// on next update. Each sim region takes only lists of its own chunks, so entity that is not in any
+// sim region stays in woken list until its chunk gets into one, and meanwhile other sims only check its chunk
+//
+#if !defined(SCHEDULER_HH)
+
+#include "lib.hh"
+#include "entity.hh"
+
+// Game time is measured in ticks, so timers don't depend on frame rate
+#define SCHEDULER_TICKS_PER_SECOND 64
+#define SCHEDULER_WHEEL_SLOT_BITS 6
+#define SCHEDULER_WHEEL_SLOT_COUNT (1 << SCHEDULER_WHEEL_SLOT_BITS)
+#define SCHEDULER_WHEEL_SLOT_MASK (SCHEDULER_WHEEL_SLOT_COUNT - 1)
+// 4 levels span 2^24 ticks - around 3 days of game time. Timers that are further away
+// are kept in overflow list which is checked when highest level wraps
+#define SCHEDULER_WHEEL_LEVEL_COUNT 4
+// Hash of chunks that have woken entities, with external collision resolving like world chunk hash
+#define SCHEDULER_CHUNK_HASH_SIZE 256
+
+enum {
+    SCHEDULER_EVENT_ORDER_ADDED,
+    SCHEDULER_EVENT_TARGET_DELETED,
+    SCHEDULER_EVENT_PLAYER_MOVED,
+    SCHEDULER_EVENT_CONSTRUCTION_FINISHED,
+    // Items that can be hauled or stockpile space to haul them to have appeared
+    SCHEDULER_EVENT_HAUL_AVAILABLE,
+    SCHEDULER_EVENT_SENTINEL,
+};
+
+#define SCHEDULER_EVENT_BIT(_event) (1 << (_event))
+
+struct ScheduledEntity;
+struct ScheduledEntityListEntry {
+    ScheduledEntity *node;
+    ScheduledEntityListEntry *next;
+    ScheduledEntityListEntry *prev;
+};
+
+// Sleeping entity. It can be both in timer wheel and in lists of events it waits for,
+// so it has separate list entry for each of them
+struct ScheduledEntity {
+    EntityID id;
+    // 0 if entity waits only for events
+    u64 wake_tick;
+    u32 wake_events;
+    // Chunk entity sleeps in, entities don't move while sleeping
+    i32 chunk_x;
+    i32 chunk_y;
+    // For events that are related to some entity
+    EntityID target;
+
+    ScheduledEntityListEntry timer_entry;
+    ScheduledEntityListEntry event_entries[SCHEDULER_EVENT_SENTINEL];
+    // Needed for free list
+    ScheduledEntity *next;
+};
+
+struct ScheduledChunk;
+struct ScheduledChunkListEntry {
+    ScheduledChunk *chunk;
+    ScheduledChunkListEntry *next;
+    ScheduledChunkListEntry *prev;
+};
+
+// Woken entities of single chunk, in order they were woken
+// Removed from hash and chunk list when its last entity is released
+struct ScheduledChunk {
+    i32 chunk_x;
+    i32 chunk_y;
+    ScheduledEntityListEntry woken_list;
+    ScheduledChunkListEntry list_entry;
+
+    ScheduledChunk *next;
+};
+
+struct EntityScheduler {
+    MemoryArena *arena;
+    // Next tick to be processed - all timers with smaller wake tick have fired
+    u64 current_tick;
+    f32 tick_accumulator;
+
+    ScheduledEntityListEntry wheel[SCHEDULER_WHEEL_LEVEL_COUNT][SCHEDULER_WHEEL_SLOT_COUNT];
+    ScheduledEntityListEntry overflow_list;
+    ScheduledEntityListEntry event_lists[SCHEDULER_EVENT_SENTINEL];
+    // Woken entities use timer entry for woken list of their chunk, since they are no longer in wheel
+    ScheduledChunk *woken_chunk_hash[SCHEDULER_CHUNK_HASH_SIZE];
+    // All chunks that have woken entities, in order they got first of them
+    ScheduledChunkListEntry woken_chunk_list;
+    ScheduledChunk *first_free_chunk;
+
+    u32 sleeping_count;
+    u32 woken_count;
+    u32 woken_chunk_count;
+    u32 timer_count;
+    u32 nodes_allocated;
+    ScheduledEntity *first_free;
+};
+
+void init_entity_scheduler(EntityScheduler *scheduler, MemoryArena *arena);
+u64 get_scheduler_ticks(f32 seconds);
+// Moves scheduler time forward by dt, entities with fired timers are moved to woken list
+void advance_entity_scheduler(EntityScheduler *scheduler, f32 dt);
+// Puts entity to sleep until wake_tick (if it is not 0) or until any of wake_events happens
+// Sleeping entities are not added to sim region pawn arrays, so they are not updated at all
+// chunk_x and chunk_y are global coordinates of chunk entity is in
+void sleep_entity(EntityScheduler *scheduler, Entity *entity, i32 chunk_x, i32 chunk_y, 
+                  u64 wake_tick, u32 wake_events, EntityID target = {});
+// Wakes all entities waiting for event. If target is not null, only entities that wait on given target are woken
+void signal_scheduler_event(EntityScheduler *scheduler, u32 event, EntityID target = {});
+// Woken list of chunk, 0 if nothing has woken up in it
+ScheduledEntityListEntry *get_woken_list(EntityScheduler *scheduler, i32 chunk_x, i32 chunk_y);
+// Removes entity from woken list - called when sim region has woken up entity
+// List of chunk is given back to scheduler when it becomes empty, but it can still be compared against
+void release_woken_entity(EntityScheduler *scheduler, ScheduledEntity *node);
+
+#define SCHEDULER_HH 1
+#endif
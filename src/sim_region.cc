@@ -157,6 +157,8 @@ bool remove_entity_from_chunk(SimRegion *sim, SimRegionChunk *chunk, EntityID id
                         LLIST_ADD(sim->first_free_entity_block, free_block);
                     }
                 }
+                not_found = false;
+                break;
             }
         }        
     }
@@ -227,11 +229,20 @@ Entity *create_new_entity(SimRegion *sim, vec2 p, Entity *src) {
         if (src) {
             *entity = *src;
         } else {
+            // Entity memory comes from frame arena and may be left from previous frames
+            *entity = {};
             EntityID id = get_new_id(sim->world);
             entity->id = id;
         }
         
         entity->p = p;
+        // Sleeping pawns are not updated, so they are added only when scheduler wakes them
+        if (src && entity->kind == ENTITY_KIND_PAWN && !(entity->flags & ENTITY_FLAG_IS_SLEEPING)) {
+            add_sim_pawn(sim, entity);
+        }
+        if (src && (entity->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION)) {
+            add_sim_construction_site(sim, entity);
+        }
         // Attempt to add to chunk
         i32 chunk_x, chunk_y; 
         p_to_chunk_coord(p, &chunk_x, &chunk_y);
@@ -239,6 +250,14 @@ Entity *create_new_entity(SimRegion *sim, vec2 p, Entity *src) {
         if (chunk) {
             add_entity_to_chunk(sim, chunk, entity->id);  
         }
+        if (src && is_logistics_entity(entity)) {
+            add_sim_logistics_entity(sim, entity);
+        }
+        // Reservations of haulers are applied when all entities are loaded
+        if (src && entity->kind == ENTITY_KIND_PAWN && entity->carry_amount) {
+            SimRegionLogistics *logistics = &sim->logistics;
+            logistics->hauler_indices[logistics->hauler_count++] = (u32)(entity - sim->entities);
+        }
         // Add to hash
         SimRegionEntityHash *hash = get_entity_hash(sim, entity->id);
         if (hash) {
@@ -250,8 +269,78 @@ Entity *create_new_entity(SimRegion *sim, vec2 p, Entity *src) {
     return result;
 }
 
+static u32 get_influence_layer(Entity *entity) {
+    u32 result = INFLUENCE_LAYER_SENTINEL;
+    if (entity->kind == ENTITY_KIND_PAWN) {
+        result = INFLUENCE_LAYER_PAWNS;
+    } else if (entity->kind == ENTITY_KIND_WORLD_OBJECT) {
+        switch (entity->world_object_kind) {
+            case WORLD_OBJECT_KIND_TREE_FOREST:
+            case WORLD_OBJECT_KIND_TREE_DESERT:
+            case WORLD_OBJECT_KIND_TREE_JUNGLE: {
+                result = INFLUENCE_LAYER_WOOD;
+            } break;
+            case WORLD_OBJECT_KIND_GOLD_DEPOSIT: {
+                result = INFLUENCE_LAYER_GOLD;
+            } break;
+            case WORLD_OBJECT_KIND_BUILDING1:
+            case WORLD_OBJECT_KIND_BUILDING2: {
+                result = INFLUENCE_LAYER_BUILDINGS;
+            } break;
+        }
+    }
+    return result;
+}
+
+// Returns 0 if p is outside of sim chunks
+static SimRegionChunk *get_influence_cell(SimRegion *sim, vec2 p, u32 *cell_idx_dst) {
+    i32 chunk_x, chunk_y;
+    vec2 chunk_p;
+    p_to_chunk_coord(p, &chunk_x, &chunk_y, &chunk_p);
+    SimRegionChunk *chunk = get_chunk(sim, chunk_x, chunk_y);
+    if (chunk) {
+        // Chunk position can be equal to chunk size because of rounding
+        i32 cell_x = Floor_i32(chunk_p.x / INFLUENCE_CELL_SIZE);
+        i32 cell_y = Floor_i32(chunk_p.y / INFLUENCE_CELL_SIZE);
+        cell_x = cell_x < 0 ? 0 : cell_x >= INFLUENCE_CELLS_IN_CHUNK ? INFLUENCE_CELLS_IN_CHUNK - 1 : cell_x;
+        cell_y = cell_y < 0 ? 0 : cell_y >= INFLUENCE_CELLS_IN_CHUNK ? INFLUENCE_CELLS_IN_CHUNK - 1 : cell_y;
+        *cell_idx_dst = (u32)(cell_y * INFLUENCE_CELLS_IN_CHUNK + cell_x);
+    }
+    return chunk;
+}
+
+static void change_entity_influence(SimRegion *sim, Entity *entity, vec2 p, f32 value) {
+    u32 layer = get_influence_layer(entity);
+    u32 cell_idx;
+    SimRegionChunk *chunk = get_influence_cell(sim, p, &cell_idx);
+    if (layer != INFLUENCE_LAYER_SENTINEL && chunk) {
+        chunk->influence.raw[layer][cell_idx] += value;
+        if (!(chunk->influence_flags & SIM_INFLUENCE_RAW_CHANGED)) {
+            chunk->influence_flags |= SIM_INFLUENCE_RAW_CHANGED;
+            sim->influence_changed_chunks[sim->influence_changed_count++] = (u32)(chunk - sim->chunks);
+        }
+    }
+}
+
+void add_sim_entity_influence(SimRegion *sim, Entity *entity) {
+    change_entity_influence(sim, entity, entity->p, 1.0f);
+}
+
+void delete_sim_entity(SimRegion *sim, Entity *entity) {
+    assert(!(entity->flags & ENTITY_FLAG_IS_DELETED));
+    change_entity_influence(sim, entity, entity->p, -1.0f);
+    entity->flags |= ENTITY_FLAG_IS_DELETED;
+}
+
 void change_entity_position(SimRegion *sim, Entity *entity, vec2 p) {
     TIMED_FUNCTION();
+    u32 old_cell_idx, new_cell_idx;
+    SimRegionChunk *old_cell_chunk = get_influence_cell(sim, entity->p, &old_cell_idx);
+    SimRegionChunk *new_cell_chunk = get_influence_cell(sim, p, &new_cell_idx);
+    if (old_cell_chunk != new_cell_chunk || (new_cell_chunk && old_cell_idx != new_cell_idx)) {
+        change_entity_influence(sim, entity, entity->p, -1.0f);
+        change_entity_influence(sim, entity, p, 1.0f);
+    }
     i32 old_chunk_x, old_chunk_y;
     p_to_chunk_coord(entity->p, &old_chunk_x, &old_chunk_y);
     i32 new_chunk_x, new_chunk_y;
@@ -270,6 +359,907 @@ void change_entity_position(SimRegion *sim, Entity *entity, vec2 p) {
     entity->p = p;
 }
 
+void add_sim_pawn(SimRegion *sim, Entity *entity) {
+    assert(entity->kind == ENTITY_KIND_PAWN);
+    SimRegionPawns *pawns = &sim->pawns;
+    assert(pawns->count < pawns->max_count);
+    u32 pawn_idx = pawns->count++;
+    pawns->entity_indices[pawn_idx] = (u32)(entity - sim->entities);
+    pawns->p_x[pawn_idx] = entity->p.x;
+    pawns->p_y[pawn_idx] = entity->p.y;
+    pawns->target_x[pawn_idx] = entity->p.x;
+    pawns->target_y[pawn_idx] = entity->p.y;
+    pawns->stop_distance_sq[pawn_idx] = F32_INFINITY;
+    pawns->avoidance_free_steps[pawn_idx] = entity->avoidance_free_steps;
+}
+
+// Points outside of grid are in border cells
+static i32 get_grid_cell(f32 coord, f32 grid_min, f32 inv_cell_size, u32 cell_count) {
+    i32 cell = Floor_i32((coord - grid_min) * inv_cell_size);
+    cell = cell < 0 ? 0 : cell;
+    cell = cell < (i32)cell_count ? cell : (i32)cell_count - 1;
+    return cell;
+}
+
+void build_sim_region_grid(SimRegionGrid *grid, MemoryArena *arena, const f32 *p_x, const f32 *p_y, u32 count, f32 cell_size) {
+    TIMED_FUNCTION();
+    f32 min_x = F32_INFINITY;
+    f32 min_y = F32_INFINITY;
+    f32 max_x = -F32_INFINITY;
+    f32 max_y = -F32_INFINITY;
+    for (u32 point_idx = 0; point_idx < count; ++point_idx) {
+        min_x = Min(min_x, p_x[point_idx]);
+        min_y = Min(min_y, p_y[point_idx]);
+        max_x = Max(max_x, p_x[point_idx]);
+        max_y = Max(max_y, p_y[point_idx]);
+    }
+    if (!count) {
+        min_x = min_y = max_x = max_y = 0;
+    }
+    u32 max_cell_count = count * 2 + 16;
+    u32 cells_x, cells_y;
+    for (;;) {
+        cells_x = (u32)((max_x - min_x) / cell_size) + 1;
+        cells_y = (u32)((max_y - min_y) / cell_size) + 1;
+        if ((u64)cells_x * cells_y <= max_cell_count) {
+            break;
+        }
+        cell_size *= 2.0f;
+    }
+    u32 cell_count = cells_x * cells_y;
+    grid->min_x = min_x;
+    grid->min_y = min_y;
+    grid->cell_size = cell_size;
+    grid->inv_cell_size = 1.0f / cell_size;
+    grid->cells_x = cells_x;
+    grid->cells_y = cells_y;
+    grid->point_count = count;
+    grid->cell_starts = alloc_arr(arena, (cell_count + 1), u32);
+    grid->indices = alloc_arr(arena, count, u32, false);
+    grid->p_x = alloc_arr(arena, count, f32, false);
+    grid->p_y = alloc_arr(arena, count, f32, false);
+    u32 *point_cells = alloc_arr(arena, count, u32, false);
+    
+    for (u32 point_idx = 0; point_idx < count; ++point_idx) {
+        u32 cell_x = (u32)((p_x[point_idx] - min_x) * grid->inv_cell_size);
+        u32 cell_y = (u32)((p_y[point_idx] - min_y) * grid->inv_cell_size);
+        // Floating point error can put points on max border to next cell
+        cell_x = cell_x < cells_x ? cell_x : cells_x - 1;
+        cell_y = cell_y < cells_y ? cell_y : cells_y - 1;
+        u32 cell = cell_y * cells_x + cell_x;
+        point_cells[point_idx] = cell;
+        ++grid->cell_starts[cell];
+    }
+    // After prefix sum each cell start holds end of cell, and points are scattered backwards 
+    // decrementing it - so it becomes start of cell and points keep their order inside cell
+    u32 sum = 0;
+    for (u32 cell = 0; cell <= cell_count; ++cell) {
+        sum += grid->cell_starts[cell];
+        grid->cell_starts[cell] = sum;
+    }
+    for (u32 point_idx = count; point_idx-- > 0;) {
+        u32 sorted_idx = --grid->cell_starts[point_cells[point_idx]];
+        grid->indices[sorted_idx] = point_idx;
+        grid->p_x[sorted_idx] = p_x[point_idx];
+        grid->p_y[sorted_idx] = p_y[point_idx];
+    }
+}
+
+// Half-plane of velocities, allowed velocities are on the left of direction
+struct OrcaLine {
+    vec2 p;
+    vec2 direction;
+};
+
+inline f32 det(vec2 a, vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+#define ORCA_EPSILON 0.00001f
+
+// Finds velocity on line line_idx that satisfies all previous lines and is closest to optimal
+// If direction_opt is set, optimal is direction and velocity that goes furthest in it is found 
+static bool orca_solve_line(OrcaLine *lines, u32 line_idx, f32 max_speed, vec2 optimal, bool direction_opt, vec2 *result) {
+    OrcaLine *line = lines + line_idx;
+    f32 dot_product = dot(line->p, line->direction);
+    f32 discriminant = SQ(dot_product) + SQ(max_speed) - length_sq(line->p);
+    if (discriminant < 0.0f) {
+        // Max speed circle does not intersect line
+        return false;
+    }
+    f32 sqrt_discriminant = Sqrt(discriminant);
+    f32 t_left = -dot_product - sqrt_discriminant;
+    f32 t_right = -dot_product + sqrt_discriminant;
+    for (u32 other_idx = 0; other_idx < line_idx; ++other_idx) {
+        OrcaLine *other = lines + other_idx;
+        f32 denominator = det(line->direction, other->direction);
+        f32 numerator = det(other->direction, line->p - other->p);
+        if (Abs(denominator) <= ORCA_EPSILON) {
+            // Lines are parallel
+            if (numerator < 0.0f) {
+                return false;
+            }
+            continue;
+        }
+        f32 t = numerator / denominator;
+        if (denominator >= 0.0f) {
+            t_right = Min(t_right, t);
+        } else {
+            t_left = Max(t_left, t);
+        }
+        if (t_left > t_right) {
+            return false;
+        }
+    }
+    
+    f32 t;
+    if (direction_opt) {
+        t = dot(optimal, line->direction) > 0.0f ? t_right : t_left;
+    } else {
+        t = Clamp(dot(line->direction, optimal - line->p), t_left, t_right);
+    }
+    *result = line->p + line->direction * t;
+    return true;
+}
+
+// Returns index of line that could not be satisfied, or line count if all are satisfied
+static u32 orca_solve(OrcaLine *lines, u32 line_count, f32 max_speed, vec2 optimal, bool direction_opt, vec2 *result) {
+    if (direction_opt) {
+        *result = optimal * max_speed;
+    } else if (length_sq(optimal) > SQ(max_speed)) {
+        *result = normalize(optimal) * max_speed;
+    } else {
+        *result = optimal;
+    }
+    for (u32 line_idx = 0; line_idx < line_count; ++line_idx) {
+        if (det(lines[line_idx].direction, lines[line_idx].p - *result) > 0.0f) {
+            vec2 previous_result = *result;
+            if (!orca_solve_line(lines, line_idx, max_speed, optimal, direction_opt, result)) {
+                *result = previous_result;
+                return line_idx;
+            }
+        }
+    }
+    return line_count;
+}
+
+// Crowd is too dense to satisfy all lines - find velocity that violates them the least
+static void orca_solve_dense(OrcaLine *lines, u32 line_count, u32 first_failed_line, f32 max_speed, vec2 *result) {
+    f32 distance = 0.0f;
+    for (u32 line_idx = first_failed_line; line_idx < line_count; ++line_idx) {
+        OrcaLine *line = lines + line_idx;
+        if (det(line->direction, line->p - *result) > distance) {
+            OrcaLine projected_lines[SIM_PAWN_MAX_NEIGHBOURS];
+            u32 projected_line_count = 0;
+            for (u32 other_idx = 0; other_idx < line_idx; ++other_idx) {
+                OrcaLine *other = lines + other_idx;
+                OrcaLine projected;
+                f32 determinant = det(line->direction, other->direction);
+                if (Abs(determinant) <= ORCA_EPSILON) {
+                    if (dot(line->direction, other->direction) > 0.0f) {
+                        // Lines point in same direction
+                        continue;
+                    }
+                    projected.p = (line->p + other->p) * 0.5f;
+                } else {
+                    projected.p = line->p + line->direction * (det(other->direction, line->p - other->p) / determinant);
+                }
+                projected.direction = normalize(other->direction - line->direction);
+                projected_lines[projected_line_count++] = projected;
+            }
+            vec2 previous_result = *result;
+            if (orca_solve(projected_lines, projected_line_count, max_speed, Vec2(-line->direction.y, line->direction.x), 
+                           true, result) < projected_line_count) {
+                // This can only happen because of floating point error, result is already optimal
+                *result = previous_result;
+            }
+            distance = det(line->direction, line->p - *result);
+        }
+    }
+}
+
+// Closest neighbours of pawn sorted by distance and push from pawns it overlaps
+// Pawns are identified by their index in pawn grid
+struct PawnNeighbours {
+    u32 count;
+    u32 indices[SIM_PAWN_MAX_NEIGHBOURS];
+    f32 distances_sq[SIM_PAWN_MAX_NEIGHBOURS];
+    u32 scanned_count;
+    // All scanned points that are in range, so closest neighbours are picked without scanning again
+    u32 in_range_count;
+    u32 in_range_indices[SIM_PAWN_MAX_SCANNED_NEIGHBOURS];
+    f32 in_range_distances_sq[SIM_PAWN_MAX_SCANNED_NEIGHBOURS];
+    bool is_overlapping;
+    // Some neighbour would collide with pawn within time horizon if both kept their velocities
+    bool is_on_collision_course;
+    vec2 push;
+};
+
+// Scan over neighbours only finds overlaps and collision course, most pawns are done after it
+static void check_pawn_neighbour(SimRegion *sim, PawnNeighbours *neighbours, u32 sorted_idx, vec2 v, 
+                                 u32 other_idx, vec2 relative_p, f32 distance_sq) {
+    SimRegionPawns *pawns = &sim->pawns;
+    f32 combined_radius = SIM_PAWN_RADIUS * 2.0f;
+    if (distance_sq < SQ(combined_radius)) {
+        // Each of overlapping pawns moves half of overlap away from other
+        // Pawns at the same point are pushed apart in order of their indices
+        f32 distance = Sqrt(distance_sq);
+        vec2 direction = distance > ORCA_EPSILON ? relative_p / distance : Vec2(other_idx > sorted_idx ? 1.0f : -1.0f, 0.0f);
+        neighbours->push -= direction * ((combined_radius - distance) * 0.5f);
+        neighbours->is_overlapping = true;
+    } else if (!neighbours->is_on_collision_course) {
+        // Relative velocity is in velocity obstacle if pawns get closer than combined radius at some time 
+        // within horizon - closest point of relative movement to neighbour is checked. 
+        // Closest distance is compared multiplied by squared speed, so there is no division
+        vec2 relative_v = v - Vec2(pawns->grid_v_x[other_idx], pawns->grid_v_y[other_idx]);
+        f32 speed_sq = length_sq(relative_v);
+        f32 dot_product = dot(relative_p, relative_v);
+        if (dot_product > 0.0f) {
+            if (dot_product < speed_sq * SIM_PAWN_TIME_HORIZON) {
+                neighbours->is_on_collision_course = distance_sq * speed_sq - SQ(dot_product) < SQ(combined_radius) * speed_sq;
+            } else {
+                neighbours->is_on_collision_course = distance_sq - 2.0f * SIM_PAWN_TIME_HORIZON * dot_product + 
+                    SQ(SIM_PAWN_TIME_HORIZON) * speed_sq < SQ(combined_radius);
+            }
+        }
+    }
+}
+
+// Closest neighbours for ORCA are only picked for pawns that need to avoid someone
+static void add_pawn_neighbour(PawnNeighbours *neighbours, u32 other_idx, f32 distance_sq) {
+    if (neighbours->count < SIM_PAWN_MAX_NEIGHBOURS || distance_sq < neighbours->distances_sq[neighbours->count - 1]) {
+        u32 insert_idx = neighbours->count < SIM_PAWN_MAX_NEIGHBOURS ? neighbours->count++ : neighbours->count - 1;
+        while (insert_idx > 0 && neighbours->distances_sq[insert_idx - 1] > distance_sq) {
+            neighbours->indices[insert_idx] = neighbours->indices[insert_idx - 1];
+            neighbours->distances_sq[insert_idx] = neighbours->distances_sq[insert_idx - 1];
+            --insert_idx;
+        }
+        neighbours->indices[insert_idx] = other_idx;
+        neighbours->distances_sq[insert_idx] = distance_sq;
+    }
+}
+
+// Checks 4 points of pawn grid starting from first_idx at once without branches, because whether point is in range,
+// overlaps or is on collision course is different for every point. Lanes that are not in mask are ignored
+static void check_pawn_neighbours_4x(SimRegion *sim, PawnNeighbours *neighbours, u32 sorted_idx, vec2 p, vec2 v, 
+                                     u32 first_idx, f32_4x mask, f32 max_distance_sq) {
+    SimRegionPawns *pawns = &sim->pawns;
+    SimRegionGrid *grid = &sim->pawn_grid;
+    f32 combined_radius = SIM_PAWN_RADIUS * 2.0f;
+    f32_4x combined_radius_sq = F32_4x(SQ(combined_radius));
+    f32_4x relative_x = F32_4x_loadu(grid->p_x + first_idx) - F32_4x(p.x);
+    f32_4x relative_y = F32_4x_loadu(grid->p_y + first_idx) - F32_4x(p.y);
+    f32_4x distance_sq = relative_x * relative_x + relative_y * relative_y;
+    f32_4x is_in_range = mask & (distance_sq < F32_4x(max_distance_sq));
+    u32 in_range_mask = get_mask(is_in_range);
+    for (u32 lane_idx = 0; lane_idx < 4; ++lane_idx) {
+        if (in_range_mask & (1 << lane_idx)) {
+            neighbours->in_range_indices[neighbours->in_range_count] = first_idx + lane_idx;
+            neighbours->in_range_distances_sq[neighbours->in_range_count++] = distance_sq.e[lane_idx];
+        }
+    }
+    f32_4x is_overlapping = is_in_range & (distance_sq < combined_radius_sq);
+    if (any_true(is_overlapping)) {
+        if (any_true(is_overlapping & (distance_sq <= F32_4x(SQ(ORCA_EPSILON))))) {
+            // Pawns at the same point need direction picked by index, this is rare enough to do it lane by lane
+            u32 overlap_mask = get_mask(is_overlapping);
+            for (u32 lane_idx = 0; lane_idx < 4; ++lane_idx) {
+                if (overlap_mask & (1 << lane_idx)) {
+                    vec2 relative_p = Vec2(relative_x.e[lane_idx], relative_y.e[lane_idx]);
+                    check_pawn_neighbour(sim, neighbours, sorted_idx, v, first_idx + lane_idx, relative_p, distance_sq.e[lane_idx]);
+                }
+            }
+        } else {
+            // Each of overlapping pawns moves half of overlap away from other
+            f32_4x distance = Sqrt(distance_sq);
+            f32_4x scale = select(F32_4x_zero(), is_overlapping, (F32_4x(combined_radius) - distance) * F32_4x(0.5f) / distance);
+            f32_4x push_x = relative_x * scale;
+            f32_4x push_y = relative_y * scale;
+            neighbours->push -= Vec2(push_x.e[0] + push_x.e[1] + push_x.e[2] + push_x.e[3], 
+                                     push_y.e[0] + push_y.e[1] + push_y.e[2] + push_y.e[3]);
+            neighbours->is_overlapping = true;
+        }
+    }
+    if (!neighbours->is_on_collision_course) {
+        // Same test as in check_pawn_neighbour, both ways of finding closest distance are calculated and one is picked
+        f32_4x relative_v_x = F32_4x(v.x) - F32_4x_loadu(pawns->grid_v_x + first_idx);
+        f32_4x relative_v_y = F32_4x(v.y) - F32_4x_loadu(pawns->grid_v_y + first_idx);
+        f32_4x speed_sq = relative_v_x * relative_v_x + relative_v_y * relative_v_y;
+        f32_4x dot_product = relative_x * relative_v_x + relative_y * relative_v_y;
+        f32_4x horizon = F32_4x(SIM_PAWN_TIME_HORIZON);
+        f32_4x closest_within_horizon = distance_sq * speed_sq - dot_product * dot_product < combined_radius_sq * speed_sq;
+        f32_4x closest_at_horizon = distance_sq - F32_4x(2.0f) * horizon * dot_product + horizon * horizon * speed_sq < combined_radius_sq;
+        f32_4x is_closest_within_horizon = dot_product < speed_sq * horizon;
+        f32_4x is_on_collision_course = (is_in_range ^ is_overlapping) & (dot_product > F32_4x_zero()) & 
+            select(closest_at_horizon, is_closest_within_horizon, closest_within_horizon);
+        neighbours->is_on_collision_course = any_true(is_on_collision_course);
+    }
+}
+
+// Checks points [start, end) of pawn grid - points of consecutive cells in row are stored contiguously
+// Pawn itself is counted as scanned point, so scanned count does not depend on where it is
+static void scan_pawn_neighbour_range(SimRegion *sim, PawnNeighbours *neighbours, u32 sorted_idx, vec2 p, vec2 v, 
+                                      u32 start, u32 end, f32 max_distance) {
+    SimRegionGrid *grid = &sim->pawn_grid;
+    f32 max_distance_sq = SQ(max_distance);
+    if (end - start > SIM_PAWN_MAX_SCANNED_NEIGHBOURS - neighbours->scanned_count) {
+        end = start + SIM_PAWN_MAX_SCANNED_NEIGHBOURS - neighbours->scanned_count;
+    }
+    neighbours->scanned_count += end - start;
+    u32 other_idx = start;
+    f32_4x lane_offsets = F32_4x(3.0f, 2.0f, 1.0f, 0.0f);
+    for (; other_idx + 4 <= end; other_idx += 4) {
+        f32_4x is_not_self = (F32_4x((f32)other_idx) + lane_offsets) != F32_4x((f32)sorted_idx);
+        check_pawn_neighbours_4x(sim, neighbours, sorted_idx, p, v, other_idx, is_not_self, max_distance_sq);
+    }
+    for (; other_idx < end; ++other_idx) {
+        if (other_idx == sorted_idx) {
+            continue;
+        }
+        vec2 relative_p = Vec2(grid->p_x[other_idx] - p.x, grid->p_y[other_idx] - p.y);
+        f32 distance_sq = length_sq(relative_p);
+        if (distance_sq < max_distance_sq) {
+            neighbours->in_range_indices[neighbours->in_range_count] = other_idx;
+            neighbours->in_range_distances_sq[neighbours->in_range_count++] = distance_sq;
+            check_pawn_neighbour(sim, neighbours, sorted_idx, v, other_idx, relative_p, distance_sq);
+        }
+    }
+}
+
+// At most SIM_PAWN_MAX_SCANNED_NEIGHBOURS points are checked, starting with cell of pawn, so cost of pawn
+// does not grow with crowd density
+static void scan_pawn_neighbours(SimRegion *sim, PawnNeighbours *neighbours, u32 sorted_idx, vec2 p, vec2 v, 
+                                 f32 max_distance) {
+    SimRegionGrid *grid = &sim->pawn_grid;
+    i32 cell_x = get_grid_cell(p.x, grid->min_x, grid->inv_cell_size, grid->cells_x);
+    i32 cell_y = get_grid_cell(p.y, grid->min_y, grid->inv_cell_size, grid->cells_y);
+    u32 cell = cell_y * grid->cells_x + cell_x;
+    scan_pawn_neighbour_range(sim, neighbours, sorted_idx, p, v, grid->cell_starts[cell], grid->cell_starts[cell + 1], 
+                              max_distance);
+    i32 min_cell_x = get_grid_cell(p.x - max_distance, grid->min_x, grid->inv_cell_size, grid->cells_x);
+    i32 max_cell_x = get_grid_cell(p.x + max_distance, grid->min_x, grid->inv_cell_size, grid->cells_x);
+    i32 min_cell_y = get_grid_cell(p.y - max_distance, grid->min_y, grid->inv_cell_size, grid->cells_y);
+    i32 max_cell_y = get_grid_cell(p.y + max_distance, grid->min_y, grid->inv_cell_size, grid->cells_y);
+    for (i32 row_y = min_cell_y; row_y <= max_cell_y && neighbours->scanned_count < SIM_PAWN_MAX_SCANNED_NEIGHBOURS; ++row_y) {
+        u32 *row_starts = grid->cell_starts + row_y * grid->cells_x;
+        if (row_y == cell_y) {
+            // Cell of pawn is already checked
+            scan_pawn_neighbour_range(sim, neighbours, sorted_idx, p, v, row_starts[min_cell_x], row_starts[cell_x], 
+                                      max_distance);
+            scan_pawn_neighbour_range(sim, neighbours, sorted_idx, p, v, row_starts[cell_x + 1], row_starts[max_cell_x + 1], 
+                                      max_distance);
+        } else {
+            scan_pawn_neighbour_range(sim, neighbours, sorted_idx, p, v, row_starts[min_cell_x], row_starts[max_cell_x + 1], 
+                                      max_distance);
+        }
+    }
+}
+
+// Returns number of closest neighbours that were picked from scanned points in range
+static u32 collect_pawn_neighbours(PawnNeighbours *neighbours) {
+    for (u32 in_range_idx = 0; in_range_idx < neighbours->in_range_count; ++in_range_idx) {
+        add_pawn_neighbour(neighbours, neighbours->in_range_indices[in_range_idx], neighbours->in_range_distances_sq[in_range_idx]);
+    }
+    return neighbours->count;
+}
+
+// Picks new velocity for pawn with ORCA and calculates push from pawns it overlaps
+// Neighbours are assumed to move with their preferred velocities
+// Idle pawns only look for pawns they overlap, and don't move if there are none - moving pawns take whole 
+// responsibility for avoiding them. Pawn that has no neighbour on collision course keeps its velocity, 
+// so closest neighbours are only collected and ORCA is only solved for pawns that are about to collide
+// Such pawn also skips looking for neighbours in next SIM_PAWN_AVOIDANCE_FREE_STEPS steps
+static vec2 get_pawn_avoidance_step(SimRegion *sim, u32 sorted_idx, f32 speed, f32 dt) {
+    SimRegionPawns *pawns = &sim->pawns;
+    SimRegionGrid *grid = &sim->pawn_grid;
+    u32 pawn_idx = grid->indices[sorted_idx];
+    vec2 p = Vec2(grid->p_x[sorted_idx], grid->p_y[sorted_idx]);
+    vec2 v = Vec2(pawns->grid_v_x[sorted_idx], pawns->grid_v_y[sorted_idx]);
+    f32 combined_radius = SIM_PAWN_RADIUS * 2.0f;
+    bool is_idle = v.x == 0.0f && v.y == 0.0f;
+    f32 max_distance = is_idle ? combined_radius : SIM_PAWN_NEIGHBOUR_DISTANCE;
+    
+    // Arrays are not cleared, they are only read up to counts
+    PawnNeighbours neighbours;
+    neighbours.count = neighbours.scanned_count = neighbours.in_range_count = 0;
+    neighbours.is_overlapping = neighbours.is_on_collision_course = false;
+    neighbours.push = Vec2(0);
+    bool is_free = pawns->avoidance_free_steps[pawn_idx] != 0;
+    if (is_free) {
+        --pawns->avoidance_free_steps[pawn_idx];
+    } else {
+        scan_pawn_neighbours(sim, &neighbours, sorted_idx, p, v, max_distance);
+        is_free = !is_idle && !neighbours.is_overlapping && !neighbours.is_on_collision_course;
+        if (is_free) {
+            pawns->avoidance_free_steps[pawn_idx] = SIM_PAWN_AVOIDANCE_FREE_STEPS;
+        }
+    }
+    vec2 new_v = v;
+    if (is_idle && !neighbours.is_overlapping) {
+        // Idle pawn stays where it is
+    } else if (is_free) {
+        // Preferred velocity satisfies all ORCA lines, so solving them would only clamp it to max speed
+        if (length_sq(v) > SQ(speed)) {
+            new_v = normalize(v) * speed;
+        }
+    } else if (collect_pawn_neighbours(&neighbours)) {
+        OrcaLine lines[SIM_PAWN_MAX_NEIGHBOURS];
+        f32 inv_time_horizon = 1.0f / SIM_PAWN_TIME_HORIZON;
+        f32 inv_dt = 1.0f / dt;
+        for (u32 neighbour_idx = 0; neighbour_idx < neighbours.count; ++neighbour_idx) {
+            u32 other_idx = neighbours.indices[neighbour_idx];
+            vec2 other_v = Vec2(pawns->grid_v_x[other_idx], pawns->grid_v_y[other_idx]);
+            vec2 relative_p = Vec2(grid->p_x[other_idx], grid->p_y[other_idx]) - p;
+            vec2 relative_v = v - other_v;
+            f32 distance_sq = neighbours.distances_sq[neighbour_idx];
+            OrcaLine *line = lines + neighbour_idx;
+            vec2 u;
+            if (distance_sq > SQ(combined_radius)) {
+                // Vector from cutoff circle center to relative velocity
+                vec2 w = relative_v - relative_p * inv_time_horizon;
+                f32 w_length_sq = length_sq(w);
+                f32 dot_product = dot(w, relative_p);
+                if (dot_product < 0.0f && SQ(dot_product) > SQ(combined_radius) * w_length_sq) {
+                    // Project on cutoff circle
+                    f32 w_length = Sqrt(w_length_sq);
+                    vec2 unit_w = w / w_length;
+                    line->direction = Vec2(unit_w.y, -unit_w.x);
+                    u = unit_w * (combined_radius * inv_time_horizon - w_length);
+                } else {
+                    // Project on legs of velocity obstacle cone
+                    f32 leg = Sqrt(distance_sq - SQ(combined_radius));
+                    if (det(relative_p, w) > 0.0f) {
+                        line->direction = Vec2(relative_p.x * leg - relative_p.y * combined_radius, 
+                                               relative_p.x * combined_radius + relative_p.y * leg) / distance_sq;
+                    } else {
+                        line->direction = -Vec2(relative_p.x * leg + relative_p.y * combined_radius, 
+                                                -relative_p.x * combined_radius + relative_p.y * leg) / distance_sq;
+                    }
+                    u = line->direction * dot(relative_v, line->direction) - relative_v;
+                }
+            } else {
+                // Pawns already collide - avoid collision in this step instead of time horizon
+                vec2 w = relative_v - relative_p * inv_dt;
+                f32 w_length = Sqrt(length_sq(w));
+                vec2 unit_w = w_length > ORCA_EPSILON ? w / w_length : Vec2(0, 1);
+                line->direction = Vec2(unit_w.y, -unit_w.x);
+                u = unit_w * (combined_radius * inv_dt - w_length);
+            }
+            // Each pawn takes half of responsibility to avoid collision, idle pawns don't avoid at all
+            bool is_other_idle = other_v.x == 0.0f && other_v.y == 0.0f;
+            line->p = v + u * (is_other_idle && !is_idle ? 1.0f : 0.5f);
+        }
+        
+        u32 failed_line = orca_solve(lines, neighbours.count, speed, v, false, &new_v);
+        if (failed_line < neighbours.count) {
+            orca_solve_dense(lines, neighbours.count, failed_line, speed, &new_v);
+        }
+    }
+    
+    vec2 step = new_v * dt + neighbours.push;
+    return step;
+}
+
+void add_sim_construction_site(SimRegion *sim, Entity *entity) {
+    assert(entity->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION);
+    SimRegionConstructionSites *sites = &sim->construction_sites;
+    assert(sites->count < sites->max_count);
+    sites->entity_indices[sites->count++] = (u32)(entity - sim->entities);
+}
+
+static u32 get_logistics_kind(Entity *entity) {
+    u32 result = SIM_LOGISTICS_STOCKPILES;
+    if (entity->kind == ENTITY_KIND_ITEM_PILE) {
+        assert(entity->item_kind != SIM_LOGISTICS_STOCKPILES && entity->item_kind < SIM_LOGISTICS_KIND_COUNT);
+        result = entity->item_kind;
+    }
+    return result;
+}
+
+static void link_logistics_entry(SimRegionLogistics *logistics, u32 entity_idx) {
+    u32 bucket_idx = logistics->bucket_indices[entity_idx];
+    if (bucket_idx != SIM_LOGISTICS_NULL) {
+        u32 head = logistics->bucket_heads[bucket_idx];
+        logistics->prev_in_bucket[entity_idx] = SIM_LOGISTICS_NULL;
+        logistics->next_in_bucket[entity_idx] = head;
+        if (head != SIM_LOGISTICS_NULL) {
+            logistics->prev_in_bucket[head] = entity_idx;
+        }
+        logistics->bucket_heads[bucket_idx] = entity_idx;
+        ++logistics->entry_counts[bucket_idx % SIM_LOGISTICS_KIND_COUNT];
+    }
+}
+
+static void unlink_logistics_entry(SimRegionLogistics *logistics, u32 entity_idx) {
+    u32 bucket_idx = logistics->bucket_indices[entity_idx];
+    if (bucket_idx != SIM_LOGISTICS_NULL) {
+        u32 prev = logistics->prev_in_bucket[entity_idx];
+        u32 next = logistics->next_in_bucket[entity_idx];
+        if (prev != SIM_LOGISTICS_NULL) {
+            logistics->next_in_bucket[prev] = next;
+        } else {
+            logistics->bucket_heads[bucket_idx] = next;
+        }
+        if (next != SIM_LOGISTICS_NULL) {
+            logistics->prev_in_bucket[next] = prev;
+        }
+        --logistics->entry_counts[bucket_idx % SIM_LOGISTICS_KIND_COUNT];
+    }
+}
+
+void add_sim_logistics_entity(SimRegion *sim, Entity *entity) {
+    assert(is_logistics_entity(entity));
+    SimRegionLogistics *logistics = &sim->logistics;
+    u32 entity_idx = (u32)(entity - sim->entities);
+    u32 available = entity->item_amount;
+    if (entity->flags & ENTITY_FLAG_IS_STOCKPILE) {
+        assert(entity->item_amount <= entity->item_capacity);
+        available = entity->item_capacity - entity->item_amount;
+    }
+    logistics->available[entity_idx] = available;
+    // Entity that is outside of sim chunks is still tracked, but it can't be found in queries
+    logistics->bucket_indices[entity_idx] = SIM_LOGISTICS_NULL;
+    i32 chunk_x, chunk_y;
+    p_to_chunk_coord(entity->p, &chunk_x, &chunk_y);
+    SimRegionChunk *chunk = get_chunk(sim, chunk_x, chunk_y);
+    if (chunk) {
+        u32 chunk_idx = (u32)(chunk - sim->chunks);
+        logistics->bucket_indices[entity_idx] = chunk_idx * SIM_LOGISTICS_KIND_COUNT + get_logistics_kind(entity);
+    }
+    if (available) {
+        link_logistics_entry(logistics, entity_idx);
+    }
+}
+
+u32 get_sim_logistics_available(SimRegion *sim, Entity *entity) {
+    assert(is_logistics_entity(entity));
+    return sim->logistics.available[entity - sim->entities];
+}
+
+void reserve_sim_logistics(SimRegion *sim, Entity *entity, u32 amount) {
+    assert(is_logistics_entity(entity));
+    SimRegionLogistics *logistics = &sim->logistics;
+    u32 entity_idx = (u32)(entity - sim->entities);
+    assert(logistics->available[entity_idx] >= amount);
+    if (amount) {
+        logistics->available[entity_idx] -= amount;
+        if (!logistics->available[entity_idx]) {
+            unlink_logistics_entry(logistics, entity_idx);
+        }
+    }
+}
+
+void release_sim_logistics(SimRegion *sim, Entity *entity, u32 amount) {
+    assert(is_logistics_entity(entity));
+    SimRegionLogistics *logistics = &sim->logistics;
+    u32 entity_idx = (u32)(entity - sim->entities);
+    if (amount) {
+        if (!logistics->available[entity_idx]) {
+            link_logistics_entry(logistics, entity_idx);
+        }
+        logistics->available[entity_idx] += amount;
+    }
+}
+
+Entity *find_nearest_sim_logistics_entity(SimRegion *sim, u32 logistics_kind, vec2 p, f32 max_distance) {
+    TIMED_FUNCTION();
+    assert(logistics_kind < SIM_LOGISTICS_KIND_COUNT);
+    SimRegionLogistics *logistics = &sim->logistics;
+    Entity *result = 0;
+    if (logistics->entry_counts[logistics_kind]) {
+        i32 center_chunk_x, center_chunk_y;
+        p_to_chunk_coord(p, &center_chunk_x, &center_chunk_y);
+        // Sim region is rhombus, so no chunk is further from any chunk in it than its diameter
+        i32 max_ring = 2 * sim->chunk_radius + 1;
+        if (max_distance / CHUNK_SIZE + 1 < max_ring) {
+            max_ring = (i32)(max_distance / CHUNK_SIZE) + 1;
+        }
+        f32 best_distance_sq = SQ(max_distance);
+        for (i32 ring = 0; ring <= max_ring; ++ring) {
+            // Chunks of ring are at least ring - 1 chunk sizes away from p
+            f32 ring_distance = (ring - 1) * CHUNK_SIZE;
+            if (ring > 1 && SQ(ring_distance) > best_distance_sq) {
+                break;
+            }
+            
+            for (i32 dy = -ring; dy <= ring; ++dy) {
+                // Inner rows of ring only have chunks on its sides
+                i32 dx_step = (dy == -ring || dy == ring) ? 1 : 2 * ring;
+                for (i32 dx = -ring; dx <= ring; dx += (dx_step ? dx_step : 1)) {
+                    SimRegionChunk *chunk = get_chunk(sim, center_chunk_x + dx, center_chunk_y + dy);
+                    if (!chunk) {
+                        continue;
+                    }
+                    
+                    u32 bucket_idx = (u32)(chunk - sim->chunks) * SIM_LOGISTICS_KIND_COUNT + logistics_kind;
+                    for (u32 entity_idx = logistics->bucket_heads[bucket_idx]; 
+                         entity_idx != SIM_LOGISTICS_NULL; 
+                         entity_idx = logistics->next_in_bucket[entity_idx]) {
+                        Entity *entity = sim->entities + entity_idx;
+                        f32 distance_sq = length_sq(entity->p - p);
+                        if (distance_sq <= best_distance_sq) {
+                            best_distance_sq = distance_sq;
+                            result = entity;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Blur kernel is 3x3 binomial filter, so cells in neighbour chunks are needed only along chunk borders
+static void blur_sim_chunk_influence(SimRegion *sim, SimRegionChunk *chunk) {
+#define INFLUENCE_PADDED_SIZE (INFLUENCE_CELLS_IN_CHUNK + 2)
+    ChunkInfluence *influence = &chunk->influence;
+    SimRegionChunk *neighbours[3][3];
+    influence->is_partial = false;
+    for (i32 dy = -1; dy <= 1; ++dy) {
+        for (i32 dx = -1; dx <= 1; ++dx) {
+            neighbours[dy + 1][dx + 1] = get_chunk(sim, chunk->chunk_x + dx, chunk->chunk_y + dy);
+            if (!neighbours[dy + 1][dx + 1]) {
+                influence->is_partial = true;
+            }
+        }
+    }
+    
+    for (u32 layer = 0; layer < INFLUENCE_LAYER_SENTINEL; ++layer) {
+        // Raw values of chunk with one cell border taken from neighbours, missing chunks have no influence
+        f32 padded[INFLUENCE_PADDED_SIZE][INFLUENCE_PADDED_SIZE];
+        for (i32 y = 0; y < INFLUENCE_PADDED_SIZE; ++y) {
+            for (i32 x = 0; x < INFLUENCE_PADDED_SIZE; ++x) {
+                i32 cell_x = x - 1;
+                i32 cell_y = y - 1;
+                i32 neighbour_x = cell_x < 0 ? 0 : cell_x >= INFLUENCE_CELLS_IN_CHUNK ? 2 : 1;
+                i32 neighbour_y = cell_y < 0 ? 0 : cell_y >= INFLUENCE_CELLS_IN_CHUNK ? 2 : 1;
+                SimRegionChunk *neighbour = neighbours[neighbour_y][neighbour_x];
+                f32 value = 0;
+                if (neighbour) {
+                    u32 neighbour_cell_x = (u32)(cell_x + INFLUENCE_CELLS_IN_CHUNK) % INFLUENCE_CELLS_IN_CHUNK;
+                    u32 neighbour_cell_y = (u32)(cell_y + INFLUENCE_CELLS_IN_CHUNK) % INFLUENCE_CELLS_IN_CHUNK;
+                    value = neighbour->influence.raw[layer][neighbour_cell_y * INFLUENCE_CELLS_IN_CHUNK + neighbour_cell_x];
+                }
+                padded[y][x] = value;
+            }
+        }
+        
+        f32 max = 0;
+        for (u32 cell_y = 0; cell_y < INFLUENCE_CELLS_IN_CHUNK; ++cell_y) {
+            for (u32 cell_x = 0; cell_x < INFLUENCE_CELLS_IN_CHUNK; ++cell_x) {
+                f32 *row0 = padded[cell_y] + cell_x;
+                f32 *row1 = padded[cell_y + 1] + cell_x;
+                f32 *row2 = padded[cell_y + 2] + cell_x;
+                f32 value = ((row0[0] + 2.0f * row0[1] + row0[2]) + 
+                             (row1[0] + 2.0f * row1[1] + row1[2]) * 2.0f + 
+                             (row2[0] + 2.0f * row2[1] + row2[2])) * (1.0f / 16.0f);
+                influence->blurred[layer][cell_y * INFLUENCE_CELLS_IN_CHUNK + cell_x] = value;
+                max = value > max ? value : max;
+            }
+        }
+        influence->max[layer] = max;
+    }
+#undef INFLUENCE_PADDED_SIZE
+}
+
+void update_sim_influence(SimRegion *sim) {
+    if (sim->influence_changed_count) {
+        TIMED_FUNCTION();
+        // Blur of chunk depends on raw values of its neighbours
+        for (u32 changed_idx = 0; changed_idx < sim->influence_changed_count; ++changed_idx) {
+            SimRegionChunk *chunk = sim->chunks + sim->influence_changed_chunks[changed_idx];
+            chunk->influence_flags &= ~SIM_INFLUENCE_RAW_CHANGED;
+            for (i32 dy = -1; dy <= 1; ++dy) {
+                for (i32 dx = -1; dx <= 1; ++dx) {
+                    SimRegionChunk *neighbour = get_chunk(sim, chunk->chunk_x + dx, chunk->chunk_y + dy);
+                    if (neighbour) {
+                        neighbour->influence_flags |= SIM_INFLUENCE_NEEDS_BLUR;
+                    }
+                }
+            }
+        }
+        sim->influence_changed_count = 0;
+        
+        u32 blurred_count = 0;
+        for (u32 chunk_idx = 0; chunk_idx < sim->chunks_count; ++chunk_idx) {
+            SimRegionChunk *chunk = sim->chunks + chunk_idx;
+            if (chunk->influence_flags & SIM_INFLUENCE_NEEDS_BLUR) {
+                chunk->influence_flags &= ~SIM_INFLUENCE_NEEDS_BLUR;
+                blur_sim_chunk_influence(sim, chunk);
+                ++blurred_count;
+            }
+        }
+        DEBUG_VALUE(blurred_count, "Influence chunks blurred");
+    }
+}
+
+f32 get_sim_influence(SimRegion *sim, u32 layer, vec2 p) {
+    assert(layer < INFLUENCE_LAYER_SENTINEL);
+    update_sim_influence(sim);
+    f32 result = 0;
+    u32 cell_idx;
+    SimRegionChunk *chunk = get_influence_cell(sim, p, &cell_idx);
+    if (chunk) {
+        result = chunk->influence.blurred[layer][cell_idx];
+    }
+    return result;
+}
+
+f32 get_sim_influence_max(SimRegion *sim, u32 layer, vec2 p, f32 radius, vec2 *max_p_dst) {
+    TIMED_FUNCTION();
+    assert(layer < INFLUENCE_LAYER_SENTINEL);
+    update_sim_influence(sim);
+    f32 result = 0;
+    vec2 max_p = p;
+    ITERATE(chunk_iter, iterate_sim_chunks_in_radius(sim, p, radius)) {
+        SimRegionChunk *chunk = chunk_iter.ptr;
+        // Most of chunks have nothing larger than already found value
+        if (chunk->influence.max[layer] > result) {
+            vec2 chunk_origin = Vec2(chunk->chunk_x, chunk->chunk_y) * CHUNK_SIZE;
+            for (u32 cell_idx = 0; cell_idx < INFLUENCE_CELLS_IN_CHUNK * INFLUENCE_CELLS_IN_CHUNK; ++cell_idx) {
+                f32 value = chunk->influence.blurred[layer][cell_idx];
+                if (value > result) {
+                    vec2 cell_p = chunk_origin + Vec2(cell_idx % INFLUENCE_CELLS_IN_CHUNK + 0.5f, 
+                                                      cell_idx / INFLUENCE_CELLS_IN_CHUNK + 0.5f) * INFLUENCE_CELL_SIZE;
+                    if (length_sq(cell_p - p) <= SQ(radius)) {
+                        result = value;
+                        max_p = cell_p;
+                    }
+                }
+            }
+        }
+    }
+    if (max_p_dst) {
+        *max_p_dst = max_p;
+    }
+    return result;
+}
+
+// Range of pawns in grid order
+struct PawnAvoidanceJob {
+    SimRegion *sim;
+    u32 first_sorted_idx;
+    u32 end_sorted_idx;
+    f32 speed;
+    f32 dt;
+};
+
+// Pawns are processed in grid order, so neighbours of consecutive pawns are mostly the same
+static void pawn_avoidance_work(void *data) {
+    PawnAvoidanceJob *job = (PawnAvoidanceJob *)data;
+    SimRegionPawns *pawns = &job->sim->pawns;
+    for (u32 sorted_idx = job->first_sorted_idx; sorted_idx < job->end_sorted_idx; ++sorted_idx) {
+        u32 pawn_idx = job->sim->pawn_grid.indices[sorted_idx];
+        vec2 step = get_pawn_avoidance_step(job->sim, sorted_idx, job->speed, job->dt);
+        pawns->step_x[pawn_idx] = step.x;
+        pawns->step_y[pawn_idx] = step.y;
+    }
+}
+
+void update_sim_pawns(SimRegion *sim, f32 speed, f32 dt, bool should_avoid) {
+    TIMED_FUNCTION();
+    SimRegionPawns *pawns = &sim->pawns;
+    u32 batch_count = (pawns->count + SIM_PAWN_BATCH_SIZE - 1) / SIM_PAWN_BATCH_SIZE;
+    for (u32 pawn_idx = pawns->count; pawn_idx < batch_count * SIM_PAWN_BATCH_SIZE; ++pawn_idx) {
+        pawns->p_x[pawn_idx] = pawns->p_y[pawn_idx] = 0;
+        pawns->target_x[pawn_idx] = pawns->target_y[pawn_idx] = 0;
+        pawns->stop_distance_sq[pawn_idx] = F32_INFINITY;
+        pawns->step_x[pawn_idx] = pawns->step_y[pawn_idx] = 0;
+    }
+    
+    BEGIN_BLOCK("Pawn preferred velocity");
+    f32_4x speed_4x = F32_4x(speed);
+    f32_4x inv_dt_4x = F32_4x(1.0f / dt);
+    f32_4x zero = F32_4x_zero();
+    for (u32 batch_idx = 0; batch_idx < batch_count; ++batch_idx) {
+        u32 first_pawn_idx = batch_idx * SIM_PAWN_BATCH_SIZE;
+        f32_4x delta_x = F32_4x_load(pawns->target_x + first_pawn_idx) - F32_4x_load(pawns->p_x + first_pawn_idx);
+        f32_4x delta_y = F32_4x_load(pawns->target_y + first_pawn_idx) - F32_4x_load(pawns->p_y + first_pawn_idx);
+        f32_4x stop_distance_sq = F32_4x_load(pawns->stop_distance_sq + first_pawn_idx);
+        f32_4x distance_sq = delta_x * delta_x + delta_y * delta_y;
+        f32_4x should_move = distance_sq > stop_distance_sq;
+        // Same approximation as normalize() uses, lanes that don't move can have zero length,
+        // so their velocity is masked out. Velocity never takes pawn past target in single step, 
+        // so pawns don't overshoot when updated with big time steps
+        f32_4x scale = select(zero, should_move, Min(Rsqrt(distance_sq) * speed_4x, inv_dt_4x));
+        store(pawns->v_x + first_pawn_idx, delta_x * scale);
+        store(pawns->v_y + first_pawn_idx, delta_y * scale);
+    }
+    END_BLOCK();
+    
+    if (!should_avoid) {
+        // Velocity is already limited by speed, so pawns walk straight to their targets
+        BEGIN_BLOCK("Pawn straight step");
+        f32_4x dt_4x = F32_4x(dt);
+        for (u32 batch_idx = 0; batch_idx < batch_count; ++batch_idx) {
+            u32 first_pawn_idx = batch_idx * SIM_PAWN_BATCH_SIZE;
+            store(pawns->step_x + first_pawn_idx, F32_4x_load(pawns->v_x + first_pawn_idx) * dt_4x);
+            store(pawns->step_y + first_pawn_idx, F32_4x_load(pawns->v_y + first_pawn_idx) * dt_4x);
+        }
+        END_BLOCK();
+    } else {
+        BEGIN_BLOCK("Pawn avoidance");
+        SimRegionGrid *grid = &sim->pawn_grid;
+        build_sim_region_grid(grid, sim->arena, pawns->p_x, pawns->p_y, pawns->count, SIM_PAWN_NEIGHBOUR_DISTANCE);
+        pawns->grid_v_x = alloc_arr(sim->arena, pawns->count, f32, false);
+        pawns->grid_v_y = alloc_arr(sim->arena, pawns->count, f32, false);
+        for (u32 sorted_idx = 0; sorted_idx < pawns->count; ++sorted_idx) {
+            pawns->grid_v_x[sorted_idx] = pawns->v_x[grid->indices[sorted_idx]];
+            pawns->grid_v_y[sorted_idx] = pawns->v_y[grid->indices[sorted_idx]];
+        }
+        // Pawns only read grid and velocities and write their own results, so jobs can take any ranges of them 
+        // and result is the same
+        u32 job_count = pawns->count / SIM_PAWN_AVOIDANCE_MIN_JOB_PAWNS;
+        job_count = job_count < SIM_PAWN_AVOIDANCE_MAX_JOB_COUNT ? job_count : SIM_PAWN_AVOIDANCE_MAX_JOB_COUNT;
+        job_count = job_count && sim->work_queue ? job_count : 1;
+        PawnAvoidanceJob jobs[SIM_PAWN_AVOIDANCE_MAX_JOB_COUNT];
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            PawnAvoidanceJob *job = jobs + job_idx;
+            job->sim = sim;
+            job->speed = speed;
+            job->dt = dt;
+            job->first_sorted_idx = (u32)((u64)pawns->count * job_idx / job_count);
+            job->end_sorted_idx = (u32)((u64)pawns->count * (job_idx + 1) / job_count);
+            // Calling thread takes first job
+            if (job_idx && !add_work_queue_entry(sim->work_queue, pawn_avoidance_work, job)) {
+                pawn_avoidance_work(job);
+            }
+        }
+        pawn_avoidance_work(jobs);
+        if (job_count > 1) {
+            complete_all_work(sim->work_queue);
+        }
+        END_BLOCK();
+    }
+    
+    // Cell changes are collected during movement and applied after it, so
+    // movement loop does not touch chunk storage and influence maps at all
+    // Chunk borders are influence cell borders too, so pawn that changes chunk always changes cell
+    // This can't be temporary memory, because chunk changes allocate entity blocks on the same arena
+    u32 cell_change_count = 0;
+    u32 *cell_changes = alloc_arr(sim->arena, pawns->count, u32, false);
+    BEGIN_BLOCK("Pawn movement");
+    f32_4x inv_cell_size = F32_4x(1.0f / INFLUENCE_CELL_SIZE);
+    for (u32 batch_idx = 0; batch_idx < batch_count; ++batch_idx) {
+        u32 first_pawn_idx = batch_idx * SIM_PAWN_BATCH_SIZE;
+        f32_4x p_x = F32_4x_load(pawns->p_x + first_pawn_idx);
+        f32_4x p_y = F32_4x_load(pawns->p_y + first_pawn_idx);
+        f32_4x new_p_x = p_x + F32_4x_load(pawns->step_x + first_pawn_idx);
+        f32_4x new_p_y = p_y + F32_4x_load(pawns->step_y + first_pawn_idx);
+        store(pawns->p_x + first_pawn_idx, new_p_x);
+        store(pawns->p_y + first_pawn_idx, new_p_y);
+        
+        f32_4x cell_changed = (Floor(p_x * inv_cell_size) != Floor(new_p_x * inv_cell_size)) |
+            (Floor(p_y * inv_cell_size) != Floor(new_p_y * inv_cell_size));
+        u32 cell_changed_mask = get_mask(cell_changed);
+        if (cell_changed_mask) {
+            for (u32 lane_idx = 0; lane_idx < SIM_PAWN_BATCH_SIZE; ++lane_idx) {
+                if (cell_changed_mask & (1 << lane_idx)) {
+                    cell_changes[cell_change_count++] = first_pawn_idx + lane_idx;
+                }
+            }
+        }
+    }
+    END_BLOCK();
+    
+    BEGIN_BLOCK("Pawn cell changes");
+    for (u32 change_idx = 0; change_idx < cell_change_count; ++change_idx) {
+        u32 pawn_idx = cell_changes[change_idx];
+        Entity *entity = get_pawn_entity(sim, pawn_idx);
+        vec2 new_p = Vec2(pawns->p_x[pawn_idx], pawns->p_y[pawn_idx]);
+        change_entity_position(sim, entity, new_p);
+    }
+    for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+        Entity *entity = get_pawn_entity(sim, pawn_idx);
+        entity->p = Vec2(pawns->p_x[pawn_idx], pawns->p_y[pawn_idx]);
+        entity->avoidance_free_steps = pawns->avoidance_free_steps[pawn_idx];
+    }
+    END_BLOCK();
+    DEBUG_VALUE(pawns->count, "Pawn count");
+    DEBUG_VALUE(cell_change_count, "Pawn cell changes");
+    DEBUG_VALUE(sim->pawn_grid.cells_x * sim->pawn_grid.cells_y, "Pawn grid cells");
+}
+
 bool is_cell_occupied(SimRegion *sim, i32 cell_x, i32 cell_y) {
     TIMED_FUNCTION();
     i32 min_cell_chunk_x, min_cell_chunk_y;
@@ -300,39 +1290,34 @@ bool is_cell_occupied(SimRegion *sim, i32 cell_x, i32 cell_y) {
 }
 
 bool check_spatial_placement(SimRegion *sim, i32 cell_x, i32 cell_y, u32 width, u32 height) {
-    // TIMED_FUNCTION();
-    // i32 min_occupant_x = cell_x;
-    // i32 min_occupant_y = cell_y;
-    // i32 max_occupant_x = cell_x + width;
-    // i32 max_occupant_y = cell_y + height;
-    
-    // i32 cell_chunk_x, cell_chunk_y;
-    // get_chunk_coord_from_cell_coord(cell_x, cell_y, &cell_chunk_x, &cell_chunk_y);
-    // bool is_occupied = false;
-    // for (SimChunkIterator iter = iterate_sim_chunks(sim, cell_chunk_x - 1, cell_chunk_y - 1, 
-    //         cell_chunk_x + 1, cell_chunk_y + 1);
-    //      is_valid(&iter) && !is_occupied;
-    //      advance(&iter)) {
-    //     SimRegionChunk *chunk = iter.ptr;
-    //     i32 chunk_pos_in_cells_x = chunk->chunk_x * CELLS_IN_CHUNK;
-    //     i32 chunk_pos_in_cells_y = chunk->chunk_y * CELLS_IN_CHUNK;
-    //     for (u32 spatial_data_idx = 0;
-    //          spatial_data_idx < chunk->spatial_occupancy_count && !is_occupied;
-    //          ++spatial_data_idx) {
-    //         SpatialOccupancy occupancy = chunk->spatial_occupancy[spatial_data_idx];
-    //         i32 min_occupancy_cell_x = chunk_pos_in_cells_x - 1;
-    //         i32 min_occupancy_cell_y = chunk_pos_in_cells_y - 1;
-    //         i32 max_occupancy_cell_x = chunk_pos_in_cells_x + occupancy.x + occupancy.w + 1;
-    //         i32 max_occupancy_cell_y = chunk_pos_in_cells_y + occupancy.y + occupancy.y + 1;
-    //         if (min_occupant_x < max_occupancy_cell_x && max_occupant_x > min_occupancy_cell_x
-    //             && min_occupant_y < max_occupancy_cell_y && max_occupant_y > min_occupancy_cell_y) {
-    //             is_occupied = true;
-    //             break;       
-    //         }
-    //     }
-    // }
-    // return is_occupied;
-    return false;
+    TIMED_FUNCTION();
+    // Occupied cells must be outside of placed rect grown by one cell
+    i32 min_free_cell_x = cell_x - 1;
+    i32 min_free_cell_y = cell_y - 1;
+    i32 max_free_cell_x = cell_x + (i32)width;
+    i32 max_free_cell_y = cell_y + (i32)height;
+    i32 min_chunk_x, min_chunk_y;
+    get_chunk_coord_from_cell_coord(min_free_cell_x, min_free_cell_y, &min_chunk_x, &min_chunk_y);
+    i32 max_chunk_x, max_chunk_y;
+    get_chunk_coord_from_cell_coord(max_free_cell_x, max_free_cell_y, &max_chunk_x, &max_chunk_y);
+    bool can_be_placed = true;
+    ITERATE(chunk_iter, iterate_sim_chunks(sim, min_chunk_x, min_chunk_y, max_chunk_x, max_chunk_y)) {
+        SimRegionChunk *chunk = chunk_iter.ptr;
+        ITERATE(iter, iterate_chunk_entities(chunk)) {
+            Entity *entity = get_entity_by_id(sim, *iter.ptr);
+            if (entity && (entity->flags & ENTITY_FLAG_HAS_WORLD_PLACEMENT) && !(entity->flags & ENTITY_FLAG_IS_DELETED)) {
+                i32 occupied_cell_x = Floor_i32(entity->p.x);
+                i32 occupied_cell_y = Floor_i32(entity->p.y);
+                if (min_free_cell_x <= occupied_cell_x && occupied_cell_x <= max_free_cell_x &&
+                    min_free_cell_y <= occupied_cell_y && occupied_cell_y <= max_free_cell_y) {
+                    can_be_placed = false;
+                    goto end;
+                }
+            }
+        }
+    }
+    end:
+    return can_be_placed;
 }
 
 void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
@@ -340,6 +1325,7 @@ void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
     TIMED_FUNCTION();
     sim->arena = arena;
     sim->world = world;
+    sim->work_queue = 0;
     sim->center_chunk_x = center_x;
     sim->center_chunk_y = center_y;
     sim->chunk_radius = chunk_radius;
@@ -352,11 +1338,44 @@ void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
     sim->chunks = alloc_arr(arena, chunk_count, SimRegionChunk, false);
     sim->entities = alloc_arr(arena, sim->max_entity_count, Entity, false);
     sim->entity_hash = alloc_arr(arena, sim->max_entity_count, SimRegionEntityHash);
+    // Every entity may be a pawn. Max entity count is power of two, so arrays are already padded to batch size
+    CT_ASSERT(IS_POW2(SIM_PAWN_BATCH_SIZE));
+    sim->pawns.count = 0;
+    sim->pawns.max_count = sim->max_entity_count;
+    sim->pawns.entity_indices = alloc_arr(arena, sim->pawns.max_count, u32, false);
+    sim->pawns.p_x = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.p_y = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.target_x = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.target_y = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.stop_distance_sq = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.v_x = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.v_y = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.step_x = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.step_y = alloc_arr(arena, sim->pawns.max_count, f32, false);
+    sim->pawns.avoidance_free_steps = alloc_arr(arena, sim->pawns.max_count, u32, false);
+    sim->pawn_grid = {};
+    sim->construction_sites.count = 0;
+    sim->construction_sites.max_count = sim->max_entity_count;
+    sim->construction_sites.entity_indices = alloc_arr(arena, sim->construction_sites.max_count, u32, false);
+    SimRegionLogistics *logistics = &sim->logistics;
+    *logistics = {};
+    logistics->available = alloc_arr(arena, sim->max_entity_count, u32, false);
+    logistics->bucket_indices = alloc_arr(arena, sim->max_entity_count, u32, false);
+    logistics->next_in_bucket = alloc_arr(arena, sim->max_entity_count, u32, false);
+    logistics->prev_in_bucket = alloc_arr(arena, sim->max_entity_count, u32, false);
+    logistics->hauler_indices = alloc_arr(arena, sim->max_entity_count, u32, false);
+    logistics->bucket_heads = alloc_arr(arena, (chunk_count * SIM_LOGISTICS_KIND_COUNT), u32, false);
+    memset(logistics->bucket_heads, 0xFF, sizeof(u32) * chunk_count * SIM_LOGISTICS_KIND_COUNT);
+    sim->influence_changed_count = 0;
+    sim->influence_changed_chunks = alloc_arr(arena, chunk_count, u32, false);
     END_BLOCK();
     sim->chunks_count = chunk_count;
     for (u32 chunk_idx = 0; chunk_idx < chunk_count; ++chunk_idx) {
         SimRegionChunk *sim_chunk = sim->chunks + chunk_idx;
         sim_chunk->first_block = {};
+        sim_chunk->catch_up_ticks = 0;
+        sim_chunk->influence = {};
+        sim_chunk->influence_flags = 0;
         
         i32 chx, chy;
         chunk_array_index_to_coord(chunk_radius, chunk_idx, &chx, &chy);
@@ -366,12 +1385,22 @@ void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
         i32 world_chunk_y = sim->center_chunk_y + chy;
         WorldChunk *world_chunk = remove_world_chunk(world, world_chunk_x, world_chunk_y);
         if (world_chunk) {
+            if (world_chunk->last_packed_tick < world->frame_start_tick) {
+                sim_chunk->catch_up_ticks = world->frame_start_tick - world_chunk->last_packed_tick;
+            }
+            bool has_influence = world_chunk->has_influence;
+            if (has_influence) {
+                sim_chunk->influence = world_chunk->influence;
+            }
             WorldChunkEntityBlock *block = world_chunk->first_entity_block;
             while (block) {
                 for (u32 entity_idx = 0; entity_idx < block->entity_count; ++entity_idx) {
                     Entity *src = (Entity *)block->entity_data  + entity_idx;
                     vec2 sim_space_p = get_sim_space_p(sim, world_chunk_x, world_chunk_y, src->p);
                     Entity *dst = create_new_entity(sim, sim_space_p, src);
+                    if (dst && !has_influence) {
+                        add_sim_entity_influence(sim, dst);
+                    }
                 }
                 
                 WorldChunkEntityBlock *next_block = block->next;
@@ -381,6 +1410,39 @@ void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
             add_chunk_to_free_list(world, world_chunk);
         }
     }
+    
+    // Chunks that were on the border of sim region were blurred without some of their neighbours,
+    // they are updated as if their raw values have changed once all neighbours are in sim
+    for (u32 chunk_idx = 0; chunk_idx < chunk_count; ++chunk_idx) {
+        SimRegionChunk *sim_chunk = sim->chunks + chunk_idx;
+        if (sim_chunk->influence.is_partial) {
+            bool has_all_neighbours = true;
+            for (i32 dy = -1; dy <= 1; ++dy) {
+                for (i32 dx = -1; dx <= 1; ++dx) {
+                    if (!get_chunk(sim, sim_chunk->chunk_x + dx, sim_chunk->chunk_y + dy)) {
+                        has_all_neighbours = false;
+                    }
+                }
+            }
+            if (has_all_neighbours && !(sim_chunk->influence_flags & SIM_INFLUENCE_RAW_CHANGED)) {
+                sim_chunk->influence_flags |= SIM_INFLUENCE_RAW_CHANGED;
+                sim->influence_changed_chunks[sim->influence_changed_count++] = chunk_idx;
+            }
+        }
+    }
+    
+    // Haulers keep their reservations only in their entities, so index state does not have to be stored in world
+    for (u32 hauler_idx = 0; hauler_idx < logistics->hauler_count; ++hauler_idx) {
+        Entity *hauler = sim->entities + logistics->hauler_indices[hauler_idx];
+        EntityID reserved_ids[] = { hauler->haul_source, hauler->haul_destination };
+        for (u32 reserved_idx = 0; reserved_idx < ARRAY_SIZE(reserved_ids); ++reserved_idx) {
+            Entity *reserved = IS_NOT_NULL(reserved_ids[reserved_idx]) ? get_entity_by_id(sim, reserved_ids[reserved_idx]) : 0;
+            if (reserved && is_logistics_entity(reserved)) {
+                u32 available = get_sim_logistics_available(sim, reserved);
+                reserve_sim_logistics(sim, reserved, hauler->carry_amount < available ? hauler->carry_amount : available);
+            }
+        }
+    }
 }
 
 void end_sim(SimRegion *sim, struct WorldState *world_state) {
@@ -398,11 +1460,33 @@ void end_sim(SimRegion *sim, struct WorldState *world_state) {
                 Anchor anchor = {};
                 anchor.chunk_x = chunk_x;
                 anchor.chunk_y = chunk_y;
-                anchor.radius = 5;
+                anchor.radius = world_state->anchor_radius;
+                anchor.entity = src->id;
+                anchor.last_sim_tick = sim->world->tick;
                 world_state->anchors[world_state->anchor_count++] = anchor;
             }
         }
     }
+    
+    // Influence is stored after entities, because packing entities resets it
+    // Chunks that have no entities and no influence are not created, they are loaded with zero influence
+    update_sim_influence(sim);
+    for (u32 chunk_idx = 0; chunk_idx < sim->chunks_count; ++chunk_idx) {
+        SimRegionChunk *sim_chunk = sim->chunks + chunk_idx;
+        ChunkInfluence *influence = &sim_chunk->influence;
+        bool has_influence = influence->is_partial || sim_chunk->first_block.entity_count;
+        for (u32 layer = 0; layer < INFLUENCE_LAYER_SENTINEL; ++layer) {
+            has_influence = has_influence || influence->max[layer] > 0;
+        }
+        if (has_influence) {
+            WorldChunk *world_chunk = get_world_chunk(sim->world, sim->center_chunk_x + sim_chunk->chunk_x, 
+                                                      sim->center_chunk_y + sim_chunk->chunk_y);
+            world_chunk->influence = *influence;
+            world_chunk->has_influence = true;
+            // Chunk may be created here, and it should not be fast-forwarded next time
+            world_chunk->last_packed_tick = sim->world->tick;
+        }
+    }
 }
 
 static void next(SimChunkIterator *iter) {
@@ -543,3 +1627,45 @@ bool is_valid(EntityIterator *iter) {
 void advance(EntityIterator *iter) {
     next(iter);
 }
+
+// Moves to next cell that has points in it, row by row
+static void next(SimRegionGridIterator *iter) {
+    SimRegionGrid *grid = iter->grid;
+    while (iter->idx == iter->cell_end && iter->cell_y <= iter->max_cell_y) {
+        if (++iter->cell_x > iter->max_cell_x) {
+            iter->cell_x = iter->min_cell_x;
+            ++iter->cell_y;
+        }
+        if (iter->cell_y <= iter->max_cell_y) {
+            u32 cell = iter->cell_y * grid->cells_x + iter->cell_x;
+            iter->idx = grid->cell_starts[cell];
+            iter->cell_end = grid->cell_starts[cell + 1];
+        }
+    }
+}
+
+SimRegionGridIterator iterate_grid_in_radius(SimRegionGrid *grid, vec2 p, f32 radius) {
+    SimRegionGridIterator iter = {};
+    iter.grid = grid;
+    iter.min_cell_x = get_grid_cell(p.x - radius, grid->min_x, grid->inv_cell_size, grid->cells_x);
+    iter.max_cell_x = get_grid_cell(p.x + radius, grid->min_x, grid->inv_cell_size, grid->cells_x);
+    i32 min_cell_y = get_grid_cell(p.y - radius, grid->min_y, grid->inv_cell_size, grid->cells_y);
+    iter.max_cell_y = get_grid_cell(p.y + radius, grid->min_y, grid->inv_cell_size, grid->cells_y);
+    // Start before first cell, so next() moves to it
+    iter.cell_x = iter.min_cell_x - 1;
+    iter.cell_y = min_cell_y;
+    if (!grid->point_count) {
+        iter.cell_y = iter.max_cell_y + 1;
+    }
+    next(&iter);
+    return iter;
+}
+
+bool is_valid(SimRegionGridIterator *iter) {
+    return iter->idx < iter->cell_end;
+}
+
+void advance(SimRegionGridIterator *iter) {
+    ++iter->idx;
+    next(iter);
+}
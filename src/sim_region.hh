@@ -34,6 +34,17 @@ struct SimRegionChunk {
     // u16 spatial_occupancy_count;
     // SpatialOccupancy spatial_occupancy[CELLS_IN_CHUNK * CELLS_IN_CHUNK / 2];
     SimRegionChunkEntityBlock first_block;  
+    // Game time that chunk has spent outside of sim regions, game should fast-forward its entities
+    u64 catch_up_ticks;
+    // Raw values are always up to date, blurred ones are updated in update_sim_influence
+    ChunkInfluence influence;
+    u32 influence_flags;
+};
+
+enum {
+    // Raw values have changed, so blurred values of chunk and its neighbours are out of date
+    SIM_INFLUENCE_RAW_CHANGED = 0x1,
+    SIM_INFLUENCE_NEEDS_BLUR  = 0x2,
 };  
 
 struct SimRegionEntityHash {
@@ -41,6 +52,112 @@ struct SimRegionEntityHash {
     EntityID id;
 };
 
+// Pawns are the most numerous moving entities, and updating them one by one
+// with hash lookups and chunk changes on each step does not scale to colony sizes
+// So their movement state is additionally stored in packed arrays, which are updated in batches
+// of SIMD width. Each pawn knows index of its entity in sim entities array, so game can
+// access entity directly
+// Arrays are padded to SIMD width, padding lanes have infinite stop distance and never move
+//
+// Pawns avoid each other with ORCA - each neighbour makes half-plane of velocities that would 
+// lead to collision within time horizon, and pawn picks velocity closest to preferred one that 
+// is outside of all of them. Pawns that already overlap are also pushed apart
+#define SIM_PAWN_BATCH_SIZE 4
+#define SIM_PAWN_RADIUS 0.3f
+// Pawns further than this are not considered neighbours, this is also size of grid cell 
+#define SIM_PAWN_NEIGHBOUR_DISTANCE 2.0f
+#define SIM_PAWN_MAX_NEIGHBOURS 8
+// Points checked when looking for neighbours of pawn in dense crowds
+#define SIM_PAWN_MAX_SCANNED_NEIGHBOURS 32
+// Time in seconds for which pawn velocities are checked for collisions
+#define SIM_PAWN_TIME_HORIZON 1.0f
+// Pawn that has no one to avoid does not look for neighbours in this many next steps - 
+// collision course is checked for whole time horizon, so it is found early enough after that
+#define SIM_PAWN_AVOIDANCE_FREE_STEPS 3
+// Avoidance of pawns is split between jobs of sim work queue, smaller crowds are not worth the wait
+#define SIM_PAWN_AVOIDANCE_MAX_JOB_COUNT 8
+#define SIM_PAWN_AVOIDANCE_MIN_JOB_PAWNS 2048
+struct SimRegionPawns {
+    u32 count;
+    u32 max_count;
+    u32 *entity_indices;
+    f32 *p_x;
+    f32 *p_y;
+    // Where pawn wants to go this step - set by game before calling update_sim_pawns
+    f32 *target_x;
+    f32 *target_y;
+    // Pawn does not move if it is closer than this to target
+    f32 *stop_distance_sq;
+    // Velocity that would take pawn to target, calculated in update_sim_pawns before avoidance
+    f32 *v_x;
+    f32 *v_y;
+    // Same velocities in order of pawn grid, so avoidance reads neighbours from contiguous memory
+    f32 *grid_v_x;
+    f32 *grid_v_y;
+    // How much pawn moves in step after avoidance
+    f32 *step_x;
+    f32 *step_y;
+    // Copied from entities and written back after step
+    u32 *avoidance_free_steps;
+};
+
+// Buildings under construction in sim region. Builders don't touch building themselves - they 
+// only increase builder count and sleep, and progress of all sites is updated by game in single pass
+struct SimRegionConstructionSites {
+    u32 count;
+    u32 max_count;
+    u32 *entity_indices;
+};
+
+// Index of item piles and stockpiles, so haulers don't look for them by scanning entities
+// Entities are kept in buckets by sim chunk and kind - piles by resource kind of their items, 
+// stockpiles in separate bucket since they take any items. Only entities that have something
+// available - items that are not reserved by haulers, or space that is not reserved - are in buckets,
+// so queries never see full stockpiles and empty piles
+// Buckets are linked lists through per-entity arrays, so entities are moved in and out of them in O(1)
+// when items are reserved, picked up or dropped
+// Index is filled when entities are loaded in begin_sim, and reservations of haulers that are in sim 
+// are applied after that. Reservations of haulers that are not in sim are dropped together with their jobs
+#define SIM_LOGISTICS_STOCKPILES RESOURCE_KIND_NONE
+#define SIM_LOGISTICS_KIND_COUNT (RESOURCE_KIND_GOLD + 1)
+#define SIM_LOGISTICS_NULL ((u32)-1)
+struct SimRegionLogistics {
+    // Per sim entity arrays, valid only for logistics entities
+    u32 *available;
+    u32 *bucket_indices;
+    u32 *next_in_bucket;
+    u32 *prev_in_bucket;
+    // First entity index of bucket, buckets of chunk go in row for all kinds 
+    u32 *bucket_heads;
+    // Count of entities in buckets of each kind, so queries for kinds that have nothing are skipped
+    u32 entry_counts[SIM_LOGISTICS_KIND_COUNT];
+    // Pawns that were loaded with haul jobs
+    u32 hauler_count;
+    u32 *hauler_indices;
+};
+
+// Uniform grid over points, used to find neighbours without checking all pairs
+// Grid is built with single counting sort pass: points are counted per cell, counts are turned
+// into cell offsets with prefix sum and points are scattered to their cells - so points of 
+// each cell are stored contiguously, and no per-cell memory is allocated
+// Grid covers bounding box of points. If points are sparse cells are made bigger, so 
+// cell count stays proportional to point count
+struct SimRegionGrid {
+    f32 min_x;
+    f32 min_y;
+    f32 cell_size;
+    f32 inv_cell_size;
+    u32 cells_x;
+    u32 cells_y;
+    // Points of cell are [cell_starts[cell], cell_starts[cell + 1])
+    u32 *cell_starts;
+    u32 point_count;
+    // Points sorted by cell - indices in arrays grid was built from and positions
+    u32 *indices;
+    f32 *p_x;
+    f32 *p_y;
+};
+
 // World is split in simulation regions during updating
 // This game wants ot update all of its regions with equal percision - 
 // so AI plays seem natural and alike real player 
@@ -76,6 +193,8 @@ struct SimRegion {
     MemoryArena *arena;
     // Needed to create ids for new entities
     World *world;
+    // Queue of jobs that update waits for, set after begin_sim. If it is 0 sim is updated on calling thread only
+    WorkQueue *work_queue;
     // Sim region is defined as circle - by center and radius
     // Actually this is rhombus - there is no need in full circle
     i32 center_chunk_x;
@@ -104,7 +223,17 @@ struct SimRegion {
     
     u32 entity_blocks_allocated;
     SimRegionChunkEntityBlock *first_free_entity_block;
-    
+
+    SimRegionPawns pawns;
+    // Grid of pawns built in update_sim_pawns from positions before the step
+    // Can be used for any neighbour queries between pawn updates
+    SimRegionGrid pawn_grid;
+    SimRegionConstructionSites construction_sites;
+    SimRegionLogistics logistics;
+    // Chunks which raw influence has changed since last update_sim_influence
+    u32 influence_changed_count;
+    u32 *influence_changed_chunks;
+
     u32 missing_entity_space;
 };
 
@@ -114,10 +243,32 @@ struct SimRegion {
 // but we want only simulate parts that interest us
 // After simulation is ended, all anchor entities are written in world, 
 // so in next simulation begin we know what parts of the world to simulate
+//
+// Anchors that are far from camera-followed anchor are simulated with lower level of detail
+// Reduced anchors are updated less often with accumulated time step,
+// aggregate anchors are also updated rarely, and their pawns don't walk - they are moved to
+// destination at once and wait for as long as the walk would take
+enum {
+    SIM_LOD_FULL,
+    SIM_LOD_REDUCED,
+    SIM_LOD_AGGREGATE,
+    SIM_LOD_SENTINEL,
+};
+
 struct Anchor {
     i32 chunk_x;
     i32 chunk_y;
     u32 radius;
+    EntityID entity;
+    // Set by game, anchors written in end_sim are in full detail
+    u32 lod;
+    // Time that has passed since anchor was last simulated
+    f32 accumulated_dt;
+    // Tick at which anchor was last simulated. Time after it is stepped over with accumulated_dt,
+    // so chunks of anchor region are only caught up to this tick
+    u64 last_sim_tick;
+    // Clocks that last update of anchor sim region took, used to fit regions in frame budget
+    u64 update_clocks;
 };
 
 void p_to_chunk_coord(vec2 p, i32 *chunk_x, i32 *chunk_y, vec2 *chunk_p_dst = 0);
@@ -140,24 +291,70 @@ SimRegionEntityHash *get_entity_hash(SimRegion *sim, EntityID id);
 Entity *get_entity_by_id(SimRegion *sim, EntityID id);
 // Allocates storage for new entity and puts it into chunk inside sim
 Entity *create_new_entity(SimRegion *sim, vec2 p, Entity *src = 0);
+// Deleted entities stay in sim until end of frame, but they are not written back to world
+void delete_sim_entity(SimRegion *sim, Entity *entity);
+// Adds value of entity to influence maps. Called for entities loaded from world automatically,
+// newly created entities should be added after their kind is set
+// Influence of entity is moved with it in change_entity_position and removed in delete_sim_entity
+void add_sim_entity_influence(SimRegion *sim, Entity *entity);
+// Blurs chunks which influence has changed since last update, together with their neighbours
+// Queries call it themselves, so it only needs to be called to spread the cost
+void update_sim_influence(SimRegion *sim);
+// Blurred value of layer in cell that contains p, 0 if p is outside of sim chunks
+f32 get_sim_influence(SimRegion *sim, u32 layer, vec2 p);
+// Largest blurred value of layer in cells which centers are within radius of p, 0 if there is none
+// Position of center of cell with largest value is written to max_p_dst
+f32 get_sim_influence_max(SimRegion *sim, u32 layer, vec2 p, f32 radius, vec2 *max_p_dst = 0);
 // Sets entity position to p and moves it into new chunk
 // This is somewhat slow to modify position in that way, 
 // but it is more expensive not to use chunks either way
 // So position modifications during frame should be of minimal count
 void change_entity_position(SimRegion *sim, Entity *entity, vec2 p);
+// Adds entity to packed pawn arrays. Called for awake pawns loaded from world automatically,
+// newly created pawns should be added after their kind is set, and woken pawns when they wake up
+void add_sim_pawn(SimRegion *sim, Entity *entity);
+// Adds building to construction sites. Called for buildings loaded from world automatically,
+// newly placed buildings should be added after their flags are set
+void add_sim_construction_site(SimRegion *sim, Entity *entity);
+// Item piles and stockpiles are logistics entities
+inline bool is_logistics_entity(Entity *entity) {
+    return entity->kind == ENTITY_KIND_ITEM_PILE || (entity->flags & ENTITY_FLAG_IS_STOCKPILE);
+}
+// Adds entity to logistics index with its current items or free space available. Called for entities loaded 
+// from world automatically, new piles and stockpiles should be added after their kind, flags and amounts are set
+void add_sim_logistics_entity(SimRegion *sim, Entity *entity);
+// Items in pile or space in stockpile that are not reserved
+u32 get_sim_logistics_available(SimRegion *sim, Entity *entity);
+// Makes items or space unavailable for others, entity leaves index when nothing is available
+void reserve_sim_logistics(SimRegion *sim, Entity *entity, u32 amount);
+// Makes items or space available again - either reservation is cancelled, or items were added to pile
+void release_sim_logistics(SimRegion *sim, Entity *entity, u32 amount);
+// Returns nearest entity of given kind that has something available, 0 if there is none closer than max_distance
+// Chunks are checked in rings around p, and search stops when ring is further than best found entity
+Entity *find_nearest_sim_logistics_entity(SimRegion *sim, u32 logistics_kind, vec2 p, f32 max_distance = F32_INFINITY);
+inline Entity *get_pawn_entity(SimRegion *sim, u32 pawn_idx) {
+    assert(pawn_idx < sim->pawns.count);
+    return sim->entities + sim->pawns.entity_indices[pawn_idx];
+}
+// Moves all pawns towards their targets with speed, avoiding each other if should_avoid is set, 
+// then writes positions back to entities and applies all chunk changes in single pass
+void update_sim_pawns(SimRegion *sim, f32 speed, f32 dt, bool should_avoid);
+// Builds grid of count points. Cell size is minimal, it is increased for sparse points
+void build_sim_region_grid(SimRegionGrid *grid, MemoryArena *arena, const f32 *p_x, const f32 *p_y, u32 count, f32 cell_size);
 // All cell coordinates are sim space, basically floored position
 // @TODO this is very slow function - we can cache its results or 
 // create some structure to accelerate checking
 bool is_cell_occupied(SimRegion *sim, i32 cell_x, i32 cell_y);
 // Objects must have at least single cell in between them - 
-// check if object can be placed
-bool check_spatial_placement(SimRegion *sim, i32 cell_x, i32 cell_y, u32 radius);
+// check if object of given size in cells can be placed with its min corner at cell
+bool check_spatial_placement(SimRegion *sim, i32 cell_x, i32 cell_y, u32 width, u32 height);
 
 // We pass sim as argument because its allocation is done in world_state - 
 // it ususally allocates sims as number of anchors
 // But arena passed here is used to allocate all sim arrays
 // Loads world chunks in given radius around center point
 // All entities from world are decompressed and are made ready for simulation
+// Chunks that were outside of sim regions get catch_up_ticks set, and game should fast-forward them
 void begin_sim(SimRegion *sim, MemoryArena *arena, World *world,
                u32 center_x, u32 center_y, u32 chunk_radius);
 // Iterates over entities inside region and packs them back to world
@@ -180,6 +377,24 @@ struct SimChunkIterator {
 SimChunkIterator iterate_sim_chunks_in_radius(SimRegion *sim, vec2 p, f32 radius);
 SimChunkIterator iterate_sim_chunks(SimRegion *sim, i32 min_chunk_x, i32 min_chunk_y, i32 max_chunk_x, i32 max_chunk_y);
 
+struct SimRegionGridIterator {
+    SimRegionGrid *grid;
+    i32 min_cell_x;
+    i32 max_cell_x;
+    i32 max_cell_y;
+    i32 cell_x;
+    i32 cell_y;
+    // Index of point in sorted grid arrays
+    u32 idx;
+    u32 cell_end;
+};
+
+// Iterates over points in grid cells that overlap square around p
+// Points further than radius are returned too, so caller has to check distance
+SimRegionGridIterator iterate_grid_in_radius(SimRegionGrid *grid, vec2 p, f32 radius);
+bool is_valid(SimRegionGridIterator *iter);
+void advance(SimRegionGridIterator *iter);
+
 // @TODO we way want to add chunk-based circle iteration,
 // or rectangular iteration
 // @TODO this structure can be used in construction of sim regions, where 
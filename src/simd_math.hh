@@ -1,7 +1,16 @@
 #if !defined(SIMD_MATH_HH)
 
 #include "general.hh"
-#include <intrin.h>
+
+// 8 wide lanes need AVX2, so they are only compiled when compiler targets it (-mavx2 or /arch:AVX2)
+// Code that uses them must keep 4 wide path, and both paths must give the same results
+#ifndef SIMD_8X
+#if defined(__AVX2__)
+#define SIMD_8X 1
+#else
+#define SIMD_8X 0
+#endif
+#endif
 
 struct f32_4x {
     union {
@@ -29,6 +38,24 @@ inline f32_4x F32_4x_zero() {
     return result;
 }
 
+// Source must be aligned on 16 bytes - arena allocations are
+inline f32_4x F32_4x_load(f32 *src) {
+    f32_4x result;
+    result.p = _mm_load_ps(src);
+    return result;
+}
+
+// Source can have any alignment
+inline f32_4x F32_4x_loadu(const f32 *src) {
+    f32_4x result;
+    result.p = _mm_loadu_ps(src);
+    return result;
+}
+
+inline void store(f32 *dst, f32_4x a) {
+    _mm_store_ps(dst, a.p);
+}
+
 
 inline f32_4x operator+(f32_4x a, f32_4x b) {
     f32_4x result;
@@ -88,6 +115,48 @@ inline f32_4x Abs(f32_4x a) {
     return result;
 }
 
+inline f32_4x Sqrt(f32_4x a) {
+    f32_4x result;
+    result.p = _mm_sqrt_ps(a.p);
+    return result;
+}
+
+inline f32_4x Rsqrt(f32_4x a) {
+    f32_4x result;
+    result.p = _mm_rsqrt_ps(a.p);
+    return result;
+}
+
+inline f32_4x Min(f32_4x a, f32_4x b) {
+    f32_4x result;
+    result.p = _mm_min_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_4x Max(f32_4x a, f32_4x b) {
+    f32_4x result;
+    result.p = _mm_max_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_4x Floor(f32_4x a) {
+    f32_4x result;
+    result.p = _mm_floor_ps(a.p);
+    return result;
+}
+
+// Picks b where mask is set, a otherwise
+inline f32_4x select(f32_4x a, f32_4x mask, f32_4x b) {
+    f32_4x result;
+    result.p = _mm_blendv_ps(a.p, b.p, mask.p);
+    return result;
+}
+
+inline u32 get_mask(f32_4x a) {
+    u32 result = _mm_movemask_ps(a.p);
+    return result;
+}
+
 inline bool all_true(f32_4x a) {
     bool result = _mm_movemask_ps(a.p) == 0xF;
     return result;
@@ -157,6 +226,490 @@ inline f32_4x operator^(f32_4x a, f32_4x b) {
     return result;
 }
 
+//
+// Integer lanes
+// u32_4x does logical shifts and is used for hashing and random numbers,
+// i32_4x does arithmetic shifts and is used for coordinates
+//
+struct u32_4x {
+    __m128i p;
+};
+
+struct i32_4x {
+    __m128i p;
+};
+
+inline u32_4x U32_4x(u32 all) {
+    u32_4x result;
+    result.p = _mm_set1_epi32((int)all);
+    return result;
+}
+
+inline u32_4x U32_4x(u32 a, u32 b, u32 c, u32 d) {
+    u32_4x result;
+    result.p = _mm_setr_epi32((int)a, (int)b, (int)c, (int)d);
+    return result;
+}
+
+inline u32_4x U32_4x(i32_4x a) {
+    u32_4x result;
+    result.p = a.p;
+    return result;
+}
+
+inline i32_4x I32_4x(i32 all) {
+    i32_4x result;
+    result.p = _mm_set1_epi32(all);
+    return result;
+}
+
+inline i32_4x I32_4x(i32 a, i32 b, i32 c, i32 d) {
+    i32_4x result;
+    result.p = _mm_setr_epi32(a, b, c, d);
+    return result;
+}
+
+inline i32_4x I32_4x(u32_4x a) {
+    i32_4x result;
+    result.p = a.p;
+    return result;
+}
+
+// Source must be aligned on 16 bytes
+inline u32_4x U32_4x_load(u32 *src) {
+    u32_4x result;
+    result.p = _mm_load_si128((__m128i *)src);
+    return result;
+}
+
+// Destination must be aligned on 16 bytes
+inline void store(u32 *dst, u32_4x a) {
+    _mm_store_si128((__m128i *)dst, a.p);
+}
+
+inline u32 get_lane(u32_4x a, u32 idx) {
+    u32 lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, a.p);
+    return lanes[idx];
+}
+
+inline u32_4x operator+(u32_4x a, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_add_epi32(a.p, b.p);
+    return result;
+}
+
+inline u32_4x operator*(u32_4x a, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_mullo_epi32(a.p, b.p);
+    return result;
+}
+
+inline u32_4x operator^(u32_4x a, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_xor_si128(a.p, b.p);
+    return result;
+}
+
+inline u32_4x operator&(u32_4x a, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_and_si128(a.p, b.p);
+    return result;
+}
+
+inline u32_4x operator|(u32_4x a, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_or_si128(a.p, b.p);
+    return result;
+}
+
+inline u32_4x operator<<(u32_4x a, int shift) {
+    u32_4x result;
+    result.p = _mm_slli_epi32(a.p, shift);
+    return result;
+}
+
+inline u32_4x operator>>(u32_4x a, int shift) {
+    u32_4x result;
+    result.p = _mm_srli_epi32(a.p, shift);
+    return result;
+}
+
+inline u32_4x &operator^=(u32_4x &a, u32_4x b) {
+    return (a = (a ^ b));
+}
+
+// Returns mask of lanes that are not zero
+inline f32_4x is_not_zero(u32_4x a) {
+    f32_4x result;
+    result.p = _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(a.p, _mm_setzero_si128()), _mm_set1_epi32(-1)));
+    return result;
+}
+
+inline i32_4x operator+(i32_4x a, i32_4x b) {
+    i32_4x result;
+    result.p = _mm_add_epi32(a.p, b.p);
+    return result;
+}
+
+inline i32_4x operator-(i32_4x a, i32_4x b) {
+    i32_4x result;
+    result.p = _mm_sub_epi32(a.p, b.p);
+    return result;
+}
+
+inline i32_4x operator<<(i32_4x a, int shift) {
+    i32_4x result;
+    result.p = _mm_slli_epi32(a.p, shift);
+    return result;
+}
+
+inline i32_4x operator>>(i32_4x a, int shift) {
+    i32_4x result;
+    result.p = _mm_srai_epi32(a.p, shift);
+    return result;
+}
+
+// Picks b where mask is set, a otherwise
+inline u32_4x select(u32_4x a, f32_4x mask, u32_4x b) {
+    u32_4x result;
+    result.p = _mm_blendv_epi8(a.p, b.p, _mm_castps_si128(mask.p));
+    return result;
+}
+
+inline f32_4x F32_4x(i32_4x a) {
+    f32_4x result;
+    result.p = _mm_cvtepi32_ps(a.p);
+    return result;
+}
+
+inline i32_4x Floor_i32(f32_4x a) {
+    i32_4x result;
+    result.p = _mm_cvttps_epi32(_mm_floor_ps(a.p));
+    return result;
+}
+
+// Maps high 24 bits to [0; 1)
+inline f32_4x unit_f32(u32_4x a) {
+    f32_4x result;
+    result.p = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a.p, 8)), _mm_set1_ps(1.0f / (1 << 24)));
+    return result;
+}
+
+//
+// Random number streams - each lane is independent xorshift32 generator, 
+// so this is four different sequences computed at the speed of one
+//
+struct Entropy_4x {
+    u32_4x state;
+};
+
+// Lane seeds must not be zero
+inline Entropy_4x entropy_4x(u32 a, u32 b, u32 c, u32 d) {
+    assert(a && b && c && d);
+    Entropy_4x result;
+    result.state = U32_4x(a, b, c, d);
+    return result;
+}
+
+inline u32_4x xorshift32_4x(Entropy_4x *entropy) {
+    u32_4x x = entropy->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    entropy->state = x;
+    return x;
+}
+
+inline f32_4x random_4x(Entropy_4x *entropy) {
+    return unit_f32(xorshift32_4x(entropy));
+}
+
+inline f32_4x random_bilateral_4x(Entropy_4x *entropy) {
+    return random_4x(entropy) * F32_4x(2.0f) - F32_4x(1.0f);
+}
+
+#if SIMD_8X
+//
+// 8 wide lanes, same operations as 4 wide ones where they are needed
+//
+struct f32_8x {
+    union {
+        __m256 p;
+        f32 e[8];
+    };
+};
+
+struct u32_8x {
+    __m256i p;
+};
+
+struct i32_8x {
+    __m256i p;
+};
+
+inline f32_8x F32_8x(f32 all) {
+    f32_8x result;
+    result.p = _mm256_set1_ps(all);
+    return result;
+}
+
+inline f32_8x F32_8x_zero() {
+    f32_8x result;
+    result.p = _mm256_setzero_ps();
+    return result;
+}
+
+inline f32_8x operator+(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_add_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x operator-(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_sub_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x operator*(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_mul_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x &operator+=(f32_8x &a, f32_8x b) {
+    return (a = (a + b));
+}
+
+inline f32_8x &operator*=(f32_8x &a, f32_8x b) {
+    return (a = (a * b));
+}
+
+inline f32_8x Min(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_min_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x Max(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_max_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x Floor(f32_8x a) {
+    f32_8x result;
+    result.p = _mm256_floor_ps(a.p);
+    return result;
+}
+
+// Picks b where mask is set, a otherwise
+inline f32_8x select(f32_8x a, f32_8x mask, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_blendv_ps(a.p, b.p, mask.p);
+    return result;
+}
+
+inline u32 get_mask(f32_8x a) {
+    u32 result = _mm256_movemask_ps(a.p);
+    return result;
+}
+
+inline f32_8x operator<(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_cmp_ps(a.p, b.p, _CMP_LT_OQ);
+    return result;
+}
+
+inline f32_8x operator>(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_cmp_ps(a.p, b.p, _CMP_GT_OQ);
+    return result;
+}
+
+inline f32_8x operator&(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_and_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x operator|(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_or_ps(a.p, b.p);
+    return result;
+}
+
+inline f32_8x operator^(f32_8x a, f32_8x b) {
+    f32_8x result;
+    result.p = _mm256_xor_ps(a.p, b.p);
+    return result;
+}
+
+inline u32_8x U32_8x(u32 all) {
+    u32_8x result;
+    result.p = _mm256_set1_epi32((int)all);
+    return result;
+}
+
+// Lanes 0-3 are taken from low and 4-7 from high
+inline u32_8x U32_8x(u32_4x low, u32_4x high) {
+    u32_8x result;
+    result.p = _mm256_inserti128_si256(_mm256_castsi128_si256(low.p), high.p, 1);
+    return result;
+}
+
+inline u32_8x U32_8x(i32_8x a) {
+    u32_8x result;
+    result.p = a.p;
+    return result;
+}
+
+inline i32_8x I32_8x(i32 all) {
+    i32_8x result;
+    result.p = _mm256_set1_epi32(all);
+    return result;
+}
+
+inline i32_8x I32_8x(i32 a, i32 b, i32 c, i32 d, i32 e, i32 f, i32 g, i32 h) {
+    i32_8x result;
+    result.p = _mm256_setr_epi32(a, b, c, d, e, f, g, h);
+    return result;
+}
+
+inline i32_8x I32_8x(u32_8x a) {
+    i32_8x result;
+    result.p = a.p;
+    return result;
+}
+
+inline u32 get_lane(u32_8x a, u32 idx) {
+    u32 lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, a.p);
+    return lanes[idx];
+}
+
+inline u32_8x operator+(u32_8x a, u32_8x b) {
+    u32_8x result;
+    result.p = _mm256_add_epi32(a.p, b.p);
+    return result;
+}
+
+inline u32_8x operator*(u32_8x a, u32_8x b) {
+    u32_8x result;
+    result.p = _mm256_mullo_epi32(a.p, b.p);
+    return result;
+}
+
+inline u32_8x operator^(u32_8x a, u32_8x b) {
+    u32_8x result;
+    result.p = _mm256_xor_si256(a.p, b.p);
+    return result;
+}
+
+inline u32_8x operator&(u32_8x a, u32_8x b) {
+    u32_8x result;
+    result.p = _mm256_and_si256(a.p, b.p);
+    return result;
+}
+
+inline u32_8x operator<<(u32_8x a, int shift) {
+    u32_8x result;
+    result.p = _mm256_slli_epi32(a.p, shift);
+    return result;
+}
+
+inline u32_8x operator>>(u32_8x a, int shift) {
+    u32_8x result;
+    result.p = _mm256_srli_epi32(a.p, shift);
+    return result;
+}
+
+inline u32_8x &operator^=(u32_8x &a, u32_8x b) {
+    return (a = (a ^ b));
+}
+
+// Returns mask of lanes that are not zero
+inline f32_8x is_not_zero(u32_8x a) {
+    f32_8x result;
+    result.p = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(a.p, _mm256_setzero_si256()), _mm256_set1_epi32(-1)));
+    return result;
+}
+
+inline i32_8x operator+(i32_8x a, i32_8x b) {
+    i32_8x result;
+    result.p = _mm256_add_epi32(a.p, b.p);
+    return result;
+}
+
+inline i32_8x operator-(i32_8x a, i32_8x b) {
+    i32_8x result;
+    result.p = _mm256_sub_epi32(a.p, b.p);
+    return result;
+}
+
+inline i32_8x operator<<(i32_8x a, int shift) {
+    i32_8x result;
+    result.p = _mm256_slli_epi32(a.p, shift);
+    return result;
+}
+
+inline i32_8x operator>>(i32_8x a, int shift) {
+    i32_8x result;
+    result.p = _mm256_srai_epi32(a.p, shift);
+    return result;
+}
+
+inline f32_8x F32_8x(i32_8x a) {
+    f32_8x result;
+    result.p = _mm256_cvtepi32_ps(a.p);
+    return result;
+}
+
+inline i32_8x Floor_i32(f32_8x a) {
+    i32_8x result;
+    result.p = _mm256_cvttps_epi32(_mm256_floor_ps(a.p));
+    return result;
+}
+
+// Maps high 24 bits to [0; 1)
+inline f32_8x unit_f32(u32_8x a) {
+    f32_8x result;
+    result.p = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(a.p, 8)), _mm256_set1_ps(1.0f / (1 << 24)));
+    return result;
+}
+
+// Eight independent xorshift32 generators, same as Entropy_4x
+struct Entropy_8x {
+    u32_8x state;
+};
+
+// Lane seeds must not be zero
+inline Entropy_8x entropy_8x(u32_4x low, u32_4x high) {
+    assert(all_true(is_not_zero(low)) && all_true(is_not_zero(high)));
+    Entropy_8x result;
+    result.state = U32_8x(low, high);
+    return result;
+}
+
+inline u32_8x xorshift32_8x(Entropy_8x *entropy) {
+    u32_8x x = entropy->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    entropy->state = x;
+    return x;
+}
+
+inline f32_8x random_8x(Entropy_8x *entropy) {
+    return unit_f32(xorshift32_8x(entropy));
+}
+
+inline f32_8x random_bilateral_8x(Entropy_8x *entropy) {
+    return random_8x(entropy) * F32_8x(2.0f) - F32_8x(1.0f);
+}
+#endif
+
 typedef vec3G<f32_4x> vec3_4x;
 typedef vec4G<f32_4x> vec4_4x;
 
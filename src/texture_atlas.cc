@@ -0,0 +1,152 @@
+#include "texture_atlas.hh"
+
+#include "mips.hh"
+
+static u32 get_texture_padding(u32 width, u32 height) {
+    u32 max_padded_size = RENDERER_TEXTURE_DIM - 2 * TEXTURE_ATLAS_PADDING;
+    return width <= max_padded_size && height <= max_padded_size ? TEXTURE_ATLAS_PADDING : 0;
+}
+
+static u32 align_texture_size(u32 size) {
+    return (size + TEXTURE_ATLAS_ALIGNMENT - 1) & ~(TEXTURE_ATLAS_ALIGNMENT - 1);
+}
+
+static bool pack_in_layer(TextureAtlasLayer *layer, u32 slot_width, u32 slot_height, u32 *slot_x, u32 *slot_y) {
+    TextureAtlasShelf *best_shelf = 0;
+    for (u32 shelf_idx = 0; shelf_idx < layer->shelf_count; ++shelf_idx) {
+        TextureAtlasShelf *shelf = layer->shelves + shelf_idx;
+        if (shelf->height >= slot_height && shelf->used_width + slot_width <= RENDERER_TEXTURE_DIM &&
+            (!best_shelf || shelf->height < best_shelf->height)) {
+            best_shelf = shelf;
+        }
+    }
+    // Texture that is much smaller than shelf would waste most of its height, so new shelf is preferred
+    bool can_add_shelf = layer->shelf_count < TEXTURE_ATLAS_MAX_SHELF_COUNT && layer->used_height + slot_height <= RENDERER_TEXTURE_DIM;
+    if (can_add_shelf && (!best_shelf || best_shelf->height >= slot_height * 2)) {
+        best_shelf = layer->shelves + layer->shelf_count++;
+        best_shelf->y = layer->used_height;
+        best_shelf->height = slot_height;
+        best_shelf->used_width = 0;
+        layer->used_height += slot_height;
+    }
+
+    if (best_shelf) {
+        *slot_x = best_shelf->used_width;
+        *slot_y = best_shelf->y;
+        best_shelf->used_width += slot_width;
+    }
+    return best_shelf != 0;
+}
+
+static void evict_layer(TextureAtlasLayer *layer) {
+    layer->shelf_count = 0;
+    layer->used_height = 0;
+    layer->texture_count = 0;
+    layer->texture_area = 0;
+    layer->pinned_texture_count = 0;
+    ++layer->generation;
+}
+
+void texture_atlas_reset(TextureAtlas *atlas) {
+    for (u32 layer_idx = 0; layer_idx < atlas->layer_count; ++layer_idx) {
+        evict_layer(atlas->layers + layer_idx);
+    }
+}
+
+bool texture_atlas_pack(TextureAtlas *atlas, Texture *texture, u32 width, u32 height, bool is_pinned) {
+    assert(width && height && width <= RENDERER_TEXTURE_DIM && height <= RENDERER_TEXTURE_DIM);
+    u32 padding = get_texture_padding(width, height);
+    u32 slot_width = padding ? align_texture_size(width) + 2 * padding : RENDERER_TEXTURE_DIM;
+    u32 slot_height = padding ? align_texture_size(height) + 2 * padding : RENDERER_TEXTURE_DIM;
+    u32 slot_x = 0;
+    u32 slot_y = 0;
+    TextureAtlasLayer *layer = 0;
+    for (u32 layer_idx = 0; layer_idx < atlas->layer_count && !layer; ++layer_idx) {
+        if (pack_in_layer(atlas->layers + layer_idx, slot_width, slot_height, &slot_x, &slot_y)) {
+            layer = atlas->layers + layer_idx;
+        }
+    }
+    if (!layer && atlas->layer_count < TEXTURE_ATLAS_MAX_LAYER_COUNT) {
+        layer = atlas->layers + atlas->layer_count++;
+        bool is_packed = pack_in_layer(layer, slot_width, slot_height, &slot_x, &slot_y);
+        assert(is_packed);
+    }
+    if (!layer) {
+        TextureAtlasLayer *evicted = 0;
+        for (u32 layer_idx = 0; layer_idx < atlas->layer_count; ++layer_idx) {
+            TextureAtlasLayer *test = atlas->layers + layer_idx;
+            if (!test->pinned_texture_count && test->last_used_frame < atlas->frame_index &&
+                (!evicted || test->last_used_frame < evicted->last_used_frame)) {
+                evicted = test;
+            }
+        }
+        if (evicted) {
+            evict_layer(evicted);
+            ++atlas->eviction_count;
+            layer = evicted;
+            bool is_packed = pack_in_layer(layer, slot_width, slot_height, &slot_x, &slot_y);
+            assert(is_packed);
+        }
+    }
+
+    if (layer) {
+        ++layer->texture_count;
+        layer->texture_area += width * height;
+        layer->pinned_texture_count += is_pinned;
+        layer->last_used_frame = atlas->frame_index;
+        texture->index = (u32)(layer - atlas->layers);
+        texture->width = (u16)width;
+        texture->height = (u16)height;
+        texture->x = (u16)(slot_x + padding);
+        texture->y = (u16)(slot_y + padding);
+        texture->generation = layer->generation;
+    }
+    return layer != 0;
+}
+
+bool texture_atlas_use(TextureAtlas *atlas, Texture texture) {
+    assert(texture.index < atlas->layer_count);
+    TextureAtlasLayer *layer = atlas->layers + texture.index;
+    bool result = layer->generation == texture.generation;
+    if (result) {
+        layer->last_used_frame = atlas->frame_index;
+    }
+    return result;
+}
+
+f32 texture_atlas_get_occupancy(TextureAtlas *atlas) {
+    u64 texture_area = 0;
+    for (u32 layer_idx = 0; layer_idx < atlas->layer_count; ++layer_idx) {
+        texture_area += atlas->layers[layer_idx].texture_area;
+    }
+    f32 result = 0;
+    if (atlas->layer_count) {
+        result = (f32)texture_area / ((f32)atlas->layer_count * RENDERER_TEXTURE_DIM * RENDERER_TEXTURE_DIM);
+    }
+    return result;
+}
+
+TextureAtlasLevel get_texture_atlas_level(MemoryArena *arena, Texture texture, void *mipmaps, u32 level) {
+    MipIterator src = iterate_mips(texture.width, texture.height);
+    for (MipIterator iter = src; is_valid(&iter) && iter.level <= level; advance(&iter)) {
+        src = iter;
+    }
+    u32 padding = get_texture_padding(texture.width, texture.height) >> level;
+    TextureAtlasLevel result;
+    result.x = (texture.x >> level) - padding;
+    result.y = (texture.y >> level) - padding;
+    result.width = src.width + 2 * padding;
+    result.height = src.height + 2 * padding;
+    result.pixels = alloc_arr(arena, result.width * result.height, u32, false);
+
+    u32 *src_pixels = (u32 *)mipmaps + src.pixel_offset;
+    for (u32 y = 0; y < result.height; ++y) {
+        // Padding texels repeat closest edge texel of texture
+        u32 src_y = y < padding ? 0 : y - padding < src.height ? y - padding : src.height - 1;
+        for (u32 x = 0; x < result.width; ++x) {
+            u32 src_x = x < padding ? 0 : x - padding < src.width ? x - padding : src.width - 1;
+            result.pixels[y * result.width + x] = src_pixels[src_y * src.width + src_x];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,84 @@
+//
+// Texture atlas
+// Packs textures into layers of renderer texture array, so small sprites don't take whole layer each
+// Layer is split into shelves - rows of textures that are placed left to right. Texture goes to shelf
+// with the smallest height it fits in, or new shelf is opened below the last one
+//
+// Textures are not freed one by one. When all layers are full, layer that was not used for the longest
+// time is evicted as a whole and textures are packed in it again. Texture knows generation of its layer,
+// so texture that was evicted can be found and uploaded again
+//
+// Each texture is surrounded with padding made of copies of its edge texels, and is placed at position aligned
+// to TEXTURE_ATLAS_ALIGNMENT. Renderer keeps only TEXTURE_ATLAS_MIP_COUNT mip levels, in which texture
+// starts at whole texel and still has at least one texel of padding, so filtering doesn't mix neighbouring textures
+// Textures that can't fit in layer with padding take whole layer
+//
+#if !defined(TEXTURE_ATLAS_HH)
+
+#include "renderer.hh"
+
+#define TEXTURE_ATLAS_ALIGNMENT 16
+#define TEXTURE_ATLAS_PADDING TEXTURE_ATLAS_ALIGNMENT
+#define TEXTURE_ATLAS_MIP_COUNT 5
+#define TEXTURE_ATLAS_MAX_LAYER_COUNT 64
+#define TEXTURE_ATLAS_MAX_SHELF_COUNT (RENDERER_TEXTURE_DIM / TEXTURE_ATLAS_ALIGNMENT)
+
+CT_ASSERT((TEXTURE_ATLAS_PADDING >> (TEXTURE_ATLAS_MIP_COUNT - 1)) >= 1);
+
+struct TextureAtlasShelf {
+    u32 y;
+    u32 height;
+    u32 used_width;
+};
+
+struct TextureAtlasLayer {
+    u32 shelf_count;
+    TextureAtlasShelf shelves[TEXTURE_ATLAS_MAX_SHELF_COUNT];
+    // Shelves are placed from top to bottom
+    u32 used_height;
+    u32 texture_count;
+    // Texels of textures without padding
+    u32 texture_area;
+    // Layers with pinned textures are never evicted
+    u32 pinned_texture_count;
+    u64 last_used_frame;
+    // Incremented on eviction, textures of other generations are not in layer anymore
+    u32 generation;
+};
+
+struct TextureAtlas {
+    u64 frame_index;
+    // Layers that ever had textures packed in them. Backend needs storage for this many layers
+    u32 layer_count;
+    TextureAtlasLayer layers[TEXTURE_ATLAS_MAX_LAYER_COUNT];
+    u32 eviction_count;
+};
+
+// Evicts all layers, textures created before have to be created again
+void texture_atlas_reset(TextureAtlas *atlas);
+// Layers used in current frame are not evicted, because commands of frame reference them
+inline void texture_atlas_begin_frame(TextureAtlas *atlas) {
+    ++atlas->frame_index;
+}
+// Sets index, position and generation of texture of given size. New layer is taken when texture does not fit
+// in used ones, and least recently used layer is evicted when all are taken. Returns false if all layers were used in this frame
+bool texture_atlas_pack(TextureAtlas *atlas, Texture *texture, u32 width, u32 height, bool is_pinned = false);
+// Marks layer of texture as used in current frame. Returns false if texture was evicted
+bool texture_atlas_use(TextureAtlas *atlas, Texture texture);
+// Part of layers area taken by textures without padding, in 0..1
+f32 texture_atlas_get_occupancy(TextureAtlas *atlas);
+
+// Region of layer mip level that is written when texture is uploaded - texture with its padding
+struct TextureAtlasLevel {
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+    u32 *pixels;
+};
+
+// Pixels are allocated in arena. Levels that texture does not have are made from its last one
+TextureAtlasLevel get_texture_atlas_level(MemoryArena *arena, Texture texture, void *mipmaps, u32 level);
+
+#define TEXTURE_ATLAS_HH 1
+#endif
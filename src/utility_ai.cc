@@ -0,0 +1,85 @@
+#include "utility_ai.hh"
+
+u32 add_utility_action(UtilityEvaluator *utility, f32 weight) {
+    assert(utility->action_count < UTILITY_MAX_ACTIONS);
+    u32 action_idx = utility->action_count++;
+    UtilityAction *action = utility->actions + action_idx;
+    *action = {};
+    action->weight = weight;
+    return action_idx;
+}
+
+void add_utility_consideration(UtilityEvaluator *utility, u32 action_idx, u32 input, UtilityCurve curve) {
+    assert(action_idx < utility->action_count && input < UTILITY_MAX_INPUTS);
+    UtilityAction *action = utility->actions + action_idx;
+    assert(action->consideration_count < UTILITY_MAX_CONSIDERATIONS);
+    UtilityConsideration *consideration = action->considerations + action->consideration_count++;
+    consideration->input = input;
+    consideration->curve = curve;
+}
+
+void begin_utility_evaluation(UtilityEvaluator *utility, MemoryArena *arena, u32 pawn_count) {
+    CT_ASSERT(IS_POW2(UTILITY_BATCH_SIZE));
+    utility->pawn_count = pawn_count;
+    utility->padded_pawn_count = (pawn_count + UTILITY_BATCH_SIZE - 1) & ~(UTILITY_BATCH_SIZE - 1);
+    utility->inputs = alloc_arr(arena, (utility->action_count * UTILITY_MAX_INPUTS * utility->padded_pawn_count), f32);
+    utility->best_scores = alloc_arr(arena, utility->padded_pawn_count, f32, false);
+    utility->best_actions = alloc_arr(arena, utility->padded_pawn_count, u32, false);
+}
+
+f32 evaluate_utility_curve(UtilityCurve curve, f32 x) {
+    f32 y = ((curve.c3 * x + curve.c2) * x + curve.c1) * x + curve.c0;
+    return Clamp(y, 0.0f, 1.0f);
+}
+
+struct UtilityConsideration_4x {
+    f32 *inputs;
+    f32_4x c0;
+    f32_4x c1;
+    f32_4x c2;
+    f32_4x c3;
+};
+
+void evaluate_utility(UtilityEvaluator *utility) {
+    TIMED_FUNCTION();
+    // Coefficients are broadcast once, so batch loop only loads inputs
+    UtilityConsideration_4x considerations[UTILITY_MAX_ACTIONS][UTILITY_MAX_CONSIDERATIONS];
+    f32_4x weights[UTILITY_MAX_ACTIONS];
+    for (u32 action_idx = 0; action_idx < utility->action_count; ++action_idx) {
+        UtilityAction *action = utility->actions + action_idx;
+        weights[action_idx] = F32_4x(action->weight);
+        for (u32 consideration_idx = 0; consideration_idx < action->consideration_count; ++consideration_idx) {
+            UtilityConsideration *consideration = action->considerations + consideration_idx;
+            UtilityConsideration_4x *dst = &considerations[action_idx][consideration_idx];
+            dst->inputs = get_utility_inputs(utility, action_idx, consideration->input);
+            dst->c0 = F32_4x(consideration->curve.c0);
+            dst->c1 = F32_4x(consideration->curve.c1);
+            dst->c2 = F32_4x(consideration->curve.c2);
+            dst->c3 = F32_4x(consideration->curve.c3);
+        }
+    }
+    
+    f32_4x zero = F32_4x_zero();
+    f32_4x one = F32_4x(1.0f);
+    for (u32 first_pawn = 0; first_pawn < utility->padded_pawn_count; first_pawn += UTILITY_BATCH_SIZE) {
+        // Scores are never negative, so first action always wins over initial score
+        f32_4x best_score = F32_4x(-1.0f);
+        f32_4x best_action = zero;
+        for (u32 action_idx = 0; action_idx < utility->action_count; ++action_idx) {
+            f32_4x score = weights[action_idx];
+            u32 consideration_count = utility->actions[action_idx].consideration_count;
+            for (u32 consideration_idx = 0; consideration_idx < consideration_count; ++consideration_idx) {
+                UtilityConsideration_4x *consideration = &considerations[action_idx][consideration_idx];
+                f32_4x x = F32_4x_load(consideration->inputs + first_pawn);
+                f32_4x y = ((consideration->c3 * x + consideration->c2) * x + consideration->c1) * x + consideration->c0;
+                score *= Min(Max(y, zero), one);
+            }
+            // Ties go to action that was added first
+            f32_4x is_better = score > best_score;
+            best_score = select(best_score, is_better, score);
+            best_action = select(best_action, is_better, F32_4x((f32)action_idx));
+        }
+        store(utility->best_scores + first_pawn, best_score);
+        store(utility->best_actions + first_pawn, U32_4x(Floor_i32(best_action)));
+    }
+}
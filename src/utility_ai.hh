@@ -0,0 +1,102 @@
+//
+// Utility AI scores candidate actions of pawns and picks the best one for each pawn
+// Action has weight and list of considerations. Consideration maps single input in range 0-1 
+// through response curve to value in range 0-1, and action score is weight multiplied by values
+// of all its considerations - so any consideration that gives 0 vetoes action
+//
+// Curves are cubic polynomials clamped to 0-1. This covers linear, quadratic, inverted and smoothstep
+// responses, and costs 3 multiply-adds without any branches on curve type
+//
+// Inputs are stored in SoA form - for each action and its input slot there is array over pawns.
+// Scores are evaluated in batches of 4 pawns, curve coefficients are broadcast once per evaluation,
+// and best action is kept with compare and blend, so there are no branches that depend on scores
+//
+#if !defined(UTILITY_AI_HH)
+
+#include "lib.hh"
+
+#define UTILITY_MAX_ACTIONS 8
+#define UTILITY_MAX_CONSIDERATIONS 4
+// Each action has its own input slots, considerations of action choose which of them they read
+#define UTILITY_MAX_INPUTS 4
+#define UTILITY_BATCH_SIZE 4
+
+// y = c0 + c1 * x + c2 * x^2 + c3 * x^3, clamped to 0-1
+struct UtilityCurve {
+    f32 c0;
+    f32 c1;
+    f32 c2;
+    f32 c3;
+};
+
+inline UtilityCurve utility_curve_linear(f32 slope, f32 offset) {
+    UtilityCurve result = {};
+    result.c0 = offset;
+    result.c1 = slope;
+    return result;
+}
+
+inline UtilityCurve utility_curve_quadratic(f32 scale, f32 offset) {
+    UtilityCurve result = {};
+    result.c0 = offset;
+    result.c2 = scale;
+    return result;
+}
+
+// Goes from 0 to 1 with zero slope at both ends, or from 1 to 0 if inverted
+inline UtilityCurve utility_curve_smoothstep(bool inverted = false) {
+    UtilityCurve result = {};
+    result.c2 = 3.0f;
+    result.c3 = -2.0f;
+    if (inverted) {
+        result.c0 = 1.0f;
+        result.c2 = -3.0f;
+        result.c3 = 2.0f;
+    }
+    return result;
+}
+
+struct UtilityConsideration {
+    u32 input;
+    UtilityCurve curve;
+};
+
+struct UtilityAction {
+    f32 weight;
+    u32 consideration_count;
+    UtilityConsideration considerations[UTILITY_MAX_CONSIDERATIONS];
+};
+
+struct UtilityEvaluator {
+    u32 action_count;
+    UtilityAction actions[UTILITY_MAX_ACTIONS];
+    
+    u32 pawn_count;
+    // Pawn count rounded up to batch size, padding lanes have all inputs 0
+    u32 padded_pawn_count;
+    // [action][input][pawn]
+    f32 *inputs;
+    f32 *best_scores;
+    u32 *best_actions;
+};
+
+// Actions get indices in order of addition
+u32 add_utility_action(UtilityEvaluator *utility, f32 weight);
+void add_utility_consideration(UtilityEvaluator *utility, u32 action, u32 input, UtilityCurve curve);
+// Allocates arrays for pawn_count pawns, all inputs are 0
+void begin_utility_evaluation(UtilityEvaluator *utility, MemoryArena *arena, u32 pawn_count);
+inline f32 *get_utility_inputs(UtilityEvaluator *utility, u32 action, u32 input) {
+    assert(action < utility->action_count && input < UTILITY_MAX_INPUTS);
+    return utility->inputs + (action * UTILITY_MAX_INPUTS + input) * utility->padded_pawn_count;
+}
+inline void set_utility_input(UtilityEvaluator *utility, u32 action, u32 input, u32 pawn, f32 value) {
+    assert(pawn < utility->pawn_count);
+    get_utility_inputs(utility, action, input)[pawn] = value;
+}
+// Fills best_actions and best_scores. If all actions score 0 for pawn, its best action is 0
+void evaluate_utility(UtilityEvaluator *utility);
+// Scalar version of single curve, for debugging and tools
+f32 evaluate_utility_curve(UtilityCurve curve, f32 x);
+
+#define UTILITY_AI_HH 1
+#endif
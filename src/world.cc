@@ -18,7 +18,7 @@ static WorldChunk **get_world_chunk_internal(World *world, i32 chunk_x, i32 chun
     return chunk;
 }
 
-WorldChunk *get_world_chunk(World *world, i32 chunk_x, i32 chunk_y) {
+static WorldChunk *get_or_create_world_chunk_internal(World *world, i32 chunk_x, i32 chunk_y) {
     WorldChunk **chunk_ptr = get_world_chunk_internal(world, chunk_x, chunk_y);
     WorldChunk *result = *chunk_ptr;
     if (!result) {
@@ -31,9 +31,26 @@ WorldChunk *get_world_chunk(World *world, i32 chunk_x, i32 chunk_y) {
     return result;
 }
 
+static void wait_for_chunk_generation(World *world, i32 chunk_x, i32 chunk_y);
+
+WorldChunk *get_world_chunk(World *world, i32 chunk_x, i32 chunk_y) {
+    WorldChunk *result = *get_world_chunk_internal(world, chunk_x, chunk_y);
+    if (!result) {
+        // Chunk can be missing either because it is empty or because it was not generated yet
+        // Generation adds chunks to hash, so lookup is repeated 
+        wait_for_chunk_generation(world, chunk_x, chunk_y);
+        result = get_or_create_world_chunk_internal(world, chunk_x, chunk_y);
+    }
+    return result;
+}
+
 WorldChunk *remove_world_chunk(World *world, i32 chunk_x, i32 chunk_y) {
     WorldChunk *result = 0;
     WorldChunk **chunk_ptr = get_world_chunk_internal(world, chunk_x, chunk_y);
+    if (!*chunk_ptr) {
+        wait_for_chunk_generation(world, chunk_x, chunk_y);
+        chunk_ptr = get_world_chunk_internal(world, chunk_x, chunk_y);
+    }
     if (*chunk_ptr) {
         result = *chunk_ptr;
         *chunk_ptr = (*chunk_ptr)->next;
@@ -67,6 +84,9 @@ void pack_entity_into_chunk(World *world, WorldChunk *chunk, Entity *src) {
     *(Entity *)dst = *src;
     block->entity_data_size += pack_size;
     block->ids[block->entity_count++] = src->id;
+    chunk->last_packed_tick = world->tick;
+    // Only sim regions know influence of entities, so they set it after packing
+    chunk->has_influence = false;
 }
 
 void pack_entity_into_world(World *world, i32 chunk_x, i32 chunk_y, Entity *src) {
@@ -119,6 +139,208 @@ void add_entity_block_to_free_list(World *world, WorldChunkEntityBlock *block) {
     LLIST_ADD(world->first_free_entity_block, block);
 }
 
+void world_init(World *world, MemoryArena *arena, u32 seed, WorkQueue *work_queue) {
+    world->arena = arena;
+    world->max_entity_id = 1;
+    world->seed = seed;
+    world->work_queue = work_queue;
+    ChunkGenerationHash *hash = &world->chunk_generation_hash;
+    hash->capacity = CHUNK_GENERATION_HASH_INITIAL_SIZE;
+    hash->entries = alloc_arr(arena, hash->capacity, ChunkGenerationHashEntry);
+}
+
+static ChunkGenerationHashEntry *get_chunk_generation_entry(ChunkGenerationHash *hash, i32 chunk_x, i32 chunk_y) {
+    ChunkGenerationHashEntry *result = 0;
+    u32 hash_mask = hash->capacity - 1;
+    // Table is never full, so there is always empty entry that ends probe chain
+    for (u32 hash_idx = hash_chunk_location(chunk_x, chunk_y) & hash_mask;; hash_idx = (hash_idx + 1) & hash_mask) {
+        ChunkGenerationHashEntry *test = hash->entries + hash_idx;
+        if (test->state == CHUNK_GENERATION_STATE_NONE || 
+            (test->chunk_x == chunk_x && test->chunk_y == chunk_y)) {
+            result = test;
+            break;
+        }
+    }
+    return result;
+}
+
+static ChunkGenerationHashEntry *add_chunk_generation_entry(World *world, i32 chunk_x, i32 chunk_y) {
+    ChunkGenerationHash *hash = &world->chunk_generation_hash;
+    if ((hash->count + 1) * 100 > hash->capacity * CHUNK_GENERATION_HASH_MAX_LOAD_PERCENT) {
+        // Old entries are left in arena, same as order hash
+        ChunkGenerationHash old = *hash;
+        hash->capacity = old.capacity * 2;
+        hash->entries = alloc_arr(world->arena, hash->capacity, ChunkGenerationHashEntry);
+        for (u32 entry_idx = 0; entry_idx < old.capacity; ++entry_idx) {
+            ChunkGenerationHashEntry *entry = old.entries + entry_idx;
+            if (entry->state != CHUNK_GENERATION_STATE_NONE) {
+                *get_chunk_generation_entry(hash, entry->chunk_x, entry->chunk_y) = *entry;
+            }
+        }
+    }
+    
+    ChunkGenerationHashEntry *entry = get_chunk_generation_entry(hash, chunk_x, chunk_y);
+    assert(entry->state == CHUNK_GENERATION_STATE_NONE);
+    entry->chunk_x = chunk_x;
+    entry->chunk_y = chunk_y;
+    ++hash->count;
+    return entry;
+}
+
+// Returns false if other thread has already started generation
+static bool try_to_generate_world_chunk(WorldGenerationJob *job) {
+    bool result = false;
+    if (interlocked_compare_exchange(&job->is_started, 1, 0) == 0) {
+        generate_world_chunk(job);
+        // Entities must be visible to main thread before it sees job as generated
+        interlocked_exchange(&job->is_generated, 1);
+        result = true;
+    }
+    return result;
+}
+
+static WORK_QUEUE_CALLBACK(generate_world_chunk_work) {
+    WorldGenerationJob *job = (WorldGenerationJob *)data;
+    try_to_generate_world_chunk(job);
+    interlocked_exchange(&job->is_finished, 1);
+}
+
+// Returns false if generation could not be queued this time
+// Chunk that is needed now is generated on calling thread if queue is full
+static bool request_chunk_generation(World *world, i32 chunk_x, i32 chunk_y, bool is_needed_now = false) {
+    bool result = true;
+    ChunkGenerationHashEntry *entry = get_chunk_generation_entry(&world->chunk_generation_hash, chunk_x, chunk_y);
+    if (entry->state == CHUNK_GENERATION_STATE_NONE) {
+        WorldGenerationJob *job = world->first_free_generation_job;
+        if (!job) {
+            ++world->generation_jobs_allocated;
+            job = alloc_struct(world->arena, WorldGenerationJob, false);
+        } else {
+            LLIST_POP(world->first_free_generation_job);
+        }
+        job->seed = world->seed;
+        job->chunk_x = chunk_x;
+        job->chunk_y = chunk_y;
+        job->is_started = false;
+        job->is_generated = false;
+        job->is_finished = false;
+        job->entity_count = 0;
+        job->next = 0;
+        
+        if (world->work_queue) {
+            result = add_work_queue_entry(world->work_queue, generate_world_chunk_work, job);
+        }
+        if (!world->work_queue || (!result && is_needed_now)) {
+            generate_world_chunk_work(job);
+            result = true;
+        }
+        
+        if (result) {
+            if (world->last_generation_job) {
+                world->last_generation_job->next = job;
+            } else {
+                world->first_generation_job = job;
+            }
+            world->last_generation_job = job;
+            if (!world->first_unintegrated_generation_job) {
+                world->first_unintegrated_generation_job = job;
+            }
+            ++world->generation_jobs_in_flight;
+            // Entry pointer is invalidated if hash grows
+            entry = add_chunk_generation_entry(world, chunk_x, chunk_y);
+            entry->state = CHUNK_GENERATION_STATE_QUEUED;
+            entry->job = job;
+        } else {
+            LLIST_ADD(world->first_free_generation_job, job);
+        }
+    }
+    return result;
+}
+
+void prefetch_world_chunks(World *world, i32 center_chunk_x, i32 center_chunk_y, u32 chunk_radius) {
+    TIMED_FUNCTION();
+    i32 radius = (i32)chunk_radius;
+    for (i32 dy = -radius; dy <= radius; ++dy) {
+        for (i32 dx = -radius; dx <= radius; ++dx) {
+            // Sim regions are rhombus-shaped
+            if (Abs(dx) + Abs(dy) <= radius) {
+                if (!request_chunk_generation(world, center_chunk_x + dx, center_chunk_y + dy)) {
+                    // Queue is full - remaining chunks are requested on next frames
+                    goto end;
+                }
+            }
+        }
+    }
+    end: ;
+}
+
+static void integrate_generation_job(World *world, WorldGenerationJob *job) {
+    ChunkGenerationHashEntry *entry = get_chunk_generation_entry(&world->chunk_generation_hash, job->chunk_x, job->chunk_y);
+    assert(entry->state == CHUNK_GENERATION_STATE_QUEUED);
+    entry->state = CHUNK_GENERATION_STATE_GENERATED;
+    entry->job = 0;
+    if (job->entity_count) {
+        WorldChunk *chunk = get_or_create_world_chunk_internal(world, job->chunk_x, job->chunk_y);
+        for (u32 entity_idx = 0; entity_idx < job->entity_count; ++entity_idx) {
+            Entity *entity = job->entities + entity_idx;
+            entity->id = get_new_id(world);
+            pack_entity_into_chunk(world, chunk, entity);
+        }
+    }
+    ++world->chunks_generated;
+    --world->generation_jobs_in_flight;
+}
+
+void integrate_generated_world_chunks(World *world) {
+    TIMED_FUNCTION();
+    while (world->first_generation_job && world->first_generation_job->is_finished) {
+        WorldGenerationJob *job = world->first_generation_job;
+        world->first_generation_job = job->next;
+        if (!world->first_generation_job) {
+            world->last_generation_job = 0;
+        }
+        if (job == world->first_unintegrated_generation_job) {
+            integrate_generation_job(world, job);
+            world->first_unintegrated_generation_job = job->next;
+        }
+        LLIST_ADD(world->first_free_generation_job, job);
+    }
+}
+
+void complete_world_generation(World *world) {
+    TIMED_FUNCTION();
+    if (world->work_queue) {
+        complete_all_work(world->work_queue);
+    }
+    integrate_generated_world_chunks(world);
+    assert(!world->first_generation_job);
+}
+
+// Jobs requested before this chunk are integrated first, so entity ids are still assigned in order of request.
+// Only these jobs are waited for - ones that no worker has started yet are generated on calling thread.
+// Jobs stay in list until their queue entries are done, so they are not reused while worker can still see them
+static void wait_for_chunk_generation(World *world, i32 chunk_x, i32 chunk_y) {
+    ChunkGenerationHashEntry *entry = get_chunk_generation_entry(&world->chunk_generation_hash, chunk_x, chunk_y);
+    if (entry->state != CHUNK_GENERATION_STATE_GENERATED) {
+        request_chunk_generation(world, chunk_x, chunk_y, true);
+        // Entry pointer is invalidated if hash grows
+        WorldGenerationJob *waited_job = get_chunk_generation_entry(&world->chunk_generation_hash, chunk_x, chunk_y)->job;
+        assert(waited_job);
+        WorldGenerationJob *job = 0;
+        do {
+            job = world->first_unintegrated_generation_job;
+            assert(job);
+            if (!try_to_generate_world_chunk(job)) {
+                while (!job->is_generated) {
+                    _mm_pause();
+                }
+            }
+            integrate_generation_job(world, job);
+            world->first_unintegrated_generation_job = job->next;
+        } while (job != waited_job);
+    }
+}
+
 void add_id_to_free_list(World *world, EntityID id) {
     WorldIDListEntry *entry = world->first_free_id;
     if (!entry) {
@@ -130,4 +352,4 @@ void add_id_to_free_list(World *world, EntityID id) {
     
     entry->id = id;
     LLIST_ADD_OR_CREATE(&world->first_id, entry);
-}
\ No newline at end of file
+}
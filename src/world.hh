@@ -1,6 +1,7 @@
 #if !defined(WORLD_HH)
 
 #include "lib.hh"
+#include "os.hh"
 
 #include "entity.hh"
 
@@ -64,9 +65,42 @@ struct WorldChunkEntityBlock {
     WorldChunkEntityBlock *next;
 };
 
+// Influence maps are coarse grids of values per chunk, that tell AI where resources, pawns and
+// buildings concentrate without looking at entities. Each entity adds its value to cell it is in, 
+// and AI reads values blurred over neighbour cells, so cells near concentrations are also rated high
+// Maps are stored in world chunks, so only chunks where something has changed need to be blurred again
+#define INFLUENCE_CELLS_IN_CHUNK 4
+#define INFLUENCE_CELL_SIZE (CHUNK_SIZE / INFLUENCE_CELLS_IN_CHUNK)
+enum {
+    INFLUENCE_LAYER_WOOD,
+    INFLUENCE_LAYER_GOLD,
+    INFLUENCE_LAYER_PAWNS,
+    INFLUENCE_LAYER_BUILDINGS,
+    INFLUENCE_LAYER_SENTINEL,
+};
+
+struct ChunkInfluence {
+    // Sum of values of entities in cell
+    f32 raw[INFLUENCE_LAYER_SENTINEL][INFLUENCE_CELLS_IN_CHUNK * INFLUENCE_CELLS_IN_CHUNK];
+    // Raw values blurred with neighbour cells, including ones in neighbour chunks
+    f32 blurred[INFLUENCE_LAYER_SENTINEL][INFLUENCE_CELLS_IN_CHUNK * INFLUENCE_CELLS_IN_CHUNK];
+    // Largest blurred value of each layer, so queries skip chunks that can't have maximum
+    f32 max[INFLUENCE_LAYER_SENTINEL];
+    // Some of neighbour chunks were outside of sim region when chunk was blurred, so blurred values 
+    // near its borders miss their influence
+    bool is_partial;
+};
+
 struct WorldChunk {
     i32 chunk_x;
     i32 chunk_y;
+    // Game time when entities were last written to chunk. Chunks outside of sim regions are not
+    // simulated, so when chunk gets into sim region again game fast-forwards it for the time it was away
+    u64 last_packed_tick;
+    // False if entities were added to chunk outside of sim region, then sim region
+    // calculates influence again from entities
+    bool has_influence;
+    ChunkInfluence influence;
    
     WorldChunkEntityBlock *first_entity_block;
     
@@ -78,6 +112,65 @@ struct WorldIDListEntry {
     WorldIDListEntry *next;
 };
 
+//
+// World generation
+// World is generated lazily per chunk - contents of chunk depend only on world seed and 
+// chunk coordinates, so chunks can be generated in any order and on any thread
+// Generation is done on worker threads into separate job storage, and results are
+// integrated into world on main thread. Jobs are integrated in order they were requested,
+// so entity ids don't depend on thread timings
+//
+// Game should prefetch chunks around places that are going to be simulated, so they are 
+// ready before anybody needs them. If chunk is accessed before it is generated, 
+// access waits for it to be generated
+//
+// Objects must have one cell in between them, and generation places them so 
+// this holds across chunk borders too - so chunks never need to know about their neighbours:
+// chunk is split in blocks, and each block can have object in any cell except last row and column
+#define WORLD_GENERATION_BLOCK_SIZE 4
+CT_ASSERT(CELLS_IN_CHUNK % WORLD_GENERATION_BLOCK_SIZE == 0);
+#define WORLD_GENERATION_BLOCKS_IN_CHUNK (CELLS_IN_CHUNK / WORLD_GENERATION_BLOCK_SIZE)
+#define MAX_GENERATED_ENTITIES_PER_CHUNK (WORLD_GENERATION_BLOCKS_IN_CHUNK * WORLD_GENERATION_BLOCKS_IN_CHUNK)
+struct WorldGenerationJob {
+    u32 seed;
+    i32 chunk_x;
+    i32 chunk_y;
+    // Thread that sets it generates chunk - worker, or main thread that needs chunk before worker got to it
+    volatile i32 is_started;
+    // Set when entities are written
+    volatile i32 is_generated;
+    // Set by worker when its queue entry is done, only then job can be reused
+    volatile i32 is_finished;
+    u32 entity_count;
+    // Entity ids are assigned on integration, positions are chunk-space
+    Entity entities[MAX_GENERATED_ENTITIES_PER_CHUNK];
+    
+    WorldGenerationJob *next;
+};
+
+enum {
+    CHUNK_GENERATION_STATE_NONE,
+    CHUNK_GENERATION_STATE_QUEUED,
+    CHUNK_GENERATION_STATE_GENERATED,
+};
+
+struct ChunkGenerationHashEntry {
+    i32 chunk_x;
+    i32 chunk_y;
+    u32 state;
+    // Set while chunk is queued
+    WorldGenerationJob *job;
+};
+
+#define CHUNK_GENERATION_HASH_INITIAL_SIZE 4096
+#define CHUNK_GENERATION_HASH_MAX_LOAD_PERCENT 70
+// Open addressing hash of chunk generation states. Chunks are never forgotten, so there is no deletion
+struct ChunkGenerationHash {
+    u32 capacity;
+    u32 count;
+    ChunkGenerationHashEntry *entries;
+};
+
 //
 // @TODO there should be separate notion about world structure
 // When we do generation, primary key iterest objects needs to be stored somehow
@@ -106,6 +199,23 @@ struct World {
     WorldIDListEntry *first_free_id;
     
     WorldChunk *chunk_hash[WORLD_CHUNK_HASH_SIZE];
+    // Game time in scheduler ticks, set by game each frame before sims begin
+    // frame_start_tick is set before each sim: sim simulates time from frame_start_tick to tick, so chunks that 
+    // were packed before frame_start_tick have missed some time
+    u64 tick;
+    u64 frame_start_tick;
+    
+    u32 seed;
+    // Can be 0, then generation is done on the main thread
+    WorkQueue *work_queue;
+    ChunkGenerationHash chunk_generation_hash;
+    // Jobs in order of request
+    WorldGenerationJob *first_generation_job;
+    WorldGenerationJob *last_generation_job;
+    // Jobs before this one are integrated - chunk that is waited for integrates jobs up to its own,
+    // and they stay in list until their queue entries are done
+    WorldGenerationJob *first_unintegrated_generation_job;
+    WorldGenerationJob *first_free_generation_job;
     // In future we may want to do hot chunks - entity data will not be decomprssed and 
     // stored if it is considered hot 
     //
@@ -114,6 +224,9 @@ struct World {
     u32 entity_blocks_allocated;
     u32 chunks_allocated;
     u32 entity_ids_allocated;
+    u32 generation_jobs_allocated;
+    u32 generation_jobs_in_flight;
+    u32 chunks_generated;
 };
 
 WorldChunk *get_world_chunk(World *world, i32 chunk_x, i32 chunk_y);
@@ -129,6 +242,16 @@ WorldChunkEntityBlock *get_new_entity_block(World *world);
 void add_chunk_to_free_list(World *world, WorldChunk *chunk);
 void add_entity_block_to_free_list(World *world, WorldChunkEntityBlock *block);
 
+void world_init(World *world, MemoryArena *arena, u32 seed, WorkQueue *work_queue);
+// Writes generated entities of given chunk to job - this is called from worker threads
+void generate_world_chunk(WorldGenerationJob *job);
+// Queues generation of chunks in given radius that are not generated yet
+void prefetch_world_chunks(World *world, i32 center_chunk_x, i32 center_chunk_y, u32 chunk_radius);
+// Moves finished jobs into world storage, should be called once per frame
+void integrate_generated_world_chunks(World *world);
+// Waits for all queued chunks to be generated and integrated
+void complete_world_generation(World *world);
+
 EntityID get_new_id(World *world);
 void add_id_to_free_list(World *world, EntityID id);
 
@@ -0,0 +1,187 @@
+#include "world.hh"
+#include "noise.hh"
+
+//
+// Chunk contents generation
+// Chunk is split in blocks (see WORLD_GENERATION_BLOCK_SIZE) and each block gets at most one object
+// at jittered position - jitter never reaches last row and column of block, so there always is
+// a free cell between objects and there is no need to test candidates and reject them
+// Blocks are processed in SIMD batches - one lane per block, so all noise layers are evaluated
+// for 4 blocks at a time
+//
+// Randomness comes from hashing chunk coordinates with seed, so result doesn't depend
+// on order of generation
+//
+// With SIMD_8X batch covers same 4 blocks in two neighbouring block rows
+#define WORLD_GENERATION_BATCH_SIZE 4
+#define WORLD_GENERATION_BATCHES_IN_ROW (WORLD_GENERATION_BLOCKS_IN_CHUNK / WORLD_GENERATION_BATCH_SIZE)
+CT_ASSERT(WORLD_GENERATION_BLOCKS_IN_CHUNK % WORLD_GENERATION_BATCH_SIZE == 0);
+CT_ASSERT(WORLD_GENERATION_BLOCKS_IN_CHUNK % 2 == 0);
+
+// Different noise kinds get different seeds so they are not correlated
+#define WORLD_GENERATION_SEED_TEMPERATURE 0x1000
+#define WORLD_GENERATION_SEED_MOISTURE    0x2000
+#define WORLD_GENERATION_SEED_VEGETATION  0x3000
+#define WORLD_GENERATION_SEED_GOLD        0x4000
+#define WORLD_GENERATION_SEED_SCATTER     0x5000
+// Biomes are around 8 chunks wide
+#define WORLD_GENERATION_BIOME_SCALE_LOG2 7
+#define WORLD_GENERATION_VEGETATION_SCALE_LOG2 5
+#define WORLD_GENERATION_GOLD_SCALE_LOG2 4
+#define GOLD_DEPOSIT_INTERACTIONS 4
+
+static u32 get_generated_object_kind(u32 lane_bit, u32 desert_mask, u32 jungle_mask, u32 gold_mask) {
+    u32 object_kind = WORLD_OBJECT_KIND_TREE_FOREST;
+    if (gold_mask & lane_bit) {
+        object_kind = WORLD_OBJECT_KIND_GOLD_DEPOSIT;
+    } else if (desert_mask & lane_bit) {
+        object_kind = WORLD_OBJECT_KIND_TREE_DESERT;
+    } else if (jungle_mask & lane_bit) {
+        object_kind = WORLD_OBJECT_KIND_TREE_JUNGLE;
+    }
+    return object_kind;
+}
+
+static void add_generated_object(WorldGenerationJob *job, u32 entity_cell_x, u32 entity_cell_y, u32 object_kind) {
+    assert(job->entity_count < ARRAY_SIZE(job->entities));
+    Entity *entity = job->entities + job->entity_count++;
+    memset(entity, 0, sizeof(*entity));
+    entity->p = Vec2((entity_cell_x + 0.5f) * CELL_SIZE, (entity_cell_y + 0.5f) * CELL_SIZE);
+    entity->kind = ENTITY_KIND_WORLD_OBJECT;
+    entity->flags = ENTITY_FLAG_HAS_WORLD_PLACEMENT;
+    entity->world_object_kind = object_kind;
+    entity->resource_interactions_left = object_kind == WORLD_OBJECT_KIND_GOLD_DEPOSIT ? GOLD_DEPOSIT_INTERACTIONS : 1;
+}
+
+void generate_world_chunk(WorldGenerationJob *job) {
+    u32 seed = job->seed;
+    job->entity_count = 0;
+    // Each chunk has its own random stream per lane
+    // Seeds are made odd so no lane gets stuck at zero
+    u32 chunk_hash = hash_cell(seed + WORLD_GENERATION_SEED_SCATTER, job->chunk_x, job->chunk_y);
+    Entropy_4x entropy = entropy_4x(hash_u32(chunk_hash) | 1, hash_u32(chunk_hash + 1) | 1,
+                                    hash_u32(chunk_hash + 2) | 1, hash_u32(chunk_hash + 3) | 1);
+
+    i32 chunk_cell_x = job->chunk_x * CELLS_IN_CHUNK;
+    i32 chunk_cell_y = job->chunk_y * CELLS_IN_CHUNK;
+#if SIMD_8X
+    // Lanes 0-3 take block row block_y and lanes 4-7 take next row
+    // Scalar stream of each 4x lane gives two values per batch and rows go one after another,
+    // so upper half starts one row of draws ahead and both halves skip one row of draws after
+    // each pair of rows - every block gets the same random values and world is the same as in 4x build
+    u32 row_draw_count = 2 * WORLD_GENERATION_BATCHES_IN_ROW;
+    Entropy_4x upper_entropy = entropy;
+    for (u32 draw_idx = 0; draw_idx < row_draw_count; ++draw_idx) {
+        xorshift32_4x(&upper_entropy);
+    }
+    Entropy_8x entropy_pair = entropy_8x(entropy.state, upper_entropy.state);
+    i32_8x lane_offset_x = I32_8x(0, WORLD_GENERATION_BLOCK_SIZE, 2 * WORLD_GENERATION_BLOCK_SIZE, 3 * WORLD_GENERATION_BLOCK_SIZE,
+                                  0, WORLD_GENERATION_BLOCK_SIZE, 2 * WORLD_GENERATION_BLOCK_SIZE, 3 * WORLD_GENERATION_BLOCK_SIZE);
+    i32_8x lane_offset_y = I32_8x(0, 0, 0, 0,
+                                  WORLD_GENERATION_BLOCK_SIZE, WORLD_GENERATION_BLOCK_SIZE,
+                                  WORLD_GENERATION_BLOCK_SIZE, WORLD_GENERATION_BLOCK_SIZE);
+    for (u32 block_y = 0; block_y < WORLD_GENERATION_BLOCKS_IN_CHUNK; block_y += 2) {
+        if (block_y) {
+            for (u32 draw_idx = 0; draw_idx < row_draw_count; ++draw_idx) {
+                xorshift32_8x(&entropy_pair);
+            }
+        }
+        for (u32 block_x = 0; block_x < WORLD_GENERATION_BLOCKS_IN_CHUNK; block_x += WORLD_GENERATION_BATCH_SIZE) {
+            i32_8x block_cell_x = I32_8x(chunk_cell_x + block_x * WORLD_GENERATION_BLOCK_SIZE) + lane_offset_x;
+            i32_8x block_cell_y = I32_8x(chunk_cell_y + block_y * WORLD_GENERATION_BLOCK_SIZE) + lane_offset_y;
+            u32_8x jitter = xorshift32_8x(&entropy_pair);
+            u32_8x block_range = U32_8x(WORLD_GENERATION_BLOCK_SIZE - 1);
+            u32_8x local_x = ((jitter & U32_8x(0xFF)) * block_range) >> 8;
+            u32_8x local_y = (((jitter >> 8) & U32_8x(0xFF)) * block_range) >> 8;
+            f32_8x placement_roll = random_8x(&entropy_pair);
+            i32_8x cell_x = block_cell_x + I32_8x(local_x);
+            i32_8x cell_y = block_cell_y + I32_8x(local_y);
+
+            f32_8x temperature = value_fbm_8x(seed + WORLD_GENERATION_SEED_TEMPERATURE, cell_x, cell_y,
+                                              WORLD_GENERATION_BIOME_SCALE_LOG2, 3);
+            f32_8x moisture = value_fbm_8x(seed + WORLD_GENERATION_SEED_MOISTURE, cell_x, cell_y,
+                                           WORLD_GENERATION_BIOME_SCALE_LOG2, 3);
+            f32_8x is_desert = (temperature > F32_8x(0.55f)) & (moisture < F32_8x(0.5f));
+            f32_8x is_jungle = (temperature > F32_8x(0.5f)) & (moisture > F32_8x(0.55f));
+            f32_8x tree_density = select(select(F32_8x(0.35f), is_jungle, F32_8x(0.6f)), is_desert, F32_8x(0.15f));
+            f32_8x vegetation = simplex_fbm_8x(seed + WORLD_GENERATION_SEED_VEGETATION, cell_x, cell_y,
+                                               WORLD_GENERATION_VEGETATION_SCALE_LOG2, 2);
+            tree_density *= F32_8x(1.0f) + vegetation;
+            f32_8x gold = value_noise_8x(seed + WORLD_GENERATION_SEED_GOLD, cell_x, cell_y, WORLD_GENERATION_GOLD_SCALE_LOG2);
+            f32_8x is_gold = (gold > F32_8x(0.85f)) & (placement_roll < F32_8x(0.5f));
+            f32_8x is_placed = is_gold | (placement_roll < tree_density);
+
+            u32 placed_mask = get_mask(is_placed);
+            if (!placed_mask) {
+                continue;
+            }
+            u32 desert_mask = get_mask(is_desert);
+            u32 jungle_mask = get_mask(is_jungle);
+            u32 gold_mask = get_mask(is_gold);
+            for (u32 lane = 0; lane < 2 * WORLD_GENERATION_BATCH_SIZE; ++lane) {
+                u32 lane_bit = 1 << lane;
+                if (!(placed_mask & lane_bit)) {
+                    continue;
+                }
+
+                u32 object_kind = get_generated_object_kind(lane_bit, desert_mask, jungle_mask, gold_mask);
+                u32 lane_block_x = block_x + lane % WORLD_GENERATION_BATCH_SIZE;
+                u32 lane_block_y = block_y + lane / WORLD_GENERATION_BATCH_SIZE;
+                add_generated_object(job, lane_block_x * WORLD_GENERATION_BLOCK_SIZE + get_lane(local_x, lane),
+                                     lane_block_y * WORLD_GENERATION_BLOCK_SIZE + get_lane(local_y, lane), object_kind);
+            }
+        }
+    }
+#else
+    i32_4x lane_offset_x = I32_4x(0, WORLD_GENERATION_BLOCK_SIZE,
+                                  2 * WORLD_GENERATION_BLOCK_SIZE, 3 * WORLD_GENERATION_BLOCK_SIZE);
+    for (u32 block_y = 0; block_y < WORLD_GENERATION_BLOCKS_IN_CHUNK; ++block_y) {
+        for (u32 block_x = 0; block_x < WORLD_GENERATION_BLOCKS_IN_CHUNK; block_x += WORLD_GENERATION_BATCH_SIZE) {
+            i32_4x block_cell_x = I32_4x(chunk_cell_x + block_x * WORLD_GENERATION_BLOCK_SIZE) + lane_offset_x;
+            i32_4x block_cell_y = I32_4x(chunk_cell_y + block_y * WORLD_GENERATION_BLOCK_SIZE);
+            // Object is placed in any cell of block except last row and column
+            // Byte of random is mapped to [0; WORLD_GENERATION_BLOCK_SIZE - 1) with multiply-shift
+            u32_4x jitter = xorshift32_4x(&entropy);
+            u32_4x block_range = U32_4x(WORLD_GENERATION_BLOCK_SIZE - 1);
+            u32_4x local_x = ((jitter & U32_4x(0xFF)) * block_range) >> 8;
+            u32_4x local_y = (((jitter >> 8) & U32_4x(0xFF)) * block_range) >> 8;
+            f32_4x placement_roll = random_4x(&entropy);
+            i32_4x cell_x = block_cell_x + I32_4x(local_x);
+            i32_4x cell_y = block_cell_y + I32_4x(local_y);
+
+            f32_4x temperature = value_fbm_4x(seed + WORLD_GENERATION_SEED_TEMPERATURE, cell_x, cell_y,
+                                              WORLD_GENERATION_BIOME_SCALE_LOG2, 3);
+            f32_4x moisture = value_fbm_4x(seed + WORLD_GENERATION_SEED_MOISTURE, cell_x, cell_y,
+                                           WORLD_GENERATION_BIOME_SCALE_LOG2, 3);
+            f32_4x is_desert = (temperature > F32_4x(0.55f)) & (moisture < F32_4x(0.5f));
+            f32_4x is_jungle = (temperature > F32_4x(0.5f)) & (moisture > F32_4x(0.55f));
+            f32_4x tree_density = select(select(F32_4x(0.35f), is_jungle, F32_4x(0.6f)), is_desert, F32_4x(0.15f));
+            // Vegetation noise makes groves and clearings inside biome
+            f32_4x vegetation = simplex_fbm_4x(seed + WORLD_GENERATION_SEED_VEGETATION, cell_x, cell_y,
+                                               WORLD_GENERATION_VEGETATION_SCALE_LOG2, 2);
+            tree_density *= F32_4x(1.0f) + vegetation;
+            f32_4x gold = value_noise_4x(seed + WORLD_GENERATION_SEED_GOLD, cell_x, cell_y, WORLD_GENERATION_GOLD_SCALE_LOG2);
+            f32_4x is_gold = (gold > F32_4x(0.85f)) & (placement_roll < F32_4x(0.5f));
+            f32_4x is_placed = is_gold | (placement_roll < tree_density);
+
+            u32 placed_mask = get_mask(is_placed);
+            if (!placed_mask) {
+                continue;
+            }
+            u32 desert_mask = get_mask(is_desert);
+            u32 jungle_mask = get_mask(is_jungle);
+            u32 gold_mask = get_mask(is_gold);
+            for (u32 lane = 0; lane < WORLD_GENERATION_BATCH_SIZE; ++lane) {
+                u32 lane_bit = 1 << lane;
+                if (!(placed_mask & lane_bit)) {
+                    continue;
+                }
+
+                u32 object_kind = get_generated_object_kind(lane_bit, desert_mask, jungle_mask, gold_mask);
+                add_generated_object(job, (block_x + lane) * WORLD_GENERATION_BLOCK_SIZE + get_lane(local_x, lane),
+                                     block_y * WORLD_GENERATION_BLOCK_SIZE + get_lane(local_y, lane), object_kind);
+            }
+        }
+    }
+#endif
+}
@@ -6,28 +6,29 @@ inline WorldObjectSpec get_spec_for_type(WorldState *world_state, u32 type) {
     return world_state->world_object_specs[type];
 }
 
+// Returns null id if sim region is full
 static EntityID add_player(SimRegion *sim, vec2 pos) {
+    EntityID result = {};
     Entity *entity = create_new_entity(sim, pos);
-    entity->kind = ENTITY_KIND_PLAYER;
-    entity->flags = ENTITY_FLAG_IS_ANCHOR;
-    return entity->id;
-}
-
-static EntityID add_tree(SimRegion *sim, vec2 pos, u32 kind) {
-    pos.x = Floor(pos.x) + 0.5f;
-    pos.y = Floor(pos.y) + 0.5f;
-    Entity *entity = create_new_entity(sim, pos);
-    entity->kind = ENTITY_KIND_WORLD_OBJECT;
-    entity->flags = ENTITY_FLAG_HAS_WORLD_PLACEMENT;
-    entity->world_object_kind = kind;
-    entity->resource_interactions_left = 1;
-    return entity->id;
+    if (entity) {
+        entity->kind = ENTITY_KIND_PLAYER;
+        entity->flags = ENTITY_FLAG_IS_ANCHOR;
+        result = entity->id;
+    }
+    return result;
 }
 
+// Returns null id if sim region is full
 static EntityID add_pawn(SimRegion *sim, vec2 pos) {
+    EntityID result = {};
     Entity *entity = create_new_entity(sim, pos);
-    entity->kind = ENTITY_KIND_PAWN;
-    return entity->id;
+    if (entity) {
+        entity->kind = ENTITY_KIND_PAWN;
+        add_sim_pawn(sim, entity);
+        add_sim_entity_influence(sim, entity);
+        result = entity->id;
+    }
+    return result;
 }
 
 inline WorldObjectSpec tree_spec(u32 resource_gain) {
@@ -39,52 +40,126 @@ inline WorldObjectSpec tree_spec(u32 resource_gain) {
     return spec;
 }
 
-inline WorldObjectSpec building_spec() {
+inline WorldObjectSpec gold_spec() {
+    WorldObjectSpec spec = {};
+    spec.type = WORLD_OBJECT_TYPE_RESOURCE;
+    spec.resource_kind = RESOURCE_KIND_GOLD;
+    spec.default_resource_interactions = GOLD_DEPOSIT_INTERACTIONS;
+    spec.resource_gain = 5;
+    spec.regrowth_time = 60.0f;
+    return spec;
+}
+
+inline WorldObjectSpec building_spec(u32 stockpile_capacity = 0) {
     WorldObjectSpec spec = {};
     spec.type = WORLD_OBJECT_TYPE_BUILDING;
+    spec.build_time = 20.0f;
+    spec.max_builders = BUILDING_MAX_BUILDERS;
+    spec.stockpile_capacity = stockpile_capacity;
     return spec;
 }
 
-void world_state_init(WorldState *world_state, MemoryArena *arena, MemoryArena *frame_arena) {    
+// Returns 0 if building can't be placed there
+static Entity *add_building(SimRegion *sim, u32 world_object_kind, i32 cell_x, i32 cell_y) {
+    Entity *entity = 0;
+    if (check_spatial_placement(sim, cell_x, cell_y, 1, 1)) {
+        entity = create_new_entity(sim, Vec2(cell_x + 0.5f, cell_y + 0.5f) * CELL_SIZE);
+        if (entity) {
+            entity->kind = ENTITY_KIND_WORLD_OBJECT;
+            entity->world_object_kind = world_object_kind;
+            entity->flags = ENTITY_FLAG_HAS_WORLD_PLACEMENT;
+            add_sim_entity_influence(sim, entity);
+        }
+    }
+    return entity;
+}
+
+// Building that is built starts taking resources if it is stockpile
+static void init_built_building(WorldState *world_state, SimRegion *sim, Entity *building) {
+    WorldObjectSpec spec = get_spec_for_type(world_state, building->world_object_kind);
+    if (spec.stockpile_capacity) {
+        building->flags |= ENTITY_FLAG_IS_STOCKPILE;
+        building->item_capacity = spec.stockpile_capacity;
+        add_sim_logistics_entity(sim, building);
+        signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_HAUL_AVAILABLE);
+    }
+}
+
+// Places building that is not built yet and adds orders to build it, one for each builder slot
+// Returns null id if building can't be placed there
+static EntityID add_construction_site(WorldState *world_state, SimRegion *sim, u32 world_object_kind, i32 cell_x, i32 cell_y) {
+    EntityID result = {};
+    Entity *entity = add_building(sim, world_object_kind, cell_x, cell_y);
+    if (entity) {
+        entity->flags |= ENTITY_FLAG_IS_UNDER_CONSTRUCTION;
+        add_sim_construction_site(sim, entity);
+        
+        WorldObjectSpec spec = get_spec_for_type(world_state, world_object_kind);
+        bool is_order_added = false;
+        for (u32 slot = 0; slot < spec.max_builders; ++slot) {
+            Order order = {};
+            order.kind = ORDER_BUILD;
+            order.destination_id = entity->id;
+            order.slot = slot;
+            if (IS_NOT_NULL(try_to_add_order(&world_state->order_system, order))) {
+                is_order_added = true;
+            }
+        }
+        if (is_order_added) {
+            signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_ORDER_ADDED);
+        }
+        result = entity->id;
+    }
+    return result;
+}
+
+void world_state_init(WorldState *world_state, MemoryArena *arena, MemoryArena *frame_arena, 
+                      WorkQueue *work_queue, WorkQueue *high_priority_work_queue) {    
     world_state->arena = arena;
     world_state->frame_arena = frame_arena;
-    // @TODO initialize world properly
+    world_state->high_priority_work_queue = high_priority_work_queue;
+    world_state->anchor_radius = DEFAULT_ANCHOR_RADIUS;
+    world_state->sim_budget_ms = DEFAULT_SIM_BUDGET_MS;
     world_state->world = alloc_struct(arena, World);
-    world_state->world->arena = arena;
-    world_state->world->max_entity_id = 1;
+    world_init(world_state->world, arena, 123456789, work_queue);
     // Set spec settings
     world_state->world_object_specs[WORLD_OBJECT_KIND_TREE_FOREST] = tree_spec(4);
     world_state->world_object_specs[WORLD_OBJECT_KIND_TREE_JUNGLE] = tree_spec(2);
     world_state->world_object_specs[WORLD_OBJECT_KIND_TREE_DESERT] = tree_spec(1);
+    world_state->world_object_specs[WORLD_OBJECT_KIND_GOLD_DEPOSIT] = gold_spec();
     world_state->world_object_specs[WORLD_OBJECT_KIND_BUILDING1] = building_spec();
-    world_state->world_object_specs[WORLD_OBJECT_KIND_BUILDING2] = building_spec();
+    world_state->world_object_specs[WORLD_OBJECT_KIND_BUILDING2] = building_spec(STOCKPILE_CAPACITY);
     init_order_system(&world_state->order_system, world_state->arena);
+    init_entity_scheduler(&world_state->scheduler, world_state->arena);
+    init_pawn_utility(&world_state->pawn_utility);
     init_particle_system(&world_state->particle_system, world_state->arena);
     world_state->particle_system.emitter.spec.p = Vec3(0);
     world_state->particle_system.emitter.spec.spawn_rate = 10;
     
-    // Generate world
-    Entropy gen_entropy { 123456789 };
+    // World itself is generated when it is needed, here we only put player and pawns in it
+    i32 start_chunk_x = 100;
+    i32 start_chunk_y = 100;
+    u32 start_chunk_radius = world_state->anchor_radius;
+    prefetch_world_chunks(world_state->world, start_chunk_x, start_chunk_y, start_chunk_radius + WORLD_PREFETCH_CHUNK_MARGIN);
+    complete_world_generation(world_state->world);
     SimRegion *creation_sim = alloc_struct(frame_arena, SimRegion);
-    begin_sim(creation_sim, frame_arena, world_state->world, 100, 100, 25);
+    begin_sim(creation_sim, frame_arena, world_state->world, start_chunk_x, start_chunk_y, start_chunk_radius);
     vec2 player_pos = Vec2(0);
     world_state->camera_followed_entity = add_player(creation_sim, player_pos);    
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(5, 5));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(-5, 5));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(5, -5));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(-5, -5));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(15, 15));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(-15, 15));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(15, -15));
-    world_state->pawns[world_state->pawn_count++] = add_pawn(creation_sim, Vec2(-15, -15));
-    for (u32 i = 0; i < 1000; ++i) {
-        for (;;) {
-            f32 x = random_bilateral(&gen_entropy) * CHUNK_SIZE * 15;
-            f32 y = random_bilateral(&gen_entropy) * CHUNK_SIZE * 15;
-            if (!is_cell_occupied(creation_sim, Floor(x), Floor(y))) {
-                add_tree(creation_sim, Vec2(x, y), WORLD_OBJECT_KIND_TREE_FOREST);
-                break;
-            }
+    add_pawn(creation_sim, Vec2(5, 5));
+    add_pawn(creation_sim, Vec2(-5, 5));
+    add_pawn(creation_sim, Vec2(5, -5));
+    add_pawn(creation_sim, Vec2(-5, -5));
+    add_pawn(creation_sim, Vec2(15, 15));
+    add_pawn(creation_sim, Vec2(-15, 15));
+    add_pawn(creation_sim, Vec2(15, -15));
+    add_pawn(creation_sim, Vec2(-15, -15));
+    // Player starts with stockpile, so resources have somewhere to go before anything is built
+    for (i32 cell_x = 2; cell_x < CELLS_IN_CHUNK; ++cell_x) {
+        Entity *stockpile = add_building(creation_sim, WORLD_OBJECT_KIND_BUILDING2, cell_x, 0);
+        if (stockpile) {
+            init_built_building(world_state, creation_sim, stockpile);
+            break;
         }
     }
     end_sim(creation_sim, world_state);
@@ -112,39 +187,88 @@ static void init_particles_for_interaction(WorldState *world_state, SimRegion *s
     }
 }
 
+// Items are put in pile that is close to p if there is one with items of same kind, so piles don't 
+// get split in many small ones
+static void drop_items(WorldState *world_state, SimRegion *sim, vec2 p, u32 item_kind, u32 amount) {
+    Entity *pile = find_nearest_sim_logistics_entity(sim, item_kind, p, ITEM_PILE_MERGE_DISTANCE);
+    if (!pile) {
+        pile = create_new_entity(sim, p);
+        if (pile) {
+            pile->kind = ENTITY_KIND_ITEM_PILE;
+            pile->item_kind = item_kind;
+            add_sim_logistics_entity(sim, pile);
+        }
+    }
+    // @TODO items are lost if sim is out of entity space
+    if (pile) {
+        bool was_available = get_sim_logistics_available(sim, pile) != 0;
+        pile->item_amount += amount;
+        release_sim_logistics(sim, pile, amount);
+        if (!was_available) {
+            signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_HAUL_AVAILABLE);
+        }
+    }
+}
+
+// Scheduler keeps woken entities by chunk, so sim space position is turned into global chunk
+static void sleep_sim_entity(WorldState *world_state, SimRegion *sim, Entity *entity, 
+                             u64 wake_tick, u32 wake_events, EntityID target = {}) {
+    i32 chunk_x, chunk_y;
+    get_global_space_p(sim, entity->p, &chunk_x, &chunk_y, 0);
+    sleep_entity(&world_state->scheduler, entity, chunk_x, chunk_y, wake_tick, wake_events, target);
+}
+
 static void update_interaction(WorldState *world_state, SimRegion *sim, Entity *entity, InputManager *input) {
     assert(IS_NOT_NULL(entity->order));
     Order *order = get_order_by_id(&world_state->order_system, entity->order);
     assert(order);
+    EntityScheduler *scheduler = &world_state->scheduler;
     
     if (entity->interaction.kind) {
-        entity->interaction.current_time += input->platform->frame_dt;
-        if (entity->interaction.current_time > entity->interaction.time) {
-            Entity *interactable = get_entity_by_id(sim, entity->interaction.entity);
-            assert(interactable);
-            
+        Entity *interactable = get_entity_by_id(sim, entity->interaction.entity);
+        assert(interactable);
+        // Pawn can be woken before interaction ends if somebody else has deleted its target
+        if (interactable->flags & ENTITY_FLAG_IS_DELETED) {
+            disband_order(&world_state->order_system, entity->order);
+            entity->order = {};
+            entity->interaction = {};
+        } else if (scheduler->current_tick >= entity->interaction.end_tick) {
+            // Pawn could have slept longer than single interaction takes if it was outside of sim regions,
+            // so all interactions that should have ended by now are completed at once
+            assert(entity->interaction.duration_ticks);
+            u64 completed_count = 1 + (scheduler->current_tick - entity->interaction.end_tick) / entity->interaction.duration_ticks;
             if (entity->interaction.kind == INTERACTION_KIND_MINE_RESOURCE) {
                 assert(interactable->kind == ENTITY_KIND_WORLD_OBJECT);
                 assert(interactable->resource_interactions_left > 0);
-                interactable->resource_interactions_left -= 1;
+                if (completed_count > interactable->resource_interactions_left) {
+                    completed_count = interactable->resource_interactions_left;
+                }
+                interactable->resource_interactions_left -= (u32)completed_count;
                 WorldObjectSpec interactable_spec = get_spec_for_type(world_state, interactable->world_object_kind);
                 assert(interactable_spec.type == WORLD_OBJECT_TYPE_RESOURCE);
-                if (interactable_spec.resource_kind == RESOURCE_KIND_WOOD) {
-                    world_state->wood_count += interactable_spec.resource_gain;
-                } else {
-                    NOT_IMPLEMENTED;
-                } 
+                // Mined resources are left next to pawn, and haulers bring them to stockpiles
+                drop_items(world_state, sim, entity->p, interactable_spec.resource_kind, 
+                           interactable_spec.resource_gain * (u32)completed_count);
                 
                 if (interactable->resource_interactions_left == 0){
-                    interactable->flags |= ENTITY_FLAG_IS_DELETED;
+                    delete_sim_entity(sim, interactable);
+                    signal_scheduler_event(scheduler, SCHEDULER_EVENT_TARGET_DELETED, interactable->id);
                     disband_order(&world_state->order_system, entity->order);
                     entity->order = {};
                     // delete_particle_emitter(&world_state->particle_system, entity->interaction.particle_emitter);
                     entity->interaction = {};
+                } else {
+                    // Next interaction with same resource starts right away
+                    entity->interaction.end_tick += completed_count * entity->interaction.duration_ticks;
+                    sleep_sim_entity(world_state, sim, entity, entity->interaction.end_tick, 
+                                     SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_TARGET_DELETED), interactable->id);
                 }
             } else {
                 NOT_IMPLEMENTED;
             }
+        } else {
+            sleep_sim_entity(world_state, sim, entity, entity->interaction.end_tick, 
+                             SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_TARGET_DELETED), interactable->id);
         }
     } else {
         EntityID order_entity_id = order->destination_id;
@@ -162,6 +286,8 @@ static void update_interaction(WorldState *world_state, SimRegion *sim, Entity *
                 assert(dest_entity->resource_interactions_left > 0);
                 if (dest_spec.resource_kind == RESOURCE_KIND_WOOD) {
                     interaction_time = 1.0f;
+                } else if (dest_spec.resource_kind == RESOURCE_KIND_GOLD) {
+                    interaction_time = 2.0f;
                 } else {
                     NOT_IMPLEMENTED;
                 }
@@ -176,14 +302,566 @@ static void update_interaction(WorldState *world_state, SimRegion *sim, Entity *
             assert(interaction_kind);
             entity->interaction.kind = interaction_kind;
             entity->interaction.entity = order_entity_id;
-            entity->interaction.time = interaction_time;
-            entity->interaction.current_time = 0.0f;
+            entity->interaction.duration_ticks = get_scheduler_ticks(interaction_time);
+            entity->interaction.end_tick = scheduler->current_tick + entity->interaction.duration_ticks;
             init_particles_for_interaction(world_state, sim, input, &entity->interaction);
+            // Nothing to do until interaction ends
+            sleep_sim_entity(world_state, sim, entity, entity->interaction.end_tick, 
+                             SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_TARGET_DELETED), order_entity_id);
+        }
+    }
+}
+
+// Builder only registers at construction site and sleeps until building is finished,
+// progress itself is applied to all sites at once in update_construction_sites
+static void update_builder(WorldState *world_state, SimRegion *sim, Entity *entity) {
+    Order *order = get_order_by_id(&world_state->order_system, entity->order);
+    assert(order && order->kind == ORDER_BUILD);
+    Entity *site = get_entity_by_id(sim, order->destination_id);
+    assert(site);
+    if ((site->flags & ENTITY_FLAG_IS_DELETED) || !(site->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION)) {
+        // Building is finished or was destroyed while pawn was building it
+        disband_order(&world_state->order_system, entity->order);
+        entity->order = {};
+        entity->interaction = {};
+    } else {
+        if (!entity->interaction.kind) {
+            entity->interaction.kind = INTERACTION_KIND_BUILD;
+            entity->interaction.entity = site->id;
+            ++site->builder_count;
+        }
+        sleep_sim_entity(world_state, sim, entity, 0, 
+                         SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_CONSTRUCTION_FINISHED) | SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_TARGET_DELETED),
+                         site->id);
+    }
+}
+
+static void finish_construction(WorldState *world_state, SimRegion *sim, Entity *site) {
+    if (site->builder_count > 1) {
+        ++world_state->buildings_built_together;
+    }
+    site->build_progress = 1.0f;
+    site->builder_count = 0;
+    site->flags &= ~ENTITY_FLAG_IS_UNDER_CONSTRUCTION;
+    ++world_state->buildings_finished;
+    signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_CONSTRUCTION_FINISHED, site->id);
+    init_built_building(world_state, sim, site);
+}
+
+// Single pass over all construction sites of sim region, so builders never write to building entities
+static void update_construction_sites(WorldState *world_state, SimRegion *sim, f32 dt) {
+    TIMED_FUNCTION();
+    SimRegionConstructionSites *sites = &sim->construction_sites;
+    u32 active_site_count = 0;
+    for (u32 site_idx = 0; site_idx < sites->count; ++site_idx) {
+        Entity *site = sim->entities + sites->entity_indices[site_idx];
+        if (!(site->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION) || (site->flags & ENTITY_FLAG_IS_DELETED)) {
+            continue;
+        }
+        
+        if (site->builder_count) {
+            ++active_site_count;
+            WorldObjectSpec spec = get_spec_for_type(world_state, site->world_object_kind);
+            assert(spec.build_time > 0);
+            site->build_progress += site->builder_count * dt / spec.build_time;
+            if (site->build_progress >= 1.0f) {
+                finish_construction(world_state, sim, site);
+            }
+        }
+    }
+    DEBUG_VALUE(sites->count, "Construction sites");
+    DEBUG_VALUE(active_site_count, "Active construction sites");
+}
+
+// Entities of different chunks don't depend on each other, so chunks are split between jobs that 
+// record changes to their own command buffers. Buildings that get finished are finished by
+// update_construction_sites later in the frame
+struct CatchUpJob {
+    WorldState *world_state;
+    SimRegion *sim;
+    u32 chunk_count;
+    u32 *chunk_indices;
+    EntityCommandBuffer *commands;
+};
+
+static void catch_up_chunks(CatchUpJob *job) {
+    WorldState *world_state = job->world_state;
+    SimRegion *sim = job->sim;
+    for (u32 idx = 0; idx < job->chunk_count; ++idx) {
+        SimRegionChunk *chunk = sim->chunks + job->chunk_indices[idx];
+        ITERATE(iter, iterate_chunk_entities(chunk)) {
+            Entity *entity = get_entity_by_id(sim, *iter.ptr);
+            if (entity && entity->kind == ENTITY_KIND_WORLD_OBJECT) {
+                u32 sort_key = (u32)(entity - sim->entities);
+                WorldObjectSpec spec = get_spec_for_type(world_state, entity->world_object_kind);
+                // Resources that are partially mined regrow while nobody is around
+                if (spec.regrowth_time > 0 && entity->resource_interactions_left < spec.default_resource_interactions) {
+                    u64 regrown_count = chunk->catch_up_ticks / get_scheduler_ticks(spec.regrowth_time);
+                    u32 missing_count = spec.default_resource_interactions - entity->resource_interactions_left;
+                    u32 interactions_left = entity->resource_interactions_left + (regrown_count < missing_count ? (u32)regrown_count : missing_count);
+                    RECORD_SET_ENTITY_FIELD(job->commands, sort_key, entity->id, resource_interactions_left, interactions_left);
+                }
+                // Builders sleep at construction site, so building progresses for as long as they were away
+                if ((entity->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION) && entity->builder_count) {
+                    f32 seconds = (f32)chunk->catch_up_ticks / SCHEDULER_TICKS_PER_SECOND;
+                    f32 build_progress = entity->build_progress + entity->builder_count * seconds / spec.build_time;
+                    RECORD_SET_ENTITY_FIELD(job->commands, sort_key, entity->id, build_progress, build_progress);
+                }
+            }
+        }
+    }
+}
+
+static WORK_QUEUE_CALLBACK(catch_up_chunks_work) {
+    catch_up_chunks((CatchUpJob *)data);
+}
+
+// Chunks outside of sim regions are frozen, so when they get into sim again their entities are 
+// fast-forwarded for the time they were away in closed form. This way cost of the part of the world
+// that is not simulated depends on how often player visits it, not on how much time has passed
+// Pawns don't need this - their interactions are timed by scheduler, and update_interaction
+// completes all interactions that should have ended while pawn was away
+static void catch_up_sim_region(WorldState *world_state, SimRegion *sim) {
+    TIMED_FUNCTION();
+    u32 caught_up_chunk_count = 0;
+    u32 *caught_up_chunks = alloc_arr(sim->arena, sim->chunks_count, u32, false);
+    for (u32 chunk_idx = 0; chunk_idx < sim->chunks_count; ++chunk_idx) {
+        if (sim->chunks[chunk_idx].catch_up_ticks) {
+            caught_up_chunks[caught_up_chunk_count++] = chunk_idx;
+        }
+    }
+    
+    if (caught_up_chunk_count) {
+        u32 job_count = (caught_up_chunk_count + CATCH_UP_CHUNKS_PER_JOB - 1) / CATCH_UP_CHUNKS_PER_JOB;
+        job_count = job_count < CATCH_UP_MAX_JOB_COUNT ? job_count : CATCH_UP_MAX_JOB_COUNT;
+        CatchUpJob *jobs = alloc_arr(sim->arena, job_count, CatchUpJob);
+        EntityCommandBuffer *buffers = alloc_arr(sim->arena, job_count, EntityCommandBuffer, false);
+        // Queue of world generation can hold many long jobs, and frame would wait for all of them
+        WorkQueue *queue = world_state->high_priority_work_queue;
+        u32 first_chunk = 0;
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            CatchUpJob *job = jobs + job_idx;
+            job->world_state = world_state;
+            job->sim = sim;
+            job->chunk_indices = caught_up_chunks + first_chunk;
+            job->chunk_count = (caught_up_chunk_count * (job_idx + 1)) / job_count - first_chunk;
+            first_chunk += job->chunk_count;
+            // Each entity sets at most 2 fields
+            u32 entity_count = 0;
+            for (u32 idx = 0; idx < job->chunk_count; ++idx) {
+                ITERATE(iter, iterate_chunk_entities(sim->chunks + job->chunk_indices[idx])) {
+                    ++entity_count;
+                }
+            }
+            job->commands = buffers + job_idx;
+            init_entity_command_buffer(job->commands, sim->arena, (entity_count * 2));
+            if (job_count == 1 || !queue || !add_work_queue_entry(queue, catch_up_chunks_work, job)) {
+                catch_up_chunks(job);
+            }
+        }
+        if (job_count > 1 && queue) {
+            complete_all_work(queue);
+        }
+        apply_entity_commands(sim, buffers, job_count);
+    }
+    DEBUG_VALUE(caught_up_chunk_count, "Caught up chunks");
+}
+
+// List is given back to scheduler after its last entity is released, so loop only compares against it
+static void wake_sim_chunk_entities(EntityScheduler *scheduler, SimRegion *sim, ScheduledEntityListEntry *list) {
+    for (ScheduledEntityListEntry *entry = list->next, *next; entry != list; entry = next) {
+        next = entry->next;
+        ScheduledEntity *node = entry->node;
+        // Entity of sim chunk can still be missing if sim had no space for it, then it waits for next sim
+        Entity *entity = get_entity_by_id(sim, node->id);
+        if (entity) {
+            assert(entity->flags & ENTITY_FLAG_IS_SLEEPING);
+            entity->flags &= ~ENTITY_FLAG_IS_SLEEPING;
+            if (entity->kind == ENTITY_KIND_PAWN) {
+                add_sim_pawn(sim, entity);
+            }
+            release_woken_entity(scheduler, node);
+        }
+    }
+}
+
+// Entities that were woken by scheduler are added to sim pawns, so they are updated this frame
+// Only woken lists of chunks of this sim are looked at, entities in other chunks are left for other sims
+// Lists are found either by looking up each sim chunk, or by checking each chunk with woken entities 
+// against sim - whatever is less chunks
+static void wake_sim_entities(WorldState *world_state, SimRegion *sim) {
+    TIMED_FUNCTION();
+    EntityScheduler *scheduler = &world_state->scheduler;
+    if (!scheduler->woken_count) {
+        return;
+    }
+    if (scheduler->woken_chunk_count < sim->chunks_count) {
+        // Chunk is removed from list when its woken list gets empty, so next is taken beforehand
+        ScheduledChunkListEntry *list = &scheduler->woken_chunk_list;
+        for (ScheduledChunkListEntry *entry = list->next, *next; entry != list; entry = next) {
+            next = entry->next;
+            ScheduledChunk *chunk = entry->chunk;
+            if (get_chunk(sim, chunk->chunk_x - sim->center_chunk_x, chunk->chunk_y - sim->center_chunk_y)) {
+                wake_sim_chunk_entities(scheduler, sim, &chunk->woken_list);
+            }
+        }
+    } else {
+        for (u32 chunk_idx = 0; chunk_idx < sim->chunks_count; ++chunk_idx) {
+            SimRegionChunk *chunk = sim->chunks + chunk_idx;
+            ScheduledEntityListEntry *list = get_woken_list(scheduler, sim->center_chunk_x + chunk->chunk_x, 
+                                                            sim->center_chunk_y + chunk->chunk_y);
+            if (list) {
+                wake_sim_chunk_entities(scheduler, sim, list);
+            }
+        }
+    }
+}
+
+// Orders are shared by all sim regions, so pawns take first pending order which destination is in their sim
+// Cursor points to entry to check next. Orders before it were already checked by this assignment pass, 
+// so whole pass goes through pending list once no matter how many orders are assigned
+static OrderID get_pending_order_in_sim(WorldState *world_state, SimRegion *sim, OrderListEntry **cursor, Entity **destination_dst) {
+    OrderSystem *order_system = &world_state->order_system;
+    OrderID result = {};
+    OrderListEntry *next_entry = 0;
+    for (OrderListEntry *entry = *cursor; entry != &order_system->pending_list; entry = next_entry) {
+        next_entry = entry->next;
+        // Returned order is moved to assigned list, so cursor is advanced past it beforehand
+        *cursor = next_entry;
+        Order *order = get_order_by_id(order_system, entry->id);
+        Entity *destination = get_entity_by_id(sim, order->destination_id);
+        // Building can be finished by other builders before all of its build orders are taken
+        if (destination && order->kind == ORDER_BUILD && !(destination->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION)) {
+            disband_order(order_system, entry->id);
+        } else if (destination) {
+            result = entry->id;
+            *destination_dst = destination;
+            break;
+        }
+    }
+    return result;
+}
+
+// Pawn can be left outside of sim region of its order destination, for example if leader has walked away
+// Such order is returned to pending list, so pawn of that region can take it
+static void release_unreachable_order(WorldState *world_state, SimRegion *sim, Entity *entity) {
+    if (IS_NOT_NULL(entity->order) && !entity->interaction.kind) {
+        Order *order = get_order_by_id(&world_state->order_system, entity->order);
+        if (!get_entity_by_id(sim, order->destination_id)) {
+            set_order_unassigned(&world_state->order_system, entity->order);
+            entity->order = {};
+        }
+    }
+}
+
+// Idle pawn next to its leader has nothing to do until leader moves, new order appears or there is something to haul
+static void sleep_idle_pawn(WorldState *world_state, SimRegion *sim, Entity *entity, Entity *leader) {
+    sleep_sim_entity(world_state, sim, entity, 0, 
+                     SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_ORDER_ADDED) | SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_PLAYER_MOVED) |
+                     SCHEDULER_EVENT_BIT(SCHEDULER_EVENT_HAUL_AVAILABLE), 
+                     leader->id);
+}
+
+static Entity *find_nearest_item_pile(SimRegion *sim, vec2 p) {
+    Entity *result = 0;
+    f32 best_distance_sq = F32_INFINITY;
+    for (u32 item_kind = 0; item_kind < SIM_LOGISTICS_KIND_COUNT; ++item_kind) {
+        if (item_kind == SIM_LOGISTICS_STOCKPILES) {
+            continue;
+        }
+        Entity *pile = find_nearest_sim_logistics_entity(sim, item_kind, p, HAUL_MAX_DISTANCE);
+        if (pile && length_sq(pile->p - p) < best_distance_sq) {
+            result = pile;
+            best_distance_sq = length_sq(pile->p - p);
+        }
+    }
+    return result;
+}
+
+// Items in pile are reserved together with space in stockpile that is nearest to pile,
+// so next pawns only see what is left
+static bool assign_haul_job(SimRegion *sim, Entity *entity, Entity *pile) {
+    assert(IS_NULL(entity->order) && !entity->carry_amount);
+    bool result = false;
+    Entity *stockpile = find_nearest_sim_logistics_entity(sim, SIM_LOGISTICS_STOCKPILES, pile->p);
+    if (stockpile) {
+        u32 amount = PAWN_CARRY_CAPACITY;
+        u32 pile_available = get_sim_logistics_available(sim, pile);
+        u32 stockpile_available = get_sim_logistics_available(sim, stockpile);
+        amount = pile_available < amount ? pile_available : amount;
+        amount = stockpile_available < amount ? stockpile_available : amount;
+        reserve_sim_logistics(sim, pile, amount);
+        reserve_sim_logistics(sim, stockpile, amount);
+        entity->haul_source = pile->id;
+        entity->haul_destination = stockpile->id;
+        entity->carry_kind = pile->item_kind;
+        entity->carry_amount = amount;
+        result = true;
+    }
+    return result;
+}
+
+static void cancel_haul(Entity *entity) {
+    entity->haul_source = {};
+    entity->haul_destination = {};
+    entity->carry_kind = 0;
+    entity->carry_amount = 0;
+}
+
+// Returns entity that hauler walks to. Pile or stockpile can get out of sim region if it moves 
+// away from pawn - job is cancelled then, and items that were already picked up are dropped
+static Entity *get_haul_target(WorldState *world_state, SimRegion *sim, Entity *entity) {
+    assert(entity->carry_amount);
+    Entity *result = 0;
+    Entity *destination = get_entity_by_id(sim, entity->haul_destination);
+    if (destination && (destination->flags & ENTITY_FLAG_IS_DELETED)) {
+        destination = 0;
+    }
+    if (IS_NOT_NULL(entity->haul_source)) {
+        Entity *source = get_entity_by_id(sim, entity->haul_source);
+        if (source && !(source->flags & ENTITY_FLAG_IS_DELETED) && destination) {
+            result = source;
+        } else {
+            if (source && !(source->flags & ENTITY_FLAG_IS_DELETED)) {
+                release_sim_logistics(sim, source, entity->carry_amount);
+            }
+            if (destination) {
+                release_sim_logistics(sim, destination, entity->carry_amount);
+            }
+            cancel_haul(entity);
+        }
+    } else if (destination) {
+        result = destination;
+    } else {
+        drop_items(world_state, sim, entity->p, entity->carry_kind, entity->carry_amount);
+        cancel_haul(entity);
+    }
+    return result;
+}
+
+// Hauler has reached its target - items are picked up from pile or put in stockpile
+// Reserved amount was taken from index when job was assigned, so index does not change
+static void update_hauler(WorldState *world_state, SimRegion *sim, Entity *entity, Entity *target) {
+    if (IS_NOT_NULL(entity->haul_source)) {
+        assert(target->kind == ENTITY_KIND_ITEM_PILE && target->item_amount >= entity->carry_amount);
+        target->item_amount -= entity->carry_amount;
+        if (!target->item_amount) {
+            delete_sim_entity(sim, target);
+        }
+        entity->haul_source = {};
+    } else {
+        assert(target->flags & ENTITY_FLAG_IS_STOCKPILE);
+        target->item_amount += entity->carry_amount;
+        assert(target->item_amount <= target->item_capacity);
+        if (entity->carry_kind == RESOURCE_KIND_WOOD) {
+            world_state->wood_count += entity->carry_amount;
+        } else if (entity->carry_kind == RESOURCE_KIND_GOLD) {
+            world_state->gold_count += entity->carry_amount;
+        } else {
+            NOT_IMPLEMENTED;
+        }
+        ++world_state->haul_jobs_finished;
+        cancel_haul(entity);
+    }
+}
+
+void init_pawn_utility(UtilityEvaluator *utility) {
+    *utility = {};
+    u32 follow = add_utility_action(utility, 0.3f);
+    // Pawn that has fallen behind wants to catch up more
+    add_utility_consideration(utility, follow, PAWN_UTILITY_INPUT_DISTANCE, utility_curve_linear(0.5f, 0.5f));
+    u32 take_order = add_utility_action(utility, 1.0f);
+    add_utility_consideration(utility, take_order, PAWN_UTILITY_INPUT_AVAILABLE, utility_curve_linear(1.0f, 0.0f));
+    // Orders are given by player, so they are worth walking to even if they are far
+    add_utility_consideration(utility, take_order, PAWN_UTILITY_INPUT_DISTANCE, utility_curve_linear(-0.5f, 1.0f));
+    u32 haul = add_utility_action(utility, 0.8f);
+    add_utility_consideration(utility, haul, PAWN_UTILITY_INPUT_AVAILABLE, utility_curve_linear(1.0f, 0.0f));
+    add_utility_consideration(utility, haul, PAWN_UTILITY_INPUT_DISTANCE, utility_curve_smoothstep(true));
+    assert(follow == PAWN_ACTION_FOLLOW_LEADER && take_order == PAWN_ACTION_TAKE_ORDER && haul == PAWN_ACTION_HAUL);
+}
+
+// Pawns that have nothing to do choose what to do next all at once. Inputs are collected for each pawn,
+// actions are scored with utility AI and then chosen jobs are assigned
+static void assign_pawn_jobs(WorldState *world_state, SimRegion *sim, Entity *leader) {
+    TIMED_FUNCTION();
+    SimRegionPawns *pawns = &sim->pawns;
+    u32 *free_pawn_indices = alloc_arr(world_state->frame_arena, pawns->count, u32, false);
+    u32 free_pawn_count = 0;
+    for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+        Entity *entity = get_pawn_entity(sim, pawn_idx);
+        release_unreachable_order(world_state, sim, entity);
+        if (IS_NULL(entity->order) && !entity->carry_amount) {
+            free_pawn_indices[free_pawn_count++] = pawn_idx;
+        }
+    }
+    
+    UtilityEvaluator *utility = &world_state->pawn_utility;
+    begin_utility_evaluation(utility, world_state->frame_arena, free_pawn_count);
+    Entity *order_destination = 0;
+    OrderListEntry *order_cursor = world_state->order_system.pending_list.next;
+    OrderID order_id = get_pending_order_in_sim(world_state, sim, &order_cursor, &order_destination);
+    bool can_haul = sim->logistics.entry_counts[SIM_LOGISTICS_STOCKPILES] != 0;
+    Entity **piles = alloc_arr(world_state->frame_arena, free_pawn_count, Entity *, false);
+    f32 order_distance_scale = 1.0f / (sim->chunk_radius * CHUNK_SIZE);
+    for (u32 free_idx = 0; free_idx < free_pawn_count; ++free_idx) {
+        Entity *entity = get_pawn_entity(sim, free_pawn_indices[free_idx]);
+        f32 leader_distance = length(leader->p - entity->p) / PAWN_FOLLOW_DISTANCE_SCALE;
+        set_utility_input(utility, PAWN_ACTION_FOLLOW_LEADER, PAWN_UTILITY_INPUT_DISTANCE, free_idx, Min(leader_distance, 1.0f));
+        if (IS_NOT_NULL(order_id)) {
+            f32 order_distance = length(order_destination->p - entity->p) * order_distance_scale;
+            set_utility_input(utility, PAWN_ACTION_TAKE_ORDER, PAWN_UTILITY_INPUT_AVAILABLE, free_idx, 1.0f);
+            set_utility_input(utility, PAWN_ACTION_TAKE_ORDER, PAWN_UTILITY_INPUT_DISTANCE, free_idx, Min(order_distance, 1.0f));
+        }
+        piles[free_idx] = can_haul ? find_nearest_item_pile(sim, entity->p) : 0;
+        if (piles[free_idx]) {
+            f32 pile_distance = length(piles[free_idx]->p - entity->p) / HAUL_MAX_DISTANCE;
+            set_utility_input(utility, PAWN_ACTION_HAUL, PAWN_UTILITY_INPUT_AVAILABLE, free_idx, 1.0f);
+            set_utility_input(utility, PAWN_ACTION_HAUL, PAWN_UTILITY_INPUT_DISTANCE, free_idx, Min(pile_distance, 1.0f));
+        }
+    }
+    evaluate_utility(utility);
+    
+    u32 action_counts[PAWN_ACTION_SENTINEL] = {};
+    for (u32 free_idx = 0; free_idx < free_pawn_count; ++free_idx) {
+        Entity *entity = get_pawn_entity(sim, free_pawn_indices[free_idx]);
+        u32 action = utility->best_actions[free_idx];
+        assert(action < PAWN_ACTION_SENTINEL);
+        // Pawns that chose job that has already been taken by others wait for next evaluation
+        if (action == PAWN_ACTION_TAKE_ORDER && IS_NOT_NULL(order_id)) {
+            entity->order = order_id;
+            set_order_assigned(&world_state->order_system, order_id);
+            order_id = get_pending_order_in_sim(world_state, sim, &order_cursor, &order_destination);
+            ++action_counts[action];
+        } else if (action == PAWN_ACTION_HAUL) {
+            Entity *pile = piles[free_idx];
+            if (!get_sim_logistics_available(sim, pile)) {
+                pile = find_nearest_item_pile(sim, entity->p);
+            }
+            if (pile && assign_haul_job(sim, entity, pile)) {
+                ++action_counts[action];
+            }
+        } else if (action == PAWN_ACTION_FOLLOW_LEADER) {
+            ++action_counts[action];
         }
     }
+    DEBUG_VALUE(action_counts[PAWN_ACTION_FOLLOW_LEADER], "Pawns chose follow");
+    DEBUG_VALUE(action_counts[PAWN_ACTION_TAKE_ORDER], "Pawns chose order");
+    DEBUG_VALUE(action_counts[PAWN_ACTION_HAUL], "Pawns chose haul");
 }
 
-void update_game(WorldState *world_state, SimRegion *sim, InputManager *input) {
+// Pawn decisions are made one by one, but actual movement is done for all pawns at once
+// in update_sim_pawns. Pawns access their entities directly, and only pawns that have
+// orders need to look up other entities
+// Only awake pawns are in sim pawn arrays - pawns that wait for something are put to sleep
+// and are woken by scheduler
+// Pawns without orders follow leader - anchor entity of sim region
+// Pawns only avoid each other in regions with full level of detail, in reduced ones nobody sees them overlap
+static void update_pawns(WorldState *world_state, SimRegion *sim, InputManager *input, Entity *leader, f32 dt, 
+                         bool should_avoid) {
+    TIMED_FUNCTION();
+    wake_sim_entities(world_state, sim);
+    assign_pawn_jobs(world_state, sim, leader);
+    SimRegionPawns *pawns = &sim->pawns;
+    for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+        Entity *entity = get_pawn_entity(sim, pawn_idx);
+        vec2 target = leader->p;
+        f32 stop_distance_sq = PAWN_DISTANCE_TO_PLAYER_SQ;
+        if (IS_NOT_NULL(entity->order)) {
+            stop_distance_sq = F32_INFINITY;
+            Order *order = get_order_by_id(&world_state->order_system, entity->order);
+            if (order->kind == ORDER_CHOP) {
+                Entity *to_chop = get_entity_by_id(sim, order->destination_id);
+                assert(to_chop); 
+                target = to_chop->p;
+                stop_distance_sq = DISTANCE_TO_INTERACT_SQ;
+                if (length_sq(target - entity->p) <= DISTANCE_TO_INTERACT_SQ) {
+                    update_interaction(world_state, sim, entity, input);
+                }
+            } else if (order->kind == ORDER_BUILD) {
+                Entity *site = get_entity_by_id(sim, order->destination_id);
+                assert(site);
+                target = site->p;
+                stop_distance_sq = DISTANCE_TO_INTERACT_SQ;
+                if (length_sq(target - entity->p) <= DISTANCE_TO_INTERACT_SQ) {
+                    update_builder(world_state, sim, entity);
+                }
+            }
+        } else if (entity->carry_amount) {
+            Entity *haul_target = get_haul_target(world_state, sim, entity);
+            if (haul_target) {
+                target = haul_target->p;
+                stop_distance_sq = DISTANCE_TO_INTERACT_SQ;
+                if (length_sq(target - entity->p) <= DISTANCE_TO_INTERACT_SQ) {
+                    update_hauler(world_state, sim, entity, haul_target);
+                }
+            }
+        } else if (length_sq(leader->p - entity->p) <= PAWN_DISTANCE_TO_PLAYER_SQ) {
+            sleep_idle_pawn(world_state, sim, entity, leader);
+        }
+        
+        // Pawn that fell asleep stays in arrays until the end of frame, but does not move
+        if (entity->flags & ENTITY_FLAG_IS_SLEEPING) {
+            stop_distance_sq = F32_INFINITY;
+        }
+        pawns->target_x[pawn_idx] = target.x;
+        pawns->target_y[pawn_idx] = target.y;
+        pawns->stop_distance_sq[pawn_idx] = stop_distance_sq;
+    }
+    
+    update_sim_pawns(sim, PAWN_SPEED, dt, should_avoid);
+}
+
+// Pawns of distant regions don't walk - pawn that has somewhere to go is moved to destination
+// at once and sleeps for as long as the walk would take, so work is done at the same rate as in full detail
+static void update_pawns_aggregate(WorldState *world_state, SimRegion *sim, InputManager *input, Entity *leader) {
+    TIMED_FUNCTION();
+    wake_sim_entities(world_state, sim);
+    EntityScheduler *scheduler = &world_state->scheduler;
+    assign_pawn_jobs(world_state, sim, leader);
+    SimRegionPawns *pawns = &sim->pawns;
+    for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+        Entity *entity = get_pawn_entity(sim, pawn_idx);
+        vec2 target = leader->p;
+        f32 stop_distance_sq = PAWN_DISTANCE_TO_PLAYER_SQ;
+        Entity *haul_target = 0;
+        if (IS_NOT_NULL(entity->order)) {
+            Order *order = get_order_by_id(&world_state->order_system, entity->order);
+            assert(order->kind == ORDER_CHOP || order->kind == ORDER_BUILD);
+            Entity *destination = get_entity_by_id(sim, order->destination_id);
+            assert(destination);
+            target = destination->p;
+            stop_distance_sq = DISTANCE_TO_INTERACT_SQ;
+        } else if (entity->carry_amount) {
+            haul_target = get_haul_target(world_state, sim, entity);
+            if (haul_target) {
+                target = haul_target->p;
+                stop_distance_sq = DISTANCE_TO_INTERACT_SQ;
+            }
+        }
+        
+        f32 distance_sq = length_sq(target - entity->p);
+        if (distance_sq > stop_distance_sq) {
+            change_entity_position(sim, entity, target);
+            u64 walk_ticks = get_scheduler_ticks(Sqrt(distance_sq) / PAWN_SPEED);
+            if (walk_ticks) {
+                sleep_sim_entity(world_state, sim, entity, scheduler->current_tick + walk_ticks, 0);
+            }
+        } else if (IS_NOT_NULL(entity->order)) {
+            Order *order = get_order_by_id(&world_state->order_system, entity->order);
+            if (order->kind == ORDER_BUILD) {
+                update_builder(world_state, sim, entity);
+            } else {
+                update_interaction(world_state, sim, entity, input);
+            }
+        } else if (haul_target) {
+            update_hauler(world_state, sim, entity, haul_target);
+        } else {
+            sleep_idle_pawn(world_state, sim, entity, leader);
+        }
+    }
+}
+
+static void update_player(WorldState *world_state, SimRegion *sim, InputManager *input, Entity *camera_controlled_entity) {
     TIMED_FUNCTION();
     if (is_key_held(input, KEY_Z)) {
         f32 x_view_coef = 1.0f * input->platform->frame_dt;
@@ -201,8 +879,6 @@ void update_game(WorldState *world_state, SimRegion *sim, InputManager *input) {
     world_state->cam.pitch = Clamp(world_state->cam.pitch, MIN_CAM_PITCH, MAX_CAM_PITCH);
     world_state->cam.distance_from_player = Clamp(world_state->cam.distance_from_player, 0.5f, 1000);
     
-    Entity *camera_controlled_entity = get_entity_by_id(sim, world_state->camera_followed_entity);
-    assert(camera_controlled_entity);
     // Calculate player movement
     vec2 player_delta = Vec2(0);
     f32 move_coef = 16.0f * input->platform->frame_dt;
@@ -225,10 +901,17 @@ void update_game(WorldState *world_state, SimRegion *sim, InputManager *input) {
     player_delta.y += x_speed * Sin(world_state->cam.yaw);     
     vec2 new_p = camera_controlled_entity->p + player_delta;
     change_entity_position(sim, camera_controlled_entity, new_p);
+    if (player_delta.x != 0 || player_delta.y != 0) {
+        signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_PLAYER_MOVED, camera_controlled_entity->id);
+    }
     {DEBUG_VALUE_BLOCK("Player")
             DEBUG_VALUE(camera_controlled_entity->p, "Position");
         DEBUG_VALUE(sim->center_chunk_x, "Center chunk x");
         DEBUG_VALUE(sim->center_chunk_y, "Center chunk y");
+        vec2 densest_wood_p;
+        f32 wood_influence = get_sim_influence_max(sim, INFLUENCE_LAYER_WOOD, camera_controlled_entity->p, CHUNK_SIZE, &densest_wood_p);
+        DEBUG_VALUE(wood_influence, "Wood influence");
+        DEBUG_VALUE(densest_wood_p, "Densest wood");
     }
     
     vec3 center_pos = xz(camera_controlled_entity->p);
@@ -272,9 +955,18 @@ void update_game(WorldState *world_state, SimRegion *sim, InputManager *input) {
             min_distance = distance_to_mouse_sq;
         }
     }
-    // Add selected entity to job queue if it fits
+    if (is_key_pressed(input, KEY_MOUSE_RIGHT)) {
+        world_state->building_kind_to_place = 0;
+    }
+    // Place building if it was chosen, otherwise add selected entity to job queue if it fits
     if (is_key_pressed(input, KEY_MOUSE_LEFT)) {
-        if (IS_NOT_NULL(world_state->mouse_selected_entity)) {
+        if (world_state->building_kind_to_place) {
+            i32 cell_x = Floor_i32(world_state->mouse_projection.x / CELL_SIZE);
+            i32 cell_y = Floor_i32(world_state->mouse_projection.y / CELL_SIZE);
+            if (IS_NOT_NULL(add_construction_site(world_state, sim, world_state->building_kind_to_place, cell_x, cell_y))) {
+                world_state->building_kind_to_place = 0;
+            }
+        } else if (IS_NOT_NULL(world_state->mouse_selected_entity)) {
             Entity *entity = get_entity_by_id(sim, world_state->mouse_selected_entity);
             if (entity->kind == ENTITY_KIND_WORLD_OBJECT) {
                 WorldObjectSpec spec = get_spec_for_type(world_state, entity->world_object_kind);
@@ -282,59 +974,42 @@ void update_game(WorldState *world_state, SimRegion *sim, InputManager *input) {
                     Order order = {};
                     order.kind = ORDER_CHOP;
                     order.destination_id = world_state->mouse_selected_entity;
-                    try_to_add_order(&world_state->order_system, order);
+                    if (IS_NOT_NULL(try_to_add_order(&world_state->order_system, order))) {
+                        // Any idle pawn can take new order, pawns that don't get it fall asleep again
+                        signal_scheduler_event(&world_state->scheduler, SCHEDULER_EVENT_ORDER_ADDED);
+                    }
                 }
             }
             
         }
     }
+}
+
+void update_game(WorldState *world_state, SimRegion *sim, InputManager *input, Anchor *anchor, f32 dt) {
+    TIMED_FUNCTION();
+    // Only sim region that has player in it is controlled by input
+    Entity *camera_controlled_entity = get_entity_by_id(sim, world_state->camera_followed_entity);
+    if (camera_controlled_entity) {
+        update_player(world_state, sim, input, camera_controlled_entity);
+    }
     
-    vec2 player_pos = camera_controlled_entity->p;
-    for (u32 pawn_idx = 0; 
-         pawn_idx < world_state->pawn_count;
-         ++pawn_idx) {
-        EntityID pawn_id = world_state->pawns[pawn_idx];
-        Entity *entity = get_entity_by_id(sim, pawn_id);
-        // @TODO maybe we want all pawns to be made anchors with small radius 
-        if (entity) {
-            if (IS_NULL(entity->order)) {
-                OrderID order_id = get_pending_order_id(&world_state->order_system);
-                if (IS_NOT_NULL(order_id)) {
-                    entity->order = order_id;
-                    set_order_assigned(&world_state->order_system, order_id);
-                }
-            }
-            
-            if (IS_NOT_NULL(entity->order)) {
-                Order *order = get_order_by_id(&world_state->order_system, entity->order);
-                if (order->kind == ORDER_CHOP) {
-                    Entity *to_chop = get_entity_by_id(sim, order->destination_id);
-                    assert(to_chop); 
-                    // @TODO what do we do if entity is outside of sim region - 
-                    // set new state for order like out of bounds and request new one
-                    vec2 delta = to_chop->p - entity->p;
-                    if (length_sq(delta) > DISTANCE_TO_INTERACT_SQ) {
-                        vec2 delta_p = normalize(delta) * PAWN_SPEED * input->platform->frame_dt;
-                        vec2 new_pawn_p = entity->p + delta_p;
-                        change_entity_position(sim, entity, new_pawn_p);
-                    } else {
-                        update_interaction(world_state, sim, entity, input);
-                        // to_chop->flags |= ENTITY_FLAG_IS_DELETED;
-                        // disband_order(&world_state->order_system, entity->order);
-                        // entity->order = {};
-                    }
-                }
-            } else { 
-                vec2 delta = player_pos - entity->p;
-                if (length_sq(delta) > PAWN_DISTANCE_TO_PLAYER_SQ) {
-                    vec2 delta_p = normalize(delta) * PAWN_SPEED * input->platform->frame_dt;
-                    vec2 new_pawn_p = entity->p + delta_p;
-                    change_entity_position(sim, entity, new_pawn_p);
-                }
-            }
-        }
+    Entity *leader = get_entity_by_id(sim, anchor->entity);
+    assert(leader);
+    if (anchor->lod == SIM_LOD_AGGREGATE) {
+        update_pawns_aggregate(world_state, sim, input, leader);
+    } else {
+        update_pawns(world_state, sim, input, leader, dt, anchor->lod == SIM_LOD_FULL);
+    }
+    update_construction_sites(world_state, sim, dt);
+}
+
+static f32 get_entity_billboard_size(Entity *entity) {
+    f32 result = MAX_BILLBOARD_SIZE;
+    // Piles are drawn as small version of object items come from
+    if (entity->kind == ENTITY_KIND_ITEM_PILE) {
+        result = ITEM_PILE_BILLBOARD_SIZE;
     }
-    // Assign job to pawn if 
+    return result;
 }
 
 void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *commands, Assets *assets, InputManager *input) {
@@ -346,7 +1021,15 @@ void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *comm
     // Ground
     // 
     u32 chunk_count = get_chunk_count_for_radius(sim->chunk_radius);
+    // Chunks are culled before anything is pushed. Entities of chunk can only be visible if chunk bounds
+    // grown by billboard size are, because entity billboard starts at its position
+    Frustum frustum = frustum_from_mvp(world_state->mvp);
+    bool *chunk_has_visible_entities = alloc_arr(world_state->frame_arena, chunk_count, bool);
+    u32 visible_chunk_count = 0;
     AssetID ground_tex = assets_get_first_of_type(assets, ASSET_TYPE_GRASS);
+    Texture ground_texture = get_texture(&render_group, ground_tex);
+    u32 ground_chunks_rebuilt = 0;
+    ++world_state->render_frame;
     BEGIN_BLOCK("Ground render");
     for (u32 i = 0; i < chunk_count; ++i) {
         SimRegionChunk *chunk = sim->chunks + i;
@@ -357,15 +1040,61 @@ void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *comm
             Vec3(chunk->chunk_x + 1, 0, chunk->chunk_y) * CHUNK_SIZE,
             Vec3(chunk->chunk_x + 1, 0, chunk->chunk_y + 1) * CHUNK_SIZE,
         };
-        vec3 p1[4];
-        memcpy(p1, p, sizeof(p));
-        p1[0].y = WORLD_EPSILON;
-        p1[1].y = WORLD_EPSILON;
-        p1[2].y = WORLD_EPSILON;
-        p1[3].y = WORLD_EPSILON;
-        push_quad(&render_group, p, ground_tex);
-        if (world_state->draw_frames) {
-            DEBUG_push_quad_outline(&render_group, p1);
+        vec3 billboard_margin = Vec3(MAX_BILLBOARD_SIZE, 0, MAX_BILLBOARD_SIZE);
+        chunk_has_visible_entities[i] = is_box_in_frustum(&frustum, p[0] - billboard_margin, 
+                                                          p[3] + billboard_margin + Vec3(0, MAX_BILLBOARD_SIZE, 0));
+        if (!is_box_in_frustum(&frustum, p[0], p[3])) {
+            continue;
+        }
+        ++visible_chunk_count;
+        
+        u32 entry_idx = ((u32)chunk->chunk_y % GROUND_CACHE_SIZE) * GROUND_CACHE_SIZE + (u32)chunk->chunk_x % GROUND_CACHE_SIZE;
+        GroundCacheEntry *entry = world_state->ground_cache + entry_idx;
+        bool is_cached = entry->geometry && entry->chunk_x == chunk->chunk_x && entry->chunk_y == chunk->chunk_y &&
+            entry->texture.index == ground_texture.index && entry->texture.generation == ground_texture.generation &&
+            entry->texture.x == ground_texture.x && entry->texture.y == ground_texture.y && 
+            entry->texture.width == ground_texture.width && entry->texture.height == ground_texture.height;
+        // Geometry of entry that was already drawn this frame can't be changed, because draw command references it
+        if (!is_cached && entry->last_render_frame != world_state->render_frame) {
+            if (!entry->geometry) {
+                entry->geometry = create_retained_geometry(commands);
+            }
+            if (entry->geometry) {
+                clear_retained_geometry(commands, entry->geometry);
+                add_retained_quad(commands, entry->geometry, p[0], p[1], p[2], p[3], WHITE, 
+                                  Vec2(0, 0), Vec2(0, 1), Vec2(1, 0), Vec2(1, 1), ground_texture);
+                entry->chunk_x = chunk->chunk_x;
+                entry->chunk_y = chunk->chunk_y;
+                entry->texture = ground_texture;
+                is_cached = true;
+                ++ground_chunks_rebuilt;
+            }
+        }
+        
+        if (is_cached) {
+            push_retained_geometry(commands, entry->geometry);
+            entry->last_render_frame = world_state->render_frame;
+        } else {
+            push_quad(&render_group, p, ground_tex);
+        }
+    }
+    DEBUG_VALUE(ground_chunks_rebuilt, "Ground chunks rebuilt");
+    DEBUG_VALUE(visible_chunk_count, "Visible chunks");
+    DEBUG_VALUE(chunk_count - visible_chunk_count, "Culled chunks");
+    // Outlines face camera, so they are not retained. They are drawn after ground, so retained draws are not split
+    if (world_state->draw_frames) {
+        for (u32 i = 0; i < chunk_count; ++i) {
+            SimRegionChunk *chunk = sim->chunks + i;
+            vec3 p[4] = {
+                Vec3(chunk->chunk_x, 0, chunk->chunk_y) * CHUNK_SIZE,
+                Vec3(chunk->chunk_x, 0, chunk->chunk_y + 1) * CHUNK_SIZE,
+                Vec3(chunk->chunk_x + 1, 0, chunk->chunk_y) * CHUNK_SIZE,
+                Vec3(chunk->chunk_x + 1, 0, chunk->chunk_y + 1) * CHUNK_SIZE,
+            };
+            for (u32 vertex_idx = 0; vertex_idx < 4; ++vertex_idx) {
+                p[vertex_idx].y = WORLD_EPSILON;
+            }
+            DEBUG_push_quad_outline(&render_group, p);
         }
     }
     vec2 mouse_cell_pos = Vec2(Floor(world_state->mouse_projection.x), Floor(world_state->mouse_projection.y));
@@ -409,25 +1138,86 @@ void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *comm
         AssetID select_tex_id = assets_get_first_of_type(assets, ASSET_TYPE_ADDITIONAL);
         push_quad(&render_group, v, select_tex_id);
     }
+    // Cell where building would be placed, tinted by whether it can be placed there
+    if (world_state->building_kind_to_place) {
+        i32 cell_x = Floor_i32(world_state->mouse_projection.x / CELL_SIZE);
+        i32 cell_y = Floor_i32(world_state->mouse_projection.y / CELL_SIZE);
+        vec4 color = check_spatial_placement(sim, cell_x, cell_y, 1, 1) ? Vec4(0, 1, 0, 0.5f) : Vec4(1, 0, 0, 0.5f);
+        vec3 v[4];
+        v[0] = Vec3(cell_x * CELL_SIZE, WORLD_EPSILON, cell_y * CELL_SIZE);
+        v[1] = Vec3(cell_x * CELL_SIZE, WORLD_EPSILON, (cell_y + 1) * CELL_SIZE);
+        v[2] = Vec3((cell_x + 1) * CELL_SIZE, WORLD_EPSILON, cell_y * CELL_SIZE);
+        v[3] = Vec3((cell_x + 1) * CELL_SIZE, WORLD_EPSILON, (cell_y + 1) * CELL_SIZE);
+        AssetID select_tex_id = assets_get_first_of_type(assets, ASSET_TYPE_ADDITIONAL);
+        push_quad(&render_group, v, color, select_tex_id);
+    }
     END_BLOCK();
     
     //
     // Entities
     //
     BEGIN_BLOCK("Render entities");
-    SortEntry *sort_a = alloc_arr(world_state->frame_arena, sim->entity_count, SortEntry);
-    SortEntry *sort_b = alloc_arr(world_state->frame_arena, sim->entity_count, SortEntry);
-    vec3 cam_z = world_state->mvp.get_z();
-    for (size_t entity_idx = 0; entity_idx < sim->entity_count; ++entity_idx) {
-        sort_a[entity_idx].sort_key = dot(cam_z, xz(sim->entities[entity_idx].p) - world_state->cam_p);
-        sort_a[entity_idx].sort_index = entity_idx;
-    }
-    radix_sort(sort_a, sort_b, sim->entity_count);
+    // Bounding spheres of billboards of entities from chunks that passed culling are stored as arrays, 
+    // so they can be tested against frustum 4 at a time. Arrays are padded with copies of last sphere
+    u32 candidate_count = 0;
+    u32 max_candidate_count = (u32)sim->entity_count + 3;
+    Entity **candidates = alloc_arr(world_state->frame_arena, max_candidate_count, Entity *, false);
+    f32 *sphere_x = alloc_arr(world_state->frame_arena, max_candidate_count, f32, false);
+    f32 *sphere_y = alloc_arr(world_state->frame_arena, max_candidate_count, f32, false);
+    f32 *sphere_z = alloc_arr(world_state->frame_arena, max_candidate_count, f32, false);
+    f32 *sphere_radius = alloc_arr(world_state->frame_arena, max_candidate_count, f32, false);
     vec3 cam_x = world_state->mvp.get_x();
     vec3 cam_y = world_state->mvp.get_y();
-    for (size_t sorted_idx = 0; sorted_idx < sim->entity_count; ++sorted_idx) {
-        Entity *entity = sim->entities + sort_a[sim->entity_count - sorted_idx - 1].sort_index;
+    vec3 cam_z = world_state->mvp.get_z();
+    for (u32 i = 0; i < chunk_count; ++i) {
+        if (!chunk_has_visible_entities[i]) {
+            continue;
+        }
+        
+        ITERATE(iter, iterate_chunk_entities(sim->chunks + i)) {
+            Entity *entity = get_entity_by_id(sim, *iter.ptr);
+            assert(entity);
+            f32 billboard_size = get_entity_billboard_size(entity);
+            vec3 center = xz(entity->p) + cam_y * (billboard_size * 0.5f);
+            candidates[candidate_count] = entity;
+            sphere_x[candidate_count] = center.x;
+            sphere_y[candidate_count] = center.y;
+            sphere_z[candidate_count] = center.z;
+            // Half of billboard diagonal
+            sphere_radius[candidate_count] = billboard_size * 0.7072f;
+            ++candidate_count;
+        }
+    }
+    for (u32 pad_idx = candidate_count; candidate_count && (pad_idx & 3); ++pad_idx) {
+        sphere_x[pad_idx] = sphere_x[candidate_count - 1];
+        sphere_y[pad_idx] = sphere_y[candidate_count - 1];
+        sphere_z[pad_idx] = sphere_z[candidate_count - 1];
+        sphere_radius[pad_idx] = sphere_radius[candidate_count - 1];
+    }
+    
+    SortEntry32 *sort_a = alloc_arr(world_state->frame_arena, max_candidate_count, SortEntry32, false);
+    SortEntry32 *sort_b = alloc_arr(world_state->frame_arena, max_candidate_count, SortEntry32, false);
+    u32 visible_entity_count = 0;
+    for (u32 candidate_idx = 0; candidate_idx < candidate_count; candidate_idx += 4) {
+        u32 visible_mask = get_spheres_in_frustum_mask(&frustum, F32_4x_load(sphere_x + candidate_idx), F32_4x_load(sphere_y + candidate_idx),
+                                                       F32_4x_load(sphere_z + candidate_idx), F32_4x_load(sphere_radius + candidate_idx));
+        for (u32 lane_idx = 0; lane_idx < 4 && candidate_idx + lane_idx < candidate_count; ++lane_idx) {
+            if (visible_mask & (1 << lane_idx)) {
+                Entity *entity = candidates[candidate_idx + lane_idx];
+                sort_a[visible_entity_count].sort_key = sort_key_to_u32(dot(cam_z, xz(entity->p) - world_state->cam_p));
+                sort_a[visible_entity_count].sort_index = candidate_idx + lane_idx;
+                ++visible_entity_count;
+            }
+        }
+    }
+    DEBUG_VALUE(visible_entity_count, "Visible entities");
+    DEBUG_VALUE((u32)sim->entity_count - visible_entity_count, "Culled entities");
+    
+    SortEntry32 *sort_entries = radix_sort32(sort_a, sort_b, visible_entity_count);
+    for (size_t sorted_idx = 0; sorted_idx < visible_entity_count; ++sorted_idx) {
+        Entity *entity = candidates[sort_entries[visible_entity_count - sorted_idx - 1].sort_index];
         AssetID texture_id;
+        f32 billboard_size = get_entity_billboard_size(entity);
         switch (entity->kind) {
             case ENTITY_KIND_PLAYER: {
                 texture_id = assets_get_first_of_type(assets, ASSET_TYPE_PLAYER);
@@ -436,17 +1226,27 @@ void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *comm
                 AssetTagList match_tags = {};
                 AssetTagList weight_tags = {};
                 match_tags.tags[ASSET_TAG_WORLD_OBJECT_KIND] = entity->world_object_kind;
-                weight_tags.tags[ASSET_TAG_WORLD_OBJECT_KIND] = 1.0f;
+                weight_tags.tags[ASSET_TAG_WORLD_OBJECT_KIND] = 1000.0f;
+                // Only buildings have this tag, so it does not affect other objects
+                match_tags.tags[ASSET_TAG_BUILDING_IS_BUILT] = (entity->flags & ENTITY_FLAG_IS_UNDER_CONSTRUCTION) ? 0.0f : 1.0f;
+                weight_tags.tags[ASSET_TAG_BUILDING_IS_BUILT] = 1.0f;
                 texture_id = assets_get_closest_match(assets, ASSET_TYPE_WORLD_OBJECT, &weight_tags, &match_tags);
             } break;
             case ENTITY_KIND_PAWN: {
                 texture_id = assets_get_first_of_type(assets, ASSET_TYPE_PAWN);
             } break;
+            case ENTITY_KIND_ITEM_PILE: {
+                // Piles have no textures of their own, so they are drawn as small version of object items come from
+                AssetTagList match_tags = {};
+                AssetTagList weight_tags = {};
+                match_tags.tags[ASSET_TAG_WORLD_OBJECT_KIND] = entity->item_kind == RESOURCE_KIND_GOLD ? 
+                    WORLD_OBJECT_KIND_GOLD_DEPOSIT : WORLD_OBJECT_KIND_TREE_FOREST;
+                weight_tags.tags[ASSET_TAG_WORLD_OBJECT_KIND] = 1000.0f;
+                texture_id = assets_get_closest_match(assets, ASSET_TYPE_WORLD_OBJECT, &weight_tags, &match_tags);
+            } break;
             INVALID_DEFAULT_CASE;
         }
-        vec3 v[4];
-        get_billboard_positions(xz(entity->p), cam_x, cam_y, 1.5f, 1.5f, v);
-        push_quad(&render_group, v, texture_id);
+        push_billboard(&render_group, xz(entity->p), cam_x, cam_y, Vec2(billboard_size, billboard_size), WHITE, texture_id);
     }
     END_BLOCK();
     
@@ -457,23 +1257,203 @@ void render_game(WorldState *world_state, SimRegion *sim, RendererCommands *comm
     end_depth_peel(commands);
 }
 
+static u32 get_sim_lod_for_distance(u32 distance) {
+    u32 lod = SIM_LOD_FULL;
+    if (distance > SIM_LOD_AGGREGATE_DISTANCE) {
+        lod = SIM_LOD_AGGREGATE;
+    } else if (distance > SIM_LOD_REDUCED_DISTANCE) {
+        lod = SIM_LOD_REDUCED;
+    }
+    return lod;
+}
+
+// Anchor is promoted as soon as it gets close enough, but demoted only when it is 
+// far enough past tier border
+static u32 get_sim_lod(u32 current_lod, u32 distance) {
+    u32 lod = get_sim_lod_for_distance(distance);
+    if (lod > current_lod) {
+        u32 demotion_distance = distance > SIM_LOD_HYSTERESIS ? distance - SIM_LOD_HYSTERESIS : 0;
+        lod = get_sim_lod_for_distance(demotion_distance);
+        if (lod < current_lod) {
+            lod = current_lod;
+        }
+    }
+    return lod;
+}
+
+void add_ai_anchor(WorldState *world_state, i32 chunk_x, i32 chunk_y, u32 pawn_count) {
+    prefetch_world_chunks(world_state->world, chunk_x, chunk_y, world_state->anchor_radius + WORLD_PREFETCH_CHUNK_MARGIN);
+    complete_world_generation(world_state->world);
+    SimRegion *sim = alloc_struct(world_state->frame_arena, SimRegion);
+    begin_sim(sim, world_state->frame_arena, world_state->world, chunk_x, chunk_y, world_state->anchor_radius);
+    EntityID leader = add_player(sim, Vec2(0));
+    Entropy entropy = { (u32)leader.value * 7919 + 1 };
+    for (u32 pawn_idx = 0; pawn_idx < pawn_count; ++pawn_idx) {
+        vec2 p = Vec2(random_bilateral(&entropy), random_bilateral(&entropy)) * (CHUNK_SIZE * 0.5f);
+        add_pawn(sim, p);
+    }
+    // Anchors of other regions are not written by end_sim of this one, so they are kept
+    u32 anchor_count = world_state->anchor_count;
+    Anchor *anchors = (Anchor *)alloc_copy(world_state->frame_arena, world_state->anchors, sizeof(Anchor) * anchor_count);
+    world_state->anchor_count = 0;
+    end_sim(sim, world_state);
+    Anchor new_anchor = world_state->anchors[0];
+    memcpy(world_state->anchors, anchors, sizeof(Anchor) * anchor_count);
+    world_state->anchors[anchor_count] = new_anchor;
+    world_state->anchor_count = anchor_count + 1;
+}
+
 void update_and_render_world_state(WorldState *world_state, InputManager *input, RendererCommands *commands, Assets *assets) {
+    u64 update_begin_clock = __rdtsc();
+    f64 update_begin_time = get_time();
+    if (world_state->last_update_time != 0) {
+        f64 seconds = update_begin_time - world_state->last_update_time;
+        if (seconds > 0) {
+            f32 clocks_per_second = (f32)((f64)(update_begin_clock - world_state->last_update_clock) / seconds);
+            // Smoothed, so single long frame does not change budget much
+            world_state->clocks_per_second = world_state->clocks_per_second != 0
+                ? world_state->clocks_per_second * 0.9f + clocks_per_second * 0.1f
+                : clocks_per_second;
+        }
+    }
+    world_state->last_update_clock = update_begin_clock;
+    world_state->last_update_time = update_begin_time;
+    // Before clock rate is known there is no budget
+    u64 budget_clocks = world_state->clocks_per_second != 0
+        ? (u64)(world_state->sim_budget_ms * 0.001f * world_state->clocks_per_second)
+        : UINT64_MAX;
+    
+    advance_entity_scheduler(&world_state->scheduler, input->platform->frame_dt);
+    world_state->world->tick = world_state->scheduler.current_tick;
+    // Generate chunks around anchors a bit further than they simulate, so
+    // chunks are ready by the time anchors move to them
+    integrate_generated_world_chunks(world_state->world);
+    for (u32 anchor_idx = 0; anchor_idx < world_state->anchor_count; ++anchor_idx) {
+        Anchor *anchor = world_state->anchors + anchor_idx;
+        prefetch_world_chunks(world_state->world, anchor->chunk_x, anchor->chunk_y, anchor->radius + WORLD_PREFETCH_CHUNK_MARGIN);
+    }
     
     u32 sim_region_count = world_state->anchor_count;
+    // Anchors are copied, because end_sim writes new anchors to the same array
+    Anchor *sim_anchors = (Anchor *)alloc_copy(world_state->frame_arena, world_state->anchors, sizeof(Anchor) * sim_region_count);
+    // Anchors are kept in queue - ones that were not simulated go first, so other regions are updated
+    // in round-robin order. Camera anchor is moved to the front, because it is always updated
+    Anchor *camera_anchor = 0;
+    for (u32 anchor_idx = 0; anchor_idx < sim_region_count; ++anchor_idx) {
+        if (sim_anchors[anchor_idx].entity.value == world_state->camera_followed_entity.value) {
+            Anchor anchor = sim_anchors[anchor_idx];
+            memmove(sim_anchors + 1, sim_anchors, sizeof(Anchor) * anchor_idx);
+            sim_anchors[0] = anchor;
+            camera_anchor = sim_anchors;
+            break;
+        }
+    }
+    Anchor *not_simulated_anchors = alloc_arr(world_state->frame_arena, sim_region_count, Anchor);
+    u32 not_simulated_count = 0;
     // Zero anchor count so it can be set again from different sim regions
     world_state->anchor_count = 0;
     SimRegion *sim_regions = alloc_arr(world_state->frame_arena, sim_region_count, SimRegion);
     u32 total_sim_entities = 0;
     u32 total_sim_chunks = 0;
+    const f32 lod_steps[SIM_LOD_SENTINEL] = { 0.0f, SIM_LOD_REDUCED_STEP, SIM_LOD_AGGREGATE_STEP };
+    u32 lod_anchor_counts[SIM_LOD_SENTINEL] = {};
+    u64 lod_clocks[SIM_LOD_SENTINEL] = {};
+    // At least one region other than camera one is updated each frame, so all of them get updated eventually
+    bool has_updated_budgeted_region = false;
+    world_state->sim_regions_behind = 0;
+    world_state->max_sim_region_lag = 0;
+    world_state->most_behind_anchor = {};
     for (u32 anchor_idx = 0; anchor_idx < sim_region_count; ++anchor_idx) {
-        Anchor *anchor = world_state->anchors + anchor_idx;
+        Anchor *anchor = sim_anchors + anchor_idx;
+        if (camera_anchor) {
+            u32 distance = Abs(anchor->chunk_x - camera_anchor->chunk_x) + Abs(anchor->chunk_y - camera_anchor->chunk_y);
+            anchor->lod = get_sim_lod(anchor->lod, distance);
+        }
+        ++lod_anchor_counts[anchor->lod];
+        anchor->accumulated_dt += input->platform->frame_dt;
+        bool should_update = anchor->accumulated_dt >= lod_steps[anchor->lod];
+        if (should_update && anchor != camera_anchor) {
+            // Cost of region is predicted from its last update
+            u64 elapsed_clocks = __rdtsc() - update_begin_clock;
+            if (has_updated_budgeted_region && elapsed_clocks + anchor->update_clocks > budget_clocks) {
+                should_update = false;
+                f32 lag = anchor->accumulated_dt - lod_steps[anchor->lod];
+                ++world_state->sim_regions_behind;
+                if (lag >= world_state->max_sim_region_lag) {
+                    world_state->max_sim_region_lag = lag;
+                    world_state->most_behind_anchor = anchor->entity;
+                }
+            } else {
+                has_updated_budgeted_region = true;
+            }
+        }
+        if (!should_update) {
+            // Region is not simulated this frame, so its anchor is kept as is
+            not_simulated_anchors[not_simulated_count++] = *anchor;
+            continue;
+        }
+        
+        if (anchor->lod == SIM_LOD_FULL) {
+            BEGIN_BLOCK("Sim LOD full");
+        } else if (anchor->lod == SIM_LOD_REDUCED) {
+            BEGIN_BLOCK("Sim LOD reduced");
+        } else {
+            BEGIN_BLOCK("Sim LOD aggregate");
+        }
+        u64 sim_begin_clock = __rdtsc();
         SimRegion *sim = sim_regions + anchor_idx;
+        u32 first_written_anchor = world_state->anchor_count;
+        // update_game steps region over all of accumulated_dt, so chunks are only caught up to the start of that step.
+        // Otherwise time of frames where region was skipped by its detail level or budget would be counted twice
+        world_state->world->frame_start_tick = anchor->last_sim_tick;
         begin_sim(sim, world_state->frame_arena, world_state->world, anchor->chunk_x, anchor->chunk_y, anchor->radius);
+        sim->work_queue = world_state->high_priority_work_queue;
+        catch_up_sim_region(world_state, sim);
         total_sim_entities += sim->entity_count;
         total_sim_chunks += sim->chunks_count;
-        update_game(world_state, sim, input);
-        render_game(world_state, sim, commands, assets, input);
+        update_game(world_state, sim, input, anchor, anchor->accumulated_dt);
+        // Only region with camera in it is rendered, lower detail regions are never visible
+        if (get_entity_by_id(sim, world_state->camera_followed_entity)) {
+            render_game(world_state, sim, commands, assets, input);
+        }
         end_sim(sim, world_state);
+        u64 sim_clocks = __rdtsc() - sim_begin_clock;
+        // Anchors written by end_sim keep detail level and cost of region they were in
+        for (u32 written_idx = first_written_anchor; written_idx < world_state->anchor_count; ++written_idx) {
+            world_state->anchors[written_idx].lod = anchor->lod;
+            world_state->anchors[written_idx].update_clocks = sim_clocks;
+        }
+        lod_clocks[anchor->lod] += sim_clocks;
+        END_BLOCK();
+    }
+    // Put anchors that were not simulated in front of queue
+    assert(world_state->anchor_count + not_simulated_count <= MAX_ANCHORS);
+    memmove(world_state->anchors + not_simulated_count, world_state->anchors, sizeof(Anchor) * world_state->anchor_count);
+    memcpy(world_state->anchors, not_simulated_anchors, sizeof(Anchor) * not_simulated_count);
+    world_state->anchor_count += not_simulated_count;
+    
+    u64 update_clocks = __rdtsc() - update_begin_clock;
+    {DEBUG_VALUE_BLOCK("Sim budget")
+        f32 update_ms = world_state->clocks_per_second != 0 ? (f32)update_clocks / world_state->clocks_per_second * 1000.0f : 0.0f;
+        f32 max_lag_ms = world_state->max_sim_region_lag * 1000.0f;
+        DEBUG_VALUE(world_state->sim_budget_ms, "Budget ms");
+        DEBUG_VALUE(update_ms, "World update ms");
+        DEBUG_VALUE(world_state->sim_regions_behind, "Regions behind");
+        DEBUG_VALUE(max_lag_ms, "Max lag ms");
+        DEBUG_VALUE(world_state->most_behind_anchor.value, "Most behind anchor");
+    }
+    {DEBUG_VALUE_BLOCK("Sim LOD")
+        // Share of time spent in sim regions of each tier
+        f32 lod_shares[SIM_LOD_SENTINEL];
+        for (u32 lod = 0; lod < SIM_LOD_SENTINEL; ++lod) {
+            lod_shares[lod] = update_clocks ? (f32)lod_clocks[lod] / (f32)update_clocks * 100.0f : 0.0f;
+        }
+        DEBUG_VALUE(lod_anchor_counts[SIM_LOD_FULL], "Full anchors");
+        DEBUG_VALUE(lod_shares[SIM_LOD_FULL], "Full %");
+        DEBUG_VALUE(lod_anchor_counts[SIM_LOD_REDUCED], "Reduced anchors");
+        DEBUG_VALUE(lod_shares[SIM_LOD_REDUCED], "Reduced %");
+        DEBUG_VALUE(lod_anchor_counts[SIM_LOD_AGGREGATE], "Aggregate anchors");
+        DEBUG_VALUE(lod_shares[SIM_LOD_AGGREGATE], "Aggregate %");
     }
     {DEBUG_VALUE_BLOCK("World")
             DEBUG_SWITCH(&world_state->draw_frames, "Frames");
@@ -481,10 +1461,19 @@ void update_and_render_world_state(WorldState *world_state, InputManager *input,
         DEBUG_VALUE(world_state->world->chunks_allocated, "Chunks allocated");
         DEBUG_VALUE(world_state->world->entity_blocks_allocated, "Entity blocks allocated");
         DEBUG_VALUE(world_state->world->entity_ids_allocated, "Entity ids allocated");
+        DEBUG_VALUE(world_state->world->chunks_generated, "Chunks generated");
+        DEBUG_VALUE(world_state->world->generation_jobs_in_flight, "Generation jobs in flight");
         DEBUG_VALUE(total_sim_entities, "Total sim entities");
         DEBUG_VALUE(total_sim_chunks, "Total sim chunks");
         DEBUG_VALUE(world_state->order_system.orders_allocated, "Orders allocated");
+        DEBUG_VALUE(world_state->scheduler.sleeping_count, "Sleeping entities");
+        DEBUG_VALUE(world_state->scheduler.timer_count, "Scheduler timers");
+        DEBUG_VALUE(world_state->scheduler.woken_count, "Woken entities not in sims");
         DEBUG_VALUE(world_state->mouse_selected_entity.value, "Mouse select entity");
         DEBUG_VALUE(world_state->wood_count, "Wood count");
+        DEBUG_VALUE(world_state->gold_count, "Gold count");
+        DEBUG_VALUE(world_state->buildings_finished, "Buildings finished");
+        DEBUG_VALUE(world_state->buildings_built_together, "Buildings built together");
+        DEBUG_VALUE(world_state->haul_jobs_finished, "Haul jobs finished");
     }
 }
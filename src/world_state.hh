@@ -3,7 +3,10 @@
 #include "lib.hh"
 #include "sim_region.hh"
 #include "orders.hh"
+#include "scheduler.hh"
 #include "particle_system.hh"
+#include "utility_ai.hh"
+#include "entity_commands.hh"
 
 struct Camera {
     f32 pitch;
@@ -15,25 +18,96 @@ struct Camera {
 #define DISTANCE_TO_MOUSE_SELECT_SQ (DISTANCE_TO_MOUSE_SELECT * DISTANCE_TO_MOUSE_SELECT)
 #define DISTANCE_TO_INTERACT (0.25f)
 #define DISTANCE_TO_INTERACT_SQ SQ(DISTANCE_TO_INTERACT)
-#define MAX_PLAYER_PAWNS 32
 #define PAWN_DISTANCE_TO_PLAYER 3.0f
 #define PAWN_DISTANCE_TO_PLAYER_SQ SQ(PAWN_DISTANCE_TO_PLAYER)
 #define PAWN_SPEED 3.0f
+// Amount of resources that pawn carries at once
+#define PAWN_CARRY_CAPACITY 20
+// Haulers only take items that are this close, so they don't walk to the other end of sim region
+#define HAUL_MAX_DISTANCE (CHUNK_SIZE * 2)
+// Dropped items are added to pile that is this close instead of making new one
+#define ITEM_PILE_MERGE_DISTANCE 1.0f
+#define STOCKPILE_CAPACITY 1000
+// Each builder takes its own build order, so this many pawns can build single building at once
+#define BUILDING_MAX_BUILDERS 3
+// Distance from leader at which pawn wants to follow it the most
+#define PAWN_FOLLOW_DISTANCE_SCALE CHUNK_SIZE
+// How many chunks around sim regions are generated in advance
+#define WORLD_PREFETCH_CHUNK_MARGIN 3
+#define DEFAULT_ANCHOR_RADIUS 5
+// Distances in chunks from camera-followed anchor, after which anchors are simulated with lower detail
+#define SIM_LOD_REDUCED_DISTANCE 32
+#define SIM_LOD_AGGREGATE_DISTANCE 128
+// Anchor is moved to lower detail only when it is this much further than tier distance,
+// so anchors near the border don't switch tiers back and forth
+#define SIM_LOD_HYSTERESIS 4
+// How often anchors of lower detail tiers are simulated, in seconds
+#define SIM_LOD_REDUCED_STEP 0.25f
+#define SIM_LOD_AGGREGATE_STEP 1.0f
+// Time in milliseconds that sim regions can take each frame. Region of camera-followed anchor
+// is always updated, others are updated in round-robin order while they fit in budget
+#define DEFAULT_SIM_BUDGET_MS 4.0f
+// Chunks that are fast-forwarded are split between worker threads in jobs of at least this many chunks
+#define CATCH_UP_CHUNKS_PER_JOB 64
+#define CATCH_UP_MAX_JOB_COUNT 8
+
+// Actions that pawns without jobs choose from
+enum {
+    PAWN_ACTION_FOLLOW_LEADER,
+    PAWN_ACTION_TAKE_ORDER,
+    PAWN_ACTION_HAUL,
+    PAWN_ACTION_SENTINEL,
+};
+
+// Utility input slots of pawn actions, all in range 0-1
+enum {
+    // 1 if action can be done at all
+    PAWN_UTILITY_INPUT_AVAILABLE,
+    // Distance to action target relative to distance at which it is considered far
+    PAWN_UTILITY_INPUT_DISTANCE,
+};
 
 // Structure that defines all data related to game world - anythting that can or should
 // be saved is placed here
+// Entities are drawn as square billboards of this size, standing on entity position
+#define MAX_BILLBOARD_SIZE 1.5f
+#define ITEM_PILE_BILLBOARD_SIZE 0.5f
+// Ground of rendered chunks is kept in retained geometry, so it is only built again when chunk in cache entry
+// or ground texture changes. Cache is indexed by chunk coordinates modulo its size, so it has to be at least
+// as wide as rendered sim region
+#define GROUND_CACHE_SIZE 16
+struct GroundCacheEntry {
+    i32 chunk_x;
+    i32 chunk_y;
+    Texture texture;
+    // 0 if entry is empty
+    u32 geometry;
+    u32 last_render_frame;
+};
+
 struct WorldState {
     MemoryArena *arena;
     MemoryArena *frame_arena;
     
     World *world;
+    // Jobs of frame that it waits for, world generation uses normal queue of world
+    WorkQueue *high_priority_work_queue;
     
     WorldObjectSpec world_object_specs[WORLD_OBJECT_KIND_SENTINEL];
     u32    anchor_count;
     Anchor anchors[MAX_ANCHORS];
-    
-	EntityID pawns[MAX_PLAYER_PAWNS];
-	u32 pawn_count;
+    // Sim region radius of anchors that are written in end_sim
+    u32    anchor_radius;
+    f32    sim_budget_ms;
+    // Measured from time between frames, because clocks are used to check budget
+    f32    clocks_per_second;
+    u64    last_update_clock;
+    f64    last_update_time;
+    // Regions that were due to update in last frame, but did not fit in budget
+    u32    sim_regions_behind;
+    // Largest time that region that fell behind was due for, in seconds
+    f32    max_sim_region_lag;
+    EntityID most_behind_anchor;
     
     Camera cam;    
     EntityID camera_followed_entity;
@@ -46,13 +120,31 @@ struct WorldState {
     vec2 mouse_projection;
     
     bool draw_frames;
+    u32 render_frame;
+    GroundCacheEntry ground_cache[GROUND_CACHE_SIZE * GROUND_CACHE_SIZE];
     OrderSystem order_system;
+    EntityScheduler scheduler;
     ParticleSystem particle_system;
+    UtilityEvaluator pawn_utility;
     
+    // Resources brought to stockpiles
     u32 wood_count;
+    u32 gold_count;
+    u32 haul_jobs_finished;
+    // Building that is placed with mouse, chosen in interface. 0 if nothing is being placed
+    u32 building_kind_to_place;
+    u32 buildings_finished;
+    // Buildings that had more than one builder when finished
+    u32 buildings_built_together;
 };
 
-void world_state_init(WorldState *world_state, MemoryArena *arena, MemoryArena *frame_arena);
+void world_state_init(WorldState *world_state, MemoryArena *arena, MemoryArena *frame_arena, 
+                      WorkQueue *work_queue, WorkQueue *high_priority_work_queue);
+// Adds anchor entity that is not controlled by player, with pawns around it
+// Must be called outside of world state update
+void add_ai_anchor(WorldState *world_state, i32 chunk_x, i32 chunk_y, u32 pawn_count);
+// Sets up actions and considerations that pawns use to choose jobs
+void init_pawn_utility(UtilityEvaluator *utility);
 void update_and_render_world_state(WorldState *world_state, InputManager *input, RendererCommands *commands, Assets *assets);
 
 #define WORLD_STATE_HH 1
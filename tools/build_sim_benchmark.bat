@@ -0,0 +1,11 @@
+@echo off
+
+cls
+if not exist .\build mkdir build 
+pushd build 
+
+set "build_options=-nologo -fp:fast -O2 -Oi -Zi -FC -MTd -wd4201 -WX -I"..\src" -I"..\thirdparty" -std:c++17 -D_CRT_SECURE_NO_WARNINGS"
+
+cl %build_options% ../tools/sim_benchmark.cc -link -opt:ref gdi32.lib user32.lib kernel32.lib -out:sim_benchmark.exe
+
+popd 
@@ -0,0 +1,5 @@
+#!/bin/sh
+# Headless simulation benchmark for Linux, run from repository root
+set -e
+mkdir -p build
+${CXX:-g++} -std=c++17 -O2 -g -msse4.2 -fno-strict-aliasing -Isrc -Ithirdparty tools/sim_benchmark.cc -o build/sim_benchmark -lpthread
@@ -0,0 +1,11 @@
+@echo off
+
+cls
+if not exist .\build mkdir build 
+pushd build 
+
+set "build_options=-nologo -DINTERNAL_BUILD=0 -fp:fast -O2 -Oi -Zi -FC -MTd -wd4201 -WX -I"..\src" -I"..\thirdparty" -std:c++17 -D_CRT_SECURE_NO_WARNINGS"
+
+cl %build_options% ../tools/world_generation_benchmark.cc -link -opt:ref kernel32.lib -out:world_generation_benchmark.exe
+
+popd 
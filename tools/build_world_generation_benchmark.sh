@@ -0,0 +1,6 @@
+#!/bin/sh
+# World generation benchmark for Linux, run from repository root
+# ARCH_FLAGS=-mavx2 builds 8 wide noise kernels (see SIMD_8X)
+set -e
+mkdir -p build
+${CXX:-g++} -std=c++17 -O2 -g ${ARCH_FLAGS:--msse4.2} -fno-strict-aliasing -DINTERNAL_BUILD=0 -Isrc -Ithirdparty tools/world_generation_benchmark.cc -o build/world_generation_benchmark
@@ -0,0 +1,870 @@
+//
+// Headless simulation benchmark
+// Runs world simulation without window, graphics or sound: renderer commands are written
+// to memory of software renderer and are only executed when asked, assets are fake and input is scripted
+// Scenario: player walks in small circle while turning camera, pawns work on chop orders
+// placed around the start
+//
+// Usage: sim_benchmark [-frames N] [-radius R] [-pawns P] [-orders O] [-seed S] [-ai_anchors A] [-budget_ms B] [-crowd C] [-buildings U]
+//                      [-utility P] [-radix N] [-orders_stress N] [-entity_commands N] [-raster F] [-png file]
+//   radius is sim region radius around player in chunks, world around it is generated
+//   pawns are added to 8 pawns that game starts with
+//   ai anchors are placed further and further from player, so all simulation detail levels are used
+//   budget is time in milliseconds that sim regions can take each frame
+//   buildings are construction sites placed around start with orders to build them
+//   crowd runs only pawn avoidance in dense crowds of sizes up to C instead of scenario,
+//   time per pawn should stay the same as crowd grows
+//   utility only scores pawn actions for P pawns with random inputs instead of scenario
+//   radix only compares old radix sort with serial and parallel radix_sort32 of N entries instead of scenario
+//   orders stress only creates and disbands N orders several times and checks every lookup instead of scenario,
+//   exits with 1 if any check fails
+//   entity commands only creates N entities and moves, deletes and changes them with entity commands recorded by 
+//   1 and by several jobs instead of scenario, exits with 1 if results are different
+//   raster executes renderer commands of every F-th frame with software renderer
+//   png writes last rasterized frame to file, last frame is always rasterized if it is given
+//
+// Prints profiler records summed over all frames and frame time percentiles
+//
+#include "general.hh"
+
+#include <stdlib.h>
+
+#include "debug.cc"
+#include "mips.cc"
+#include "texture_atlas.cc"
+#include "renderer_software.cc"
+#include "render_group.cc"
+#include "assets.cc"
+#include "dev_ui.cc"
+#include "world.cc"
+#include "noise.cc"
+#include "world_generation.cc"
+#include "sim_region.cc"
+#include "world_state.cc"
+#include "orders.cc"
+#include "scheduler.cc"
+#include "utility_ai.cc"
+#include "entity_commands.cc"
+#include "particle_system.cc"
+#if COMPILER_MSVC
+#include "os.cc"
+#else
+#include "os_posix.cc"
+#endif
+
+#define BENCHMARK_FRAME_DT (1.0f / 60.0f)
+#define BENCHMARK_TEXTURE_SIZE 64
+#define BENCHMARK_AI_ANCHOR_PAWNS 16
+#define BENCHMARK_PAWN_DENSITY 0.5f
+// Entities of sim region that scenario does not use for pawns
+#define BENCHMARK_SPARE_ENTITIES 4096
+#define BENCHMARK_CROWD_STEPS 120
+#define BENCHMARK_UTILITY_REPEATS 100
+#define BENCHMARK_RADIX_REPEATS 20
+#define BENCHMARK_ORDERS_STRESS_ROUNDS 4
+#define BENCHMARK_ENTITY_COMMAND_MAX_JOBS 8
+// Sim region of entity commands check is far from start, so it does not take chunks of scenario
+#define BENCHMARK_ENTITY_COMMAND_CHUNK 100000
+
+// Single loaded texture of each type, so asset lookups work without asset file
+// Textures are discs of different colors, so rasterized frames show where sprites are
+// Mipmaps are kept like asset system does, so textures can be packed again if atlas evicts them
+static Assets *create_fake_assets(Renderer *renderer, MemoryArena *frame_arena) {
+    Assets *assets = bootstrap_alloc_struct(Assets, arena);
+    assets->frame_arena = frame_arena;
+    assets->renderer = renderer;
+    assets->asset_info_count = ASSET_TYPE_SENTINEL + 1;
+    assets->asset_infos = alloc_arr(&assets->arena, assets->asset_info_count, Asset);
+    assets->type_info_count = ASSET_TYPE_SENTINEL + 1;
+    assets->type_infos = alloc_arr(&assets->arena, assets->type_info_count, AssetTypeInfo);
+    for (u32 type = 1; type <= ASSET_TYPE_SENTINEL; ++type) {
+        assets->type_infos[type].first_info_idx = type;
+        assets->type_infos[type].asset_count = 1;
+        Asset *asset = assets->asset_infos + type;
+        asset->file_info.kind = ASSET_KIND_TEXTURE;
+        asset->file_info.width = BENCHMARK_TEXTURE_SIZE;
+        asset->file_info.height = BENCHMARK_TEXTURE_SIZE;
+        asset->state = ASSET_STATE_LOADED;
+
+        u32 *texture_data = (u32 *)alloc(&assets->arena, get_total_size_for_mips(BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE));
+        u32 color = crc32(&type, sizeof(type)) | 0xFF000000;
+        f32 radius = BENCHMARK_TEXTURE_SIZE * 0.5f;
+        for (u32 y = 0; y < BENCHMARK_TEXTURE_SIZE; ++y) {
+            for (u32 x = 0; x < BENCHMARK_TEXTURE_SIZE; ++x) {
+                vec2 d = Vec2((f32)x + 0.5f - radius, (f32)y + 0.5f - radius);
+                texture_data[y * BENCHMARK_TEXTURE_SIZE + x] = length_sq(d) < SQ(radius) ? color : 0;
+            }
+        }
+        generate_sequential_mips(BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE, texture_data);
+        asset->texture.mipmaps = texture_data;
+        asset->texture.texture = renderer_create_texture_mipmaps(renderer, texture_data, BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE);
+    }
+    return assets;
+}
+
+// Adds pawns around player and chop orders for resources close to start, so
+// pawns don't chase them outside of sim region while player walks
+// Returns false if pawns don't fit in sim region
+static bool setup_scenario(WorldState *world_state, u32 pawn_count, u32 order_count, u32 building_count, u32 seed) {
+    assert(world_state->anchor_count == 1);
+    Anchor *anchor = world_state->anchors;
+    SimRegion *sim = alloc_struct(world_state->frame_arena, SimRegion);
+    begin_sim(sim, world_state->frame_arena, world_state->world, anchor->chunk_x, anchor->chunk_y, anchor->radius);
+    // Game creates entities too, like item piles of chopped trees, so some space is left for them
+    u64 max_pawn_count = sim->max_entity_count - sim->entity_count;
+    max_pawn_count = max_pawn_count > BENCHMARK_SPARE_ENTITIES ? max_pawn_count - BENCHMARK_SPARE_ENTITIES : 0;
+    if (pawn_count > max_pawn_count) {
+        outf("Sim region of radius %u can fit at most %llu more pawns, use larger radius\n", anchor->radius,
+             (unsigned long long)max_pawn_count);
+        world_state->anchor_count = 0;
+        end_sim(sim, world_state);
+        return false;
+    }
+
+    Entropy entropy = { seed };
+    // Large colonies are spread so there is at most BENCHMARK_PAWN_DENSITY pawns per square unit,
+    // but they have to stay inside of sim region
+    f32 pawn_spread = Max(CHUNK_SIZE * 2, Sqrt(pawn_count / BENCHMARK_PAWN_DENSITY) * 0.5f);
+    pawn_spread = Min(pawn_spread, (anchor->radius - 1) * CHUNK_SIZE * 0.5f);
+    for (u32 pawn_idx = 0; pawn_idx < pawn_count; ++pawn_idx) {
+        vec2 p = Vec2(random_bilateral(&entropy), random_bilateral(&entropy)) * pawn_spread;
+        EntityID pawn = add_pawn(sim, p);
+        assert(IS_NOT_NULL(pawn));
+    }
+
+    u32 orders_added = 0;
+    i32 order_radius = (i32)anchor->radius - 2;
+    for (u32 entity_idx = 0; entity_idx < sim->entity_count && orders_added < order_count; ++entity_idx) {
+        Entity *entity = sim->entities + entity_idx;
+        if (entity->kind != ENTITY_KIND_WORLD_OBJECT) {
+            continue;
+        }
+        WorldObjectSpec spec = get_spec_for_type(world_state, entity->world_object_kind);
+        i32 chunk_x, chunk_y;
+        p_to_chunk_coord(entity->p, &chunk_x, &chunk_y);
+        if (spec.type == WORLD_OBJECT_TYPE_RESOURCE && Abs(chunk_x) + Abs(chunk_y) <= order_radius) {
+            Order order = {};
+            order.kind = ORDER_CHOP;
+            order.destination_id = entity->id;
+            if (IS_NOT_NULL(try_to_add_order(&world_state->order_system, order))) {
+                ++orders_added;
+            }
+        }
+    }
+    
+    u32 buildings_added = 0;
+    f32 building_spread = CHUNK_SIZE;
+    for (u32 attempt_idx = 0; attempt_idx < building_count * 16 && buildings_added < building_count; ++attempt_idx) {
+        vec2 p = Vec2(random_bilateral(&entropy), random_bilateral(&entropy)) * building_spread;
+        u32 kind = (attempt_idx & 1) ? WORLD_OBJECT_KIND_BUILDING2 : WORLD_OBJECT_KIND_BUILDING1;
+        if (IS_NOT_NULL(add_construction_site(world_state, sim, kind, Floor_i32(p.x), Floor_i32(p.y)))) {
+            ++buildings_added;
+        }
+    }
+    outf("Scenario: %u sim entities, %u pawns, %u orders, %u buildings\n", (u32)sim->entity_count, sim->pawns.count, 
+         orders_added, buildings_added);
+    // Anchor is written again by end_sim
+    world_state->anchor_count = 0;
+    end_sim(sim, world_state);
+    return true;
+}
+
+// Destination ids are spread over whole u32 range, so description hashes collide and deletion has to fix probe chains
+static Order get_stress_order(u32 order_idx) {
+    Order result = {};
+    result.kind = (order_idx & 1) ? ORDER_BUILD : ORDER_CHOP;
+    result.destination_id.value = (order_idx + 1) * 2654435761u;
+    return result;
+}
+
+// Orders on N different entities are added, first half of them is assigned and all are disbanded in random order.
+// This is repeated, so freed slots and hash entries are reused. Every lookup is checked against order that was added,
+// and tables must not grow after first round, because backward shift deletion leaves no tombstones. Returns number of failed checks
+static u32 run_orders_stress_benchmark(MemoryArena *arena, u32 order_count, u32 seed) {
+    OrderSystem *sys = alloc_struct(arena, OrderSystem);
+    init_order_system(sys, arena);
+    OrderID *ids = alloc_arr(arena, order_count, OrderID);
+    u32 *disband_indices = alloc_arr(arena, order_count, u32);
+    Entropy entropy = { seed };
+    u32 error_count = 0;
+    u32 id_hash_capacity = 0;
+    u32 description_hash_capacity = 0;
+    f64 add_time = 0;
+    f64 lookup_time = 0;
+    f64 disband_time = 0;
+    for (u32 round_idx = 0; round_idx < BENCHMARK_ORDERS_STRESS_ROUNDS; ++round_idx) {
+        f64 add_start = get_time();
+        for (u32 order_idx = 0; order_idx < order_count; ++order_idx) {
+            ids[order_idx] = try_to_add_order(sys, get_stress_order(order_idx));
+        }
+        add_time += get_time() - add_start;
+        for (u32 order_idx = 0; order_idx < order_count; ++order_idx) {
+            error_count += IS_NULL(ids[order_idx]);
+            // Order with same description already exists
+            error_count += IS_NOT_NULL(try_to_add_order(sys, get_stress_order(order_idx)));
+        }
+        error_count += sys->order_count != order_count;
+        
+        f64 lookup_start = get_time();
+        for (u32 order_idx = 0; order_idx < order_count; ++order_idx) {
+            Order *order = get_order_by_id(sys, ids[order_idx]);
+            Order expected = get_stress_order(order_idx);
+            error_count += !order || order->kind != expected.kind || !IS_SAME(order->destination_id, expected.destination_id);
+        }
+        lookup_time += get_time() - lookup_start;
+        
+        // Pending orders are given out in order of addition
+        for (u32 order_idx = 0; order_idx < order_count / 2; ++order_idx) {
+            OrderID id = get_pending_order_id(sys);
+            error_count += !IS_SAME(id, ids[order_idx]);
+            if (IS_NOT_NULL(id)) {
+                set_order_assigned(sys, id);
+            }
+        }
+        
+        for (u32 order_idx = 0; order_idx < order_count; ++order_idx) {
+            disband_indices[order_idx] = order_idx;
+        }
+        for (u32 order_idx = order_count - 1; order_idx > 0; --order_idx) {
+            u32 swap_idx = (u32)random_int(&entropy, order_idx + 1);
+            u32 temp = disband_indices[order_idx];
+            disband_indices[order_idx] = disband_indices[swap_idx];
+            disband_indices[swap_idx] = temp;
+        }
+        u32 half_count = order_count / 2;
+        f64 disband_start = get_time();
+        for (u32 disband_idx = 0; disband_idx < half_count; ++disband_idx) {
+            disband_order(sys, ids[disband_indices[disband_idx]]);
+        }
+        disband_time += get_time() - disband_start;
+        // Deletion must not break probe chains of orders that are left
+        for (u32 disband_idx = 0; disband_idx < order_count; ++disband_idx) {
+            u32 order_idx = disband_indices[disband_idx];
+            Order *order = get_order_by_id(sys, ids[order_idx]);
+            Order expected = get_stress_order(order_idx);
+            if (disband_idx < half_count) {
+                error_count += order != 0;
+            } else {
+                error_count += !order || !IS_SAME(order->destination_id, expected.destination_id);
+                error_count += IS_NOT_NULL(try_to_add_order(sys, expected));
+            }
+        }
+        disband_start = get_time();
+        for (u32 disband_idx = half_count; disband_idx < order_count; ++disband_idx) {
+            disband_order(sys, ids[disband_indices[disband_idx]]);
+        }
+        disband_time += get_time() - disband_start;
+        
+        error_count += sys->order_count || sys->id_hash.count || sys->description_hash.count;
+        error_count += sys->pending_list.next != &sys->pending_list || sys->assigned_list.next != &sys->assigned_list;
+        if (!round_idx) {
+            id_hash_capacity = sys->id_hash.capacity;
+            description_hash_capacity = sys->description_hash.capacity;
+        } else {
+            error_count += sys->id_hash.capacity != id_hash_capacity || sys->description_hash.capacity != description_hash_capacity;
+        }
+    }
+    error_count += sys->orders_allocated != order_count;
+    
+    f64 op_count = (f64)order_count * BENCHMARK_ORDERS_STRESS_ROUNDS;
+    outf("Orders stress %u orders x %u rounds: add %.1fns, lookup %.1fns, disband %.1fns per order\n",
+         order_count, BENCHMARK_ORDERS_STRESS_ROUNDS, add_time * 1e9 / op_count, lookup_time * 1e9 / op_count, 
+         disband_time * 1e9 / op_count);
+    outf("Hash capacity %u, %u grows, %u slots allocated, %u failed checks\n", sys->id_hash.capacity, 
+         sys->hash_grow_count, sys->orders_allocated, error_count);
+    return error_count;
+}
+
+// Pawns are put in disc with one pawn per square unit and all walk to its center,
+// so crowd only gets denser as it goes
+static void run_crowd_benchmark(WorldState *world_state, MemoryArena *frame_arena, u32 max_pawn_count, u32 seed) {
+    Anchor *anchor = world_state->anchors;
+    for (u32 pawn_count = max_pawn_count / 8 ? max_pawn_count / 8 : 1; pawn_count <= max_pawn_count; pawn_count *= 2) {
+        arena_clear(frame_arena);
+        SimRegion *sim = alloc_struct(frame_arena, SimRegion);
+        begin_sim(sim, frame_arena, world_state->world, anchor->chunk_x, anchor->chunk_y, anchor->radius);
+        sim->work_queue = world_state->high_priority_work_queue;
+        Entropy entropy = { seed };
+        f32 crowd_radius = Sqrt((f32)pawn_count / PI);
+        vec2 crowd_center = Vec2(CHUNK_SIZE * 0.5f);
+        for (u32 pawn_idx = 0; pawn_idx < pawn_count; ++pawn_idx) {
+            vec2 offset;
+            do {
+                offset = Vec2(random_bilateral(&entropy), random_bilateral(&entropy));
+            } while (length_sq(offset) > 1.0f);
+            Entity *entity = create_new_entity(sim, crowd_center + offset * crowd_radius);
+            assert(entity);
+            entity->kind = ENTITY_KIND_PAWN;
+            add_sim_pawn(sim, entity);
+            add_sim_entity_influence(sim, entity);
+        }
+        SimRegionPawns *pawns = &sim->pawns;
+        for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+            pawns->target_x[pawn_idx] = crowd_center.x;
+            pawns->target_y[pawn_idx] = crowd_center.y;
+            pawns->stop_distance_sq[pawn_idx] = 0;
+        }
+        
+        f64 start = get_time();
+        for (u32 step_idx = 0; step_idx < BENCHMARK_CROWD_STEPS; ++step_idx) {
+            update_sim_pawns(sim, PAWN_SPEED, BENCHMARK_FRAME_DT, true);
+        }
+        f64 step_time = (get_time() - start) / BENCHMARK_CROWD_STEPS;
+        
+        u32 overlap_count = 0;
+        SimRegionGrid *grid = &sim->pawn_grid;
+        build_sim_region_grid(grid, frame_arena, pawns->p_x, pawns->p_y, pawns->count, SIM_PAWN_NEIGHBOUR_DISTANCE);
+        for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+            vec2 p = Vec2(pawns->p_x[pawn_idx], pawns->p_y[pawn_idx]);
+            ITERATE(iter, iterate_grid_in_radius(grid, p, SIM_PAWN_RADIUS * 2.0f)) {
+                vec2 other_p = Vec2(grid->p_x[iter.idx], grid->p_y[iter.idx]);
+                if (grid->indices[iter.idx] > pawn_idx && length_sq(other_p - p) < SQ(SIM_PAWN_RADIUS * 2.0f * 0.9f)) {
+                    ++overlap_count;
+                }
+            }
+        }
+        outf("Crowd %6u pawns: %.3fms per step, %.1fns per pawn, %u overlapping pairs after %u steps\n",
+             pawn_count, step_time * 1000.0, step_time * 1e9 / pawn_count, overlap_count, BENCHMARK_CROWD_STEPS);
+        
+        // Crowd is not written back to world
+        for (u32 pawn_idx = 0; pawn_idx < pawns->count; ++pawn_idx) {
+            delete_sim_entity(sim, get_pawn_entity(sim, pawn_idx));
+        }
+        world_state->anchor_count = 0;
+        end_sim(sim, world_state);
+    }
+}
+
+// Pawn actions of game are scored for pawns with random inputs. Result is checked against scalar
+// evaluation, so SIMD path can't get faster by being wrong
+static void run_utility_benchmark(WorldState *world_state, MemoryArena *frame_arena, u32 pawn_count, u32 seed) {
+    arena_clear(frame_arena);
+    UtilityEvaluator *utility = &world_state->pawn_utility;
+    begin_utility_evaluation(utility, frame_arena, pawn_count);
+    Entropy entropy = { seed };
+    for (u32 action_idx = 0; action_idx < utility->action_count; ++action_idx) {
+        for (u32 input_idx = 0; input_idx < UTILITY_MAX_INPUTS; ++input_idx) {
+            f32 *inputs = get_utility_inputs(utility, action_idx, input_idx);
+            for (u32 pawn_idx = 0; pawn_idx < pawn_count; ++pawn_idx) {
+                // Availability inputs are 0 or 1
+                inputs[pawn_idx] = input_idx == PAWN_UTILITY_INPUT_AVAILABLE 
+                    ? (random(&entropy) < 0.7f ? 1.0f : 0.0f) : random(&entropy);
+            }
+        }
+    }
+    
+    f64 start = get_time();
+    for (u32 repeat_idx = 0; repeat_idx < BENCHMARK_UTILITY_REPEATS; ++repeat_idx) {
+        evaluate_utility(utility);
+    }
+    f64 evaluation_time = (get_time() - start) / BENCHMARK_UTILITY_REPEATS;
+    
+    u32 mismatch_count = 0;
+    u32 action_counts[UTILITY_MAX_ACTIONS] = {};
+    for (u32 pawn_idx = 0; pawn_idx < pawn_count; ++pawn_idx) {
+        u32 best_action = 0;
+        f32 best_score = -1.0f;
+        for (u32 action_idx = 0; action_idx < utility->action_count; ++action_idx) {
+            UtilityAction *action = utility->actions + action_idx;
+            f32 score = action->weight;
+            for (u32 consideration_idx = 0; consideration_idx < action->consideration_count; ++consideration_idx) {
+                UtilityConsideration *consideration = action->considerations + consideration_idx;
+                f32 x = get_utility_inputs(utility, action_idx, consideration->input)[pawn_idx];
+                score *= evaluate_utility_curve(consideration->curve, x);
+            }
+            if (score > best_score) {
+                best_score = score;
+                best_action = action_idx;
+            }
+        }
+        mismatch_count += best_action != utility->best_actions[pawn_idx];
+        ++action_counts[utility->best_actions[pawn_idx]];
+    }
+    f64 pair_count = (f64)pawn_count * utility->action_count;
+    outf("Utility %u pawns x %u actions: %.3fms per evaluation, %.0f pairs per ms, %u mismatches with scalar\n",
+         pawn_count, utility->action_count, evaluation_time * 1000.0, pair_count / (evaluation_time * 1000.0), mismatch_count);
+    outf("Follow %u, order %u, haul %u\n", action_counts[PAWN_ACTION_FOLLOW_LEADER], 
+         action_counts[PAWN_ACTION_TAKE_ORDER], action_counts[PAWN_ACTION_HAUL]);
+}
+
+enum {
+    BENCHMARK_RADIX_KEYS_DEPTH,
+    BENCHMARK_RADIX_KEYS_NARROW,
+    BENCHMARK_RADIX_KEYS_SENTINEL,
+};
+
+// Depth keys are spread over whole sim region, narrow ones are in [1; 1.5), so high digit of their keys is the same
+// and radix_sort32 skips its pass. Results of all sorts have to be the same, as all of them are stable
+// Parallel sort is called directly, so it is measured even where radix_sort32 would not use it
+static void run_radix_benchmark(MemoryArena *frame_arena, WorkQueue *queue, u32 entry_count, u32 seed) {
+    const char *key_names[] = { "depth", "narrow" };
+    CT_ASSERT(ARRAY_SIZE(key_names) == BENCHMARK_RADIX_KEYS_SENTINEL);
+    for (u32 keys = 0; keys < BENCHMARK_RADIX_KEYS_SENTINEL; ++keys) {
+        arena_clear(frame_arena);
+        Entropy entropy = { seed };
+        f32 spread = (DEFAULT_ANCHOR_RADIUS + 0.5f) * CHUNK_SIZE;
+        f32 *sort_keys = alloc_arr(frame_arena, entry_count, f32);
+        for (u32 entry_idx = 0; entry_idx < entry_count; ++entry_idx) {
+            sort_keys[entry_idx] = keys == BENCHMARK_RADIX_KEYS_DEPTH ? random_bilateral(&entropy) * spread : 1.0f + random(&entropy) * 0.5f;
+        }
+        SortEntry *baseline_a = alloc_arr(frame_arena, entry_count, SortEntry);
+        SortEntry *baseline_b = alloc_arr(frame_arena, entry_count, SortEntry);
+        SortEntry32 *serial_a = alloc_arr(frame_arena, entry_count, SortEntry32);
+        SortEntry32 *serial_b = alloc_arr(frame_arena, entry_count, SortEntry32);
+        SortEntry32 *parallel_a = alloc_arr(frame_arena, entry_count, SortEntry32);
+        SortEntry32 *parallel_b = alloc_arr(frame_arena, entry_count, SortEntry32);
+        SortEntry32 *serial_sorted = 0;
+        SortEntry32 *parallel_sorted = 0;
+        f64 baseline_time = 0;
+        f64 serial_time = 0;
+        f64 parallel_time = 0;
+        for (u32 repeat_idx = 0; repeat_idx < BENCHMARK_RADIX_REPEATS; ++repeat_idx) {
+            for (u32 entry_idx = 0; entry_idx < entry_count; ++entry_idx) {
+                baseline_a[entry_idx].sort_key = sort_keys[entry_idx];
+                baseline_a[entry_idx].sort_index = entry_idx;
+                serial_a[entry_idx].sort_key = sort_key_to_u32(sort_keys[entry_idx]);
+                serial_a[entry_idx].sort_index = entry_idx;
+            }
+            memcpy(parallel_a, serial_a, sizeof(SortEntry32) * entry_count);
+            
+            f64 baseline_start = get_time();
+            radix_sort(baseline_a, baseline_b, entry_count);
+            baseline_time += get_time() - baseline_start;
+            f64 serial_start = get_time();
+            serial_sorted = radix_sort32(serial_a, serial_b, entry_count);
+            serial_time += get_time() - serial_start;
+            f64 parallel_start = get_time();
+            parallel_sorted = radix_sort32_parallel(parallel_a, parallel_b, entry_count, queue);
+            parallel_time += get_time() - parallel_start;
+        }
+        
+        u32 mismatch_count = 0;
+        for (u32 entry_idx = 0; entry_idx < entry_count; ++entry_idx) {
+            u32 baseline_index = (u32)baseline_a[entry_idx].sort_index;
+            mismatch_count += serial_sorted[entry_idx].sort_index != baseline_index || 
+                parallel_sorted[entry_idx].sort_index != baseline_index;
+        }
+        outf("Radix sort %u entries, %s keys: baseline %.2fus, serial %.2fus, parallel %.2fus (%u workers), %u mismatches\n",
+             entry_count, key_names[keys], baseline_time * 1000000.0 / BENCHMARK_RADIX_REPEATS,
+             serial_time * 1000000.0 / BENCHMARK_RADIX_REPEATS, parallel_time * 1000000.0 / BENCHMARK_RADIX_REPEATS, 
+             get_work_queue_worker_count(queue), mismatch_count);
+    }
+}
+
+enum {
+    BENCHMARK_ENTITY_COMMANDS_CREATE,
+    BENCHMARK_ENTITY_COMMANDS_UPDATE,
+    BENCHMARK_ENTITY_COMMANDS_SENTINEL,
+};
+
+// Job records commands of every job_count-th entity. Each entity takes its random numbers from its own 
+// entropy and uses its index as sort key, so recorded commands don't depend on how entities are split between jobs
+struct EntityCommandRecordJob {
+    EntityCommandBuffer *buffer;
+    EntityID *ids;
+    u32 entity_count;
+    u32 first_entity_idx;
+    u32 job_count;
+    u32 phase;
+    u32 seed;
+    f32 spread;
+};
+
+static void record_entity_commands_work(void *data) {
+    EntityCommandRecordJob *job = (EntityCommandRecordJob *)data;
+    for (u32 entity_idx = job->first_entity_idx; entity_idx < job->entity_count; entity_idx += job->job_count) {
+        Entropy entropy = { ((job->seed + entity_idx) * 2654435761u) | 1 };
+        if (job->phase == BENCHMARK_ENTITY_COMMANDS_CREATE) {
+            vec2 p = Vec2(random_bilateral(&entropy), random_bilateral(&entropy)) * job->spread;
+            Entity *entity = record_create_entity(job->buffer, entity_idx, p);
+            entity->kind = ENTITY_KIND_WORLD_OBJECT;
+            entity->world_object_kind = WORLD_OBJECT_KIND_TREE_FOREST;
+            entity->resource_interactions_left = entity_idx;
+            continue;
+        }
+        
+        // Other entity is changed by several entities, so order of their commands decides result
+        EntityID id = job->ids[entity_idx];
+        EntityID other_id = job->ids[random_int(&entropy, job->entity_count)];
+        vec2 p = Vec2(random_bilateral(&entropy), random_bilateral(&entropy)) * job->spread;
+        switch (random_int(&entropy, 4)) {
+            case 0: {
+                record_move_entity(job->buffer, entity_idx, id, p);
+            } break;
+            case 1: {
+                record_delete_entity(job->buffer, entity_idx, id);
+                record_move_entity(job->buffer, entity_idx, id, p);
+            } break;
+            case 2: {
+                RECORD_SET_ENTITY_FIELD(job->buffer, entity_idx, other_id, resource_interactions_left, entity_idx);
+                record_delete_entity(job->buffer, entity_idx, other_id);
+            } break;
+            case 3: {
+                record_move_entity(job->buffer, entity_idx, other_id, p);
+                Entity *entity = record_create_entity(job->buffer, entity_idx, p);
+                entity->kind = ENTITY_KIND_WORLD_OBJECT;
+                entity->world_object_kind = WORLD_OBJECT_KIND_GOLD_DEPOSIT;
+            } break;
+        }
+    }
+}
+
+// Entities are created and then moved, deleted and changed with commands recorded by job_count jobs on queue.
+// Returns hash of entities, chunk entity lists and influence of sim region after commands are applied,
+// ids are not hashed because they are different in each run
+static u32 get_entity_commands_hash(WorldState *world_state, MemoryArena *frame_arena, WorkQueue *queue, 
+                                    u32 entity_count, u32 job_count, u32 seed, u32 *alive_count) {
+    arena_clear(frame_arena);
+    SimRegion *sim = alloc_struct(frame_arena, SimRegion);
+    begin_sim(sim, frame_arena, world_state->world, BENCHMARK_ENTITY_COMMAND_CHUNK, BENCHMARK_ENTITY_COMMAND_CHUNK, 
+              world_state->anchor_radius);
+    EntityCommandRecordJob jobs[BENCHMARK_ENTITY_COMMAND_MAX_JOBS];
+    EntityCommandBuffer buffers[BENCHMARK_ENTITY_COMMAND_MAX_JOBS];
+    EntityID *ids = alloc_arr(frame_arena, entity_count, EntityID);
+    for (u32 phase = 0; phase < BENCHMARK_ENTITY_COMMANDS_SENTINEL; ++phase) {
+        for (u32 job_idx = 0; job_idx < job_count; ++job_idx) {
+            u32 job_entity_count = (entity_count + job_count - 1) / job_count;
+            EntityCommandRecordJob *job = jobs + job_idx;
+            job->buffer = buffers + job_idx;
+            job->ids = ids;
+            job->entity_count = entity_count;
+            job->first_entity_idx = job_idx;
+            job->job_count = job_count;
+            job->phase = phase;
+            job->seed = seed;
+            job->spread = (world_state->anchor_radius - 1) * CHUNK_SIZE;
+            init_entity_command_buffer(job->buffer, frame_arena, job_entity_count * 2, job_entity_count);
+            if (job_idx == 0 || !add_work_queue_entry(queue, record_entity_commands_work, job)) {
+                record_entity_commands_work(job);
+            }
+        }
+        complete_all_work(queue);
+        apply_entity_commands(sim, buffers, job_count);
+        // Created entities are applied in order of sort keys, which are entity indices
+        for (u32 entity_idx = 0; entity_idx < entity_count && phase == BENCHMARK_ENTITY_COMMANDS_CREATE; ++entity_idx) {
+            ids[entity_idx] = sim->entities[entity_idx].id;
+        }
+    }
+    
+    u32 hash = 0;
+    *alive_count = 0;
+    for (u32 entity_idx = 0; entity_idx < sim->entity_count; ++entity_idx) {
+        Entity *entity = sim->entities + entity_idx;
+        hash = crc32(&entity->p, sizeof(entity->p), hash);
+        hash = crc32(&entity->flags, sizeof(entity->flags), hash);
+        hash = crc32(&entity->world_object_kind, sizeof(entity->world_object_kind), hash);
+        hash = crc32(&entity->resource_interactions_left, sizeof(entity->resource_interactions_left), hash);
+        *alive_count += !(entity->flags & ENTITY_FLAG_IS_DELETED);
+    }
+    for (u32 chunk_idx = 0; chunk_idx < sim->chunks_count; ++chunk_idx) {
+        SimRegionChunk *chunk = sim->chunks + chunk_idx;
+        ITERATE(iter, iterate_chunk_entities(chunk)) {
+            u32 entity_idx = (u32)(get_entity_by_id(sim, *iter.ptr) - sim->entities);
+            hash = crc32(&entity_idx, sizeof(entity_idx), hash);
+        }
+        hash = crc32(&chunk_idx, sizeof(chunk_idx), hash);
+        hash = crc32(chunk->influence.raw, sizeof(chunk->influence.raw), hash);
+    }
+    // Sim region is not ended - it has only entities of check
+    return hash;
+}
+
+// Commands recorded by 1 job are reference, runs with more jobs have to end with the same sim region
+// Returns number of runs that were different from reference
+static u32 run_entity_commands_benchmark(WorldState *world_state, MemoryArena *frame_arena, WorkQueue *queue, 
+                                         u32 entity_count, u32 seed) {
+    // Chunks are generated when sim region takes them from world for the first time, and they are not 
+    // given back - so all runs start with the same empty region
+    arena_clear(frame_arena);
+    SimRegion *sim = alloc_struct(frame_arena, SimRegion);
+    begin_sim(sim, frame_arena, world_state->world, BENCHMARK_ENTITY_COMMAND_CHUNK, BENCHMARK_ENTITY_COMMAND_CHUNK, 
+              world_state->anchor_radius);
+    
+    u32 error_count = 0;
+    u32 reference_alive_count;
+    u32 reference_hash = get_entity_commands_hash(world_state, frame_arena, queue, entity_count, 1, seed, &reference_alive_count);
+    for (u32 job_count = 2; job_count <= BENCHMARK_ENTITY_COMMAND_MAX_JOBS; job_count *= 2) {
+        u32 alive_count;
+        u32 hash = get_entity_commands_hash(world_state, frame_arena, queue, entity_count, job_count, seed, &alive_count);
+        bool is_same = hash == reference_hash && alive_count == reference_alive_count;
+        error_count += !is_same;
+        outf("Entity commands of %u entities recorded by %u jobs: %u entities left, hash %08x %s\n", 
+             entity_count, job_count, alive_count, hash, is_same ? "matches" : "DIFFERS");
+    }
+    outf("Entity commands: %u entities left after 1 job, hash %08x, %u runs differ\n", 
+         reference_alive_count, reference_hash, error_count);
+    return error_count;
+}
+
+// Records of different frames are matched by debug name, which is unique string literal for each block
+struct BenchmarkRecord {
+    const char *debug_name;
+    const char *name;
+    u64 times_called;
+    u64 total_clocks;
+};
+
+#define BENCHMARK_MAX_RECORDS 256
+struct BenchmarkRecords {
+    u32 record_count;
+    BenchmarkRecord records[BENCHMARK_MAX_RECORDS];
+    u64 total_frame_clocks;
+};
+
+static void accumulate_debug_frame(BenchmarkRecords *records, DebugFrame *frame) {
+    records->total_frame_clocks += frame->end_clock - frame->begin_clock;
+    for (u32 frame_record_idx = 0; frame_record_idx < frame->records_count; ++frame_record_idx) {
+        DebugRecord *src = frame->records + frame_record_idx;
+        BenchmarkRecord *dst = 0;
+        for (u32 record_idx = 0; record_idx < records->record_count; ++record_idx) {
+            if (records->records[record_idx].debug_name == src->debug_name) {
+                dst = records->records + record_idx;
+                break;
+            }
+        }
+        if (!dst) {
+            assert(records->record_count < BENCHMARK_MAX_RECORDS);
+            dst = records->records + records->record_count++;
+            dst->debug_name = src->debug_name;
+            dst->name = src->name;
+        }
+        dst->times_called += src->times_called;
+        dst->total_clocks += src->total_clocks;
+    }
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 av = *(const f64 *)a;
+    f64 bv = *(const f64 *)b;
+    return (av > bv) - (av < bv);
+}
+
+static int compare_records(const void *a, const void *b) {
+    u64 av = ((const BenchmarkRecord *)a)->total_clocks;
+    u64 bv = ((const BenchmarkRecord *)b)->total_clocks;
+    return (av < bv) - (av > bv);
+}
+
+int main(int argc, char **argv) {
+    u32 frame_count = 600;
+    u32 radius = DEFAULT_ANCHOR_RADIUS;
+    u32 pawn_count = 64;
+    u32 order_count = 64;
+    u32 seed = 1;
+    u32 ai_anchor_count = 0;
+    f32 budget_ms = DEFAULT_SIM_BUDGET_MS;
+    u32 crowd_pawn_count = 0;
+    u32 building_count = 0;
+    u32 utility_pawn_count = 0;
+    u32 radix_entry_count = 0;
+    u32 orders_stress_count = 0;
+    u32 entity_command_count = 0;
+    u32 raster_frame_interval = 0;
+    const char *png_filename = 0;
+    for (int arg_idx = 1; arg_idx + 1 < argc; arg_idx += 2) {
+        const char *arg = argv[arg_idx];
+        u32 value = (u32)strtoul(argv[arg_idx + 1], 0, 10);
+        if (strcmp(arg, "-frames") == 0) {
+            frame_count = value;
+        } else if (strcmp(arg, "-radius") == 0) {
+            radius = value;
+        } else if (strcmp(arg, "-pawns") == 0) {
+            pawn_count = value;
+        } else if (strcmp(arg, "-orders") == 0) {
+            order_count = value;
+        } else if (strcmp(arg, "-seed") == 0) {
+            seed = value;
+        } else if (strcmp(arg, "-ai_anchors") == 0) {
+            ai_anchor_count = value;
+        } else if (strcmp(arg, "-budget_ms") == 0) {
+            budget_ms = (f32)atof(argv[arg_idx + 1]);
+        } else if (strcmp(arg, "-buildings") == 0) {
+            building_count = value;
+        } else if (strcmp(arg, "-crowd") == 0) {
+            crowd_pawn_count = value;
+        } else if (strcmp(arg, "-utility") == 0) {
+            utility_pawn_count = value;
+        } else if (strcmp(arg, "-radix") == 0) {
+            radix_entry_count = value;
+        } else if (strcmp(arg, "-orders_stress") == 0) {
+            orders_stress_count = value;
+        } else if (strcmp(arg, "-entity_commands") == 0) {
+            entity_command_count = value;
+        } else if (strcmp(arg, "-raster") == 0) {
+            raster_frame_interval = value;
+        } else if (strcmp(arg, "-png") == 0) {
+            png_filename = argv[arg_idx + 1];
+        } else {
+            outf("Unknown argument %s\n", arg);
+            return 1;
+        }
+    }
+    if (radius < 3 || !frame_count || !seed) {
+        outf("Radius must be at least 3, frame count and seed must not be 0\n");
+        return 1;
+    }
+
+    OS *os = os_init_headless();
+#if INTERNAL_BUILD
+    DebugState *debug_state = DEBUG_init();
+    BenchmarkRecords *records = (BenchmarkRecords *)os_alloc(sizeof(BenchmarkRecords));
+#endif
+    MemoryArena arena;
+    arena_init(&arena, os_alloc(MEGABYTES(512)), MEGABYTES(512));
+    MemoryArena frame_arena;
+    arena_init(&frame_arena, os_alloc(MEGABYTES(512)), MEGABYTES(512));
+    if (orders_stress_count) {
+        u32 error_count = run_orders_stress_benchmark(&arena, orders_stress_count, seed);
+        return error_count ? 1 : 0;
+    }
+
+    f64 init_start = get_time();
+    WorldState *world_state = alloc_struct(&arena, WorldState);
+    world_state_init(world_state, &arena, &frame_arena, os_get_work_queue(os), os_get_high_priority_work_queue(os));
+    world_state->anchor_radius = radius;
+    world_state->sim_budget_ms = budget_ms;
+    world_state->anchors[0].radius = radius;
+    prefetch_world_chunks(world_state->world, world_state->anchors[0].chunk_x, world_state->anchors[0].chunk_y,
+                          radius + WORLD_PREFETCH_CHUNK_MARGIN);
+    complete_world_generation(world_state->world);
+    arena_clear(&frame_arena);
+    if (crowd_pawn_count) {
+        run_crowd_benchmark(world_state, &frame_arena, crowd_pawn_count, seed);
+        return 0;
+    }
+    if (utility_pawn_count) {
+        run_utility_benchmark(world_state, &frame_arena, utility_pawn_count, seed);
+        return 0;
+    }
+    if (radix_entry_count) {
+        run_radix_benchmark(&frame_arena, os_get_high_priority_work_queue(os), radix_entry_count, seed);
+        return 0;
+    }
+    if (entity_command_count) {
+        // Entities of update phase can each create one more
+        if (entity_command_count * 2 + 1 >= get_chunk_count_for_radius(radius) * MAX_ENTITIES_PER_CHUNK) {
+            outf("Entity commands check can have at most %u entities with radius %u\n", 
+                 (get_chunk_count_for_radius(radius) * MAX_ENTITIES_PER_CHUNK - 2) / 2, radius);
+            return 1;
+        }
+        u32 error_count = run_entity_commands_benchmark(world_state, &frame_arena, os_get_high_priority_work_queue(os), 
+                                                        entity_command_count, seed);
+        return error_count ? 1 : 0;
+    }
+    if (!setup_scenario(world_state, pawn_count, order_count, building_count, seed)) {
+        return 1;
+    }
+    if (ai_anchor_count + 1 > MAX_ANCHORS) {
+        outf("At most %u ai anchors can be added\n", MAX_ANCHORS - 1);
+        return 1;
+    }
+    for (u32 anchor_idx = 0; anchor_idx < ai_anchor_count; ++anchor_idx) {
+        // Each anchor is one sim region width further than previous one, so regions don't overlap
+        // and entities are not simulated by two regions at once
+        i32 distance = (i32)((2 * radius + 1) * (anchor_idx + 1));
+        Anchor *player_anchor = world_state->anchors;
+        arena_clear(&frame_arena);
+        add_ai_anchor(world_state, player_anchor->chunk_x + distance, player_anchor->chunk_y, BENCHMARK_AI_ANCHOR_PAWNS);
+    }
+    outf("Init: %.2fms\n", (get_time() - init_start) * 1000.0);
+
+    Platform platform = {};
+    platform.display_size = Vec2(1280, 720);
+    RendererSettings renderer_settings = {};
+    renderer_settings.display_size = platform.display_size;
+    Renderer *renderer = renderer_init(renderer_settings);
+    renderer_set_work_queue(renderer, os_get_high_priority_work_queue(os));
+    Assets *assets = create_fake_assets(renderer, &frame_arena);
+    platform.mpos = platform.display_size * 0.5f;
+    platform.frame_dt = BENCHMARK_FRAME_DT;
+    // Player walks forward while camera turns, so it moves in circle of radius
+    // (player speed / turn speed) - around half of a chunk
+    platform.is_keys_down[KEY_W] = true;
+    platform.is_keys_down[KEY_Z] = true;
+    platform.mdelta = Vec2(2.0f, 0.0f);
+    InputManager input = create_input_manager(&platform);
+
+    f64 *frame_times = (f64 *)os_alloc(sizeof(f64) * frame_count);
+    u32 max_regions_behind = 0;
+    f32 max_region_lag = 0;
+    u32 raster_frame_count = 0;
+    f64 raster_time = 0;
+    f64 total_start = get_time();
+    u64 total_start_clock = __rdtsc();
+    for (u32 frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+        f64 frame_start = get_time();
+        FRAME_MARKER();
+        arena_clear(&frame_arena);
+        RendererCommands *commands = renderer_begin_frame(renderer);
+        update_and_render_world_state(world_state, &input, commands, assets);
+        frame_times[frame_idx] = get_time() - frame_start;
+        // Commands of frames that are not rasterized are just thrown away
+        if ((raster_frame_interval && (frame_idx + 1) % raster_frame_interval == 0) ||
+            (png_filename && frame_idx + 1 == frame_count)) {
+            f64 raster_start = get_time();
+            renderer_end_frame(renderer);
+            raster_time += get_time() - raster_start;
+            ++raster_frame_count;
+        }
+        if (world_state->sim_regions_behind > max_regions_behind) {
+            max_regions_behind = world_state->sim_regions_behind;
+        }
+        if (world_state->max_sim_region_lag > max_region_lag) {
+            max_region_lag = world_state->max_sim_region_lag;
+        }
+
+#if INTERNAL_BUILD
+        DEBUG_frame_end(debug_state);
+        // First marker only starts frame, so there is nothing collated yet
+        if (frame_idx) {
+            u32 last_frame_index = debug_state->frame_index ? debug_state->frame_index - 1 : DEBUG_MAX_FRAME_COUNT - 1;
+            accumulate_debug_frame(records, debug_state->frames + last_frame_index);
+        }
+#endif
+    }
+    f64 total_time = get_time() - total_start;
+    // Profiler records are in clocks, they are converted to time with clock rate measured over whole run
+    f64 clocks_per_ms = (f64)(__rdtsc() - total_start_clock) / (total_time * 1000.0);
+
+    outf("%u frames in %.3fs, %u chunks generated, wood %u, gold %u, hauls %u, buildings %u (%u built together), orders left %u\n",
+         frame_count, total_time, world_state->world->chunks_generated, world_state->wood_count, 
+         world_state->gold_count, world_state->haul_jobs_finished, world_state->buildings_finished, 
+         world_state->buildings_built_together, world_state->order_system.order_count);
+    outf("Sim budget %.2fms: at most %u regions behind, max lag %.1fms\n",
+         world_state->sim_budget_ms, max_regions_behind, max_region_lag * 1000.0f);
+    if (raster_frame_count) {
+        outf("Software renderer: %u frames rasterized, %.3fms per frame\n", raster_frame_count,
+             raster_time * 1000.0 / raster_frame_count);
+        outf("Texture atlas: %u layers, %.1f%% occupied, %u evictions\n", renderer->atlas.layer_count,
+             texture_atlas_get_occupancy(&renderer->atlas) * 100.0f, renderer->atlas.eviction_count);
+    }
+    if (png_filename) {
+        if (renderer_write_png(renderer, png_filename)) {
+            outf("Last frame written to %s\n", png_filename);
+        } else {
+            outf("Can't open %s\n", png_filename);
+        }
+    }
+#if INTERNAL_BUILD
+    qsort(records->records, records->record_count, sizeof(BenchmarkRecord), compare_records);
+    outf("%32s %14s %10s %12s %9s %7s\n", "Block", "Total clocks", "Calls", "Clocks/call", "ms/call", "Frame%");
+    for (u32 record_idx = 0; record_idx < records->record_count; ++record_idx) {
+        BenchmarkRecord *record = records->records + record_idx;
+        outf("%32s %14llu %10llu %12llu %9.4f %6.2f%%\n", record->name,
+             (unsigned long long)record->total_clocks, (unsigned long long)record->times_called,
+             (unsigned long long)(record->total_clocks / record->times_called),
+             (f64)record->total_clocks / record->times_called / clocks_per_ms,
+             (f64)record->total_clocks / records->total_frame_clocks * 100.0);
+    }
+#endif
+    qsort(frame_times, frame_count, sizeof(f64), compare_f64);
+    f64 percentiles[] = { 0.5, 0.9, 0.99, 1.0 };
+    outf("Frame time:");
+    for (u32 percentile_idx = 0; percentile_idx < ARRAY_SIZE(percentiles); ++percentile_idx) {
+        f64 percentile = percentiles[percentile_idx];
+        u32 frame_idx = (u32)(percentile * (frame_count - 1) + 0.5);
+        outf(" p%g %.3fms", percentile * 100.0, frame_times[frame_idx] * 1000.0);
+    }
+    outf("\n");
+    return 0;
+}
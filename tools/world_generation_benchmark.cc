@@ -0,0 +1,125 @@
+//
+// Measures world generation speed outside of the game
+// Generation is done on single thread, so result is chunks per second per core
+// Usage: world_generation_benchmark [chunks_side] [seed]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "world.hh"
+#include "noise.hh"
+
+#include "noise.cc"
+#include "world_generation.cc"
+
+static f64 get_seconds() {
+    return (f64)clock() / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv) {
+    i32 chunks_side = 256;
+    u32 seed = 123456789;
+    if (argc > 1) {
+        chunks_side = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        seed = (u32)strtoul(argv[2], 0, 10);
+    }
+
+    WorldGenerationJob *job = (WorldGenerationJob *)calloc(1, sizeof(WorldGenerationJob));
+    u64 entity_count = 0;
+    u64 kind_counts[WORLD_OBJECT_KIND_SENTINEL] = {};
+    // Chunks are generated around some point far from origin so sign and precision
+    // issues would show up
+    i32 origin = 1 << 20;
+    f64 start = get_seconds();
+    for (i32 chunk_y = 0; chunk_y < chunks_side; ++chunk_y) {
+        for (i32 chunk_x = 0; chunk_x < chunks_side; ++chunk_x) {
+            job->seed = seed;
+            job->chunk_x = origin + chunk_x - chunks_side / 2;
+            job->chunk_y = origin + chunk_y - chunks_side / 2;
+            generate_world_chunk(job);
+            entity_count += job->entity_count;
+            for (u32 entity_idx = 0; entity_idx < job->entity_count; ++entity_idx) {
+                ++kind_counts[job->entities[entity_idx].world_object_kind];
+            }
+        }
+    }
+    f64 generation_time = get_seconds() - start;
+    u64 chunk_count = (u64)chunks_side * chunks_side;
+    // u64 is unsigned long on Linux, so it is cast to match %llu everywhere
+    printf("Generated %llu chunks in %.3fs: %.0f chunks/sec/core, %.2f entities per chunk\n",
+        (unsigned long long)chunk_count, generation_time, chunk_count / generation_time, (f64)entity_count / chunk_count);
+    printf("Forest %llu, desert %llu, jungle %llu, gold %llu\n",
+        (unsigned long long)kind_counts[WORLD_OBJECT_KIND_TREE_FOREST], (unsigned long long)kind_counts[WORLD_OBJECT_KIND_TREE_DESERT],
+        (unsigned long long)kind_counts[WORLD_OBJECT_KIND_TREE_JUNGLE], (unsigned long long)kind_counts[WORLD_OBJECT_KIND_GOLD_DEPOSIT]);
+
+    // Noise kernels on their own, scalar against 4x and 8x when it is compiled in
+    i32 sample_side = 1024;
+    u64 sample_count = (u64)sample_side * sample_side;
+    f32 scalar_sum = 0;
+    start = get_seconds();
+    for (i32 y = 0; y < sample_side; ++y) {
+        for (i32 x = 0; x < sample_side; ++x) {
+            scalar_sum += value_fbm(seed, x, y, 7, 3);
+        }
+    }
+    f64 scalar_time = get_seconds() - start;
+
+    f32_4x value_sum = F32_4x_zero();
+    start = get_seconds();
+    for (i32 y = 0; y < sample_side; ++y) {
+        for (i32 x = 0; x < sample_side; x += 4) {
+            value_sum += value_fbm_4x(seed, I32_4x(x, x + 1, x + 2, x + 3), I32_4x(y), 7, 3);
+        }
+    }
+    f64 value_time = get_seconds() - start;
+
+    f32_4x simplex_sum = F32_4x_zero();
+    start = get_seconds();
+    for (i32 y = 0; y < sample_side; ++y) {
+        for (i32 x = 0; x < sample_side; x += 4) {
+            simplex_sum += simplex_fbm_4x(seed, I32_4x(x, x + 1, x + 2, x + 3), I32_4x(y), 7, 3);
+        }
+    }
+    f64 simplex_time = get_seconds() - start;
+#if SIMD_8X
+    f32_8x value_sum_8x = F32_8x_zero();
+    start = get_seconds();
+    for (i32 y = 0; y < sample_side; ++y) {
+        for (i32 x = 0; x < sample_side; x += 8) {
+            value_sum_8x += value_fbm_8x(seed, I32_8x(x, x + 1, x + 2, x + 3, x + 4, x + 5, x + 6, x + 7), I32_8x(y), 7, 3);
+        }
+    }
+    f64 value_time_8x = get_seconds() - start;
+
+    f32_8x simplex_sum_8x = F32_8x_zero();
+    start = get_seconds();
+    for (i32 y = 0; y < sample_side; ++y) {
+        for (i32 x = 0; x < sample_side; x += 8) {
+            simplex_sum_8x += simplex_fbm_8x(seed, I32_8x(x, x + 1, x + 2, x + 3, x + 4, x + 5, x + 6, x + 7), I32_8x(y), 7, 3);
+        }
+    }
+    f64 simplex_time_8x = get_seconds() - start;
+#endif
+    // Sums are printed so compiler does not throw away the loops
+    printf("Value fBm scalar: %.1f Msamples/sec (%f)\n", sample_count / scalar_time * 1e-6, scalar_sum);
+    printf("Value fBm 4x:     %.1f Msamples/sec (%f)\n", sample_count / value_time * 1e-6,
+        value_sum.e[0] + value_sum.e[1] + value_sum.e[2] + value_sum.e[3]);
+    printf("Simplex fBm 4x:   %.1f Msamples/sec (%f)\n", sample_count / simplex_time * 1e-6,
+        simplex_sum.e[0] + simplex_sum.e[1] + simplex_sum.e[2] + simplex_sum.e[3]);
+#if SIMD_8X
+    f32 value_total_8x = 0;
+    f32 simplex_total_8x = 0;
+    for (u32 lane = 0; lane < 8; ++lane) {
+        value_total_8x += value_sum_8x.e[lane];
+        simplex_total_8x += simplex_sum_8x.e[lane];
+    }
+    printf("Value fBm 8x:     %.1f Msamples/sec (%f)\n", sample_count / value_time_8x * 1e-6, value_total_8x);
+    printf("Simplex fBm 8x:   %.1f Msamples/sec (%f)\n", sample_count / simplex_time_8x * 1e-6, simplex_total_8x);
+#else
+    printf("8x kernels are not compiled in, build with -mavx2 to measure them\n");
+#endif
+    return 0;
+}